@@ -0,0 +1,149 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <memory>
+#include <sstream>
+
+#include <IRBuilder.h>
+#include <IRParser.h>
+#include <BinaryIR.h>
+
+
+// Context with `functionCount` functions, each is a chain of `loopCount` loops with arithmetic, memory and calls
+static void BuildModule(VMIR::IRContext& IrContext, size_t functionCount, size_t loopCount) {
+    VMIR::Function* Scale = IrContext.CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "Scale");
+    VMIR::BasicBlock* Scale_BB_1 = IrContext.CreateBasicBlock(Scale, "Scale_BB_1");
+    Scale->SetEntryBasicBlock(Scale_BB_1);
+    VMIR::Value* scaled = IrContext.CreateValue(VMIR::ValueType::Uint64);
+    IrContext.CreateMul(Scale_BB_1, Scale->GetArg(0), IrContext.GetOrCreateValueWithData(uint64_t(3)), scaled);
+    IrContext.CreateRet(Scale_BB_1, scaled);
+
+    for (size_t f = 0; f < functionCount; ++f) {
+        const std::string name = "Func_" + std::to_string(f);
+        VMIR::Function* Func = IrContext.CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, name);
+        VMIR::BasicBlock* entry = IrContext.CreateBasicBlock(Func, name + "_Entry");
+        Func->SetEntryBasicBlock(entry);
+
+        VMIR::Value* ptr = IrContext.CreateValue(VMIR::ValueType::Pointer);
+        IrContext.CreateAlloc(entry, ptr, VMIR::ValueType::Uint64);
+        IrContext.CreateNullCheck(entry, ptr);
+
+        VMIR::Value* acc = Func->GetArg(0);
+        VMIR::BasicBlock* pred = entry;
+        for (size_t l = 0; l < loopCount; ++l) {
+            VMIR::BasicBlock* header = IrContext.CreateBasicBlock(Func, name + "_Loop_" + std::to_string(l));
+            VMIR::BasicBlock* exit = IrContext.CreateBasicBlock(Func, name + "_Exit_" + std::to_string(l));
+            IrContext.CreateJump(pred, header);
+
+            VMIR::Value* counter = IrContext.CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* shifted = IrContext.CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* loaded = IrContext.CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* called = IrContext.CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* next = IrContext.CreateValue(VMIR::ValueType::Uint64);
+
+            IrContext.CreatePhi(header, {acc, next}, counter);
+            IrContext.CreateShl(header, counter, IrContext.GetOrCreateValueWithData(uint64_t(l % 64)), shifted);
+            IrContext.CreateStore(header, ptr, shifted);
+            IrContext.CreateLoad(header, ptr, loaded);
+            IrContext.CreateCall(header, Scale, called, {loaded});
+            IrContext.CreateAdd(header, called, IrContext.GetOrCreateValueWithData(uint64_t(f)), next);
+            IrContext.CreateBne(header, next, Func->GetArg(0), header, exit);
+
+            acc = next;
+            pred = exit;
+        }
+        IrContext.CreateRet(pred, acc);
+    }
+}
+
+// Text and binary forms of the same module
+struct ModuleData {
+    std::string text{};
+    std::vector<uint64_t> binary{};   // 8-byte words keep the records aligned
+    size_t binarySize{0};
+
+    std::string_view GetBinary() const { return {reinterpret_cast<const char*>(binary.data()), binarySize}; }
+};
+
+static ModuleData BuildModuleData(size_t functionCount) {
+    VMIR::IRContext IrContext{};
+    BuildModule(IrContext, functionCount, 16);
+
+    ModuleData data{};
+    std::ostringstream text{};
+    IrContext.PrintIR(text);
+    data.text = text.str();
+
+    std::ostringstream binary{};
+    VMIR::BinaryIRWriter writer{&IrContext};
+    writer.Write(binary);
+    const std::string bytes = binary.str();
+    data.binarySize = bytes.size();
+    data.binary.resize((bytes.size() + 7) / 8);
+    std::memcpy(data.binary.data(), bytes.data(), bytes.size());
+    return data;
+}
+
+
+// Text of the same module for comparison with the binary loading
+static void BM_ParseText(benchmark::State& state) {
+    const ModuleData data = BuildModuleData(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto IrContext = std::make_unique<VMIR::IRContext>();
+        VMIR::IRParser parser{IrContext.get()};
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(parser.Parse(data.text));
+
+        state.PauseTiming();
+        IrContext.reset();
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_ParseText)->Arg(16)->Arg(256)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+
+// Every function of the module is materialized
+static void BM_LoadBinary(benchmark::State& state) {
+    const ModuleData data = BuildModuleData(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto IrContext = std::make_unique<VMIR::IRContext>();
+        state.ResumeTiming();
+
+        VMIR::BinaryIRModule module{IrContext.get()};
+        benchmark::DoNotOptimize(module.Load(data.GetBinary()));
+        benchmark::DoNotOptimize(module.MaterializeAll());
+
+        state.PauseTiming();
+        IrContext.reset();
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_LoadBinary)->Arg(16)->Arg(256)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+
+// Only one function of the module is requested, the rest of the cost is the lookup in the function table
+static void BM_LoadOneFunction(benchmark::State& state) {
+    const ModuleData data = BuildModuleData(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto IrContext = std::make_unique<VMIR::IRContext>();
+        state.ResumeTiming();
+
+        VMIR::BinaryIRModule module{IrContext.get()};
+        benchmark::DoNotOptimize(module.Load(data.GetBinary()));
+        benchmark::DoNotOptimize(module.GetFunction("Func_0"));
+
+        state.PauseTiming();
+        IrContext.reset();
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_LoadOneFunction)->Arg(16)->Arg(256)->Arg(2048)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,240 @@
+#ifndef BENCH_IR_GENERATORS_H
+#define BENCH_IR_GENERATORS_H
+
+#include <string>
+
+#include <IRBuilder.h>
+
+// Synthetic functions of a given size for benchmarks. Every generated function is valid IR with reducible loops,
+// and has something for each pass to do: constants to fold, peepholes, repeated checks and calls to inline
+namespace IRGenerators {
+
+enum class Shape {
+    StraightLine,
+    LoopNest,
+    WideDiamond,
+    ManyCalls,
+    RegisterPressure,
+};
+
+static inline const char* ShapeToStr(Shape shape) {
+    switch (shape) {
+        default:
+        case Shape::StraightLine:       return "StraightLine";
+        case Shape::LoopNest:           return "LoopNest";
+        case Shape::WideDiamond:        return "WideDiamond";
+        case Shape::ManyCalls:          return "ManyCalls";
+        case Shape::RegisterPressure:   return "RegisterPressure";
+    }
+}
+
+template <typename T>
+static inline VMIR::Value* Const(VMIR::IRContext* IrContext, T value) {
+    return IrContext->GetOrCreateValueWithData(value);
+}
+
+
+// One block of `instCount` arithmetic instructions, each fifth one folds and each fifth one is a peephole
+static inline VMIR::Function* BuildStraightLine(VMIR::IRContext* IrContext, size_t instCount) {
+    VMIR::Function* Func = IrContext->CreateFunction(VMIR::ValueType::Int64, {VMIR::ValueType::Int64, VMIR::ValueType::Int64}, "StraightLine");
+    VMIR::BasicBlock* bb = IrContext->CreateBasicBlock(Func, "StraightLine_BB");
+    Func->SetEntryBasicBlock(bb);
+
+    VMIR::Value* acc = Func->GetArg(0);
+    for (size_t i = 0; i < instCount; ++i) {
+        VMIR::Value* out = IrContext->CreateValue(VMIR::ValueType::Int64);
+        switch (i % 5) {
+            default:
+            case 0: IrContext->CreateAdd(bb, Const(IrContext, int64_t(i)), Const(IrContext, int64_t(7)), out); break;
+            case 1: IrContext->CreateMul(bb, acc, Func->GetArg(1), out); break;
+            case 2: IrContext->CreateAdd(bb, acc, acc, out); break;
+            case 3: IrContext->CreateXor(bb, acc, Const(IrContext, int64_t(i)), out); break;
+            case 4: IrContext->CreateSub(bb, acc, Func->GetArg(0), out); break;
+        }
+        // Folded constants are added to the chain, so they have users
+        if (i % 5 == 0) {
+            VMIR::Value* sum = IrContext->CreateValue(VMIR::ValueType::Int64);
+            IrContext->CreateAdd(bb, acc, out, sum);
+            out = sum;
+        }
+        acc = out;
+    }
+    IrContext->CreateRet(bb, acc);
+
+    return Func;
+}
+
+
+// `depth` loops nested into each other. Every level checks the same pointer and updates memory
+static inline VMIR::Function* BuildLoopNest(VMIR::IRContext* IrContext, size_t depth) {
+    VMIR::Function* Func = IrContext->CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "LoopNest");
+    VMIR::BasicBlock* entry = IrContext->CreateBasicBlock(Func, "LoopNest_Entry");
+    Func->SetEntryBasicBlock(entry);
+
+    VMIR::Value* ptr = IrContext->CreateValue(VMIR::ValueType::Pointer);
+    IrContext->CreateAlloc(entry, ptr, VMIR::ValueType::Uint64);
+
+    std::vector<VMIR::BasicBlock*> headers(depth);
+    std::vector<VMIR::BasicBlock*> latches(depth);
+    std::vector<VMIR::Value*> counters(depth);
+    std::vector<VMIR::Value*> nexts(depth);
+    for (size_t l = 0; l < depth; ++l) {
+        headers[l] = IrContext->CreateBasicBlock(Func, "Header_" + std::to_string(l));
+        counters[l] = IrContext->CreateValue(VMIR::ValueType::Uint64);
+        nexts[l] = IrContext->CreateValue(VMIR::ValueType::Uint64);
+    }
+    for (size_t l = depth; l-- > 0;) {
+        latches[l] = IrContext->CreateBasicBlock(Func, "Latch_" + std::to_string(l));
+    }
+    VMIR::BasicBlock* exit = IrContext->CreateBasicBlock(Func, "LoopNest_Exit");
+
+    // Headers are entered from the outer level first, so that edge is the first predecessor
+    IrContext->CreateJump(entry, headers.empty() ? exit : headers[0]);
+    for (size_t l = 0; l < depth; ++l) {
+        VMIR::BasicBlock* header = headers[l];
+        IrContext->CreatePhi(header, {Const(IrContext, uint64_t(0)), nexts[l]}, counters[l]);
+        IrContext->CreateNullCheck(header, ptr);
+
+        VMIR::Value* loaded = IrContext->CreateValue(VMIR::ValueType::Uint64);
+        VMIR::Value* stored = IrContext->CreateValue(VMIR::ValueType::Uint64);
+        IrContext->CreateLoad(header, ptr, loaded);
+        IrContext->CreateAdd(header, loaded, counters[l], stored);
+        IrContext->CreateStore(header, ptr, stored);
+        IrContext->CreateJump(header, l + 1 < depth ? headers[l + 1] : latches[l]);
+    }
+    for (size_t l = depth; l-- > 0;) {
+        VMIR::BasicBlock* latch = latches[l];
+        IrContext->CreateAdd(latch, counters[l], Const(IrContext, uint64_t(1)), nexts[l]);
+        IrContext->CreateBlt(latch, nexts[l], Func->GetArg(0), headers[l], l > 0 ? latches[l - 1] : exit);
+    }
+
+    VMIR::Value* result = IrContext->CreateValue(VMIR::ValueType::Uint64);
+    IrContext->CreateLoad(exit, ptr, result);
+    IrContext->CreateRet(exit, result);
+
+    return Func;
+}
+
+
+// Cascade of `width - 1` branches selects one of `width` arms, which all meet in a single phi
+static inline VMIR::Function* BuildWideDiamond(VMIR::IRContext* IrContext, size_t width) {
+    VMIR::Function* Func = IrContext->CreateFunction(VMIR::ValueType::Int32, {VMIR::ValueType::Int32}, "WideDiamond");
+    width = std::max<size_t>(width, 2);
+
+    std::vector<VMIR::BasicBlock*> tests(width - 1);
+    std::vector<VMIR::BasicBlock*> arms(width);
+    for (size_t i = 0; i + 1 < width; ++i) {
+        tests[i] = IrContext->CreateBasicBlock(Func, "Test_" + std::to_string(i));
+    }
+    for (size_t i = 0; i < width; ++i) {
+        arms[i] = IrContext->CreateBasicBlock(Func, "Arm_" + std::to_string(i));
+    }
+    VMIR::BasicBlock* join = IrContext->CreateBasicBlock(Func, "Join");
+    Func->SetEntryBasicBlock(tests[0]);
+
+    for (size_t i = 0; i + 1 < width; ++i) {
+        VMIR::BasicBlock* falseBB = i + 2 < width ? tests[i + 1] : arms[width - 1];
+        IrContext->CreateBeq(tests[i], Func->GetArg(0), Const(IrContext, static_cast<int32_t>(i)), arms[i], falseBB);
+    }
+
+    std::vector<VMIR::Value*> inputs(width);
+    for (size_t i = 0; i < width; ++i) {
+        inputs[i] = IrContext->CreateValue(VMIR::ValueType::Int32);
+        IrContext->CreateMul(arms[i], Func->GetArg(0), Const(IrContext, static_cast<int32_t>(i + 1)), inputs[i]);
+        IrContext->CreateJump(arms[i], join);
+    }
+
+    VMIR::Value* result = IrContext->CreateValue(VMIR::ValueType::Int32);
+    IrContext->CreatePhi(join, inputs, result);
+    IrContext->CreateRet(join, result);
+
+    return Func;
+}
+
+
+// Chain of `callCount` calls to a small callee, which static inlining replaces with its body
+static inline VMIR::Function* BuildManyCalls(VMIR::IRContext* IrContext, size_t callCount) {
+    VMIR::Function* Callee = IrContext->CreateFunction(VMIR::ValueType::Int64, {VMIR::ValueType::Int64}, "Callee");
+    VMIR::BasicBlock* Callee_BB = IrContext->CreateBasicBlock(Callee, "Callee_BB");
+    Callee->SetEntryBasicBlock(Callee_BB);
+    VMIR::Value* scaled = IrContext->CreateValue(VMIR::ValueType::Int64);
+    IrContext->CreateMul(Callee_BB, Callee->GetArg(0), Const(IrContext, int64_t(3)), scaled);
+    IrContext->CreateRet(Callee_BB, scaled);
+
+    VMIR::Function* Func = IrContext->CreateFunction(VMIR::ValueType::Int64, {VMIR::ValueType::Int64}, "ManyCalls");
+    VMIR::BasicBlock* bb = IrContext->CreateBasicBlock(Func, "ManyCalls_BB");
+    Func->SetEntryBasicBlock(bb);
+
+    VMIR::Value* acc = Func->GetArg(0);
+    for (size_t i = 0; i < callCount; ++i) {
+        VMIR::Value* called = IrContext->CreateValue(VMIR::ValueType::Int64);
+        VMIR::Value* sum = IrContext->CreateValue(VMIR::ValueType::Int64);
+        IrContext->CreateCall(bb, Callee, called, {acc});
+        IrContext->CreateAdd(bb, called, Func->GetArg(0), sum);
+        acc = sum;
+    }
+    IrContext->CreateRet(bb, acc);
+
+    return Func;
+}
+
+
+// Loop body defines `valueCount` integer and `valueCount` floating point values and uses them in reverse order,
+// so all of them are live at once
+static inline VMIR::Function* BuildRegisterPressure(VMIR::IRContext* IrContext, size_t valueCount) {
+    VMIR::Function* Func = IrContext->CreateFunction(VMIR::ValueType::Int64, {VMIR::ValueType::Int64, VMIR::ValueType::Float64}, "RegisterPressure");
+    VMIR::BasicBlock* entry = IrContext->CreateBasicBlock(Func, "Pressure_Entry");
+    VMIR::BasicBlock* loop = IrContext->CreateBasicBlock(Func, "Pressure_Loop");
+    VMIR::BasicBlock* exit = IrContext->CreateBasicBlock(Func, "Pressure_Exit");
+    Func->SetEntryBasicBlock(entry);
+
+    VMIR::Value* ptr = IrContext->CreateValue(VMIR::ValueType::Pointer);
+    IrContext->CreateAlloc(entry, ptr, VMIR::ValueType::Float64);
+    IrContext->CreateJump(entry, loop);
+
+    VMIR::Value* acc = IrContext->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* next = IrContext->CreateValue(VMIR::ValueType::Int64);
+    IrContext->CreatePhi(loop, {Func->GetArg(0), next}, acc);
+
+    std::vector<VMIR::Value*> ints(valueCount);
+    std::vector<VMIR::Value*> floats(valueCount);
+    for (size_t i = 0; i < valueCount; ++i) {
+        ints[i] = IrContext->CreateValue(VMIR::ValueType::Int64);
+        floats[i] = IrContext->CreateValue(VMIR::ValueType::Float64);
+        IrContext->CreateAdd(loop, acc, Const(IrContext, static_cast<int64_t>(i)), ints[i]);
+        IrContext->CreateMul(loop, Func->GetArg(1), Const(IrContext, static_cast<double>(i)), floats[i]);
+    }
+
+    VMIR::Value* intSum = acc;
+    VMIR::Value* floatSum = Func->GetArg(1);
+    for (size_t i = valueCount; i-- > 0;) {
+        VMIR::Value* newIntSum = IrContext->CreateValue(VMIR::ValueType::Int64);
+        VMIR::Value* newFloatSum = IrContext->CreateValue(VMIR::ValueType::Float64);
+        IrContext->CreateXor(loop, intSum, ints[i], newIntSum);
+        IrContext->CreateAdd(loop, floatSum, floats[i], newFloatSum);
+        intSum = newIntSum;
+        floatSum = newFloatSum;
+    }
+    IrContext->CreateStore(loop, ptr, floatSum);
+    IrContext->CreateMv(loop, intSum, next);
+    IrContext->CreateBne(loop, next, Const(IrContext, int64_t(0)), loop, exit);
+    IrContext->CreateRet(exit, next);
+
+    return Func;
+}
+
+
+static inline VMIR::Function* Build(VMIR::IRContext* IrContext, Shape shape, size_t size) {
+    switch (shape) {
+        default:
+        case Shape::StraightLine:       return BuildStraightLine(IrContext, size);
+        case Shape::LoopNest:           return BuildLoopNest(IrContext, size);
+        case Shape::WideDiamond:        return BuildWideDiamond(IrContext, size);
+        case Shape::ManyCalls:          return BuildManyCalls(IrContext, size);
+        case Shape::RegisterPressure:   return BuildRegisterPressure(IrContext, size);
+    }
+}
+
+}   // namespace IRGenerators
+
+#endif  // BENCH_IR_GENERATORS_H
@@ -0,0 +1,138 @@
+#include <benchmark/benchmark.h>
+
+#include <functional>
+#include <memory>
+
+#include <IRGenerators.h>
+#include <IRBuilder.h>
+#include <ControlFlowGraph.h>
+#include <LoopAnalyzer.h>
+#include <LivenessAnalyzer.h>
+#include <RegisterAllocator.h>
+#include <ConstantFoldingPass.h>
+#include <PeepholesPass.h>
+#include <CheckEliminationPass.h>
+#include <StaticInliningPass.h>
+
+using IRGenerators::Shape;
+
+/*
+    Every analysis and pass over every shape of generated functions. Each pair is a separate family,
+    so Google Benchmark fits its own complexity over the number of instructions and prints it as <name>_BigO
+*/
+
+static constexpr Shape kShapes[] = {
+    Shape::StraightLine, Shape::LoopNest, Shape::WideDiamond, Shape::ManyCalls, Shape::RegisterPressure
+};
+
+static constexpr uint32_t kGPRegisterCount = 8;
+static constexpr uint32_t kFPRegisterCount = 8;
+
+
+static int64_t GetInstructionCount(VMIR::Function* func) {
+    return static_cast<int64_t>(func->GetInstructionCount());
+}
+
+// Function is built once and analyzed in every iteration, analyses below are computed beforehand
+using AnalysisBody = std::function<void(VMIR::IRContext*, VMIR::ControlFlowGraph*)>;
+
+static void RunAnalysis(benchmark::State& state, Shape shape, const AnalysisBody& prepare, const AnalysisBody& body) {
+    VMIR::IRContext IrContext{};
+    VMIR::Function* Func = IRGenerators::Build(&IrContext, shape, static_cast<size_t>(state.range(0)));
+    if (!Func->IsValid()) {
+        state.SkipWithError("generated function is not valid");
+        return;
+    }
+
+    VMIR::ControlFlowGraph* cfg = IrContext.GetOrCreateControlFlowGraph(Func);
+    prepare(&IrContext, cfg);
+    for (auto _ : state) {
+        body(&IrContext, cfg);
+    }
+
+    state.SetComplexityN(GetInstructionCount(Func));
+    state.SetItemsProcessed(state.iterations() * GetInstructionCount(Func));
+}
+
+// Passes change the function, so every iteration gets a new one. Building it is not measured
+static void RunPass(benchmark::State& state, Shape shape, const std::function<std::unique_ptr<VMIR::Pass>()>& createPass) {
+    int64_t instCount = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto IrContext = std::make_unique<VMIR::IRContext>();
+        VMIR::Function* Func = IRGenerators::Build(IrContext.get(), shape, static_cast<size_t>(state.range(0)));
+        instCount = GetInstructionCount(Func);
+        std::unique_ptr<VMIR::Pass> pass = createPass();
+        state.ResumeTiming();
+
+        pass->Run(Func);
+
+        state.PauseTiming();
+        IrContext.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetComplexityN(instCount);
+    state.SetItemsProcessed(state.iterations() * instCount);
+}
+
+
+static void RegisterAnalysis(const std::string& name, Shape shape, AnalysisBody prepare, AnalysisBody body) {
+    benchmark::RegisterBenchmark((name + "/" + IRGenerators::ShapeToStr(shape)).c_str(),
+        [shape, prepare, body](benchmark::State& state) { RunAnalysis(state, shape, prepare, body); })
+        ->RangeMultiplier(4)->Range(16, 1024)->Complexity()->Unit(benchmark::kMicrosecond);
+}
+
+template <typename PassType>
+static void RegisterPass(const std::string& name, Shape shape) {
+    benchmark::RegisterBenchmark((name + "/" + IRGenerators::ShapeToStr(shape)).c_str(),
+        [shape](benchmark::State& state) { RunPass(state, shape, [] { return std::make_unique<PassType>(); }); })
+        ->RangeMultiplier(4)->Range(16, 1024)->Complexity()->Unit(benchmark::kMicrosecond);
+}
+
+
+static void RegisterAll() {
+    auto nothing = [](VMIR::IRContext*, VMIR::ControlFlowGraph*) {};
+    auto buildDomTree = [](VMIR::IRContext*, VMIR::ControlFlowGraph* cfg) { cfg->BuildDominatorTree(); };
+    auto buildLoopTree = [](VMIR::IRContext* IrContext, VMIR::ControlFlowGraph* cfg) {
+        IrContext->GetOrCreateLoopAnalyzer(cfg)->BuildLoopTree();
+    };
+    auto performLiveness = [](VMIR::IRContext* IrContext, VMIR::ControlFlowGraph* cfg) {
+        IrContext->GetOrCreateLivenessAnalyzer(cfg)->PerformLivenessAnalysis();
+    };
+
+    for (Shape shape : kShapes) {
+        RegisterAnalysis("DominatorTree", shape, nothing, buildDomTree);
+
+        RegisterAnalysis("LoopTree", shape, buildDomTree, [](VMIR::IRContext* IrContext, VMIR::ControlFlowGraph* cfg) {
+            VMIR::LoopAnalyzer* loopAnalyzer = IrContext->GetOrCreateLoopAnalyzer(cfg);
+            loopAnalyzer->Invalidate();
+            loopAnalyzer->BuildLoopTree();
+        });
+
+        RegisterAnalysis("Liveness", shape, buildLoopTree, performLiveness);
+
+        // Allocator keeps its free registers between runs, so every iteration uses a new one over the same liveness
+        RegisterAnalysis("LinearScan", shape, performLiveness, [](VMIR::IRContext* IrContext, VMIR::ControlFlowGraph* cfg) {
+            VMIR::RegisterAllocator allocator{IrContext, cfg, kGPRegisterCount, kFPRegisterCount};
+            benchmark::DoNotOptimize(allocator.PerformRegisterAllocation());
+        });
+
+        RegisterPass<VMIR::ConstantFoldingPass>("ConstantFolding", shape);
+        RegisterPass<VMIR::PeepholesPass>("Peepholes", shape);
+        RegisterPass<VMIR::CheckEliminationPass>("CheckElimination", shape);
+        RegisterPass<VMIR::StaticInliningPass>("StaticInlining", shape);
+    }
+}
+
+
+int main(int argc, char** argv) {
+    RegisterAll();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+
+#include <IRBuilder.h>
+#include <ConstantFoldingPass.h>
+
+
+// Every instruction folds into a brand new constant, so the constant pool grows with the function
+static VMIR::Function* BuildFoldableFunction(VMIR::IRBuilder* IrBuilder, size_t instCount) {
+    VMIR::Function* Func = IrBuilder->CreateFunction(VMIR::ValueType::Int64, "Foldable");
+
+    VMIR::BasicBlock* bb = IrBuilder->CreateBasicBlock(Func);
+    Func->SetEntryBasicBlock(bb);
+
+    VMIR::Value* three = IrBuilder->CreateValue(int64_t(3));
+    VMIR::Value* sum = IrBuilder->CreateValue(int64_t(0));
+    for (size_t i = 0; i < instCount; ++i) {
+        VMIR::Value* lhs = IrBuilder->CreateValue(static_cast<int64_t>(i));
+        VMIR::Value* mul = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+        VMIR::Value* add = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+
+        IrBuilder->CreateMul(bb, lhs, three, mul);
+        IrBuilder->CreateAdd(bb, mul, sum, add);
+        sum = add;
+    }
+    IrBuilder->CreateRet(bb, sum);
+
+    return Func;
+}
+
+
+static void BM_ConstantFolding(benchmark::State& state) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    const size_t instCount = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        VMIR::Function* Func = BuildFoldableFunction(IrBuilder, instCount);
+        state.ResumeTiming();
+
+        VMIR::ConstantFoldingPass pass{};
+        pass.Run(Func);
+
+        state.PauseTiming();
+        IrBuilder->Cleanup();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(instCount * 2));
+}
+BENCHMARK(BM_ConstantFolding)->RangeMultiplier(8)->Range(8, 8 << 9)->Unit(benchmark::kMicrosecond);
+
+
+BENCHMARK_MAIN();
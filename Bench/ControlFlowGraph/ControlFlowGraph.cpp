@@ -0,0 +1,143 @@
+#include <benchmark/benchmark.h>
+
+#include <IRBuilder.h>
+
+
+// Chain of `diamondCount` diamonds: head -> {left, right} -> join, and join branches
+// either back to its head or forward to the head of the next diamond
+static VMIR::Function* BuildDiamondChain(VMIR::IRBuilder* IrBuilder, size_t diamondCount) {
+    VMIR::Function* Func = IrBuilder->CreateFunction("DiamondChain");
+
+    VMIR::BasicBlock* head = IrBuilder->CreateBasicBlock(Func);
+    Func->SetEntryBasicBlock(head);
+    for (size_t i = 0; i < diamondCount; ++i) {
+        VMIR::BasicBlock* left = IrBuilder->CreateBasicBlock(Func);
+        VMIR::BasicBlock* right = IrBuilder->CreateBasicBlock(Func);
+        VMIR::BasicBlock* join = IrBuilder->CreateBasicBlock(Func);
+        VMIR::BasicBlock* next = IrBuilder->CreateBasicBlock(Func);
+
+        IrBuilder->CreateBeq(head, nullptr, nullptr, left, right);
+        IrBuilder->CreateJump(left, join);
+        IrBuilder->CreateJump(right, join);
+        IrBuilder->CreateBeq(join, nullptr, nullptr, head, next);
+        head = next;
+    }
+    IrBuilder->CreateRet(head);
+
+    return Func;
+}
+
+
+// Depth-first traversal of the whole graph
+static void BM_DFS(benchmark::State& state) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    const size_t diamondCount = static_cast<size_t>(state.range(0));
+    VMIR::Function* Func = BuildDiamondChain(IrBuilder, diamondCount);
+    VMIR::BasicBlock* entry = Func->GetEntryBasicBlock();
+
+    VMIR::DFS dfs{};
+    for (auto _ : state) {
+        dfs.Clear();
+        dfs.Run(entry);
+        benchmark::DoNotOptimize(dfs.GetBasicBlocks().data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(Func->GetBasicBlocks().size()));
+    IrBuilder->Cleanup();
+}
+BENCHMARK(BM_DFS)->RangeMultiplier(8)->Range(8, 8 << 9)->Unit(benchmark::kMicrosecond);
+
+
+// Reverse post-order of the whole graph
+static void BM_RPO(benchmark::State& state) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    const size_t diamondCount = static_cast<size_t>(state.range(0));
+    VMIR::Function* Func = BuildDiamondChain(IrBuilder, diamondCount);
+    VMIR::BasicBlock* entry = Func->GetEntryBasicBlock();
+
+    VMIR::RPO rpo{};
+    for (auto _ : state) {
+        size_t count = Func->GetBasicBlocks().size();
+        rpo.Run(entry, &count);
+        benchmark::DoNotOptimize(rpo.GetBasicBlocks().data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(Func->GetBasicBlocks().size()));
+    IrBuilder->Cleanup();
+}
+BENCHMARK(BM_RPO)->RangeMultiplier(8)->Range(8, 8 << 9)->Unit(benchmark::kMicrosecond);
+
+
+// Visit every edge from both ends, like dataflow analyses do
+static void BM_WalkEdges(benchmark::State& state) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    const size_t diamondCount = static_cast<size_t>(state.range(0));
+    VMIR::Function* Func = BuildDiamondChain(IrBuilder, diamondCount);
+
+    for (auto _ : state) {
+        size_t edges = 0;
+        for (auto* bb : Func->GetBasicBlocks()) {
+            for (auto* succ : bb->GetSuccessors()) {
+                edges += succ->HasPredecessor(bb);
+            }
+            edges += bb->GetPredecessors().size();
+        }
+        benchmark::DoNotOptimize(edges);
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(Func->GetBasicBlocks().size()));
+    IrBuilder->Cleanup();
+}
+BENCHMARK(BM_WalkEdges)->RangeMultiplier(8)->Range(8, 8 << 9)->Unit(benchmark::kMicrosecond);
+
+
+// Dominator tree of the whole graph, from 100 to 100k blocks
+static void BM_BuildDominatorTree(benchmark::State& state) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    const size_t diamondCount = static_cast<size_t>(state.range(0));
+    VMIR::Function* Func = BuildDiamondChain(IrBuilder, diamondCount);
+    VMIR::ControlFlowGraph* cfg = IrBuilder->CreateControlFlowGraph(Func);
+
+    for (auto _ : state) {
+        cfg->BuildDominatorTree();
+        benchmark::DoNotOptimize(Func->GetBasicBlocks().back()->GetImmediateDominator());
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(Func->GetBasicBlocks().size()));
+    state.counters["blocks"] = static_cast<double>(Func->GetBasicBlocks().size());
+    IrBuilder->Cleanup();
+}
+BENCHMARK(BM_BuildDominatorTree)->Arg(25)->Arg(250)->Arg(2500)->Arg(25000)->Unit(benchmark::kMicrosecond);
+
+
+// Ask dominance for every block against the entry and the exit, like check elimination does
+static void BM_DominanceQueries(benchmark::State& state) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    const size_t diamondCount = static_cast<size_t>(state.range(0));
+    VMIR::Function* Func = BuildDiamondChain(IrBuilder, diamondCount);
+    VMIR::ControlFlowGraph* cfg = IrBuilder->CreateControlFlowGraph(Func);
+    cfg->BuildDominatorTree();
+
+    VMIR::BasicBlock* entry = Func->GetEntryBasicBlock();
+    VMIR::BasicBlock* exit = Func->GetBasicBlocks().back();
+    for (auto _ : state) {
+        size_t dominated = 0;
+        for (auto* bb : Func->GetBasicBlocks()) {
+            dominated += bb->IsDominatedBy(entry);
+            dominated += exit->IsDominatedBy(bb);
+        }
+        benchmark::DoNotOptimize(dominated);
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(2 * Func->GetBasicBlocks().size()));
+    IrBuilder->Cleanup();
+}
+BENCHMARK(BM_DominanceQueries)->RangeMultiplier(8)->Range(8, 8 << 9)->Unit(benchmark::kMicrosecond);
+
+
+BENCHMARK_MAIN();
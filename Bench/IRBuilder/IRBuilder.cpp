@@ -0,0 +1,156 @@
+#include <benchmark/benchmark.h>
+
+#include <IRBuilder.h>
+
+
+// Straight-line function of `blockCount` blocks chained with jumps, each block holds `instCount` arithmetic instructions
+static VMIR::Function* BuildStraightLineFunction(VMIR::IRBuilder* IrBuilder, size_t blockCount, size_t instCount) {
+    VMIR::Function* Func = IrBuilder->CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "StraightLine");
+
+    VMIR::Value* one = IrBuilder->CreateValue(1UL);
+    VMIR::Value* prev = Func->GetArg(0);
+
+    VMIR::BasicBlock* bb = IrBuilder->CreateBasicBlock(Func);
+    Func->SetEntryBasicBlock(bb);
+    for (size_t i = 0; i < blockCount; ++i) {
+        for (size_t j = 0; j < instCount; ++j) {
+            VMIR::Value* curr = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+            if (j % 2 == 0) {
+                IrBuilder->CreateAdd(bb, prev, one, curr);
+            }
+            else {
+                IrBuilder->CreateMul(bb, prev, prev, curr);
+            }
+            prev = curr;
+        }
+
+        if (i + 1 == blockCount) {
+            IrBuilder->CreateRet(bb, prev);
+        }
+        else {
+            VMIR::BasicBlock* next = IrBuilder->CreateBasicBlock(Func);
+            IrBuilder->CreateJump(bb, next);
+            bb = next;
+        }
+    }
+
+    return Func;
+}
+
+
+// Build a large function and tear the whole IR down
+static void BM_BuildAndCleanup(benchmark::State& state) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    const size_t blockCount = static_cast<size_t>(state.range(0));
+    const size_t instCount = 16;
+    for (auto _ : state) {
+        VMIR::Function* Func = BuildStraightLineFunction(IrBuilder, blockCount, instCount);
+        benchmark::DoNotOptimize(Func);
+        IrBuilder->Cleanup();
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(blockCount * (instCount + 1)));
+}
+BENCHMARK(BM_BuildAndCleanup)->RangeMultiplier(8)->Range(8, 8 << 12)->Unit(benchmark::kMicrosecond);
+
+
+// Replace every Mul with a Mv and remove the original instruction, like peepholes do
+static void BM_ReplaceInstructions(benchmark::State& state) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    const size_t blockCount = static_cast<size_t>(state.range(0));
+    const size_t instCount = 16;
+    for (auto _ : state) {
+        state.PauseTiming();
+        VMIR::Function* Func = BuildStraightLineFunction(IrBuilder, blockCount, instCount);
+        state.ResumeTiming();
+
+        for (auto* bb : Func->GetBasicBlocks()) {
+            VMIR::Instruction* inst = bb->Front();
+            while (inst) {
+                VMIR::Instruction* next = inst->GetNext();
+                if (inst->GetType() == VMIR::InstructionType::Mul) {
+                    auto* instMul = static_cast<VMIR::InstructionMul*>(inst);
+                    VMIR::Value* input = instMul->GetInput1();
+                    VMIR::Value* output = instMul->GetOutput();
+
+                    VMIR::InstructionMv* instMv = IrBuilder->CreateMv(input, output);
+
+                    bb->InsertInstructionBefore(instMv, instMul);
+                    bb->RemoveInstruction(instMul);
+                    IrBuilder->RemoveInstruction(instMul);
+                }
+                inst = next;
+            }
+        }
+
+        state.PauseTiming();
+        IrBuilder->Cleanup();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(blockCount * instCount / 2));
+}
+BENCHMARK(BM_ReplaceInstructions)->RangeMultiplier(8)->Range(8, 8 << 12)->Unit(benchmark::kMicrosecond);
+
+
+// Follow every def-use edge of the function, touching the values on both ends
+static void BM_WalkDefUse(benchmark::State& state) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    const size_t blockCount = static_cast<size_t>(state.range(0));
+    const size_t instCount = 16;
+    VMIR::Function* Func = BuildStraightLineFunction(IrBuilder, blockCount, instCount);
+
+    for (auto _ : state) {
+        uint64_t checksum = 0;
+        for (auto* bb : Func->GetBasicBlocks()) {
+            for (VMIR::Instruction* inst = bb->Front(); inst; inst = inst->GetNext()) {
+                VMIR::Value* output = inst->GetOutput();
+                if (!output) {
+                    continue;
+                }
+                for (auto* user : output->GetUsers()) {
+                    VMIR::Value* userOutput = user->GetOutput();
+                    if (userOutput) {
+                        checksum += static_cast<uint64_t>(userOutput->GetValueType());
+                    }
+                }
+            }
+        }
+        benchmark::DoNotOptimize(checksum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(blockCount * instCount));
+    state.counters["sizeof(Value)"] = static_cast<double>(sizeof(VMIR::Value));
+
+    IrBuilder->Cleanup();
+}
+BENCHMARK(BM_WalkDefUse)->RangeMultiplier(8)->Range(8, 8 << 12)->Unit(benchmark::kMicrosecond);
+
+
+// Ask whether instructions of one large block come before each other, like check elimination does
+static void BM_InstructionOrderQueries(benchmark::State& state) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    const size_t instCount = static_cast<size_t>(state.range(0));
+    VMIR::Function* Func = BuildStraightLineFunction(IrBuilder, 1, instCount);
+    VMIR::BasicBlock* bb = Func->GetEntryBasicBlock();
+
+    for (auto _ : state) {
+        size_t dominated = 0;
+        for (VMIR::Instruction* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            dominated += inst->IsDominatedBy(bb->Front());
+            dominated += bb->Back()->IsDominatedBy(inst);
+        }
+        benchmark::DoNotOptimize(dominated);
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(2 * bb->Size()));
+    IrBuilder->Cleanup();
+}
+BENCHMARK(BM_InstructionOrderQueries)->RangeMultiplier(8)->Range(8, 8 << 9)->Unit(benchmark::kMicrosecond);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <sstream>
+
+#include <IRBuilder.h>
+#include <IRParser.h>
+
+
+// Text of `functionCount` functions, each is a chain of `loopCount` loops with arithmetic, memory and calls
+static std::string BuildModuleText(size_t functionCount, size_t loopCount) {
+    VMIR::IRContext IrContext{};
+
+    VMIR::Function* Scale = IrContext.CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "Scale");
+    VMIR::BasicBlock* Scale_BB_1 = IrContext.CreateBasicBlock(Scale, "Scale_BB_1");
+    Scale->SetEntryBasicBlock(Scale_BB_1);
+    VMIR::Value* scaled = IrContext.CreateValue(VMIR::ValueType::Uint64);
+    IrContext.CreateMul(Scale_BB_1, Scale->GetArg(0), IrContext.GetOrCreateValueWithData(uint64_t(3)), scaled);
+    IrContext.CreateRet(Scale_BB_1, scaled);
+
+    for (size_t f = 0; f < functionCount; ++f) {
+        const std::string name = "Func_" + std::to_string(f);
+        VMIR::Function* Func = IrContext.CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, name);
+        VMIR::BasicBlock* entry = IrContext.CreateBasicBlock(Func, name + "_Entry");
+        Func->SetEntryBasicBlock(entry);
+
+        VMIR::Value* ptr = IrContext.CreateValue(VMIR::ValueType::Pointer);
+        IrContext.CreateAlloc(entry, ptr, VMIR::ValueType::Uint64);
+        IrContext.CreateNullCheck(entry, ptr);
+
+        VMIR::Value* acc = Func->GetArg(0);
+        VMIR::BasicBlock* pred = entry;
+        for (size_t l = 0; l < loopCount; ++l) {
+            VMIR::BasicBlock* header = IrContext.CreateBasicBlock(Func, name + "_Loop_" + std::to_string(l));
+            VMIR::BasicBlock* exit = IrContext.CreateBasicBlock(Func, name + "_Exit_" + std::to_string(l));
+            IrContext.CreateJump(pred, header);
+
+            VMIR::Value* counter = IrContext.CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* shifted = IrContext.CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* loaded = IrContext.CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* called = IrContext.CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* next = IrContext.CreateValue(VMIR::ValueType::Uint64);
+
+            IrContext.CreatePhi(header, {acc, next}, counter);
+            IrContext.CreateShl(header, counter, IrContext.GetOrCreateValueWithData(uint64_t(l % 64)), shifted);
+            IrContext.CreateStore(header, ptr, shifted);
+            IrContext.CreateLoad(header, ptr, loaded);
+            IrContext.CreateCall(header, Scale, called, {loaded});
+            IrContext.CreateAdd(header, called, IrContext.GetOrCreateValueWithData(uint64_t(f)), next);
+            IrContext.CreateBne(header, next, Func->GetArg(0), header, exit);
+
+            acc = next;
+            pred = exit;
+        }
+        IrContext.CreateRet(pred, acc);
+    }
+
+    std::ostringstream out{};
+    IrContext.PrintIR(out);
+    return out.str();
+}
+
+
+// Throughput of the parser in bytes of text per second. Contexts are destroyed outside of the measured region
+static void BM_ParseText(benchmark::State& state) {
+    const std::string text = BuildModuleText(static_cast<size_t>(state.range(0)), 16);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto IrContext = std::make_unique<VMIR::IRContext>();
+        VMIR::IRParser parser{IrContext.get()};
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(parser.Parse(text));
+
+        state.PauseTiming();
+        IrContext.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(text.size()));
+}
+BENCHMARK(BM_ParseText)->Arg(16)->Arg(256)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
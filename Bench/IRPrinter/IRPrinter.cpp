@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+
+#include <IRBuilder.h>
+#include <IRPrinter.h>
+
+
+// Context with `functionCount` functions, each is a chain of `loopCount` loops with arithmetic, memory and calls
+static void BuildModule(VMIR::IRContext& IrContext, size_t functionCount, size_t loopCount) {
+    VMIR::Function* Scale = IrContext.CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "Scale");
+    VMIR::BasicBlock* Scale_BB_1 = IrContext.CreateBasicBlock(Scale, "Scale_BB_1");
+    Scale->SetEntryBasicBlock(Scale_BB_1);
+    VMIR::Value* scaled = IrContext.CreateValue(VMIR::ValueType::Uint64);
+    IrContext.CreateMul(Scale_BB_1, Scale->GetArg(0), IrContext.GetOrCreateValueWithData(uint64_t(3)), scaled);
+    IrContext.CreateRet(Scale_BB_1, scaled);
+
+    for (size_t f = 0; f < functionCount; ++f) {
+        const std::string name = "Func_" + std::to_string(f);
+        VMIR::Function* Func = IrContext.CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, name);
+        VMIR::BasicBlock* entry = IrContext.CreateBasicBlock(Func, name + "_Entry");
+        Func->SetEntryBasicBlock(entry);
+
+        VMIR::Value* ptr = IrContext.CreateValue(VMIR::ValueType::Pointer);
+        IrContext.CreateAlloc(entry, ptr, VMIR::ValueType::Uint64);
+        IrContext.CreateNullCheck(entry, ptr);
+
+        VMIR::Value* acc = Func->GetArg(0);
+        VMIR::BasicBlock* pred = entry;
+        for (size_t l = 0; l < loopCount; ++l) {
+            VMIR::BasicBlock* header = IrContext.CreateBasicBlock(Func, name + "_Loop_" + std::to_string(l));
+            VMIR::BasicBlock* exit = IrContext.CreateBasicBlock(Func, name + "_Exit_" + std::to_string(l));
+            IrContext.CreateJump(pred, header);
+
+            VMIR::Value* counter = IrContext.CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* shifted = IrContext.CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* loaded = IrContext.CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* called = IrContext.CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* next = IrContext.CreateValue(VMIR::ValueType::Uint64);
+
+            IrContext.CreatePhi(header, {acc, next}, counter);
+            IrContext.CreateShl(header, counter, IrContext.GetOrCreateValueWithData(uint64_t(l % 64)), shifted);
+            IrContext.CreateStore(header, ptr, shifted);
+            IrContext.CreateLoad(header, ptr, loaded);
+            IrContext.CreateCall(header, Scale, called, {loaded});
+            IrContext.CreateAdd(header, called, IrContext.GetOrCreateValueWithData(uint64_t(f)), next);
+            IrContext.CreateBne(header, next, Func->GetArg(0), header, exit);
+
+            acc = next;
+            pred = exit;
+        }
+        IrContext.CreateRet(pred, acc);
+    }
+}
+
+// Module is printed the way IRContext::PrintIR did before IRPrinter, one temporary string per instruction
+static void BM_PrintWithFunctions(benchmark::State& state) {
+    VMIR::IRContext IrContext{};
+    BuildModule(IrContext, static_cast<size_t>(state.range(0)), 16);
+
+    std::ostringstream out{};
+    for (auto _ : state) {
+        out.str("");
+        for (auto* func : IrContext.GetFunctions()) {
+            func->Print(out);
+            out << "\n\n";
+        }
+        benchmark::DoNotOptimize(out.tellp());
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(out.str().size()));
+}
+BENCHMARK(BM_PrintWithFunctions)->Arg(16)->Arg(256)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+
+static void BM_PrintWithPrinter(benchmark::State& state) {
+    VMIR::IRContext IrContext{};
+    BuildModule(IrContext, static_cast<size_t>(state.range(0)), 16);
+
+    std::ostringstream out{};
+    VMIR::IRPrinter printer{};
+    for (auto _ : state) {
+        out.str("");
+        printer.PrintIR(&IrContext, out);
+        benchmark::DoNotOptimize(out.tellp());
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(out.str().size()));
+}
+BENCHMARK(BM_PrintWithPrinter)->Arg(16)->Arg(256)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
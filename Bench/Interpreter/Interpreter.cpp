@@ -0,0 +1,84 @@
+#include <benchmark/benchmark.h>
+
+#include <IRBuilder.h>
+#include <IRParser.h>
+#include <Interpreter.h>
+
+
+// Same as SampleIR/FactLoop/FactLoop.cpp
+static uint64_t NativeFactLoop(uint64_t n) {
+    uint64_t acc = 1;
+    for (uint64_t i = 2; i <= n; ++i) {
+        acc *= i;
+    }
+    return acc;
+}
+
+static int32_t NativeFactRecursive(int32_t n) {
+    if (n == 0 || n == 1) {
+        return 1;
+    }
+    return static_cast<int32_t>(static_cast<uint32_t>(n) * static_cast<uint32_t>(NativeFactRecursive(n - 1)));
+}
+
+
+static void BM_NativeFactLoop(benchmark::State& state) {
+    uint64_t n = static_cast<uint64_t>(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(n);
+        benchmark::DoNotOptimize(NativeFactLoop(n));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_NativeFactLoop)->Arg(20)->Arg(1000)->Arg(100000);
+
+
+static void BM_InterpretFactLoop(benchmark::State& state) {
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    if (!parser.ParseFile("SampleIR/FactLoop/FactLoop.vmir")) {
+        state.SkipWithError(parser.GetError().c_str());
+        return;
+    }
+
+    VMIR::Interpreter interpreter{&IrContext};
+    VMIR::Function* FactLoop = parser.GetFunctions()[0];
+    const uint64_t n = static_cast<uint64_t>(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpreter.Call<uint64_t>(FactLoop, n));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_InterpretFactLoop)->Arg(20)->Arg(1000)->Arg(100000);
+
+
+static void BM_NativeFactRecursive(benchmark::State& state) {
+    int32_t n = static_cast<int32_t>(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(n);
+        benchmark::DoNotOptimize(NativeFactRecursive(n));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_NativeFactRecursive)->Arg(12)->Arg(1000)->Arg(10000);
+
+
+static void BM_InterpretFactRecursive(benchmark::State& state) {
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    if (!parser.ParseFile("SampleIR/FactRecursive/FactRecursive.vmir")) {
+        state.SkipWithError(parser.GetError().c_str());
+        return;
+    }
+
+    VMIR::Interpreter interpreter{&IrContext};
+    VMIR::Function* FactRecursive = parser.GetFunctions()[0];
+    const int32_t n = static_cast<int32_t>(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpreter.Call<int32_t>(FactRecursive, n));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_InterpretFactRecursive)->Arg(12)->Arg(1000)->Arg(10000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+
+#include <IRBuilder.h>
+#include <IRParser.h>
+#include <Interpreter.h>
+#include <JITCompiler.h>
+
+
+template <typename R, typename T>
+static void RunCompiled(benchmark::State& state, const char* path) {
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    if (!parser.ParseFile(path)) {
+        state.SkipWithError(parser.GetError().c_str());
+        return;
+    }
+
+    VMIR::JITCompiler compiler{&IrContext};
+    auto entry = reinterpret_cast<R (*)(T)>(compiler.GetEntry(parser.GetFunctions()[0]));
+    if (entry == nullptr) {
+        state.SkipWithError(compiler.GetError().c_str());
+        return;
+    }
+
+    T n = static_cast<T>(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(n);
+        benchmark::DoNotOptimize(entry(n));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+template <typename R, typename T>
+static void RunInterpreted(benchmark::State& state, const char* path) {
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    if (!parser.ParseFile(path)) {
+        state.SkipWithError(parser.GetError().c_str());
+        return;
+    }
+
+    VMIR::Interpreter interpreter{&IrContext};
+    VMIR::Function* func = parser.GetFunctions()[0];
+    const T n = static_cast<T>(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpreter.Call<R>(func, n));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+
+static void BM_CompiledFactLoop(benchmark::State& state) {
+    RunCompiled<uint64_t, uint64_t>(state, "SampleIR/FactLoop/FactLoop.vmir");
+}
+BENCHMARK(BM_CompiledFactLoop)->Arg(20)->Arg(1000)->Arg(100000);
+
+static void BM_InterpretedFactLoop(benchmark::State& state) {
+    RunInterpreted<uint64_t, uint64_t>(state, "SampleIR/FactLoop/FactLoop.vmir");
+}
+BENCHMARK(BM_InterpretedFactLoop)->Arg(20)->Arg(1000)->Arg(100000);
+
+static void BM_CompiledFactRecursive(benchmark::State& state) {
+    RunCompiled<int32_t, int32_t>(state, "SampleIR/FactRecursive/FactRecursive.vmir");
+}
+BENCHMARK(BM_CompiledFactRecursive)->Arg(12)->Arg(1000)->Arg(10000);
+
+static void BM_InterpretedFactRecursive(benchmark::State& state) {
+    RunInterpreted<int32_t, int32_t>(state, "SampleIR/FactRecursive/FactRecursive.vmir");
+}
+BENCHMARK(BM_InterpretedFactRecursive)->Arg(12)->Arg(1000)->Arg(10000);
+
+
+// Register allocation and code generation, parsing excluded
+static void BM_CompileFactLoop(benchmark::State& state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        VMIR::IRContext IrContext{};
+        VMIR::IRParser parser{&IrContext};
+        parser.ParseFile("SampleIR/FactLoop/FactLoop.vmir");
+        state.ResumeTiming();
+
+        VMIR::JITCompiler compiler{&IrContext};
+        benchmark::DoNotOptimize(compiler.Compile(parser.GetFunctions()[0]));
+    }
+}
+BENCHMARK(BM_CompileFactLoop);
+
+BENCHMARK_MAIN();
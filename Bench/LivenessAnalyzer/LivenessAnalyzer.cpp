@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+
+#include <IRGenerators.h>
+#include <IRBuilder.h>
+#include <LivenessAnalyzer.h>
+
+using IRGenerators::Shape;
+
+
+// Liveness of one function again and again, the loop tree is built beforehand
+static void RunLiveness(benchmark::State& state, Shape shape) {
+    VMIR::IRContext IrContext{};
+    VMIR::Function* Func = IRGenerators::Build(&IrContext, shape, static_cast<size_t>(state.range(0)));
+    VMIR::ControlFlowGraph* cfg = IrContext.GetOrCreateControlFlowGraph(Func);
+    IrContext.GetOrCreateLoopAnalyzer(cfg)->BuildLoopTree();
+
+    VMIR::LivenessAnalyzer* livenessAnalyzer = IrContext.GetOrCreateLivenessAnalyzer(cfg);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(livenessAnalyzer->PerformLivenessAnalysis());
+    }
+
+    size_t maxLive = 0;
+    for (auto* bb : livenessAnalyzer->GetBasicBlocksLinearOrder()) {
+        maxLive = std::max(maxLive, livenessAnalyzer->GetLiveIn(bb).Count());
+    }
+    state.counters["max_live_in"] = static_cast<double>(maxLive);
+    state.SetComplexityN(static_cast<int64_t>(Func->GetInstructionCount()));
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(Func->GetInstructionCount()));
+}
+
+
+// All values of the loop body are live at once
+static void BM_LivenessRegisterPressure(benchmark::State& state) {
+    RunLiveness(state, Shape::RegisterPressure);
+}
+BENCHMARK(BM_LivenessRegisterPressure)->RangeMultiplier(4)->Range(16, 4096)->Complexity()->Unit(benchmark::kMicrosecond);
+
+// Values stay live through every level of the nest
+static void BM_LivenessLoopNest(benchmark::State& state) {
+    RunLiveness(state, Shape::LoopNest);
+}
+BENCHMARK(BM_LivenessLoopNest)->RangeMultiplier(4)->Range(4, 256)->Complexity()->Unit(benchmark::kMicrosecond);
+
+static void BM_LivenessWideDiamond(benchmark::State& state) {
+    RunLiveness(state, Shape::WideDiamond);
+}
+BENCHMARK(BM_LivenessWideDiamond)->RangeMultiplier(4)->Range(16, 1024)->Complexity()->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
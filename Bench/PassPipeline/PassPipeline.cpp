@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include <IRBuilder.h>
+#include <PassPipeline.h>
+#include <ThreadPool.h>
+
+
+// Every function is a chain of `loopCount` loops. Each loop has constants to fold, a shift pair for peepholes,
+// a repeated null check and a call to a small callee which gets inlined
+static void BuildModule(VMIR::IRContext* IrContext, size_t functionCount, size_t loopCount) {
+    VMIR::Function* Scale = IrContext->CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "Scale");
+    VMIR::BasicBlock* Scale_BB_1 = IrContext->CreateBasicBlock(Scale);
+    Scale->SetEntryBasicBlock(Scale_BB_1);
+
+    VMIR::Value* scaled = IrContext->CreateValue(VMIR::ValueType::Uint64);
+    IrContext->CreateMul(Scale_BB_1, Scale->GetArg(0), IrContext->GetOrCreateValueWithData(uint64_t(3)), scaled);
+    IrContext->CreateRet(Scale_BB_1, scaled);
+
+    for (size_t f = 0; f < functionCount; ++f) {
+        VMIR::Function* Func = IrContext->CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "Func_" + std::to_string(f));
+        VMIR::BasicBlock* entry = IrContext->CreateBasicBlock(Func);
+        Func->SetEntryBasicBlock(entry);
+
+        VMIR::Value* ptr = IrContext->CreateValue(VMIR::ValueType::Pointer);
+        IrContext->CreateAlloc(entry, ptr, VMIR::ValueType::Uint64);
+        IrContext->CreateNullCheck(entry, ptr);
+
+        VMIR::Value* acc = Func->GetArg(0);
+        VMIR::BasicBlock* pred = entry;
+        for (size_t l = 0; l < loopCount; ++l) {
+            VMIR::BasicBlock* header = IrContext->CreateBasicBlock(Func);
+            VMIR::BasicBlock* exit = IrContext->CreateBasicBlock(Func);
+            IrContext->CreateJump(pred, header);
+
+            VMIR::Value* counter = IrContext->CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* folded = IrContext->CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* shl = IrContext->CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* shr = IrContext->CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* called = IrContext->CreateValue(VMIR::ValueType::Uint64);
+            VMIR::Value* next = IrContext->CreateValue(VMIR::ValueType::Uint64);
+
+            IrContext->CreatePhi(header, {acc, next}, counter);
+            IrContext->CreateAdd(header, IrContext->GetOrCreateValueWithData(uint64_t(l)), IrContext->GetOrCreateValueWithData(uint64_t(f)), folded);
+            IrContext->CreateShl(header, counter, IrContext->GetOrCreateValueWithData(uint64_t(8)), shl);
+            IrContext->CreateShr(header, shl, IrContext->GetOrCreateValueWithData(uint64_t(8)), shr);
+            IrContext->CreateNullCheck(header, ptr);
+            IrContext->CreateStore(header, ptr, shr);
+            IrContext->CreateCall(header, Scale, called, {folded});
+            IrContext->CreateAdd(header, called, shr, next);
+            IrContext->CreateBne(header, next, Func->GetArg(0), header, exit);
+
+            acc = next;
+            pred = exit;
+        }
+        IrContext->CreateRet(pred, acc);
+    }
+}
+
+
+// Whole pipeline over a module of 512 functions with 16 loops each. Zero threads means the calling thread only
+// Speedup needs a core per worker, on fewer cores the larger counts only show the overhead of the pool
+static void BM_PassPipeline(benchmark::State& state) {
+    constexpr size_t functionCount = 512;
+    constexpr size_t loopCount = 16;
+
+    const size_t threadCount = static_cast<size_t>(state.range(0));
+    std::unique_ptr<VMIR::ThreadPool> pool = threadCount > 0 ? std::make_unique<VMIR::ThreadPool>(threadCount) : nullptr;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto IrContext = std::make_unique<VMIR::IRContext>();
+        BuildModule(IrContext.get(), functionCount, loopCount);
+        VMIR::PassPipeline pipeline{IrContext.get(), 4, 2};
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(pipeline.Run(pool.get()));
+
+        state.PauseTiming();
+        IrContext.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(functionCount));
+}
+BENCHMARK(BM_PassPipeline)->Arg(0)->RangeMultiplier(2)->Range(1, 32)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+
+#include <IRGenerators.h>
+#include <IRBuilder.h>
+#include <LivenessAnalyzer.h>
+#include <RegisterAllocator.h>
+
+using IRGenerators::Shape;
+
+static constexpr uint32_t kGPRegisterCount = 8;
+static constexpr uint32_t kFPRegisterCount = 8;
+
+
+// Allocation of one function again and again, liveness is done beforehand. Counters show the stack traffic
+static void RunAllocation(benchmark::State& state, Shape shape, VMIR::RegisterAllocationMode mode = VMIR::RegisterAllocationMode::LinearScan) {
+    VMIR::IRContext IrContext{};
+    VMIR::Function* Func = IRGenerators::Build(&IrContext, shape, static_cast<size_t>(state.range(0)));
+    Func->SetRegisterAllocationMode(mode);
+    VMIR::ControlFlowGraph* cfg = IrContext.GetOrCreateControlFlowGraph(Func);
+    IrContext.GetOrCreateLivenessAnalyzer(cfg)->PerformLivenessAnalysis();
+
+    VMIR::RegisterAllocator allocator{&IrContext, cfg, kGPRegisterCount, kFPRegisterCount};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(allocator.PerformRegisterAllocation());
+    }
+
+    const auto& stats = allocator.GetStatistics();
+    state.counters["splits"] = static_cast<double>(stats.splits);
+    state.counters["moves"] = static_cast<double>(stats.moves);
+    state.counters["coalesced"] = static_cast<double>(stats.coalescedMoves);
+    state.counters["phi_copies"] = static_cast<double>(stats.phiCopies);
+    state.counters["stack_stores"] = static_cast<double>(stats.stackStores);
+    state.counters["stack_loads"] = static_cast<double>(stats.stackLoads);
+    state.counters["weighted_stores"] = stats.weightedStackStores;
+    state.counters["weighted_loads"] = stats.weightedStackLoads;
+    state.SetComplexityN(static_cast<int64_t>(Func->GetInstructionCount()));
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(Func->GetInstructionCount()));
+}
+
+
+// Every value of the loop body has one use, so its stack part spans the pressure between the two.
+// Both register classes are busy, the largest size has 16k intervals before splitting
+static void BM_AllocationRegisterPressure(benchmark::State& state) {
+    RunAllocation(state, Shape::RegisterPressure);
+}
+BENCHMARK(BM_AllocationRegisterPressure)->RangeMultiplier(4)->Range(16, 4096)->Complexity()->Unit(benchmark::kMicrosecond);
+
+// Counters of outer loops are used before and after the inner loops and wait in the stack while those run
+static void BM_AllocationLoopNest(benchmark::State& state) {
+    RunAllocation(state, Shape::LoopNest);
+}
+BENCHMARK(BM_AllocationLoopNest)->RangeMultiplier(4)->Range(4, 64)->Complexity()->Unit(benchmark::kMicrosecond);
+
+static void BM_AllocationStraightLine(benchmark::State& state) {
+    RunAllocation(state, Shape::StraightLine);
+}
+BENCHMARK(BM_AllocationStraightLine)->RangeMultiplier(4)->Range(64, 4096)->Complexity()->Unit(benchmark::kMicrosecond);
+
+// Same shapes colored as a whole. Interference graph grows with the square of the values live at once
+static void BM_ColoringRegisterPressure(benchmark::State& state) {
+    RunAllocation(state, Shape::RegisterPressure, VMIR::RegisterAllocationMode::GraphColoring);
+}
+BENCHMARK(BM_ColoringRegisterPressure)->RangeMultiplier(4)->Range(16, 1024)->Complexity()->Unit(benchmark::kMicrosecond);
+
+static void BM_ColoringLoopNest(benchmark::State& state) {
+    RunAllocation(state, Shape::LoopNest, VMIR::RegisterAllocationMode::GraphColoring);
+}
+BENCHMARK(BM_ColoringLoopNest)->RangeMultiplier(4)->Range(4, 64)->Complexity()->Unit(benchmark::kMicrosecond);
+
+static void BM_ColoringStraightLine(benchmark::State& state) {
+    RunAllocation(state, Shape::StraightLine, VMIR::RegisterAllocationMode::GraphColoring);
+}
+BENCHMARK(BM_ColoringStraightLine)->RangeMultiplier(4)->Range(64, 4096)->Complexity()->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
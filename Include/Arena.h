@@ -0,0 +1,131 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <array>
+
+namespace VMIR {
+
+// Bump pointer allocator for IR objects.
+// Memory is carved out of big chunks and is returned to the system all at once by Release().
+// Deallocated blocks are not returned to the system, instead they are put to the free list of
+// their size class, so removed instructions are reused by the next instructions of the same size
+class Arena {
+public:
+    static constexpr size_t kDefaultChunkSize = 64 * 1024;
+    static constexpr size_t kAlignment = alignof(std::max_align_t);
+
+    explicit Arena(const size_t chunkSize = kDefaultChunkSize) : mChunkSize{chunkSize} {};
+
+    Arena(const Arena& other) = delete;
+    Arena& operator=(const Arena& other) = delete;
+
+    ~Arena() { Release(); }
+
+    inline void* Allocate(size_t size) {
+        size = RoundUpSize(size);
+
+        if (size <= kMaxFreeListSize) {
+            FreeNode*& freeList = mFreeLists[FreeListIndex(size)];
+            if (freeList != nullptr) {
+                FreeNode* node = freeList;
+                freeList = node->next;
+                return node;
+            }
+        }
+
+        if (static_cast<size_t>(mEnd - mCurrent) < size) {
+            return AllocateSlow(size);
+        }
+
+        void* ptr = mCurrent;
+        mCurrent += size;
+        return ptr;
+    }
+
+    // Does not return memory to the system, only makes it available for next allocations of the same size
+    inline void Deallocate(void* ptr, size_t size) {
+        if (ptr == nullptr) {
+            return;
+        }
+
+        size = RoundUpSize(size);
+        if (size > kMaxFreeListSize) {
+            // Big blocks are rare, simply wait for Release()
+            return;
+        }
+
+        FreeNode*& freeList = mFreeLists[FreeListIndex(size)];
+        FreeNode* node = static_cast<FreeNode*>(ptr);
+        node->next = freeList;
+        freeList = node;
+    }
+
+    template <typename T, typename... Args>
+    inline T* New(Args&&... args) {
+        static_assert(alignof(T) <= kAlignment, "Over-aligned types are not supported by the arena");
+        return new (Allocate(sizeof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Object is followed by `extraSize` bytes of storage, e.g. for a trailing array
+    template <typename T, typename... Args>
+    inline T* NewWithExtraStorage(const size_t extraSize, Args&&... args) {
+        static_assert(alignof(T) <= kAlignment, "Over-aligned types are not supported by the arena");
+        return new (Allocate(sizeof(T) + extraSize)) T(std::forward<Args>(args)...);
+    }
+
+    // Destroy the object and put its memory to the free list. The static type must be the dynamic one
+    template <typename T>
+    inline void Delete(T* object) {
+        if (object == nullptr) {
+            return;
+        }
+        object->~T();
+        Deallocate(object, sizeof(T));
+    }
+
+    // Return all chunks to the system. Destructors of the objects are not called
+    void Release();
+
+    inline size_t GetReservedBytes() const { return mReservedBytes; }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    struct ChunkHeader {
+        ChunkHeader* prev;
+        size_t size;
+    };
+
+    static constexpr size_t kMaxFreeListSize = 512;
+    static constexpr size_t kFreeListCount = kMaxFreeListSize / kAlignment;
+    static constexpr size_t kChunkHeaderSize = (sizeof(ChunkHeader) + kAlignment - 1) & ~(kAlignment - 1);
+
+    static constexpr size_t RoundUpSize(const size_t size) {
+        return size == 0 ? kAlignment : (size + kAlignment - 1) & ~(kAlignment - 1);
+    }
+
+    static constexpr size_t FreeListIndex(const size_t roundedSize) {
+        return roundedSize / kAlignment - 1;
+    }
+
+    void* AllocateSlow(size_t size);
+
+    size_t mChunkSize{kDefaultChunkSize};
+    size_t mReservedBytes{0};
+
+    char* mCurrent{nullptr};
+    char* mEnd{nullptr};
+    ChunkHeader* mLastChunk{nullptr};
+
+    std::array<FreeNode*, kFreeListCount> mFreeLists{};
+};
+
+}   // namespace VMIR
+
+#endif  // ARENA_H
@@ -2,9 +2,11 @@
 #define BASIC_BLOCK_H
 
 #include <vector>
+#include <span>
 #include <ostream>
 
 #include <Instruction.h>
+#include <SmallVector.h>
 
 namespace VMIR {
 
@@ -14,17 +16,6 @@ class Loop;
 
 class BasicBlock {
 public:
-    enum Marker : uint32_t {
-        None  = 0,
-        Black = 1 << 0,
-        Grey  = 1 << 1,
-        Green = 1 << 2,
-
-        All = Black | Grey | Green
-    };
-
-    using MarkerFlags = uint32_t;
-
     BasicBlock(const BasicBlockId id = -1, Function* parentFunction = nullptr, const std::string& name = "")
     : mId{id}, mParentFunction{parentFunction}, mName{name} {};
 
@@ -35,6 +26,8 @@ public:
     inline void SetId(const BasicBlockId id) { mId = id; }
 
     inline std::string GetName() const { return mName.length() > 0 ? (mName) : ("<Unnamed BB#" + std::to_string(mId) + ">"); }
+    // Name without the placeholder of unnamed blocks
+    inline const std::string& GetRawName() const { return mName; }
     inline void SetName(const std::string& name) { mName = name; }
 
     inline Instruction* Front() const { return mFirstInst; }
@@ -72,6 +65,7 @@ public:
     }
 
     void PrependInstruction(Instruction* inst) {
+        AssignInstructionOrder(inst, nullptr, mFirstInst);
         if (mFirstInst == nullptr) {
             mFirstInst = mLastInst = inst;
         }
@@ -85,6 +79,7 @@ public:
     }
 
     void AppendInstruction(Instruction* inst)  {
+        AssignInstructionOrder(inst, mLastInst, nullptr);
         if (mLastInst == nullptr) {
             mFirstInst = mLastInst = inst;
         }
@@ -103,6 +98,7 @@ public:
         }
 
         Instruction* instBefore = position->GetPrev();
+        AssignInstructionOrder(inst, instBefore, position);
         if (instBefore != nullptr) {
             instBefore->SetNext(inst);
             inst->SetPrev(instBefore);
@@ -124,6 +120,7 @@ public:
         }
 
         Instruction* instAfter = position->GetNext();
+        AssignInstructionOrder(inst, position, instAfter);
         if (instAfter != nullptr) {
             inst->SetNext(instAfter);
             instAfter->SetPrev(inst);
@@ -165,53 +162,97 @@ public:
         --mSize;
     }
 
-    inline const std::set<BasicBlock*>& GetPredecessors() const { return mPredecessors; }
+    // Order numbers of the instructions are valid until an insertion finds no gap between neighbours
+    inline bool IsInstructionOrderValid() const { return mIsInstructionOrderValid; }
+
+    void RenumberInstructions() {
+        uint32_t order = 0;
+        for (Instruction* inst = mFirstInst; inst != nullptr; inst = inst->GetNext()) {
+            order += InstructionOrderSpacing;
+            inst->SetOrder(order);
+        }
+        mIsInstructionOrderValid = true;
+    }
+
+    using PredecessorList = SmallVector<BasicBlock*, 2>;
+    using DominatorTreeChildList = SmallVector<BasicBlock*, 2>;
 
-    inline void SetPredecessors(const std::set<BasicBlock*>& preds) { mPredecessors = preds; }
-    inline void AddPredecessor(BasicBlock* pred)       { mPredecessors.insert(pred); }
+    // Predecessors are unique and listed in the order they were added
+    inline const PredecessorList& GetPredecessors() const { return mPredecessors; }
+
+    inline void SetPredecessors(std::span<BasicBlock* const> preds) {
+        mPredecessors.clear();
+        for (auto* pred : preds) {
+            AddPredecessor(pred);
+        }
+    }
+    // Phi inputs without blocks are matched to the new edge, see InstructionPhi::AssignIncomingBlock
+    inline void AddPredecessor(BasicBlock* pred) {
+        if (!mPredecessors.contains(pred)) {
+            mPredecessors.push_back(pred);
+            for (Instruction* inst = mFirstInst; inst != nullptr && inst->IsPhi(); inst = inst->GetNext()) {
+                static_cast<InstructionPhi*>(inst)->AssignIncomingBlock(pred);
+            }
+        }
+    }
     inline bool HasPredecessor(BasicBlock* pred) const { return mPredecessors.contains(pred); }
-    inline void RemovePredecessor(BasicBlock* pred)    { mPredecessors.erase(pred); }
+    inline void RemovePredecessor(BasicBlock* pred) {
+        if (auto it = std::find(mPredecessors.begin(), mPredecessors.end(), pred); it != mPredecessors.end()) {
+            mPredecessors.erase(it);
+        }
+    }
 
-    inline BasicBlock* GetSuccessor()      { return mTrueSuccessor; }
-    inline BasicBlock* GetTrueSuccessor()  { return mTrueSuccessor; }
-    inline BasicBlock* GetFalseSuccessor() { return mFalseSuccessor; }
-    inline std::vector<BasicBlock*> GetSuccessors() const {
-        std::vector<BasicBlock*> succs;
-        if (mTrueSuccessor) {
-            succs.push_back(mTrueSuccessor);
+    // Edge from oldPred now comes from newPred. It keeps its position, and phi inputs of the edge go with it
+    inline void ReplacePredecessor(BasicBlock* oldPred, BasicBlock* newPred) {
+        auto it = std::find(mPredecessors.begin(), mPredecessors.end(), oldPred);
+        if (it == mPredecessors.end() || oldPred == newPred) {
+            return;
         }
-        if (mFalseSuccessor) {
-            succs.push_back(mFalseSuccessor);
+        if (mPredecessors.contains(newPred)) {
+            mPredecessors.erase(it);
+        }
+        else {
+            *it = newPred;
+        }
+        for (Instruction* inst = mFirstInst; inst != nullptr && inst->IsPhi(); inst = inst->GetNext()) {
+            static_cast<InstructionPhi*>(inst)->ReplaceIncomingBlock(oldPred, newPred);
         }
-        return succs;
     }
 
-    inline void SetSuccessor(BasicBlock* succ)      { mTrueSuccessor = succ; }
-    inline void SetTrueSuccessor(BasicBlock* succ)  { mTrueSuccessor = succ; }
-    inline void SetFalseSuccessor(BasicBlock* succ) { mFalseSuccessor = succ; }
+    inline BasicBlock* GetSuccessor()      { return mTrueSuccessor; }
+    inline BasicBlock* GetTrueSuccessor()  { return mTrueSuccessor; }
+    inline BasicBlock* GetFalseSuccessor() { return mFalseSuccessor; }
+
+    // Non-null successors, true one goes first. The span is invalidated by the successor setters
+    inline std::span<BasicBlock* const> GetSuccessors() const { return {mSuccessors, mNumSuccessors}; }
+
+    inline void SetSuccessor(BasicBlock* succ)      { SetTrueSuccessor(succ); }
+    inline void SetTrueSuccessor(BasicBlock* succ)  { mTrueSuccessor = succ; UpdateSuccessors(); }
+    inline void SetFalseSuccessor(BasicBlock* succ) { mFalseSuccessor = succ; UpdateSuccessors(); }
 
     inline BasicBlock* GetImmediateDominator() const { return mImmediateDominator; }
-    inline std::set<BasicBlock*>& GetDominatedBasicBlocks() { return mDominatedBlocks; }
+    inline const DominatorTreeChildList& GetDominatorTreeChildren() const { return mDominatorTreeChildren; }
 
-    inline bool IsDominatedBy(BasicBlock* other) {
-        if (other == nullptr) {
+    // Dominator tree DFS interval of this block is nested into interval of every its dominator.
+    // Every reachable block dominates itself, unreachable ones have no interval
+    inline bool IsDominatedBy(const BasicBlock* other) const {
+        if (other == nullptr || other->mDomTreeEnter == 0) {
             return false;
         }
-        return other->GetDominatedBasicBlocks().contains(this);
+        return other->mDomTreeEnter <= mDomTreeEnter && mDomTreeExit <= other->mDomTreeExit;
     }
 
-    inline bool IsDominatorOf(BasicBlock* other) {
+    inline bool IsDominatorOf(const BasicBlock* other) const {
         if (other == nullptr) {
             return false;
         }
-        return mDominatedBlocks.contains(other);
+        return other->IsDominatedBy(this);
     }
 
     inline void SetImmediateDominator(BasicBlock* dom) { mImmediateDominator = dom; }
-
-    inline bool IsMarked(const MarkerFlags marker = Marker::All) const { return mMarkedFlags & marker; }
-    inline void SetMarked(const MarkerFlags marker = Marker::All)   { mMarkedFlags |= marker; }
-    inline void SetUnmarked(const MarkerFlags marker = Marker::All) { mMarkedFlags &= ~marker; }
+    inline void AddDominatorTreeChild(BasicBlock* child) { mDominatorTreeChildren.push_back(child); }
+    inline void ClearDominatorTreeChildren() { mDominatorTreeChildren.clear(); }
+    inline void SetDominatorTreeInterval(uint32_t enter, uint32_t exit) { mDomTreeEnter = enter; mDomTreeExit = exit; }
 
     inline Loop* GetLoop() const { return mLoop; }
     inline void SetLoop(Loop* loop) { mLoop = loop; }
@@ -273,6 +314,42 @@ public:
     }
 
 private:
+    // Instructions are numbered sparsely, so most insertions fit between the neighbours
+    static constexpr uint32_t InstructionOrderSpacing = 16;
+
+    void AssignInstructionOrder(Instruction* inst, const Instruction* prev, const Instruction* next) {
+        if (!mIsInstructionOrderValid) {
+            return;
+        }
+
+        const uint32_t lower = prev != nullptr ? prev->GetOrder() : 0;
+        if (next == nullptr) {
+            if (lower > UINT32_MAX - InstructionOrderSpacing) {
+                mIsInstructionOrderValid = false;
+                return;
+            }
+            inst->SetOrder(lower + InstructionOrderSpacing);
+            return;
+        }
+
+        const uint32_t upper = next->GetOrder();
+        if (upper - lower < 2) {
+            mIsInstructionOrderValid = false;
+            return;
+        }
+        inst->SetOrder(lower + (upper - lower) / 2);
+    }
+
+    inline void UpdateSuccessors() {
+        mNumSuccessors = 0;
+        if (mTrueSuccessor) {
+            mSuccessors[mNumSuccessors++] = mTrueSuccessor;
+        }
+        if (mFalseSuccessor) {
+            mSuccessors[mNumSuccessors++] = mFalseSuccessor;
+        }
+    }
+
     BasicBlockId mId{-1};
     Function* mParentFunction{nullptr};
     std::string mName{};
@@ -281,18 +358,23 @@ private:
     Instruction* mFirstInst{};
     Instruction* mLastInst{};
     size_t mSize{0};
+    bool mIsInstructionOrderValid{true};
 
-    std::set<BasicBlock*> mPredecessors{};
+    PredecessorList mPredecessors{};
 
     // True successor is also unconditional successor for Jump instruction
     BasicBlock* mTrueSuccessor{nullptr};
     BasicBlock* mFalseSuccessor{nullptr};
 
+    // Compact copy of the successors above, so they can be iterated without branches
+    BasicBlock* mSuccessors[2]{nullptr, nullptr};
+    uint32_t mNumSuccessors{0};
+
     // Information related to dominator tree
     BasicBlock* mImmediateDominator{nullptr};
-    std::set<BasicBlock*> mDominatedBlocks{};
-
-    MarkerFlags mMarkedFlags{Marker::None};
+    DominatorTreeChildList mDominatorTreeChildren{};
+    uint32_t mDomTreeEnter{0};
+    uint32_t mDomTreeExit{0};
 
     Loop* mLoop{nullptr};
 
@@ -0,0 +1,109 @@
+#ifndef BINARY_IR_H
+#define BINARY_IR_H
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <Function.h>
+
+namespace VMIR {
+
+class IRContext;
+
+/*
+    Binary module consists of fixed-size records, so nothing has to be parsed to read it:
+        header
+        constant pool:      type and bits of every constant
+        function table:     signature of every function and the location of its body
+        string table:       names of functions and basic blocks
+        function bodies:    value types, blocks, instructions, operands and predecessors of one function
+
+    Instructions refer to values by their index in the function or to constants by their index in the pool,
+    so every body can be materialized on its own
+*/
+
+// Writes all functions of the context in the binary format
+class BinaryIRWriter {
+public:
+    BinaryIRWriter() = delete;
+    BinaryIRWriter(IRContext* context) : mContext{context} {}
+
+    bool Write(std::ostream& out);
+    bool WriteFile(const std::string& filename);
+
+    inline const std::string& GetError() const { return mError; }
+
+private:
+    bool Error(const std::string& message);
+
+    IRContext* mContext{nullptr};
+    std::string mError{};
+};
+
+
+// Binary module mapped into memory. Functions are created in the context only when they are requested,
+// so the cost of loading is proportional to the functions which are actually used
+class BinaryIRModule {
+public:
+    BinaryIRModule() = delete;
+    BinaryIRModule(IRContext* context) : mContext{context} {}
+    BinaryIRModule(const BinaryIRModule& other) = delete;
+    BinaryIRModule& operator=(const BinaryIRModule& other) = delete;
+
+    ~BinaryIRModule();
+
+    // File stays mapped until the module is destroyed
+    bool Open(const std::string& filename);
+
+    // Data is not copied and has to outlive the module
+    bool Load(std::string_view data);
+
+    size_t GetFunctionCount() const;
+    std::string_view GetFunctionName(size_t idx) const;
+
+    // Materializes the body of the function. Its callees are only declared until they are requested too
+    Function* GetFunction(size_t idx);
+    Function* GetFunction(std::string_view name);
+    bool MaterializeAll();
+
+    inline bool IsMaterialized(size_t idx) const { return idx < mMaterialized.size() && mMaterialized[idx] != 0; }
+    inline size_t GetMaterializedCount() const { return mMaterializedCount; }
+
+    inline const std::string& GetError() const { return mError; }
+
+private:
+    bool Error(const std::string& message);
+    void Unmap();
+
+    // Function with the signature of the record and without a body
+    Function* GetOrDeclareFunction(size_t idx);
+    Value* GetConstant(uint32_t idx);
+    bool Materialize(size_t idx);
+
+    template <typename T>
+    const T* GetRecords(uint64_t offset, uint64_t count) const;
+
+    IRContext* mContext{nullptr};
+    std::string mError{};
+
+    const char* mData{nullptr};
+    size_t mSize{0};
+
+    void* mMapping{nullptr};
+    size_t mMappingSize{0};
+
+    std::vector<Function*> mFunctions{};
+    std::vector<uint8_t> mMaterialized{};
+    size_t mMaterializedCount{0};
+    std::vector<Value*> mConstants{};
+
+    // Built on the first lookup by name
+    std::unordered_map<std::string_view, size_t> mFunctionsByName{};
+};
+
+}   // namespace VMIR
+
+#endif  // BINARY_IR_H
@@ -0,0 +1,90 @@
+#ifndef BIT_VECTOR_H
+#define BIT_VECTOR_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VMIR {
+
+// Set of indices below a fixed size. Set operations go a word at a time in plain loops, so compilers vectorize them
+class BitVector {
+public:
+    using Word = uint64_t;
+    static constexpr size_t kWordBits = 64;
+
+    // Constructors
+    BitVector() = default;
+    explicit BitVector(const size_t size) { Resize(size); }
+
+    // Drops all indices
+    inline void Resize(const size_t size) {
+        mSize = size;
+        mWords.assign((size + kWordBits - 1) / kWordBits, 0);
+    }
+
+    inline size_t Size() const { return mSize; }
+
+    inline bool Test(const size_t idx) const { return (mWords[idx / kWordBits] >> (idx % kWordBits)) & 1; }
+    inline void Set(const size_t idx) { mWords[idx / kWordBits] |= Word{1} << (idx % kWordBits); }
+    inline void Reset(const size_t idx) { mWords[idx / kWordBits] &= ~(Word{1} << (idx % kWordBits)); }
+    inline void Clear() { std::fill(mWords.begin(), mWords.end(), 0); }
+
+    // Both vectors must have the same size. Returns true if any index was added
+    inline bool UniteWith(const BitVector& other) {
+        Word added = 0;
+        const Word* src = other.mWords.data();
+        Word* dst = mWords.data();
+        for (size_t i = 0, count = mWords.size(); i < count; ++i) {
+            added |= src[i] & ~dst[i];
+            dst[i] |= src[i];
+        }
+        return added != 0;
+    }
+
+    inline void Subtract(const BitVector& other) {
+        const Word* src = other.mWords.data();
+        Word* dst = mWords.data();
+        for (size_t i = 0, count = mWords.size(); i < count; ++i) {
+            dst[i] &= ~src[i];
+        }
+    }
+
+    inline size_t Count() const {
+        size_t count = 0;
+        for (Word word : mWords) {
+            count += static_cast<size_t>(std::popcount(word));
+        }
+        return count;
+    }
+
+    inline bool None() const {
+        Word any = 0;
+        for (Word word : mWords) {
+            any |= word;
+        }
+        return any == 0;
+    }
+
+    // Calls the function with every index in increasing order
+    template <typename F>
+    inline void ForEach(F&& func) const {
+        for (size_t i = 0, count = mWords.size(); i < count; ++i) {
+            for (Word word = mWords[i]; word != 0; word &= word - 1) {
+                func(i * kWordBits + static_cast<size_t>(std::countr_zero(word)));
+            }
+        }
+    }
+
+    inline bool operator==(const BitVector& other) const = default;
+
+private:
+    std::vector<Word> mWords{};
+    size_t mSize{0};
+};
+
+}   // namespace VMIR
+
+#endif  // BIT_VECTOR_H
@@ -10,6 +10,12 @@ public:
     CheckEliminationPass();
 
     virtual void Run(Function* func) override;
+    virtual PreservedAnalyses GetPreservedAnalyses() const override;
+    virtual void ReportStatistics(TraceScope& scope) const override;
+
+private:
+    size_t mRemovedNullChecks{0};
+    size_t mRemovedBoundsChecks{0};
 };
 
 }   // namespace VMIR
@@ -13,18 +13,18 @@ public:
     ConstantFoldingPass();
 
     virtual void Run(Function* func) override;
+    virtual PreservedAnalyses GetPreservedAnalyses() const override;
+    virtual void ReportStatistics(TraceScope& scope) const override;
 
 private:
     // Combine optimization and get next instruction because current instruction can be erased due to optimizations
-    Instruction* OptimizeInstructionAndGetNext(Instruction* inst) const;
+    Instruction* OptimizeInstructionAndGetNext(Instruction* inst);
 
     // Optimize arithmetic instruction if both inputs are constants and convert it to Mv with calculated resulting constant
-    Instruction* OptimizeInstructionArithmetic(InstructionArithmetic* inst) const;
+    Instruction* OptimizeInstructionArithmetic(InstructionArithmetic* inst);
 
     // Helper function to get or create Value which holds calculated resulting constant
-    Value* GetOrCreateConstantForMove(Value* input1, Value* input2, InstructionType op) const;
-    
-    void ReplaceMoveUserInputWithConstant(Instruction* user, InstructionMv* instMv) const;
+    Value* GetOrCreateConstantForMove(IRContext* IrContext, Value* input1, Value* input2, InstructionType op) const;
 
     template <typename T>
     T PerformValueOperation(T a, T b, InstructionType op) const {
@@ -90,6 +90,8 @@ private:
             }
         }
     }
+
+    size_t mFoldedInstructions{0};
 };
 
 }   // namespace VMIR
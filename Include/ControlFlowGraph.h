@@ -1,27 +1,75 @@
 #ifndef CONTROL_FLOW_GRAPH_H
 #define CONTROL_FLOW_GRAPH_H
 
+#include <vector>
+#include <algorithm>
+
 #include <BasicBlock.h>
 #include <Function.h>
 
 namespace VMIR {
 
+class TraceRecorder;
+
+// Set of basic blocks visited by one traversal. Blocks are looked up by their ids. Starting next traversal
+// just bumps the epoch, so nothing has to be unmarked and several traversals can run at once
+class VisitedBlocks {
+public:
+    inline void NextEpoch() {
+        if (++mEpoch == 0) {
+            std::fill(mEpochs.begin(), mEpochs.end(), 0);
+            mEpoch = 1;
+        }
+    }
+
+    inline bool IsVisited(const BasicBlock* bb) const {
+        const size_t idx = static_cast<size_t>(bb->GetId());
+        return idx < mEpochs.size() && mEpochs[idx] == mEpoch;
+    }
+
+    // Returns false if the block has already been visited
+    inline bool Visit(const BasicBlock* bb) {
+        const size_t idx = static_cast<size_t>(bb->GetId());
+        if (idx >= mEpochs.size()) {
+            mEpochs.resize(idx + 1, 0);
+        }
+        if (mEpochs[idx] == mEpoch) {
+            return false;
+        }
+        mEpochs[idx] = mEpoch;
+        return true;
+    }
+
+    inline void Unvisit(const BasicBlock* bb) {
+        const size_t idx = static_cast<size_t>(bb->GetId());
+        if (idx < mEpochs.size()) {
+            mEpochs[idx] = 0;
+        }
+    }
+
+private:
+    std::vector<uint32_t> mEpochs{};
+    uint32_t mEpoch{1};
+};
+
+
 class DFS {
 public:
     void Run(BasicBlock* entryBB, BasicBlock* ignoredBB = nullptr);
 
     inline std::vector<BasicBlock*>& GetBasicBlocks() { return mDFSVector; }
-    inline BasicBlock::Marker GetMarker() const { return mMarker; }
-    inline void SetMarker(const BasicBlock::Marker marker) { mMarker = marker; }
     inline void Clear() { mDFSVector.clear(); }
     inline void SetReverse(bool reverse = true) { mReverse = reverse; }
-    void UnmarkAll();
 
 private:
-    void DFSInternal(BasicBlock* block, BasicBlock* ignoredBB);
+    struct Frame {
+        BasicBlock* block;
+        uint32_t nextEdge;
+    };
 
     std::vector<BasicBlock*> mDFSVector{};
-    BasicBlock::Marker mMarker = BasicBlock::Marker::All;
+    std::vector<Frame> mStack{};
+    VisitedBlocks mVisited{};
     bool mReverse{false};
 };
 
@@ -31,16 +79,17 @@ public:
     void Run(BasicBlock* entryBB, size_t* pCount, BasicBlock* ignoredBB = nullptr);
 
     inline std::vector<BasicBlock*>& GetBasicBlocks() { return mRPOVector; }
-    inline BasicBlock::Marker GetMarker() const { return mMarker; }
-    inline void SetMarker(const BasicBlock::Marker marker) { mMarker = marker; }
     inline void Clear() { mRPOVector.clear(); }
-    void UnmarkAll();
 
 private:
-    void RPOInternal(BasicBlock* entryBB, size_t* pCount, BasicBlock* ignoredBB);
+    struct Frame {
+        BasicBlock* block;
+        uint32_t nextSucc;
+    };
 
     std::vector<BasicBlock*> mRPOVector{};
-    BasicBlock::Marker mMarker = BasicBlock::Marker::All;
+    std::vector<Frame> mStack{};
+    VisitedBlocks mVisited{};
 };
 
 
@@ -52,18 +101,29 @@ public:
     
     inline const std::vector<BasicBlock*>& GetBasicBlocks() const { return mGraph; }
     inline BasicBlock* GetEntryBasicBlock() const { return mEntry; }
+    inline const Function* GetFunction() const { return mFunction; }
+
+    // Recorder of the function's context, null if the graph is not built over a function or tracing is off
+    TraceRecorder* GetTraceRecorder() const;
 
     bool GenerateDotFileCFG(const std::string& filename);
     bool GenerateDotFileDomTree(const std::string& filename);
 
     void BuildDominatorTree();
     inline bool IsDominatorTreeBuilt() const { return mDomTreeBuilt; }
+    inline void InvalidateDominatorTree() { mDomTreeBuilt = false; }
+
+    // Copy the blocks of the function again after its control flow has changed
+    void Refresh();
 
 private:
+    void NumberDominatorTree();
+
     // Each basic block contains its predecessors and successors
     // So, we store only basic blocks
     std::vector<BasicBlock*> mGraph{};
     BasicBlock* mEntry{};
+    const Function* mFunction{nullptr};
     bool mDomTreeBuilt{false};
 };
 
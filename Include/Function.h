@@ -5,17 +5,27 @@
 
 namespace VMIR {
 
+class IRContext;
+
+// Graph coloring spends more compile time on the interference graph and gets fewer stack accesses
+enum class RegisterAllocationMode {
+    LinearScan,
+    GraphColoring
+};
+
 class Function {
 public:
     // Constructors
-    Function(const std::string& name = "") : mName{name}, mRetType{ValueType::Void} {};
-    Function(const ValueType retType, const std::string& name = "") : mName{name}, mRetType{retType} {};
+    Function(IRContext* context, const std::string& name = "") : mContext{context}, mName{name}, mRetType{ValueType::Void} {};
+    Function(IRContext* context, const ValueType retType, const std::string& name = "") : mContext{context}, mName{name}, mRetType{retType} {};
 
-    Function(const std::vector<ValueType>& argsTypes, const std::string& name = "");
-    Function(const ValueType retType, const std::vector<ValueType>& argsTypes, const std::string& name = "");
+    Function(IRContext* context, const std::vector<ValueType>& argsTypes, const std::string& name = "");
+    Function(IRContext* context, const ValueType retType, const std::vector<ValueType>& argsTypes, const std::string& name = "");
 
     // Getters
-    inline std::string GetName() const { return mName; }
+    inline IRContext* GetContext() const { return mContext; }
+
+    inline const std::string& GetName() const { return mName; }
 
     inline ValueType GetReturnType() const { return mRetType; }
     inline const std::vector<Value*>& GetArgs() const { return mArgs; }
@@ -30,9 +40,12 @@ public:
     size_t GetInstructionCount() const;
     size_t GetReturnCount() const;
 
+    inline RegisterAllocationMode GetRegisterAllocationMode() const { return mRegisterAllocationMode; }
+
     // Setters
     inline void SetName(const std::string& name) { mName = name; }
     inline void SetEntryBasicBlock(BasicBlock* basicBlock) { mEntry = basicBlock; }
+    inline void SetRegisterAllocationMode(RegisterAllocationMode mode) { mRegisterAllocationMode = mode; }
 
     inline void AppendBasicBlock(BasicBlock* basicBlock) {
         if (basicBlock) {
@@ -41,6 +54,12 @@ public:
         }
     }
 
+    // Blocks are only detached, they stay in the context
+    inline void ClearBasicBlocks() {
+        mBasicBlocks.clear();
+        mEntry = nullptr;
+    }
+
     inline void Print(std::ostream& out) const {
         out << "function " << ValueTypeToIdStr(mRetType) << " ";
 
@@ -80,11 +99,13 @@ public:
     }
 
 private:
+    IRContext* mContext{nullptr};
     std::string mName{};
     ValueType mRetType{ValueType::Unknown};
     std::vector<Value*> mArgs{};
     std::vector<BasicBlock*> mBasicBlocks{};
     BasicBlock* mEntry{};
+    RegisterAllocationMode mRegisterAllocationMode{RegisterAllocationMode::LinearScan};
 };
 
 }   // namespace VMIR
@@ -0,0 +1,195 @@
+#ifndef GRAPH_COLORING_ALLOCATOR_H
+#define GRAPH_COLORING_ALLOCATOR_H
+
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+#include <ControlFlowGraph.h>
+#include <RegisterAllocator.h>
+#include <BitVector.h>
+
+namespace VMIR {
+
+class LivenessAnalyzer;
+
+/*
+    Iterated register coalescing of George and Appel. Interference graph is built from the livesets and kept as a bit
+    matrix along with adjacency lists, one graph per register class. Copies of Mv and Phi are coalesced when the Briggs
+    or the George test shows it does not make the graph harder to color. Spill candidate has the least cost per degree,
+    cost is the number of stack accesses it would need weighted by loop depth. Spilled value which leaves its block is
+    rewritten and the graph is built and colored again: the value lives in its stack slot, the definition goes to a
+    temporary stored right after it, and every other block which uses the value more than once gets a temporary
+    loaded before the first use. Temporaries are split parts of the value with moves before instructions, the code
+    itself is not changed. Other spilled values, the ones spilled in the last round and temporaries which got no
+    register stay in the stack slot
+*/
+class GraphColoringAllocator {
+public:
+    GraphColoringAllocator() = delete;
+    GraphColoringAllocator(LivenessAnalyzer* livenessAnalyzer, uint32_t GPRegCount, uint32_t FPRegCount) : mLivenessAnalyzer{livenessAnalyzer}, mGPRegisterCount{GPRegCount}, mFPRegisterCount{FPRegCount} {}
+
+    // Sets locations of the outputs of all instructions. Stack slots are numbered from firstStackLocation
+    void PerformRegisterAllocation(uint32_t firstStackLocation = 0);
+
+    inline uint32_t GetStackLocationCount() const { return mStackLocationCount; }
+    inline uint64_t GetCoalescedMoveCount() const { return mCoalescedMoveCount; }
+    inline uint64_t GetInterferenceCount() const { return mInterferenceCount; }
+    inline uint64_t GetSplitCount() const { return mSplitCount; }
+
+    // Loads and stores of the rewritten values, done at once right before the instruction
+    inline const std::unordered_map<const Instruction*, std::vector<RegisterAllocator::Move>>& GetInstructionMoves() const { return mInstructionMoves; }
+
+private:
+    static constexpr size_t kNoNode = SIZE_MAX;
+    static constexpr uint32_t kNoStackLocation = UINT32_MAX;
+    static constexpr uint32_t kMaxRewriteRounds = 4;
+
+    enum class NodeState : uint8_t {
+        Initial,
+        Simplify,
+        Freeze,
+        Spill,
+        Selected,
+        Coalesced,
+        Colored,
+        Spilled
+    };
+
+    enum class MoveState : uint8_t {
+        Worklist,
+        Active,
+        Coalesced,
+        Constrained,
+        Frozen
+    };
+
+    struct Node {
+        Value* value;
+
+        // Temporaries of rewritten values live in one block
+        const BasicBlock* block{nullptr};
+        NodeState state{NodeState::Initial};
+        uint32_t degree{0};
+        uint32_t color{0};
+        size_t alias{kNoNode};
+        double cost{0};
+        std::vector<size_t> adjacent{};
+        std::vector<size_t> moves{};
+    };
+
+    // Copy from src to dst, both are nodes
+    struct CopyMove {
+        size_t dst;
+        size_t src;
+        MoveState state{MoveState::Worklist};
+    };
+
+    // Part of a rewritten value in one block: from its definition or from the load before the first use to the last
+    // use, or to the block end when phis of the successors read it
+    struct Temporary {
+        size_t node;
+        const Instruction* first;
+        const Instruction* last;
+        bool isDefinition;
+        bool isEdgeUse;
+    };
+
+    void AllocateClass(bool isGP);
+    void CreateNodes(bool isGP);
+    void CreateTemporaries(const BasicBlock* bb);
+    bool RewriteSpilled();
+    void Build();
+    void MakeWorklists();
+    void Simplify();
+    void Coalesce();
+    void Freeze();
+    void SelectSpill();
+    void AssignColors();
+    void AssignLocations(bool isGP);
+    void AssignRewrittenLocation(Value* value, const std::vector<const Temporary*>& temporaries, bool isGP);
+
+    void AddEdge(size_t u, size_t v);
+    void AddMove(size_t dst, size_t src);
+    void DecrementDegree(size_t node);
+    void EnableMoves(size_t node);
+    void AddToSimplify(size_t node);
+    void Combine(size_t u, size_t v);
+    void FreezeMoves(size_t node);
+    bool IsMoveRelated(size_t node) const;
+    bool BriggsTest(size_t u, size_t v) const;
+    bool GeorgeTest(size_t u, size_t v) const;
+    size_t GetAlias(size_t node) const;
+
+    void PushNode(NodeState state, size_t node);
+    bool HasNode(std::vector<size_t>& worklist, NodeState state);
+    bool HasMove();
+
+    inline bool IsAdjacent(size_t u, size_t v) const { return mAdjacency.Test(u * mNodes.size() + v); }
+    inline bool IsSignificant(size_t node) const { return mNodes[node].degree >= mRegisterCount; }
+    size_t GetNode(const Value* value, const BasicBlock* bb) const;
+    size_t GetNode(size_t valueIdx, const BasicBlock* bb) const;
+    bool IsLiveOutOfDefinition(const Value* value) const;
+    bool IsUsedByNextOnly(const Value* value) const;
+    Location GetRegisterLocation(const Node& node, bool isGP) const;
+    StackLocation GetStackLocation(Node& node);
+
+    // Neighbours still in the graph, removed and coalesced ones are skipped
+    template <typename F>
+    inline void ForEachAdjacent(size_t node, F&& func) const {
+        const auto& adjacent = mNodes[node].adjacent;
+        for (size_t i = 0; i < adjacent.size(); ++i) {
+            const NodeState state = mNodes[adjacent[i]].state;
+            if (state != NodeState::Selected && state != NodeState::Coalesced) {
+                func(adjacent[i]);
+            }
+        }
+    }
+
+    // Moves which still may be coalesced
+    template <typename F>
+    inline void ForEachNodeMove(size_t node, F&& func) {
+        const auto& moves = mNodes[node].moves;
+        for (size_t i = 0; i < moves.size(); ++i) {
+            const MoveState state = mMoves[moves[i]].state;
+            if (state == MoveState::Worklist || state == MoveState::Active) {
+                func(moves[i]);
+            }
+        }
+    }
+
+    LivenessAnalyzer* mLivenessAnalyzer{nullptr};
+    uint32_t mGPRegisterCount{};
+    uint32_t mFPRegisterCount{};
+
+    // State of the register class being colored
+    uint32_t mRegisterCount{};
+    std::vector<Node> mNodes{};
+    std::vector<size_t> mNodeByValueIndex{};
+    BitVector mAdjacency{};
+    std::vector<CopyMove> mMoves{};
+
+    // Rewritten values live in stack slots and are represented in blocks by their temporaries
+    BitVector mRewritten{};
+    std::map<std::pair<const BasicBlock*, size_t>, Temporary> mTemporaries{};
+
+    // Worklists drop nodes lazily: an entry is valid while the node has the state of the list
+    std::vector<size_t> mSimplifyWorklist{};
+    std::vector<size_t> mFreezeWorklist{};
+    std::vector<size_t> mSpillWorklist{};
+    std::vector<size_t> mMoveWorklist{};
+    std::vector<size_t> mSelectStack{};
+
+    std::unordered_map<const Instruction*, std::vector<RegisterAllocator::Move>> mInstructionMoves{};
+
+    uint32_t mNextStackLocation{0};
+    uint32_t mStackLocationCount{0};
+    uint64_t mCoalescedMoveCount{0};
+    uint64_t mInterferenceCount{0};
+    uint64_t mSplitCount{0};
+};
+
+}   // namespace VMIR
+
+#endif  // GRAPH_COLORING_ALLOCATOR_H
@@ -4,7 +4,10 @@
 #include <unordered_map>
 #include <limits>
 #include <list>
+#include <mutex>
+#include <vector>
 
+#include <Arena.h>
 #include <Instruction.h>
 #include <BasicBlock.h>
 #include <Function.h>
@@ -12,28 +15,44 @@
 #include <LoopAnalyzer.h>
 #include <LivenessAnalyzer.h>
 #include <RegisterAllocator.h>
+#include <Pass.h>
+#include <Trace.h>
 
 namespace VMIR {
 
-// Make it singleton
-class IRBuilder {
-public:
-	IRBuilder(const IRBuilder& other) = delete;
+// Constants are interned by their type and exact bits
+struct ConstantKey {
+    ValueType type;
+    uint64_t bits;
 
-	static IRBuilder* GetInstance() {
-		if (!mInstancePtr)
-			mInstancePtr = new IRBuilder();
+    bool operator==(const ConstantKey&) const = default;
+};
 
-		return mInstancePtr;
-	}
+struct ConstantKeyHash {
+    inline size_t operator()(const ConstantKey& key) const {
+        // Fibonacci hashing spreads small integers, which are the most common constants
+        uint64_t h = (key.bits ^ (static_cast<uint64_t>(key.type) << 56)) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+};
 
-    ~IRBuilder();
+// Owns every IR object and cached analysis of one compilation job and creates them.
+// Contexts share nothing, so independent jobs can run on different threads.
+// Creation and removal of objects are serialized, so functions of one context can be processed in parallel
+class IRContext {
+public:
+    IRContext();
+    IRContext(const IRContext& other) = delete;
+    IRContext& operator=(const IRContext& other) = delete;
 
-private:
-	static IRBuilder* mInstancePtr;
-	IRBuilder();
+    ~IRContext();
+
+    // Default context for code which compiles a single job
+    static IRContext* GetInstance() {
+        static IRContext* instance = new IRContext();
+        return instance;
+    }
 
-public:
     Function* CreateFunction(const std::string& name = "");
     Function* CreateFunction(const ValueType retType, const std::string& name = "");
     Function* CreateFunction(const std::vector<ValueType>& argsTypes, const std::string& name = "");
@@ -46,33 +65,31 @@ public:
 
 
     inline Value* CreateValue(const ValueType vt) {
+        std::lock_guard lock{mMutex};
         ValueId id = GenerateNewValueId();
-        Value* v = new Value(id, vt);
-        mValues.emplace(id, v);
+        Value* v = mArena.New<Value>(id, vt);
+        mValues.push_back(v);
         return v;
     }
 
     template <typename T>
     requires NumericType<T>
     inline Value* CreateValue(const T value) {
+        std::lock_guard lock{mMutex};
         ValueId id = GenerateNewValueWithDataId();
-        Value* v = new Value(id, value);
-        mValuesWithData.emplace(id, v);
+        Value* v = mArena.New<Value>(id, value);
+        mValuesWithData.push_back(v);
+        // The first constant with such data becomes the canonical one
+        mConstantPool.try_emplace(ConstantKey{TypeToValueType<T>(), ToBitPattern(value)}, v);
         return v;
     }
 
     template <typename T>
     requires NumericType<T>
     inline Value* GetOrCreateValueWithData(const T data) {
-        auto it = std::find_if(mValuesWithData.begin(), mValuesWithData.end(), [data](const auto& e) {
-            Value* v = e.second;
-            if (v->GetValueType() != TypeToValueType<T>()) {
-                return false;
-            }
-            return v->GetValue<T>().value() == data;
-        });
-
-        if (it != mValuesWithData.end()) {
+        std::lock_guard lock{mMutex};
+        auto it = mConstantPool.find(ConstantKey{TypeToValueType<T>(), ToBitPattern(data)});
+        if (it != mConstantPool.end()) {
             return it->second;
         }
         return CreateValue<T>(data);
@@ -199,9 +216,12 @@ public:
     InstructionAlloc* CreateAlloc(BasicBlock* parentBasicBlock, Value* output, ValueType type, size_t count = 1);
 
     InstructionPhi* CreatePhi();
-    InstructionPhi* CreatePhi(const std::list<Value*>& inputs, Value* output);
+    InstructionPhi* CreatePhi(const std::vector<Value*>& inputs, Value* output);
     InstructionPhi* CreatePhi(BasicBlock* parentBasicBlock);
-    InstructionPhi* CreatePhi(BasicBlock* parentBasicBlock, const std::list<Value*>& inputs, Value* output);
+    // Inputs produced in a predecessor come along its edge, a single other input takes the edge left.
+    // Phis with more such inputs need the explicit incoming blocks
+    InstructionPhi* CreatePhi(BasicBlock* parentBasicBlock, const std::vector<Value*>& inputs, Value* output);
+    InstructionPhi* CreatePhi(BasicBlock* parentBasicBlock, const std::vector<Value*>& inputs, const std::vector<BasicBlock*>& incomingBlocks, Value* output);
 
     InstructionMv* CreateMv();
     InstructionMv* CreateMv(Value* input, Value* output);
@@ -220,6 +240,7 @@ public:
 
 
     Value* CopyValue(Value* src);
+    // Copy has the same type and number of operands, but all operands are empty
     Instruction* CopyInstruction(Instruction* src);
     BasicBlock* CopyBasicBlock(BasicBlock* src);
     Function* CopyFunction(Function* src);
@@ -233,18 +254,27 @@ public:
             return;
         }
 
+        std::lock_guard lock{mMutex};
+
         ValueId id = value->GetId();
         if (id == -1) {
             return;
         }
 
-        if (mValues.contains(id)) {
-            delete mValues[id];
-            mValues.erase(id);
+        Value** slot = nullptr;
+        if (id <= mValuesIDs) {
+            slot = &mValues[static_cast<size_t>(id)];
         }
-        if (mValuesWithData.contains(id)) {
-            delete mValuesWithData[id];
-            mValuesWithData.erase(id);
+        else if (id >= mValuesWithDataIDs) {
+            slot = &mValuesWithData[ValueWithDataIndex(id)];
+        }
+
+        if (slot && *slot == value) {
+            if (value->HasValue()) {
+                ForgetConstant(value);
+            }
+            mArena.Delete(value);
+            *slot = nullptr;
         }
     }
 
@@ -253,14 +283,17 @@ public:
             return;
         }
 
+        std::lock_guard lock{mMutex};
+
         InstructionId id = inst->GetId();
-        if (id == -1) {
+        if (id == -1 || id > mInstructionsIDs) {
             return;
         }
 
-        if (mInstructions.contains(id)) {
-            delete mInstructions[id];
-            mInstructions.erase(id);
+        Instruction*& slot = mInstructions[static_cast<size_t>(id)];
+        if (slot == inst) {
+            DestroyInstruction(inst);
+            slot = nullptr;
         }
     }
 
@@ -269,14 +302,27 @@ public:
             return;
         }
 
+        std::lock_guard lock{mMutex};
+
         BasicBlockId id = bb->GetId();
-        if (id == -1) {
+        if (id == -1 || id > mBasicBlockIDs) {
             return;
         }
 
-        if (mBasicBlocks.contains(id)) {
-            delete mBasicBlocks[id];
-            mBasicBlocks.erase(id);
+        BasicBlock*& slot = mBasicBlocks[static_cast<size_t>(id)];
+        if (slot == bb) {
+            mArena.Delete(bb);
+            slot = nullptr;
+        }
+    }
+
+    // Functions are printed in the order they are kept in
+    void MoveFunctionToBack(Function* func) {
+        std::lock_guard lock{mMutex};
+
+        auto it = std::find(mFunctions.begin(), mFunctions.end(), func);
+        if (it != mFunctions.end()) {
+            mFunctions.splice(mFunctions.end(), mFunctions, it);
         }
     }
 
@@ -285,12 +331,14 @@ public:
             return;
         }
 
+        std::lock_guard lock{mMutex};
+
         auto it = std::find(mFunctions.begin(), mFunctions.end(), func);
         if (it == mFunctions.end()) {
             return;
         }
 
-        delete *it;
+        mArena.Delete(func);
         mFunctions.erase(it);
 
         if (mGraphs.contains(func)) {
@@ -316,30 +364,35 @@ public:
 
 
     inline ControlFlowGraph* CreateControlFlowGraph(Function* function) {
+        std::lock_guard lock{mMutex};
         ControlFlowGraph* cfg = new ControlFlowGraph(function);
         mGraphs.insert({function, cfg});
         return cfg;
     }
 
     inline LoopAnalyzer* CreateLoopAnalyzer(ControlFlowGraph* graph) {
+        std::lock_guard lock{mMutex};
         LoopAnalyzer* loopAnalyzer = new LoopAnalyzer(graph);
         mLoopAnalyzers.insert({graph, loopAnalyzer});
         return loopAnalyzer;
     }
 
     inline LivenessAnalyzer* CreateLivenessAnalyzer(ControlFlowGraph* graph) {
-        LivenessAnalyzer* livenessAnalyzer = new LivenessAnalyzer(graph);
+        std::lock_guard lock{mMutex};
+        LivenessAnalyzer* livenessAnalyzer = new LivenessAnalyzer(this, graph);
         mLivenessAnalyzers.insert({graph, livenessAnalyzer});
         return livenessAnalyzer;
     }
 
     inline RegisterAllocator* CreateRegisterAllocator(ControlFlowGraph* graph, uint32_t GPRegCount, uint32_t FPRegCount) {
-        RegisterAllocator* registerAllocator = new RegisterAllocator(graph, GPRegCount, FPRegCount);
+        std::lock_guard lock{mMutex};
+        RegisterAllocator* registerAllocator = new RegisterAllocator(this, graph, GPRegCount, FPRegCount);
         mRegisterAllocators.insert({graph, registerAllocator});
         return registerAllocator;
     }
 
     inline ControlFlowGraph* GetOrCreateControlFlowGraph(Function* function) {
+        std::lock_guard lock{mMutex};
         if (auto it = mGraphs.find(function); it != mGraphs.end()) {
             return it->second;
         }
@@ -347,6 +400,7 @@ public:
     }
 
     inline LoopAnalyzer* GetOrCreateLoopAnalyzer(ControlFlowGraph* graph) {
+        std::lock_guard lock{mMutex};
         if (auto it = mLoopAnalyzers.find(graph); it != mLoopAnalyzers.end()) {
             return it->second;
         }
@@ -354,6 +408,7 @@ public:
     }
 
     inline LivenessAnalyzer* GetOrCreateLivenessAnalyzer(ControlFlowGraph* graph) {
+        std::lock_guard lock{mMutex};
         if (auto it = mLivenessAnalyzers.find(graph); it != mLivenessAnalyzers.end()) {
             return it->second;
         }
@@ -361,27 +416,45 @@ public:
     }
 
     inline RegisterAllocator* GetOrCreateRegisterAllocator(ControlFlowGraph* graph, uint32_t GPRegCount, uint32_t FPRegCount) {
+        std::lock_guard lock{mMutex};
         if (auto it = mRegisterAllocators.find(graph); it != mRegisterAllocators.end()) {
             return it->second;
         }
         return CreateRegisterAllocator(graph, GPRegCount, FPRegCount);
     }
 
+    // Passes and analyses over functions of this context are traced only while a recorder is attached
+    inline TraceRecorder* GetTraceRecorder() const { return mTraceRecorder; }
+    inline void SetTraceRecorder(TraceRecorder* recorder) { mTraceRecorder = recorder; }
+
+    // Mark cached analyses of the function as not computed, unless they are preserved. They are rebuilt on the next use
+    void InvalidateAnalyses(Function* function, const PreservedAnalyses& preserved);
+
     inline void Cleanup() {
-        for (const auto& v : mValues) {
-            delete v.second;
+        // IR objects live in the arena, so only run their destructors and then drop all the memory at once.
+        // Instructions go first, so values are destroyed with empty use-lists
+        for (auto* i : mInstructions) {
+            if (i) {
+                i->~Instruction();
+            }
         }
-        for (const auto& v : mValuesWithData) {
-            delete v.second;
+        for (auto* v : mValues) {
+            if (v) {
+                v->~Value();
+            }
         }
-        for (const auto& i : mInstructions) {
-            delete i.second;
+        for (auto* v : mValuesWithData) {
+            if (v) {
+                v->~Value();
+            }
         }
-        for (const auto& b : mBasicBlocks) {
-            delete b.second;
+        for (auto* b : mBasicBlocks) {
+            if (b) {
+                b->~BasicBlock();
+            }
         }
-        for (const auto* f : mFunctions) {
-            delete f;
+        for (auto* f : mFunctions) {
+            f->~Function();
         }
         for (const auto& cfg : mGraphs) {
             delete cfg.second;
@@ -401,17 +474,23 @@ public:
         mInstructions.clear();
         mValues.clear();
         mValuesWithData.clear();
+        mConstantPool.clear();
         mGraphs.clear();
         mLoopAnalyzers.clear();
         mLivenessAnalyzers.clear();
         mRegisterAllocators.clear();
 
+        mArena.Release();
+
         mValuesIDs = -1;
         mValuesWithDataIDs = std::numeric_limits<ValueId>::max();
         mInstructionsIDs = -1;
         mBasicBlockIDs = -1;
     }
 
+    // Functions are listed in the order of creation
+    inline const std::list<Function*>& GetFunctions() const { return mFunctions; }
+
     void PrintIR(std::ostream& out);
     void PrintDebug(std::ostream& out);
 
@@ -432,16 +511,53 @@ private:
         return ++mBasicBlockIDs;
     }
 
+    // Values with data are numbered downwards starting from max - 1
+    static size_t ValueWithDataIndex(const ValueId id) {
+        return static_cast<size_t>(std::numeric_limits<ValueId>::max() - 1 - id);
+    }
+
+    // Remove the constant from the pool if it is the canonical one
+    void ForgetConstant(Value* value);
+
+    // Run the destructor of the exact instruction class and put its memory back to the arena
+    void DestroyInstruction(Instruction* inst);
+
+    template <typename InstructionT, typename... Args>
+    InstructionT* NewInstruction(Args&&... args) {
+        std::lock_guard lock{mMutex};
+        InstructionT* inst = mArena.New<InstructionT>(GenerateNewInstructionId(), std::forward<Args>(args)...);
+        mInstructions.push_back(inst);
+        return inst;
+    }
+
+    // Variadic instructions keep their operands right after the object
+    template <typename InstructionT, typename... Args>
+    InstructionT* NewInstructionWithExtraStorage(size_t extraSize, Args&&... args) {
+        std::lock_guard lock{mMutex};
+        InstructionT* inst = mArena.NewWithExtraStorage<InstructionT>(extraSize, GenerateNewInstructionId(), std::forward<Args>(args)...);
+        mInstructions.push_back(inst);
+        return inst;
+    }
+
+    // Recursive, since creation of some objects creates others, e.g. a function creates its arguments
+    std::recursive_mutex mMutex{};
+
+    // All Values, Instructions, BasicBlocks and Functions are allocated here
+    Arena mArena{};
+
     ValueId mValuesIDs = -1;
     ValueId mValuesWithDataIDs = std::numeric_limits<ValueId>::max();
     InstructionId mInstructionsIDs = -1;
     BasicBlockId mBasicBlockIDs = -1;
 
     // Deliberately differentiate between Values with no data and Values with data
-    std::unordered_map<ValueId, Value*> mValues{};
-    std::unordered_map<ValueId, Value*> mValuesWithData{};
-    std::unordered_map<InstructionId, Instruction*> mInstructions{};
-    std::unordered_map<BasicBlockId, BasicBlock*> mBasicBlocks{};
+    // Objects are indexed by their ids, removed ones leave nullptr behind
+    std::vector<Value*> mValues{};
+    std::vector<Value*> mValuesWithData{};
+    std::vector<Instruction*> mInstructions{};
+    std::vector<BasicBlock*> mBasicBlocks{};
+
+    std::unordered_map<ConstantKey, Value*, ConstantKeyHash> mConstantPool{};
 
     std::list<Function*> mFunctions{};
 
@@ -449,8 +565,13 @@ private:
     std::unordered_map<ControlFlowGraph*, LoopAnalyzer*> mLoopAnalyzers{};
     std::unordered_map<ControlFlowGraph*, LivenessAnalyzer*> mLivenessAnalyzers{};
     std::unordered_map<ControlFlowGraph*, RegisterAllocator*> mRegisterAllocators{};
+
+    TraceRecorder* mTraceRecorder{nullptr};
 };
 
+// The context is the builder of its IR
+using IRBuilder = IRContext;
+
 }
 
 #endif  // IR_BUILDER_H
@@ -0,0 +1,100 @@
+#ifndef IR_PARSER_H
+#define IR_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <Function.h>
+
+namespace VMIR {
+
+class IRContext;
+
+// Reads functions in the text format written by IRContext::PrintIR and creates them in the context.
+// Text is read in a single pass: values, basic blocks and functions may be used before they are defined
+class IRParser {
+public:
+    IRParser() = delete;
+    IRParser(IRContext* context) : mContext{context} {}
+
+    // On failure GetError() describes the first problem. Functions parsed before it stay in the context
+    bool Parse(std::string_view text);
+    bool ParseFile(const std::string& filename);
+
+    inline const std::string& GetError() const { return mError; }
+
+    // Functions defined by the parsed text in order of their definitions
+    inline const std::vector<Function*>& GetFunctions() const { return mFunctions; }
+
+private:
+    // Value "vN" of the current function is kept in slot N. Slots of other functions are told apart by the epoch
+    struct ValueSlot {
+        Value* value{nullptr};
+        uint32_t epoch{0};
+        bool isForwardReference{false};
+    };
+
+    struct BasicBlockSlot {
+        BasicBlock* block{nullptr};
+        bool isDefined{false};
+    };
+
+    // Predecessors listed in the header of a block, their names are kept in mPredecessorNames
+    struct PredecessorList {
+        BasicBlock* block{nullptr};
+        uint32_t begin{0};
+        uint32_t end{0};
+    };
+
+    bool Error(const std::string& message);
+
+    void SkipSpace();
+    void SkipInlineSpace();
+    bool IsAtLineEnd();
+    bool Consume(char c);
+    bool Expect(char c);
+    std::string_view ReadWord();
+
+    bool ParseType(ValueType& type);
+    bool ParseFunction();
+    bool ParseBasicBlockHeader(std::string_view name);
+    bool ParseInstruction(std::string_view first);
+    bool ParseCall(std::string_view outputName);
+    bool FinishFunction();
+
+    Value* ParseOperand(ValueType type);
+    Value* ParseConstant(std::string_view word, ValueType type);
+    bool DefineValue(std::string_view name, Value* value);
+    ValueSlot* GetValueSlot(std::string_view name);
+
+    BasicBlock* GetBasicBlock(std::string_view name);
+    BasicBlock* ParseBasicBlockReference();
+
+    IRContext* mContext{nullptr};
+    std::string mError{};
+    std::vector<Function*> mFunctions{};
+    std::unordered_map<std::string, Function*> mFunctionsByName{};
+
+    std::string_view mText{};
+    size_t mPos{0};
+
+    // State of the function being parsed
+    Function* mFunction{nullptr};
+    BasicBlock* mBasicBlock{nullptr};
+    std::vector<ValueSlot> mValueSlots{};
+    uint32_t mEpoch{0};
+    size_t mForwardReferences{0};
+    std::unordered_map<std::string_view, BasicBlockSlot> mBasicBlocks{};
+    std::vector<PredecessorList> mPredecessorLists{};
+    std::vector<std::string_view> mPredecessorNames{};
+
+    // Reused for operands of phis and calls
+    std::vector<Value*> mOperands{};
+    std::vector<ValueType> mTypes{};
+};
+
+}   // namespace VMIR
+
+#endif  // IR_PARSER_H
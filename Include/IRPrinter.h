@@ -0,0 +1,49 @@
+#ifndef IR_PRINTER_H
+#define IR_PRINTER_H
+
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include <Function.h>
+
+namespace VMIR {
+
+class IRContext;
+
+// Writes IR straight into a reusable buffer, without temporary strings.
+// Output is the same as of Function::Print and Instruction::GetAsString
+class IRPrinter {
+public:
+    IRPrinter() = default;
+
+    // Buffer is passed to the stream every time it grows over kFlushThreshold
+    void PrintIR(const IRContext* context, std::ostream& out);
+
+    void PrintFunction(const Function* func);
+    void PrintBasicBlock(const BasicBlock* bb);
+    void PrintInstruction(const Instruction* inst);
+    void PrintValue(const Value* value);
+
+    inline std::string_view GetBuffer() const { return mBuffer; }
+    inline void Clear() { mBuffer.clear(); }
+    void Flush(std::ostream& out);
+
+    static constexpr size_t kFlushThreshold = 64 * 1024;
+
+private:
+    inline void Append(std::string_view str) { mBuffer.append(str); }
+    inline void Append(char c) { mBuffer.push_back(c); }
+
+    template <typename T>
+    void AppendNumber(T number);
+
+    void AppendBasicBlockName(const BasicBlock* bb);
+    void AppendTypedValue(const Value* value);
+
+    std::string mBuffer{};
+};
+
+}   // namespace VMIR
+
+#endif  // IR_PRINTER_H
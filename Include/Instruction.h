@@ -3,9 +3,10 @@
 
 #include <string>
 #include <vector>
-#include <list>
+#include <span>
 
 #include <Value.h>
+#include <SmallVector.h>
 
 namespace VMIR {
 
@@ -91,7 +92,6 @@ public:
     virtual bool IsValid() const = 0;
     virtual bool IsTerminator() const { return false; }
     virtual Value* GetOutput() const { return nullptr; }
-    virtual void PopulateInputs(std::vector<Value*>& inputs) const { (void)inputs; }
 
     bool IsArithmetic() const { return mType == InstructionType::Add
                                     || mType == InstructionType::Sub
@@ -128,6 +128,13 @@ public:
     inline Instruction* GetNext() const { return mNext; }
     inline void SetNext(Instruction* next) { mNext = next; }
 
+    // Position in the parent basic block, maintained lazily by the block. Numbers only grow along the block
+    inline uint32_t GetOrder() const { return mOrder; }
+    inline void SetOrder(const uint32_t order) { mOrder = order; }
+
+    // Both instructions must be in the same basic block
+    bool ComesBefore(const Instruction* other) const;
+
     bool IsDominatedBy(Instruction* inst);
 
     inline uint64_t GetLinearNumber() const { return mLinearNumber; }
@@ -139,7 +146,35 @@ public:
     inline LiveInterval& GetLiveInterval() { return GetOutput()->GetLiveInterval(); }
     inline const LiveInterval& GetLiveInterval() const { return GetOutput()->GetLiveInterval(); }
 
+    // Inputs of any instruction in their natural order, no virtual calls or allocations involved
+    inline OperandRange operands() const { return OperandRange(mOperands, mOperands + mNumOperands); }
+    inline size_t NumOperands() const { return mNumOperands; }
+    inline Value* GetOperand(size_t idx) const { return mOperands[idx].Get(); }
+    inline std::span<Use> GetOperandUses() { return {mOperands, mNumOperands}; }
+
+    // Replace the input keeping use-lists of both old and new values consistent
+    inline void SetOperand(size_t idx, Value* value) { mOperands[idx].Set(value); }
+
+    // Replace every input which takes the old value
+    inline void ReplaceInput(Value* oldValue, Value* newValue) {
+        for (auto& use : GetOperandUses()) {
+            if (use.Get() == oldValue) {
+                use.Set(newValue);
+            }
+        }
+    }
+
 protected:
+    // Storage of the operands is owned by the derived instruction
+    inline void SetOperandStorage(Use* operands, uint32_t count) {
+        mOperands = operands;
+        mNumOperands = count;
+    }
+
+    Use* mOperands{nullptr};
+    uint32_t mNumOperands{0};
+    uint32_t mOrder{0};
+
     InstructionType mType{};
     InstructionId mId{-1};
     BasicBlock* mParentBasicBlock{nullptr};
@@ -155,29 +190,31 @@ protected:
 class InstructionArithmetic : public Instruction {
 public:
     // Constructors
-    InstructionArithmetic(const InstructionType type, const InstructionId id) : Instruction(type, id) {};
+    InstructionArithmetic(const InstructionType type, const InstructionId id) : Instruction(type, id) {
+        SetOperandStorage(mInlineOperands, 2);
+    };
 
     InstructionArithmetic(const InstructionType type, const InstructionId id, Value* input1, Value* input2, Value* output)
-    : Instruction(type, id), mInput1{input1}, mInput2{input2}, mOutput{output} {};
+    : Instruction(type, id), mInlineOperands{Use(this, input1), Use(this, input2)}, mOutput{output} {
+        SetOperandStorage(mInlineOperands, 2);
+    };
 
     virtual std::string GetAsString() const override;
     virtual bool IsValid() const override;
     virtual Value* GetOutput() const override { return mOutput; }
-    virtual void PopulateInputs(std::vector<Value*>& inputs) const override;
 
     // Getters
-    inline Value* GetInput1() { return mInput1; }
-    inline Value* GetInput2() { return mInput2; }
+    inline Value* GetInput1() { return mOperands[0]; }
+    inline Value* GetInput2() { return mOperands[1]; }
 
     // Setters
-    inline void SetInput1(Value* value) { mInput1 = value; }
-    inline void SetInput2(Value* value) { mInput2 = value; }
+    inline void SetInput1(Value* value) { mOperands[0].Set(value); }
+    inline void SetInput2(Value* value) { mOperands[1].Set(value); }
     inline void SetOutput(Value* value) { mOutput = value; }
 
 protected:
-    Value* mInput1;
-    Value* mInput2;
-    Value* mOutput;
+    Use mInlineOperands[2]{Use(this), Use(this)};
+    Value* mOutput{nullptr};
 };
 
 
@@ -307,52 +344,57 @@ public:
 class InstructionLoad final : public Instruction {
 public:
     // Constructors
-    InstructionLoad(const InstructionId id) : Instruction(InstructionType::Load, id) {};
+    InstructionLoad(const InstructionId id) : Instruction(InstructionType::Load, id) {
+        SetOperandStorage(&mLoadPtr, 1);
+    };
 
     InstructionLoad(const InstructionId id, Value* loadPtr, Value* output)
-    : Instruction(InstructionType::Load, id), mLoadPtr{loadPtr}, mOutput{output} {};
+    : Instruction(InstructionType::Load, id), mLoadPtr{this, loadPtr}, mOutput{output} {
+        SetOperandStorage(&mLoadPtr, 1);
+    };
 
     virtual std::string GetAsString() const override;
     virtual bool IsValid() const override;
     virtual Value* GetOutput() const override { return mOutput; }
-    virtual void PopulateInputs(std::vector<Value*>& inputs) const override;
 
     // Getters
     inline Value* GetLoadPtr() { return mLoadPtr; }
 
     // Setters
-    inline void SetLoadPtr(Value* value) { mLoadPtr = value; }
+    inline void SetLoadPtr(Value* value) { mLoadPtr.Set(value); }
     inline void SetOutput(Value* value)  { mOutput = value; }
 
 private:
-    Value* mLoadPtr;
-    Value* mOutput;
+    Use mLoadPtr{this};
+    Value* mOutput{nullptr};
 };
 
 
 class InstructionStore final : public Instruction {
 public:
     // Constructors
-    InstructionStore(const InstructionId id) : Instruction(InstructionType::Store, id) {};
+    InstructionStore(const InstructionId id) : Instruction(InstructionType::Store, id) {
+        SetOperandStorage(mInlineOperands, 2);
+    };
 
     InstructionStore(const InstructionId id, Value* storePtr, Value* input)
-    : Instruction(InstructionType::Store, id), mStorePtr{storePtr}, mInput{input} {};
+    : Instruction(InstructionType::Store, id), mInlineOperands{Use(this, storePtr), Use(this, input)} {
+        SetOperandStorage(mInlineOperands, 2);
+    };
 
     virtual std::string GetAsString() const override;
     virtual bool IsValid() const override;
-    virtual void PopulateInputs(std::vector<Value*>& inputs) const override;
 
     // Getters
-    inline Value* GetStorePtr() { return mStorePtr; }
-    inline Value* GetInput()    { return mInput; }
+    inline Value* GetStorePtr() { return mOperands[0]; }
+    inline Value* GetInput()    { return mOperands[1]; }
 
     // Setters
-    inline void SetStorePtr(Value* value) { mStorePtr = value; }
-    inline void SetInput(Value* value)    { mInput = value; }
+    inline void SetStorePtr(Value* value) { mOperands[0].Set(value); }
+    inline void SetInput(Value* value)    { mOperands[1].Set(value); }
 
 private:
-    Value* mStorePtr;
-    Value* mInput;
+    Use mInlineOperands[2]{Use(this), Use(this)};
 };
 
 
@@ -388,19 +430,22 @@ private:
 class InstructionBranch : public Instruction {
 public:
     // Constructors
-    InstructionBranch(const InstructionType type, const InstructionId id) : Instruction(type, id) {};
+    InstructionBranch(const InstructionType type, const InstructionId id) : Instruction(type, id) {
+        SetOperandStorage(mInlineOperands, 2);
+    };
 
     InstructionBranch(const InstructionType type, const InstructionId id, Value* input1, Value* input2, BasicBlock *pTrueBB, BasicBlock *pFalseBB)
-    : Instruction(type, id), mInput1{input1}, mInput2{input2}, mTrueBB{pTrueBB}, mFalseBB{pFalseBB} {};
+    : Instruction(type, id), mInlineOperands{Use(this, input1), Use(this, input2)}, mTrueBB{pTrueBB}, mFalseBB{pFalseBB} {
+        SetOperandStorage(mInlineOperands, 2);
+    };
 
     virtual std::string GetAsString() const override;
     virtual bool IsValid() const override;
     virtual bool IsTerminator() const override { return true; }
-    virtual void PopulateInputs(std::vector<Value*>& inputs) const override;
 
     // Getters
-    inline Value* GetInput1() { return mInput1; }
-    inline Value* GetInput2() { return mInput2; }
+    inline Value* GetInput1() { return mOperands[0]; }
+    inline Value* GetInput2() { return mOperands[1]; }
 
     inline const BasicBlock *GetTrueBasicBlock()  const { return mTrueBB; }
     inline const BasicBlock *GetFalseBasicBlock() const { return mFalseBB; }
@@ -409,15 +454,14 @@ public:
     inline BasicBlock *GetFalseBasicBlock() { return mFalseBB; }
 
     // Setters
-    inline void SetInput1(Value* value) { mInput1 = value; }
-    inline void SetInput2(Value* value) { mInput2 = value; }
+    inline void SetInput1(Value* value) { mOperands[0].Set(value); }
+    inline void SetInput2(Value* value) { mOperands[1].Set(value); }
 
     inline void SetTrueBasicBlock(BasicBlock *pTrueBB) { mTrueBB = pTrueBB; }
     inline void SetFalseBasicBlock(BasicBlock *pFalseBB) { mFalseBB = pFalseBB; }
 
 private:
-    Value* mInput1;
-    Value* mInput2;
+    Use mInlineOperands[2]{Use(this), Use(this)};
 
     BasicBlock *mTrueBB{nullptr};
     BasicBlock *mFalseBB{nullptr};
@@ -474,47 +518,94 @@ public:
 
 
 
+// Capacity of the operand array allocated right after the instruction object
+struct TrailingOperands {
+    uint32_t capacity{0};
+};
+
+
+// Interface for instructions with variable number of inputs.
+// Inputs live in the trailing array if the instruction was allocated with one, and are moved to the heap once they outgrow it
+class InstructionVariadic : public Instruction {
+public:
+    // Constructors
+    InstructionVariadic(const InstructionType type, const InstructionId id, Use* trailingOperands, const TrailingOperands trailing)
+    : Instruction(type, id), mCapacity{trailing.capacity}, mTrailingCapacity{trailing.capacity} {
+        SetOperandStorage(trailingOperands, 0);
+    };
+
+    InstructionVariadic(const InstructionVariadic& other) = delete;
+    InstructionVariadic& operator=(const InstructionVariadic& other) = delete;
+
+    virtual ~InstructionVariadic() override;
+
+    // Bytes to allocate right after the instruction object to hold the trailing array
+    static constexpr size_t GetTrailingSize(const TrailingOperands trailing) { return trailing.capacity * sizeof(Use); }
+
+    inline TrailingOperands GetTrailingOperands() const { return TrailingOperands{mTrailingCapacity}; }
+
+protected:
+    void AppendOperand(Value* value);
+    void AssignOperands(const std::vector<Value*>& values);
+    void EraseOperands(Value* value);
+    void ClearOperands();
+
+private:
+    void GrowOperands(uint32_t capacity);
+
+    uint32_t mCapacity{0};
+    uint32_t mTrailingCapacity{0};
+    bool mIsSpilled{false};
+};
+
+
+
 // Call instruction
 
-class InstructionCall final : public Instruction {
+class InstructionCall final : public InstructionVariadic {
 public:
     // Constructors
-    InstructionCall(const InstructionId id) : Instruction(InstructionType::Call, id) {};
-    InstructionCall(const InstructionId id, Function* function) : Instruction(InstructionType::Call, id), mFunction{function} {};
+    InstructionCall(const InstructionId id, const TrailingOperands trailing, Function* function, Value* ret, const std::vector<Value*>& args)
+    : InstructionVariadic(InstructionType::Call, id, reinterpret_cast<Use*>(this + 1), trailing), mFunction{function}, mOutput{ret} {
+        AssignOperands(args);
+    };
+
+    InstructionCall(const InstructionId id) : InstructionCall(id, TrailingOperands{}, nullptr, nullptr, {}) {};
+    InstructionCall(const InstructionId id, Function* function) : InstructionCall(id, TrailingOperands{}, function, nullptr, {}) {};
     
     InstructionCall(const InstructionId id, Function* function, Value* ret)
-    : Instruction(InstructionType::Call, id), mFunction{function}, mOutput{ret} {};
+    : InstructionCall(id, TrailingOperands{}, function, ret, {}) {};
     
     InstructionCall(const InstructionId id, Function* function, const std::vector<Value*>& args)
-    : Instruction(InstructionType::Call, id), mFunction{function}, mInputs{args} {};
+    : InstructionCall(id, TrailingOperands{}, function, nullptr, args) {};
     
     InstructionCall(const InstructionId id, Function* function, Value* ret, const std::vector<Value*>& args)
-    : Instruction(InstructionType::Call, id), mFunction{function}, mOutput{ret}, mInputs{args} {};
+    : InstructionCall(id, TrailingOperands{}, function, ret, args) {};
 
     virtual std::string GetAsString() const override;
     virtual bool IsValid() const override;
     virtual Value* GetOutput() const override { return mOutput; }
-    virtual void PopulateInputs(std::vector<Value*>& inputs) const override;
 
     // Getters
-    inline Function* GetFunction() { return mFunction; }
+    inline Function* GetFunction() const { return mFunction; }
     inline Value* GetReturnValue() { return mOutput; }
-    inline const std::vector<Value*>& GetArguments() const { return mInputs; }
-    inline Value* GetArgument(size_t idx) const { return mInputs[idx]; }
+    inline OperandRange GetArguments() const { return operands(); }
+    inline Value* GetArgument(size_t idx) const { return GetOperand(idx); }
 
     // Setters
     inline void SetFunction(Function* function) { mFunction = function; }
     inline void SetReturnValue(Value* value) { mOutput = value; }
-    inline void SetArguments(const std::vector<Value*>& args) { mInputs = args; }
-    inline void SetArgument(size_t idx, Value* arg) { mInputs[idx] = arg; }
+    inline void SetArguments(const std::vector<Value*>& args) { AssignOperands(args); }
+    inline void SetArgument(size_t idx, Value* arg) { SetOperand(idx, arg); }
 
 private:
     Function* mFunction{nullptr};
 
     Value* mOutput{nullptr};
-    std::vector<Value*> mInputs{};
 };
 
+static_assert(sizeof(InstructionCall) % alignof(Use) == 0, "Trailing operands of Call must be aligned");
+
 
 
 // Ret instruction
@@ -522,22 +613,29 @@ private:
 class InstructionRet final : public Instruction {
 public:
     // Constructors
-    InstructionRet(const InstructionId id) : Instruction(InstructionType::Ret, id) {};
-    InstructionRet(const InstructionId id, Value* returnValue) : Instruction(InstructionType::Ret, id), mReturnValue{returnValue} {};
+    InstructionRet(const InstructionId id) : Instruction(InstructionType::Ret, id) {
+        SetOperandStorage(&mReturnValue, 0);
+    };
+    InstructionRet(const InstructionId id, Value* returnValue) : Instruction(InstructionType::Ret, id), mReturnValue{this, returnValue} {
+        SetOperandStorage(&mReturnValue, returnValue ? 1 : 0);
+    };
     
     virtual std::string GetAsString() const override;
     virtual bool IsValid() const override;
     virtual bool IsTerminator() const override { return true; }
-    virtual void PopulateInputs(std::vector<Value*>& inputs) const override;
 
     // Getters
     inline Value* GetReturnValue() { return mReturnValue; }
 
     // Setters
-    inline void SetReturnValue(Value* returnValue) { mReturnValue = returnValue; }
+    // Ret without return value has no operands
+    inline void SetReturnValue(Value* returnValue) {
+        mReturnValue.Set(returnValue);
+        SetOperandStorage(&mReturnValue, returnValue ? 1 : 0);
+    }
 
 private:
-    Value* mReturnValue{nullptr};
+    Use mReturnValue{this};
 };
 
 
@@ -574,34 +672,64 @@ private:
 
 // Phi instruction
 
-class InstructionPhi final : public Instruction {
+class InstructionPhi final : public InstructionVariadic {
 public:
     // Constructors
-    InstructionPhi(const InstructionId id) : Instruction(InstructionType::Phi, id) {};
-    InstructionPhi(const InstructionId id, const std::list<Value*>& inputs, Value* output)
-    : Instruction(InstructionType::Phi, id), mInputs{inputs}, mOutput{output} {};
+    InstructionPhi(const InstructionId id, const TrailingOperands trailing, const std::vector<Value*>& inputs, const std::vector<BasicBlock*>& incomingBlocks, Value* output)
+    : InstructionVariadic(InstructionType::Phi, id, reinterpret_cast<Use*>(this + 1), trailing), mOutput{output} {
+        SetInputs(inputs, incomingBlocks);
+    };
+
+    InstructionPhi(const InstructionId id) : InstructionPhi(id, TrailingOperands{}, {}, {}, nullptr) {};
+    InstructionPhi(const InstructionId id, const std::vector<Value*>& inputs, Value* output)
+    : InstructionPhi(id, TrailingOperands{}, inputs, {}, output) {};
+    InstructionPhi(const InstructionId id, const std::vector<Value*>& inputs, const std::vector<BasicBlock*>& incomingBlocks, Value* output)
+    : InstructionPhi(id, TrailingOperands{}, inputs, incomingBlocks, output) {};
 
     virtual std::string GetAsString() const override;
     virtual bool IsValid() const override;
     virtual Value* GetOutput() const override { return mOutput; }
-    virtual void PopulateInputs(std::vector<Value*>& inputs) const override;
 
     // Getters
-    inline const std::list<Value*>& GetInputs() const { return mInputs; }
+    inline OperandRange GetInputs() const { return operands(); }
+
+    // Predecessor along whose edge the input comes, null while it is not known
+    inline BasicBlock* GetIncomingBlock(size_t idx) const { return mIncomingBlocks[idx]; }
+
+    // Input which comes along the edge from the predecessor
+    Value* GetInputFrom(const BasicBlock* pred) const;
+
+    // Inputs in the order of predecessors of the block, as the text and the binary formats keep them.
+    // Phi without an input for each predecessor keeps its own order
+    std::vector<Value*> GetInputsByPredecessors() const;
 
     // Setters
-    inline void SetInputs(const std::list<Value*>& inputs) { mInputs = inputs; }
-    inline void AddInput(Value* input)       { mInputs.push_back(input); }
-    inline bool HasInput(Value* input) const { return std::find(mInputs.begin(), mInputs.end(), input) != mInputs.end(); }
-    inline void RemoveInput(Value* input)    { mInputs.remove(input); }
+    // Inputs without a block take none, the blocks are set later
+    void SetInputs(const std::vector<Value*>& inputs, const std::vector<BasicBlock*>& incomingBlocks = {});
+    void AddInput(Value* input, BasicBlock* incomingBlock = nullptr);
+    inline bool HasInput(Value* input) const { return std::find(operands().begin(), operands().end(), input) != operands().end(); }
+    void RemoveInput(Value* input);
+
+    inline void SetIncomingBlock(size_t idx, BasicBlock* bb) { mIncomingBlocks[idx] = bb; }
+
+    // Inputs of the edge from oldBlock come from newBlock, when the edge is moved to another predecessor
+    void ReplaceIncomingBlock(const BasicBlock* oldBlock, BasicBlock* newBlock);
+
+    // Input produced in the predecessor comes along its edge, if the input has no block yet.
+    // Once there is an input per predecessor, the only input without a block comes along the only edge left
+    void AssignIncomingBlock(BasicBlock* pred);
 
     inline void SetOutput(Value* value) { mOutput = value; }
 
 private:
-    std::list<Value*> mInputs{};
-    Value* mOutput;
+    Value* mOutput{nullptr};
+
+    // Parallel to the inputs
+    SmallVector<BasicBlock*, 2> mIncomingBlocks{};
 };
 
+static_assert(sizeof(InstructionPhi) % alignof(Use) == 0, "Trailing operands of Phi must be aligned");
+
 
 
 // Mv instruction
@@ -609,25 +737,28 @@ private:
 class InstructionMv final : public Instruction {
 public:
     // Constructors
-    InstructionMv(const InstructionId id) : Instruction(InstructionType::Mv, id) {};
+    InstructionMv(const InstructionId id) : Instruction(InstructionType::Mv, id) {
+        SetOperandStorage(&mInput, 1);
+    };
     InstructionMv(const InstructionId id, Value* input, Value* output)
-    : Instruction(InstructionType::Mv, id), mInput{input}, mOutput{output} {};
+    : Instruction(InstructionType::Mv, id), mInput{this, input}, mOutput{output} {
+        SetOperandStorage(&mInput, 1);
+    };
 
     virtual std::string GetAsString() const override;
     virtual bool IsValid() const override;
     virtual Value* GetOutput() const override { return mOutput; }
-    virtual void PopulateInputs(std::vector<Value*>& inputs) const override;
 
     // Getters
     inline Value* GetInput() const { return mInput; }
 
     // Setters
-    inline void SetInput(Value* input) { mInput = input; }
+    inline void SetInput(Value* input) { mInput.Set(input); }
     inline void SetOutput(Value* value) { mOutput = value; }
 
 private:
-    Value* mInput;
-    Value* mOutput;
+    Use mInput{this};
+    Value* mOutput{nullptr};
 };
 
 
@@ -637,46 +768,51 @@ private:
 class InstructionNullCheck final : public Instruction {
 public:
     // Constructors
-    InstructionNullCheck(const InstructionId id) : Instruction(InstructionType::NullCheck, id) {};
+    InstructionNullCheck(const InstructionId id) : Instruction(InstructionType::NullCheck, id) {
+        SetOperandStorage(&mInput, 1);
+    };
     InstructionNullCheck(const InstructionId id, Value* input)
-    : Instruction(InstructionType::NullCheck, id), mInput{input} {};
+    : Instruction(InstructionType::NullCheck, id), mInput{this, input} {
+        SetOperandStorage(&mInput, 1);
+    };
 
     virtual std::string GetAsString() const override;
     virtual bool IsValid() const override;
-    virtual void PopulateInputs(std::vector<Value*>& inputs) const override;
 
     // Getters
     inline Value* GetInput() const { return mInput; }
 
     // Setters
-    inline void SetInput(Value* input) { mInput = input; }
+    inline void SetInput(Value* input) { mInput.Set(input); }
 
 private:
-    Value* mInput;
+    Use mInput{this};
 };
 
 class InstructionBoundsCheck final : public Instruction {
 public:
     // Constructors
-    InstructionBoundsCheck(const InstructionId id) : Instruction(InstructionType::BoundsCheck, id) {};
+    InstructionBoundsCheck(const InstructionId id) : Instruction(InstructionType::BoundsCheck, id) {
+        SetOperandStorage(mInlineOperands, 2);
+    };
     InstructionBoundsCheck(const InstructionId id, Value* inputPtr, Value* inputArray)
-    : Instruction(InstructionType::BoundsCheck, id), mInputPtr{inputPtr}, mInputArray{inputArray} {};
+    : Instruction(InstructionType::BoundsCheck, id), mInlineOperands{Use(this, inputPtr), Use(this, inputArray)} {
+        SetOperandStorage(mInlineOperands, 2);
+    };
 
     virtual std::string GetAsString() const override;
     virtual bool IsValid() const override;
-    virtual void PopulateInputs(std::vector<Value*>& inputs) const override;
 
     // Getters
-    inline Value* GetInputPtr() const { return mInputPtr; }
-    inline Value* GetInputArray() const { return mInputArray; }
+    inline Value* GetInputPtr() const { return mOperands[0]; }
+    inline Value* GetInputArray() const { return mOperands[1]; }
 
     // Setters
-    inline void SetInputPtr(Value* inputPtr) { mInputPtr = inputPtr; }
-    inline void SetInputArray(Value* inputArray) { mInputArray = inputArray; }
+    inline void SetInputPtr(Value* inputPtr) { mOperands[0].Set(inputPtr); }
+    inline void SetInputArray(Value* inputArray) { mOperands[1].Set(inputArray); }
 
 private:
-    Value* mInputPtr;
-    Value* mInputArray;
+    Use mInlineOperands[2]{Use(this), Use(this)};
 };
 
 }   // namespace VMIR
@@ -0,0 +1,99 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Function.h>
+
+namespace VMIR {
+
+class IRContext;
+
+/*
+    Reference semantics of the IR:
+        - integers wrap around on overflow, shift amounts are taken modulo the bit width
+        - integer division by zero is an error, division of the minimal value by -1 wraps around
+        - pointer arithmetic is in bytes, Alloc gives `count * size of type` bytes which live until the function returns
+        - NullCheck and BoundsCheck stop the execution with an error when they fail
+        - Phi with an input per predecessor takes the input of the edge the block is entered from. Phi with another
+          number of inputs takes the input which was defined last in the current call (FactLoop sample has such phis)
+*/
+class Interpreter {
+public:
+    Interpreter() = delete;
+    Interpreter(IRContext* context, size_t stackSlotCount = kDefaultStackSlotCount, size_t memorySize = kDefaultMemorySize);
+    ~Interpreter();
+
+    Interpreter(const Interpreter& other) = delete;
+    Interpreter& operator=(const Interpreter& other) = delete;
+
+    // Arguments and the result are bit patterns of the values as produced by ToBitPattern
+    bool Run(Function* func, const std::vector<uint64_t>& args);
+    inline uint64_t GetResult() const { return mResult; }
+
+    template <typename R, typename... Args>
+    requires NumericType<R> && (NumericType<Args> && ...)
+    inline std::optional<R> Call(Function* func, Args... args) {
+        if (!Run(func, {ToBitPattern(args)...})) {
+            return std::nullopt;
+        }
+        R result{};
+        std::memcpy(&result, &mResult, sizeof(R));
+        return result;
+    }
+
+    // Decoded functions are kept between runs, so they have to be dropped once the IR changes
+    void Invalidate();
+
+    inline const std::string& GetError() const { return mError; }
+
+    static constexpr size_t kDefaultStackSlotCount = 1 << 20;
+    static constexpr size_t kDefaultMemorySize = 1 << 20;
+
+private:
+    struct DecodedFunction;
+
+    // State of the caller, which is restored on return
+    struct Frame {
+        const DecodedFunction* func;
+        uint64_t* regs;
+        uint32_t returnPc;
+        uint32_t outSlot;
+        size_t memoryTop;
+    };
+
+    bool Error(const std::string& message);
+
+    // Index of the decoded function, the function and all its callees are decoded on the first request
+    std::optional<uint32_t> Decode(Function* func);
+    bool DecodeBody(Function* func, DecodedFunction& decoded);
+
+    bool Execute(uint32_t funcIdx, const std::vector<uint64_t>& args);
+
+    IRContext* mContext{nullptr};
+    std::string mError{};
+    uint64_t mResult{0};
+
+    std::vector<std::unique_ptr<DecodedFunction>> mDecoded{};
+    std::unordered_map<const Function*, uint32_t> mDecodedIds{};
+
+    // Virtual registers of all active calls, and memory of their allocs
+    std::unique_ptr<uint64_t[]> mStack{};
+    size_t mStackSlotCount{0};
+    std::unique_ptr<uint8_t[]> mMemory{};
+    size_t mMemorySize{0};
+    std::vector<Frame> mFrames{};
+
+    // Edge moves of a phi block are done through this buffer, sized for the largest block
+    std::vector<uint64_t> mPhiScratch{};
+    size_t mMaxPhiMoves{0};
+};
+
+}   // namespace VMIR
+
+#endif  // INTERPRETER_H
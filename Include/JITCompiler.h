@@ -0,0 +1,95 @@
+#ifndef JIT_COMPILER_H
+#define JIT_COMPILER_H
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <Function.h>
+
+namespace VMIR {
+
+class IRContext;
+
+/*
+    Compiles functions to x86-64 machine code in executable memory, using the locations of RegisterAllocator.
+    Compiled functions follow the System V calling convention, so they can be called through plain function pointers.
+    Semantics are the ones of the Interpreter, except that Alloc gives the same stack memory each time it is executed
+    in one call, and running out of native stack is not detected
+*/
+class JITCompiler {
+public:
+    JITCompiler() = delete;
+    JITCompiler(IRContext* context) : mContext{context} {}
+    ~JITCompiler();
+
+    JITCompiler(const JITCompiler& other) = delete;
+    JITCompiler& operator=(const JITCompiler& other) = delete;
+
+    // Compiles the function together with all its callees which are not compiled yet
+    bool Compile(Function* func);
+
+    // Entry of the compiled function, it is compiled on the first request. Returns nullptr on errors
+    void* GetEntry(Function* func);
+
+    // Calls the compiled function, failed null checks, bounds checks and divisions by zero are reported as errors
+    template <typename R, typename... Args>
+    requires NumericType<R> && ((NumericType<Args> || std::is_pointer_v<Args>) && ...)
+    inline std::optional<R> Call(Function* func, Args... args) {
+        void* entry = GetEntry(func);
+        if (entry == nullptr) {
+            return std::nullopt;
+        }
+
+        struct Invocation {
+            R (*entry)(Args...);
+            std::tuple<Args...> args;
+            R result;
+        };
+        Invocation invocation{reinterpret_cast<R (*)(Args...)>(entry), {args...}, R{}};
+        auto invoke = [](void* data) {
+            Invocation* inv = static_cast<Invocation*>(data);
+            inv->result = std::apply(inv->entry, inv->args);
+        };
+        if (!Invoke(invoke, &invocation)) {
+            return std::nullopt;
+        }
+        return invocation.result;
+    }
+
+    inline size_t GetCodeSize() const { return mCodeSize; }
+    inline const std::string& GetError() const { return mError; }
+
+    // Allocatable registers: rbx, r12-r15, rsi, rdi, r8-r10 and xmm8-xmm13
+    static constexpr uint32_t kGPRegisterCount = 10;
+    static constexpr uint32_t kFPRegisterCount = 6;
+
+private:
+    bool Error(const std::string& message);
+
+    // Runs the callback, returns false if compiled code trapped in it
+    bool Invoke(void (*callback)(void*), void* data);
+
+    struct CodeRegion {
+        void* memory;
+        size_t size;
+    };
+
+    IRContext* mContext{nullptr};
+    std::string mError{};
+
+    std::vector<CodeRegion> mRegions{};
+    std::unordered_map<const Function*, void*> mEntries{};
+    size_t mCodeSize{0};
+
+    // Names of compiled functions for trap messages, they must outlive the code
+    std::vector<std::unique_ptr<std::string>> mNames{};
+};
+
+}   // namespace VMIR
+
+#endif  // JIT_COMPILER_H
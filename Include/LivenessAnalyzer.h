@@ -1,16 +1,21 @@
 #ifndef LIVENESS_ANALYZER_H
 #define LIVENESS_ANALYZER_H
 
+#include <unordered_map>
+
 #include <ControlFlowGraph.h>
 #include <BasicBlock.h>
 #include <LoopAnalyzer.h>
+#include <BitVector.h>
 
 namespace VMIR {
 
+class IRContext;
+
 class LivenessAnalyzer {
 public:
     LivenessAnalyzer() = delete;
-    LivenessAnalyzer(ControlFlowGraph* graph) : mGraph{graph} {}
+    LivenessAnalyzer(IRContext* context, ControlFlowGraph* graph) : mContext{context}, mGraph{graph} {}
 
     bool PerformLivenessAnalysis();
 
@@ -18,6 +23,23 @@ public:
     inline const std::vector<BasicBlock*>& GetBasicBlocksLinearOrder() const { return mBBLinearOrder; }
     inline LoopAnalyzer* GetLoopAnalyzer() const { return mLoopAnalyzer; }
     inline bool IsAnalysisDone() const { return mIsAnalysisDone; }
+    inline void Invalidate() { mBBLinearOrder.clear(); mBBLinearIndices.clear(); mLiveIn.clear(); mLiveOut.clear(); mIsAnalysisDone = false; }
+
+    // Values live at the start and at the end of the block. Bits are indices of GetValueIndex
+    const BitVector& GetLiveIn(const BasicBlock* bb) const;
+    const BitVector& GetLiveOut(const BasicBlock* bb) const;
+
+    // Blocks unreachable from the entry are not in the linear order and have neither livesets nor live ranges
+    inline bool IsInLinearOrder(const BasicBlock* bb) const { return mBBLinearIndices.find(bb) != mBBLinearIndices.end(); }
+
+    // Arguments come first, then outputs of instructions by linear number. Constants have no index
+    static constexpr size_t kNoValueIndex = SIZE_MAX;
+    size_t GetValueIndex(const Value* value) const;
+    inline Value* GetValueByIndex(size_t idx) const { return mValues[idx]; }
+    inline size_t GetValueCount() const { return mValues.size(); }
+
+    inline bool IsLiveIn(const BasicBlock* bb, const Value* value) const { return IsInSet(GetLiveIn(bb), value); }
+    inline bool IsLiveOut(const BasicBlock* bb, const Value* value) const { return IsInSet(GetLiveOut(bb), value); }
 
 private:
     void CreateBasicBlocksLinearOrder(BasicBlock* entry);
@@ -26,12 +48,27 @@ private:
 
     bool CheckIfBlockCanBeVisited(BasicBlock* bb);
 
+    inline bool IsInSet(const BitVector& set, const Value* value) const {
+        const size_t idx = GetValueIndex(value);
+        return idx != kNoValueIndex && set.Test(idx);
+    }
+
     void VisitLoopBlock(BasicBlock* bb, std::set<BasicBlock*>& exitBlocks);
     void VisitLoop(Loop* loop, std::set<BasicBlock*>& exitBlocks);
 
+    IRContext* mContext{nullptr};
     ControlFlowGraph* mGraph{nullptr};
     LoopAnalyzer* mLoopAnalyzer{nullptr};
     std::vector<BasicBlock*> mBBLinearOrder;
+
+    // Livesets are indexed by position in the linear order
+    std::unordered_map<const BasicBlock*, size_t> mBBLinearIndices{};
+    std::vector<BitVector> mLiveIn{};
+    std::vector<BitVector> mLiveOut{};
+    std::vector<Value*> mValues{};
+    size_t mArgCount{0};
+    BitVector mEmptySet{};
+    VisitedBlocks mVisited{};
     bool mIsAnalysisDone{false};
 };
 
@@ -31,6 +31,15 @@ public:
     void BuildLoopTree();
     inline bool IsLoopTreeBuilt() const { return mIsLoopTreeBuilt; }
 
+    // Drop the loops, so the next build starts from scratch
+    inline void Invalidate() {
+        for (auto* bb : mGraph->GetBasicBlocks()) {
+            bb->SetLoop(nullptr);
+        }
+        Cleanup();
+        mIsLoopTreeBuilt = false;
+    }
+
     inline bool HasIrreducibleLoops() const {
         for (const auto& ll : mLoops) {
             if (!ll.second->IsReducible()) {
@@ -1,16 +1,58 @@
 #ifndef PASS_H
 #define PASS_H
 
+#include <cstdint>
+
 #include <Function.h>
 
 namespace VMIR {
 
+class TraceScope;
+
+// Cached per-function analyses. Each one is computed from the previous one
+enum class AnalysisKind : uint8_t {
+    ControlFlowGraph,
+    DominatorTree,
+    LoopTree,
+    Liveness,
+};
+
+// Analyses which are still valid after a pass. An analysis is kept only if everything it is computed from is kept too
+class PreservedAnalyses {
+public:
+    static PreservedAnalyses None() { return PreservedAnalyses{}; }
+    static PreservedAnalyses All() {
+        return PreservedAnalyses{}.Preserve(AnalysisKind::ControlFlowGraph).Preserve(AnalysisKind::DominatorTree)
+                                  .Preserve(AnalysisKind::LoopTree).Preserve(AnalysisKind::Liveness);
+    }
+
+    inline PreservedAnalyses& Preserve(AnalysisKind kind) { mMask |= Bit(kind); return *this; }
+
+    inline bool IsPreserved(AnalysisKind kind) const {
+        // Mask of the analysis and all the ones below it
+        const uint32_t required = (Bit(kind) << 1) - 1;
+        return (mMask & required) == required;
+    }
+
+private:
+    static constexpr uint32_t Bit(AnalysisKind kind) { return 1u << static_cast<uint32_t>(kind); }
+
+    uint32_t mMask{0};
+};
+
 class Pass {
 public:
     Pass(const std::string& name) : mName{name} {}
+    virtual ~Pass() = default;
 
     virtual void Run(Function* func) = 0;
 
+    // Pass which does not override this changes everything
+    virtual PreservedAnalyses GetPreservedAnalyses() const { return PreservedAnalyses::None(); }
+
+    // Counters of the last run, they are attached to the trace event of the pass
+    virtual void ReportStatistics([[maybe_unused]] TraceScope& scope) const {}
+
     inline const std::string& GetName() const { return mName; }
 
 protected:
@@ -0,0 +1,32 @@
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include <memory>
+#include <vector>
+
+#include <Pass.h>
+
+namespace VMIR {
+
+// Ordered list of passes. After every pass analyses of the function which the pass does not preserve are invalidated
+class PassManager {
+public:
+    template <typename PassT, typename... Args>
+    PassT* AddPass(Args&&... args) {
+        auto pass = std::make_unique<PassT>(std::forward<Args>(args)...);
+        PassT* ret = pass.get();
+        mPasses.push_back(std::move(pass));
+        return ret;
+    }
+
+    inline const std::vector<std::unique_ptr<Pass>>& GetPasses() const { return mPasses; }
+
+    void Run(Function* func);
+
+private:
+    std::vector<std::unique_ptr<Pass>> mPasses{};
+};
+
+}   // namespace VMIR
+
+#endif  // PASS_MANAGER_H
@@ -0,0 +1,37 @@
+#ifndef PASS_PIPELINE_H
+#define PASS_PIPELINE_H
+
+#include <vector>
+
+#include <Function.h>
+#include <ThreadPool.h>
+
+namespace VMIR {
+
+class IRContext;
+
+// Optimizes every function of a context and allocates registers for it.
+// Inlining goes sequentially from callees to callers, then functions are processed independently:
+// constant folding, peepholes, check elimination, liveness analysis and register allocation
+class PassPipeline {
+public:
+    PassPipeline(IRContext* context, uint32_t GPRegCount, uint32_t FPRegCount)
+    : mContext{context}, mGPRegisterCount{GPRegCount}, mFPRegisterCount{FPRegCount} {}
+
+    // Functions are distributed over the pool, without a pool they are processed on the calling thread
+    bool Run(ThreadPool* pool = nullptr);
+
+    // Callees go before their callers, a recursive call does not reorder functions in the cycle
+    std::vector<Function*> GetCallGraphPostOrder() const;
+
+private:
+    bool RunFunctionPasses(Function* func) const;
+
+    IRContext* mContext{nullptr};
+    uint32_t mGPRegisterCount{0};
+    uint32_t mFPRegisterCount{0};
+};
+
+}   // namespace VMIR
+
+#endif  // PASS_PIPELINE_H
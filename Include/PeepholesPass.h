@@ -11,6 +11,8 @@ public:
     PeepholesPass();
 
     virtual void Run(Function* func) override;
+    virtual PreservedAnalyses GetPreservedAnalyses() const override;
+    virtual void ReportStatistics(TraceScope& scope) const override;
 
 private:
     bool PerformSingleAddPeephole(InstructionAdd* inst) const;
@@ -20,6 +22,8 @@ private:
 
     bool PerformSingleAndPeephole(InstructionAnd* inst) const;
 
+    size_t mAppliedPeepholes{0};
+
     template <typename T>
     bool AreValuesHoldSameConstants(Value* v1, Value* v2) const {
         T data1 = v1->GetValue<T>().value();
@@ -29,13 +33,11 @@ private:
 
     template <typename T>
     void ReplaceShlWithMvOrZero(InstructionAshr* rShift, InstructionShl* lShift) const {
-        IRBuilder* IrBuilder = IRBuilder::GetInstance();
-
         BasicBlock* bb = rShift->GetParentBasicBlock();
+        IRContext* IrContext = bb->GetParentFunction()->GetContext();
 
         Value* rShiftInput1 = rShift->GetInput1();
 
-        Value* lShiftInput1 = lShift->GetInput1();
         Value* lShiftInput2 = lShift->GetInput2();
         Value* lShiftOutput = lShift->GetOutput();
 
@@ -45,42 +47,31 @@ private:
         if (shiftAmount < bitSize) {
             T one = static_cast<T>(1);
             T andConstant = static_cast<T>(~((one << shiftAmount) - one));
-            Value* andConstantValue = IrBuilder->GetOrCreateValueWithData<T>(andConstant);
+            Value* andConstantValue = IrContext->GetOrCreateValueWithData<T>(andConstant);
 
-            InstructionAnd* instAnd = IrBuilder->CreateAnd();
+            InstructionAnd* instAnd = IrContext->CreateAnd();
             instAnd->SetInput1(rShiftInput1);
             instAnd->SetInput2(andConstantValue);
             instAnd->SetOutput(lShiftOutput);
-
-            lShiftInput1->RemoveUser(lShift);
-            lShiftInput2->RemoveUser(lShift);
-
-            rShiftInput1->AddUser(instAnd);
-            andConstantValue->AddUser(instAnd);
             lShiftOutput->SetProducer(instAnd);
 
             bb->InsertInstructionBefore(instAnd, lShift);
             bb->RemoveInstruction(lShift);
 
-            IrBuilder->RemoveInstruction(lShift);
+            IrContext->RemoveInstruction(lShift);
         }
         else {
-            Value* zero = IrBuilder->GetOrCreateValueWithData<T>(0);
+            Value* zero = IrContext->GetOrCreateValueWithData<T>(0);
 
-            InstructionMv* instMv = IrBuilder->CreateMv();
+            InstructionMv* instMv = IrContext->CreateMv();
             instMv->SetInput(zero);
             instMv->SetOutput(lShiftOutput);
-
-            lShiftInput1->RemoveUser(lShift);
-            lShiftInput2->RemoveUser(lShift);
-
-            zero->AddUser(instMv);
             lShiftOutput->SetProducer(instMv);
 
             bb->InsertInstructionBefore(instMv, lShift);
             bb->RemoveInstruction(lShift);
 
-            IrBuilder->RemoveInstruction(lShift);
+            IrContext->RemoveInstruction(lShift);
         }
     }
 };
@@ -2,25 +2,32 @@
 #define REGISTER_ALLOCATOR_H
 
 #include <set>
+#include <map>
+#include <deque>
 #include <vector>
+#include <optional>
 #include <algorithm>
+#include <unordered_map>
 
 #include <ControlFlowGraph.h>
 
 namespace VMIR {
 
+class IRContext;
+class LivenessAnalyzer;
+
+/*
+    Linear scan over live ranges with lifetime holes. When registers run out, intervals are split instead of being
+    spilled as a whole: the part around the conflict goes to the stack and the value returns to a register before
+    its next use. Value keeps the location of its definition and the later locations as splits. Moves between the
+    locations are returned for instructions inside blocks and for edges between blocks. Functions in the graph coloring
+    mode are allocated by GraphColoringAllocator instead, its spilled values move only inside blocks and need no
+    moves on edges
+*/
 class RegisterAllocator {
 public:
     RegisterAllocator() = delete;
-    RegisterAllocator(ControlFlowGraph* graph, uint32_t GPRegCount, uint32_t FPRegCount) : mGraph{graph}, mGPRegisterCount{GPRegCount}, mFPRegisterCount{FPRegCount} {
-        for (uint32_t i = 0; i < mGPRegisterCount; ++i) {
-            mFreeGPRegisters.emplace(i);
-        }
-
-        for (uint32_t i = 0; i < mFPRegisterCount; ++i) {
-            mFreeFPRegisters.emplace(i);
-        }
-    }
+    RegisterAllocator(IRContext* context, ControlFlowGraph* graph, uint32_t GPRegCount, uint32_t FPRegCount) : mContext{context}, mGraph{graph}, mGPRegisterCount{GPRegCount}, mFPRegisterCount{FPRegCount} {}
 
     bool PerformRegisterAllocation();
 
@@ -29,68 +36,152 @@ public:
 
     inline ControlFlowGraph* GetGraph() const { return mGraph; }
 
-private:
-    void ExpireOldIntervals(Value* valueIn);
-    void SpillAtInterval(Value* valueIn);
-
-    inline bool IsGPRegisterOccupied(GPRegisterLocation reg) const { return mFreeGPRegisters.find(reg) == mFreeGPRegisters.cend(); }
-    inline bool IsGPRegisterFree(GPRegisterLocation reg) const { return mFreeGPRegisters.find(reg) != mFreeGPRegisters.cend(); }
+    struct Move {
+        Value* value;
+        Location from;
+        Location to;
+    };
 
-    inline void SetGPRegisterOccupied(GPRegisterLocation reg) { mFreeGPRegisters.erase(reg); }
-    inline void SetGPRegisterFree(GPRegisterLocation reg) { mFreeGPRegisters.insert(reg); }
+    // Moves right before the instruction. All moves of one place are done at once
+    inline const std::vector<Move>& GetMovesBefore(const Instruction* inst) const {
+        auto it = mInstructionMoves.find(inst);
+        return it != mInstructionMoves.end() ? it->second : kNoMoves;
+    }
 
-    inline bool AreAllGPRegistersOccupied() const { return mFreeGPRegisters.empty(); }
+    // Moves on the edge, besides the inputs of phis of the successor
+    inline const std::vector<Move>& GetEdgeMoves(const BasicBlock* pred, const BasicBlock* succ) const {
+        auto it = mEdgeMoves.find({pred, succ});
+        return it != mEdgeMoves.end() ? it->second : kNoMoves;
+    }
 
-    inline bool IsFPRegisterOccupied(FPRegisterLocation reg) const { return mFreeFPRegisters.find(reg) == mFreeFPRegisters.cend(); }
-    inline bool IsFPRegisterFree(FPRegisterLocation reg) const { return mFreeFPRegisters.find(reg) != mFreeFPRegisters.cend(); }
+    // Stack accesses of the allocated code. Weighted counts assume every loop runs kLoopWeight times.
+    // Phi copies are the inputs of phis which are not in the location of the phi on their edges
+    struct Statistics {
+        uint64_t splits{0};
+        uint64_t moves{0};
+        uint64_t coalescedMoves{0};
+        uint64_t phiCopies{0};
+        uint64_t stackStores{0};
+        uint64_t stackLoads{0};
+        double weightedStackStores{0};
+        double weightedStackLoads{0};
+    };
+    inline const Statistics& GetStatistics() const { return mStatistics; }
 
-    inline void SetFPRegisterOccupied(FPRegisterLocation reg) { mFreeFPRegisters.erase(reg); }
-    inline void SetFPRegisterFree(FPRegisterLocation reg) { mFreeFPRegisters.insert(reg); }
+    static constexpr double kLoopWeight = 10.0;
+    static constexpr uint32_t kMaxWeightedLoopDepth = 6;
 
-    inline bool AreAllFPRegistersOccupied() const { return mFreeFPRegisters.empty(); }
+    // Weight of the block for spill decisions, grows with the loop depth of the block
+    static double GetBlockWeight(const BasicBlock* bb);
 
-    inline std::optional<GPRegisterLocation> GetFreeGPRegisterLocation() {
-        if (AreAllGPRegistersOccupied()) {
-            return std::nullopt;
+private:
+    // Part of the lifetime of a value which stays in one location
+    struct Interval {
+        Value* value;
+        LiveRangeList ranges;
+        Location location;
+        uint64_t order;
+
+        // Range which covers the current position or follows it
+        size_t rangeIdx{0};
+
+        inline uint64_t Start() const { return ranges.GetRanges().front().start; }
+        inline uint64_t End() const { return ranges.GetRanges().back().end; }
+        inline uint64_t CurrentStart() const { return ranges.GetRanges()[rangeIdx].start; }
+        inline uint64_t CurrentEnd() const { return ranges.GetRanges()[rangeIdx].end; }
+        inline bool IsGP() const { return value->IsIntegralValueType(); }
+        inline uint32_t Register() const {
+            return IsGP() ? std::get<GPRegisterLocation>(location).registerId : std::get<FPRegisterLocation>(location).registerId;
         }
-        return *mFreeGPRegisters.begin();
-    }
+    };
 
-    inline std::optional<FPRegisterLocation> GetFreeFPRegisterLocation() {
-        if (AreAllFPRegistersOccupied()) {
-            return std::nullopt;
-        }
-        return *mFreeFPRegisters.begin();
-    }
-    
+    struct RegisterClass;
+
+    void BuildIntervals(LivenessAnalyzer* livenessAnalyzer);
+    void ExpireOldIntervals(RegisterClass& regClass, uint64_t position);
+    void Activate(RegisterClass& regClass, Interval* interval, uint64_t position);
+    bool TryAllocateFreeRegister(Interval* current);
+    void SpillAtInterval(Interval* current);
+    void SpillFrom(Interval* interval, uint64_t position);
+    void SplitBeforeNextUse(Interval* spilled);
+    void Resolve(LivenessAnalyzer* livenessAnalyzer);
+    void StoreSpilledAtDefinition();
+    void CountStackAccesses(LivenessAnalyzer* livenessAnalyzer);
+    void PerformGraphColoring(LivenessAnalyzer* livenessAnalyzer);
+
+    Interval* SplitInterval(Interval* interval, uint64_t position);
+    std::optional<uint64_t> FindSplitPosition(uint64_t after, uint64_t latest) const;
+    uint64_t SplitPositionBefore(uint64_t position) const;
+    bool IsBlockStart(uint64_t position) const;
+    void AddUnhandled(Interval* interval);
+    void AssignRegister(Interval* interval, uint32_t reg);
+    void AssignStackLocation(Interval* interval);
+
+    static inline bool IsStore(const Move& move) { return std::holds_alternative<StackLocation>(move.to); }
+
+    inline uint32_t GetRegisterCount(const Interval* interval) const { return interval->IsGP() ? mGPRegisterCount : mFPRegisterCount; }
+    inline RegisterClass& GetRegisterClass(const Interval* interval) { return interval->IsGP() ? mGPClass : mFPClass; }
     inline StackLocation GenerateNewStackLocation() { return StackLocation(mStackLocations++); }
 
+    IRContext* mContext{nullptr};
     ControlFlowGraph* mGraph{nullptr};
     uint32_t mGPRegisterCount{};
     uint32_t mFPRegisterCount{};
 
-    // I want always use a register with the smallest ID possible
-    struct IncreasingGPRegisterIdComparator {
-        bool operator() (GPRegisterLocation a, GPRegisterLocation b) const {
-            return a.registerId < b.registerId;
+    std::deque<Interval> mIntervals{};
+
+    // Intervals are handled by increasing start, ties go in order of creation
+    struct LaterStartComparator {
+        bool operator() (const Interval* a, const Interval* b) const {
+            return a->Start() != b->Start() ? a->Start() > b->Start() : a->order > b->order;
         }
     };
-    std::set<GPRegisterLocation, IncreasingGPRegisterIdComparator> mFreeGPRegisters{};
+    std::vector<Interval*> mUnhandled{};
 
-    struct IncreasingFPRegisterIdComparator {
-        bool operator() (FPRegisterLocation a, FPRegisterLocation b) const {
-            return a.registerId < b.registerId;
+    // Intervals in registers of one class. Active ones are live at the current position, one per register.
+    // Inactive ones are in lifetime holes. Both are ordered by the position where they change state next
+    struct CurrentEndComparator {
+        bool operator() (const Interval* a, const Interval* b) const {
+            return a->CurrentEnd() < b->CurrentEnd();
+        }
+    };
+    struct CurrentStartComparator {
+        bool operator() (const Interval* a, const Interval* b) const {
+            return a->CurrentStart() < b->CurrentStart();
         }
     };
-    std::set<FPRegisterLocation, IncreasingFPRegisterIdComparator> mFreeFPRegisters{};
+    template <typename Set>
+    static inline void EraseInterval(Set& set, Interval* interval) {
+        auto [first, last] = set.equal_range(interval);
+        set.erase(std::find(first, last, interval));
+    }
+
+    struct RegisterClass {
+        std::multiset<Interval*, CurrentEndComparator> active{};
+        std::multiset<Interval*, CurrentStartComparator> inactive{};
+        std::vector<Interval*> activeByRegister{};
 
-    struct IncreasingEndComparator {
-        bool operator() (Value* a, Value* b) const {
-            return a->GetLiveInterval().end < b->GetLiveInterval().end;
+        inline void Reset(uint32_t registerCount) {
+            active.clear();
+            inactive.clear();
+            activeByRegister.assign(registerCount, nullptr);
         }
     };
-    std::multiset<Value*, IncreasingEndComparator> mActiveValues{};
+    RegisterClass mGPClass{};
+    RegisterClass mFPClass{};
+
+    // All split parts of a value share one stack slot
+    std::unordered_map<const Value*, StackLocation> mSpillSlots{};
+
+    // Starts of blocks in the linear order and their loop depths
+    std::vector<uint64_t> mBlockStarts{};
+    std::vector<uint32_t> mBlockDepths{};
+
+    std::unordered_map<const Instruction*, std::vector<Move>> mInstructionMoves{};
+    std::map<std::pair<const BasicBlock*, const BasicBlock*>, std::vector<Move>> mEdgeMoves{};
+    static inline const std::vector<Move> kNoMoves{};
 
+    Statistics mStatistics{};
     uint32_t mStackLocations{0};
 };
 
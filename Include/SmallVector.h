@@ -0,0 +1,161 @@
+#ifndef SMALL_VECTOR_H
+#define SMALL_VECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <initializer_list>
+#include <type_traits>
+
+namespace VMIR {
+
+// Vector which keeps first N elements inside the object and goes to the heap only when it outgrows them.
+// Made for short lists of pointers, like CFG edges, so elements must be trivially copyable
+template <typename T, size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector only holds trivially copyable elements");
+    static_assert(N > 0, "SmallVector must have inline storage");
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    // Constructors
+    SmallVector() = default;
+
+    SmallVector(std::initializer_list<T> init) {
+        Assign(init.begin(), init.size());
+    }
+
+    SmallVector(const SmallVector& other) {
+        Assign(other.mData, other.mSize);
+    }
+
+    SmallVector(SmallVector&& other) noexcept {
+        MoveFrom(other);
+    }
+
+    // Operators
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) {
+            mSize = 0;
+            Assign(other.mData, other.mSize);
+        }
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            FreeHeap();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    inline T& operator[](size_t idx) { return mData[idx]; }
+    inline const T& operator[](size_t idx) const { return mData[idx]; }
+
+    ~SmallVector() { FreeHeap(); }
+
+    // Getters
+    inline iterator begin() { return mData; }
+    inline iterator end()   { return mData + mSize; }
+    inline const_iterator begin() const { return mData; }
+    inline const_iterator end()   const { return mData + mSize; }
+
+    inline T* data() { return mData; }
+    inline const T* data() const { return mData; }
+
+    inline size_t size() const { return mSize; }
+    inline size_t capacity() const { return mCapacity; }
+    inline bool empty() const { return mSize == 0; }
+    inline bool IsInline() const { return mData == mInline; }
+
+    inline T& front() { return mData[0]; }
+    inline T& back()  { return mData[mSize - 1]; }
+    inline const T& front() const { return mData[0]; }
+    inline const T& back()  const { return mData[mSize - 1]; }
+
+    inline bool contains(const T& value) const { return std::find(begin(), end(), value) != end(); }
+
+    // Modifiers
+    inline void push_back(const T& value) {
+        if (mSize == mCapacity) {
+            Grow(2 * mCapacity);
+        }
+        mData[mSize++] = value;
+    }
+
+    inline void pop_back() { --mSize; }
+    inline void clear() { mSize = 0; }
+
+    inline void reserve(size_t capacity) {
+        if (capacity > mCapacity) {
+            Grow(capacity);
+        }
+    }
+
+    // Keeps the order of the remaining elements
+    inline iterator erase(const_iterator pos) {
+        T* it = mData + (pos - mData);
+        std::copy(it + 1, end(), it);
+        --mSize;
+        return it;
+    }
+
+private:
+    void Grow(size_t capacity) {
+        T* data = static_cast<T*>(::operator new(capacity * sizeof(T)));
+        if (mSize > 0) {
+            std::memcpy(data, mData, mSize * sizeof(T));
+        }
+        FreeHeap();
+        mData = data;
+        mCapacity = capacity;
+    }
+
+    void Assign(const T* data, size_t size) {
+        reserve(size);
+        if (size > 0) {
+            std::memcpy(mData, data, size * sizeof(T));
+        }
+        mSize = size;
+    }
+
+    void MoveFrom(SmallVector& other) {
+        if (other.IsInline()) {
+            mData = mInline;
+            mCapacity = N;
+            Assign(other.mData, other.mSize);
+        }
+        else {
+            // Steal the heap buffer
+            mData = other.mData;
+            mSize = other.mSize;
+            mCapacity = other.mCapacity;
+            other.mData = other.mInline;
+            other.mCapacity = N;
+        }
+        other.mSize = 0;
+    }
+
+    inline void FreeHeap() {
+        if (!IsInline()) {
+            ::operator delete(mData);
+        }
+        mData = mInline;
+        mCapacity = N;
+    }
+
+    T* mData{mInline};
+    size_t mSize{0};
+    size_t mCapacity{N};
+    T mInline[N]{};
+};
+
+}   // namespace VMIR
+
+#endif  // SMALL_VECTOR_H
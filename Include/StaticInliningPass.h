@@ -12,6 +12,7 @@ public:
     StaticInliningPass();
 
     virtual void Run(Function* func) override;
+    virtual void ReportStatistics(TraceScope& scope) const override;
 
     size_t GetInlineInstructionCountThreshold() const;
     void SetInlineInstructionCountThreshold(size_t threshold);
@@ -24,6 +25,7 @@ private:
     std::unordered_set<Function*> mFunctionsToProcess{};
 
     size_t mInlineInstructionCountThreshold;
+    size_t mInlinedCalls{0};
 };
 
 }   // namespace VMIR
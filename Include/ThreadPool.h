@@ -0,0 +1,68 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VMIR {
+
+// Fixed set of workers, each one with its own task queue. A worker takes the newest task of its own queue
+// and, when the queue is empty, steals the oldest task of another worker
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // Zero means one worker per hardware thread
+    explicit ThreadPool(size_t threadCount = 0);
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    ~ThreadPool();
+
+    // Task submitted from a worker goes to the queue of this worker, other tasks are spread round-robin
+    void Submit(Task task);
+
+    // Blocks until every submitted task is finished. Must not be called from a worker
+    void Wait();
+
+    inline size_t GetThreadCount() const { return mWorkers.size(); }
+    inline size_t GetStealCount() const { return mStealCount.load(std::memory_order_relaxed); }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex{};
+        std::deque<Task> tasks{};
+    };
+
+    void WorkerLoop(size_t idx);
+    bool TryPop(size_t idx, Task& task);
+    bool TrySteal(size_t idx, Task& task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> mQueues{};
+    std::vector<std::thread> mWorkers{};
+
+    // Workers sleep on mMutex when there is nothing to run. Tasks are counted without it, the mutex is only taken
+    // to wake a sleeping worker or the waiter
+    std::mutex mMutex{};
+    std::condition_variable mWorkAvailable{};
+    std::condition_variable mAllDone{};
+    bool mStopping{false};
+
+    // Queued count is bumped after the push and dropped after the pop, so it may briefly go below zero
+    std::atomic<int64_t> mQueuedTasks{0};
+    std::atomic<size_t> mUnfinishedTasks{0};
+    std::atomic<size_t> mSleepingWorkers{0};
+
+    std::atomic<size_t> mNextQueue{0};
+    std::atomic<size_t> mStealCount{0};
+};
+
+}   // namespace VMIR
+
+#endif  // THREAD_POOL_H
@@ -0,0 +1,92 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace VMIR {
+
+class Function;
+
+// Finished span of work: a pass or an analysis over one function
+struct TraceEvent {
+    std::string name{};
+    std::string category{};
+    std::string function{};
+    uint64_t startNs{0};
+    uint64_t durationNs{0};
+    uint32_t threadId{0};
+    std::vector<std::pair<std::string, int64_t>> args{};
+};
+
+// Collects events from any number of threads. Attach it to a context to enable tracing of its passes and analyses
+class TraceRecorder {
+public:
+    TraceRecorder() : mOrigin{std::chrono::steady_clock::now()} {}
+
+    void Record(TraceEvent&& event);
+
+    inline uint64_t GetTimestampNs() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mOrigin).count());
+    }
+
+    // Copy is taken under the lock, so it can be called while other threads still record
+    std::vector<TraceEvent> GetEvents() const;
+    void Clear();
+
+    // JSON in Chrome trace event format, can be opened in chrome://tracing or Perfetto
+    void WriteChromeTrace(std::ostream& out) const;
+
+    // Total time and call count per event name, the most expensive go first
+    void PrintSummary(std::ostream& out) const;
+
+private:
+    std::chrono::steady_clock::time_point mOrigin;
+
+    mutable std::mutex mMutex{};
+    std::vector<TraceEvent> mEvents{};
+    std::unordered_map<std::thread::id, uint32_t> mThreadIds{};
+};
+
+// Measures its own lifetime. Without a recorder it does nothing, not even reads the clock
+class TraceScope {
+public:
+    TraceScope(TraceRecorder* recorder, const char* name, const char* category, const Function* function = nullptr)
+    : mRecorder{recorder}, mName{name}, mCategory{category}, mFunction{function} {
+        if (mRecorder != nullptr) {
+            mStartNs = mRecorder->GetTimestampNs();
+        }
+    }
+
+    TraceScope(const TraceScope& other) = delete;
+    TraceScope& operator=(const TraceScope& other) = delete;
+
+    ~TraceScope();
+
+    inline bool IsEnabled() const { return mRecorder != nullptr; }
+
+    inline void AddArg(const char* key, int64_t value) {
+        if (mRecorder != nullptr) {
+            mArgs.emplace_back(key, value);
+        }
+    }
+
+private:
+    TraceRecorder* mRecorder{nullptr};
+    const char* mName{nullptr};
+    const char* mCategory{nullptr};
+    const Function* mFunction{nullptr};
+    uint64_t mStartNs{0};
+    std::vector<std::pair<std::string, int64_t>> mArgs{};
+};
+
+}   // namespace VMIR
+
+#endif  // TRACE_H
@@ -2,15 +2,18 @@
 #define VALUE_H
 
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
 #include <variant>
 #include <string>
 #include <optional>
-#include <set>
+#include <vector>
+#include <algorithm>
+#include <iterator>
 
 namespace VMIR {
 
-enum class ValueType {
+enum class ValueType : uint8_t {
     Void = 0,
     Int8,
     Int16,
@@ -76,6 +79,18 @@ constexpr ValueType TypeToValueType() {
 }
 
 
+// Raw bits of the numeric value zero-extended to 64 bits. Distinguishes +0.0 from -0.0 and NaNs with different payloads
+template <typename T>
+requires NumericType<T>
+inline uint64_t ToBitPattern(const T value) {
+    static_assert(sizeof(T) <= sizeof(uint64_t));
+
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(T));
+    return bits;
+}
+
+
 constexpr uint64_t kInstructionLiveDiffSpillFill = 2;
 
 struct LiveRange {
@@ -109,6 +124,111 @@ struct LiveRange {
 // These two are pretty similar
 using LiveInterval = LiveRange;
 
+// Ranges where the value is live, with lifetime holes between them, and live numbers of the instructions
+// which define or read it. Liveness adds ranges in any order and sorts them once in Finalize
+class LiveRangeList {
+public:
+    inline void AddRange(const LiveRange& range) {
+        if (!mRanges.empty() && mRanges.back().start <= range.end && range.start <= mRanges.back().end) {
+            mRanges.back().UniteWith(range);
+        }
+        else {
+            mRanges.push_back(range);
+        }
+    }
+
+    // Definition starts the range which was added last, if it covers the definition. Unused values live shortly
+    inline void SetDefinition(const uint64_t position) {
+        if (!mRanges.empty() && mRanges.back().start <= position && position < mRanges.back().end) {
+            mRanges.back().start = position;
+        }
+        else {
+            mRanges.push_back(LiveRange{position, position + kInstructionLiveDiffSpillFill});
+        }
+        mUsePositions.push_back(position);
+    }
+
+    inline void AddUse(const uint64_t position) { mUsePositions.push_back(position); }
+
+    // Sorts ranges and uses, merges ranges which overlap or touch
+    inline void Finalize() {
+        std::sort(mRanges.begin(), mRanges.end(), [](const LiveRange& a, const LiveRange& b) { return a.start < b.start; });
+        size_t last = 0;
+        for (size_t i = 1; i < mRanges.size(); ++i) {
+            if (mRanges[i].start <= mRanges[last].end) {
+                mRanges[last].end = std::max(mRanges[last].end, mRanges[i].end);
+            }
+            else {
+                mRanges[++last] = mRanges[i];
+            }
+        }
+        mRanges.resize(mRanges.empty() ? 0 : last + 1);
+
+        std::sort(mUsePositions.begin(), mUsePositions.end());
+        mUsePositions.erase(std::unique(mUsePositions.begin(), mUsePositions.end()), mUsePositions.end());
+    }
+
+    inline void Clear() {
+        mRanges.clear();
+        mUsePositions.clear();
+    }
+
+    // Moves ranges and uses from the position on into the returned list
+    inline LiveRangeList SplitAt(const uint64_t position) {
+        LiveRangeList tail{};
+        auto it = std::find_if(mRanges.begin(), mRanges.end(), [position](const LiveRange& range) { return position < range.end; });
+        if (it != mRanges.end() && it->start < position) {
+            tail.mRanges.push_back(LiveRange{position, it->end});
+            it->end = position;
+            ++it;
+        }
+        tail.mRanges.insert(tail.mRanges.end(), it, mRanges.end());
+        mRanges.erase(it, mRanges.end());
+
+        auto useIt = std::lower_bound(mUsePositions.begin(), mUsePositions.end(), position);
+        tail.mUsePositions.assign(useIt, mUsePositions.end());
+        mUsePositions.erase(useIt, mUsePositions.end());
+        return tail;
+    }
+
+    inline const std::vector<LiveRange>& GetRanges() const { return mRanges; }
+    inline const std::vector<uint64_t>& GetUsePositions() const { return mUsePositions; }
+    inline bool IsEmpty() const { return mRanges.empty(); }
+
+    inline LiveRange GetHull() const {
+        return mRanges.empty() ? LiveRange{0, 0} : LiveRange{mRanges.front().start, mRanges.back().end};
+    }
+
+    inline bool Covers(const uint64_t position) const {
+        auto it = std::upper_bound(mRanges.begin(), mRanges.end(), position, [](uint64_t pos, const LiveRange& range) { return pos < range.start; });
+        return it != mRanges.begin() && position < std::prev(it)->end;
+    }
+
+    // First position where both values are live
+    inline std::optional<uint64_t> FirstIntersection(const LiveRangeList& other) const {
+        auto a = mRanges.begin();
+        auto b = other.mRanges.begin();
+        while (a != mRanges.end() && b != other.mRanges.end()) {
+            const uint64_t start = std::max(a->start, b->start);
+            if (start < std::min(a->end, b->end)) {
+                return start;
+            }
+            (a->end < b->end) ? ++a : ++b;
+        }
+        return std::nullopt;
+    }
+
+    // First use at the position or after it
+    inline std::optional<uint64_t> NextUseFrom(const uint64_t position) const {
+        auto it = std::lower_bound(mUsePositions.begin(), mUsePositions.end(), position);
+        return it != mUsePositions.end() ? std::optional<uint64_t>{*it} : std::nullopt;
+    }
+
+private:
+    std::vector<LiveRange> mRanges{};
+    std::vector<uint64_t> mUsePositions{};
+};
+
 using ValueId = int64_t;
 using InstructionId = int64_t;
 using BasicBlockId = int64_t;
@@ -139,37 +259,196 @@ struct StackLocation {
 using Location = std::variant<GPRegisterLocation, FPRegisterLocation, StackLocation>;
 
 class Instruction;
+class Value;
+
+// Input of an instruction. All uses of a value are chained into the intrusive doubly-linked list, so the value
+// knows its users without any extra allocations. Setting a new value moves the use to the list of that value
+class Use {
+public:
+    // Constructors
+    explicit Use(Instruction* user, Value* value = nullptr) : mUser{user} { Set(value); }
+
+    Use(const Use& other) = delete;
+
+    // Moved use keeps the user, it is used by containers of uses that belong to the same instruction
+    Use(Use&& other) noexcept : mUser{other.mUser} {
+        Set(other.mValue);
+        other.Set(nullptr);
+    }
+
+    // Operators
+    Use& operator=(const Use& other) = delete;
+
+    Use& operator=(Use&& other) noexcept {
+        if (this != &other) {
+            Set(other.mValue);
+            other.Set(nullptr);
+        }
+        return *this;
+    }
+
+    inline operator Value*() const { return mValue; }
+    inline Value* operator->() const { return mValue; }
+
+    ~Use() { Set(nullptr); }
+
+    // Getters
+    inline Value* Get() const { return mValue; }
+    inline Instruction* GetUser() const { return mUser; }
+    inline Use* GetNext() const { return mNext; }
+
+    // Setters
+    inline void Set(Value* value);
+
+private:
+    inline void Link(Value* value);
+
+    // Constants are shared by all functions of a context, so their use-lists are changed under a lock
+    void SetShared(Value* value);
+
+    Value* mValue{nullptr};
+    Instruction* mUser{nullptr};
+
+    Use* mPrev{nullptr};
+    Use* mNext{nullptr};
+};
+
+
+// Walks the use-list of a value and yields users. Instruction appears once for every input it takes the value through
+class UserIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = Instruction*;
+    using pointer = Instruction* const*;
+    using reference = Instruction*;
+
+    UserIterator(Use* use = nullptr) : mUse{use} {};
+
+    inline Instruction* operator*() const { return mUse->GetUser(); }
+    inline UserIterator& operator++() { mUse = mUse->GetNext(); return *this; }
+    inline UserIterator operator++(int) { UserIterator tmp = *this; ++(*this); return tmp; }
+    inline bool operator==(const UserIterator& other) const = default;
+
+private:
+    Use* mUse{nullptr};
+};
+
+class UserRange {
+public:
+    using value_type = Instruction*;
+    using iterator = UserIterator;
+    using const_iterator = UserIterator;
+
+    UserRange(Use* head) : mHead{head} {};
+
+    inline UserIterator begin() const { return UserIterator(mHead); }
+    inline UserIterator end() const { return UserIterator(); }
+    inline bool empty() const { return mHead == nullptr; }
+    inline size_t size() const { return static_cast<size_t>(std::distance(begin(), end())); }
+
+private:
+    Use* mHead{nullptr};
+};
+
+
+// Yields values of contiguous uses, e.g. arguments of a call
+class OperandIterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = Value*;
+    using pointer = Value* const*;
+    using reference = Value*;
+
+    OperandIterator(const Use* use = nullptr) : mUse{use} {};
+
+    inline Value* operator*() const { return mUse->Get(); }
+    inline Value* operator[](difference_type n) const { return mUse[n].Get(); }
+    inline OperandIterator& operator++() { ++mUse; return *this; }
+    inline OperandIterator operator++(int) { OperandIterator tmp = *this; ++mUse; return tmp; }
+    inline OperandIterator& operator--() { --mUse; return *this; }
+    inline OperandIterator operator--(int) { OperandIterator tmp = *this; --mUse; return tmp; }
+    inline OperandIterator& operator+=(difference_type n) { mUse += n; return *this; }
+    inline OperandIterator& operator-=(difference_type n) { mUse -= n; return *this; }
+    inline OperandIterator operator+(difference_type n) const { return OperandIterator(mUse + n); }
+    inline OperandIterator operator-(difference_type n) const { return OperandIterator(mUse - n); }
+    inline difference_type operator-(const OperandIterator& other) const { return mUse - other.mUse; }
+    inline auto operator<=>(const OperandIterator& other) const = default;
+
+    friend inline OperandIterator operator+(difference_type n, const OperandIterator& it) { return it + n; }
+
+private:
+    const Use* mUse{nullptr};
+};
+
+class OperandRange {
+public:
+    using value_type = Value*;
+    using iterator = OperandIterator;
+    using const_iterator = OperandIterator;
+
+    OperandRange(const Use* begin = nullptr, const Use* end = nullptr) : mBegin{begin}, mEnd{end} {};
+
+    inline OperandIterator begin() const { return OperandIterator(mBegin); }
+    inline OperandIterator end() const { return OperandIterator(mEnd); }
+    inline bool empty() const { return mBegin == mEnd; }
+    inline size_t size() const { return static_cast<size_t>(mEnd - mBegin); }
+    inline Value* operator[](size_t idx) const { return mBegin[idx].Get(); }
+
+private:
+    const Use* mBegin{nullptr};
+    const Use* mEnd{nullptr};
+};
+
+
+// Value moves to the location at the position, when its lifetime is split between several locations
+struct LocationSplit {
+    uint64_t position;
+    Location location;
+};
+
+// Results of liveness analysis and register allocation. Most values never need them (constants, values of
+// functions which are not compiled yet), so they are kept out of line and created on first request
+struct ValueAllocationInfo {
+    LiveInterval liveInterval{};
+    LiveRangeList liveRanges{};
+    std::vector<LocationSplit> locationSplits{};
+    Location location{};
+};
 
 class Value {
 public:
     // Constructors
     Value(const ValueId id = -1) : mId{id} {};
 
-    Value(const Value& other) : mId{other.mId}, mValueType{other.mValueType}, mValue{other.mValue} {};
+    Value(const Value& other) : mId{other.mId}, mData{other.mData}, mValueType{other.mValueType}, mHasValue{other.mHasValue} {};
 
-    Value(Value&& other) noexcept : mId{std::move(other.mId)}, mValueType{std::move(other.mValueType)}, mValue{std::move(other.mValue)} {};
+    Value(Value&& other) noexcept : mId{other.mId}, mData{other.mData}, mValueType{other.mValueType}, mHasValue{other.mHasValue} {};
 
     explicit Value(const ValueId id, const ValueType vt) : mId{id}, mValueType{vt} {};
 
     template <typename T>
     requires NumericType<T>
-    explicit Value(const ValueId id, const T value) : mId{id}, mValueType{TypeToValueType<T>()}, mValue{value} {};
+    explicit Value(const ValueId id, const T value) : mId{id}, mData{ToBitPattern(value)}, mValueType{TypeToValueType<T>()}, mHasValue{true} {};
 
     // Operators
     Value& operator=(const Value& other) {
         if (this != &other) { 
             mId = other.mId;
+            mData = other.mData;
             mValueType = other.mValueType;
-            mValue = other.mValue;
+            mHasValue = other.mHasValue;
         }
         return *this;
     }
 
     Value& operator=(Value&& other) noexcept {
         if (this != &other) {
-            mId = std::move(other.mId);
-            mValueType = std::move(other.mValueType);
-            mValue = std::move(other.mValue);
+            mId = other.mId;
+            mData = other.mData;
+            mValueType = other.mValueType;
+            mHasValue = other.mHasValue;
         }
         return *this;
     }
@@ -177,10 +456,17 @@ public:
     bool operator==(const Value& other) {
         return mId == other.mId
             && mValueType == other.mValueType
-            && mValue == other.mValue;
+            && mHasValue == other.mHasValue
+            && mData == other.mData;
     }
 
-    ~Value() {};
+    // Uses of the removed value are reset, so instructions never point to freed memory
+    ~Value() {
+        while (mUses) {
+            mUses->Set(nullptr);
+        }
+        delete mAllocationInfo;
+    };
 
     // Getters. Value class is deliberately immutable, so no setters
     inline ValueType GetValueType() const { return mValueType; } 
@@ -211,32 +497,67 @@ public:
         return GetValueType() == ValueType::Pointer;
     }
 
-    inline bool HasValue() const { return mValue.has_value(); }
+    inline bool HasValue() const { return mHasValue; }
 
     template <typename T>
     requires NumericType<T>
     inline std::optional<T> GetValue() const {
         if (HasValue()) {
-            return std::get<std::remove_cv_t<T>>(*mValue);
+            T value{};
+            std::memcpy(&value, &mData, sizeof(T));
+            return value;
         }
         return std::nullopt;
     } 
 
+    // Raw bits of the constant as produced by ToBitPattern
+    inline uint64_t GetBitPattern() const { return mData; }
+
     inline ValueId GetId() const { return mId; }
 
-    inline void AddUser(Instruction* u)                   { mUsers.insert(u); }
-    inline bool HasUser(Instruction* u) const             { return mUsers.contains(u); }
-    inline void RemoveUser(Instruction* u)                { mUsers.erase(u); }
-    inline const std::set<Instruction*>& GetUsers() const { return mUsers; }
+    inline Use* GetFirstUse() const { return mUses; }
+    inline UserRange GetUsers() const { return UserRange(mUses); }
+    inline bool HasUser(const Instruction* u) const {
+        for (Use* use = mUses; use; use = use->GetNext()) {
+            if (use->GetUser() == u) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Make all users take the other value instead. Linear in the number of uses
+    inline void ReplaceAllUsesWith(Value* other) {
+        if (!other || other == this) {
+            return;
+        }
+        while (mUses) {
+            mUses->Set(other);
+        }
+    }
 
     inline Instruction* GetProducer() const { return mProducer; }
     inline void SetProducer(Instruction* prod) { mProducer = prod; }
 
-    inline LiveInterval& GetLiveInterval() { return mLiveInterval; }
-    inline const LiveInterval& GetLiveInterval() const { return mLiveInterval; }
+    inline LiveInterval& GetLiveInterval() { return GetOrCreateAllocationInfo()->liveInterval; }
+    inline const LiveInterval& GetLiveInterval() const { return mAllocationInfo ? mAllocationInfo->liveInterval : kEmptyAllocationInfo.liveInterval; }
+
+    inline LiveRangeList& GetLiveRanges() { return GetOrCreateAllocationInfo()->liveRanges; }
+    inline const LiveRangeList& GetLiveRanges() const { return mAllocationInfo ? mAllocationInfo->liveRanges : kEmptyAllocationInfo.liveRanges; }
 
-    inline Location GetLocation() const { return mLocation; }
-    inline void SetLocation(Location loc) { mLocation = loc; }
+    // Location at the definition
+    inline Location GetLocation() const { return mAllocationInfo ? mAllocationInfo->location : kEmptyAllocationInfo.location; }
+    inline void SetLocation(Location loc) { GetOrCreateAllocationInfo()->location = loc; }
+
+    // Later locations of the value, sorted by position
+    inline const std::vector<LocationSplit>& GetLocationSplits() const { return mAllocationInfo ? mAllocationInfo->locationSplits : kEmptyAllocationInfo.locationSplits; }
+    inline void SetLocationSplits(std::vector<LocationSplit>&& splits) { GetOrCreateAllocationInfo()->locationSplits = std::move(splits); }
+
+    inline Location GetLocationAt(const uint64_t position) const {
+        const auto& splits = GetLocationSplits();
+        auto it = std::upper_bound(splits.begin(), splits.end(), position, [](uint64_t pos, const LocationSplit& split) { return pos < split.position; });
+        return it == splits.begin() ? GetLocation() : std::prev(it)->location;
+    }
 
     inline std::string GetValueStr() const {
         if (HasValue()) {
@@ -261,20 +582,75 @@ public:
     inline bool IsValid() const { return mId != -1 && mValueType != ValueType::Unknown; }
 
 private:
-    ValueId mId{-1};
+    inline ValueAllocationInfo* GetOrCreateAllocationInfo() {
+        if (!mAllocationInfo) {
+            mAllocationInfo = new ValueAllocationInfo();
+        }
+        return mAllocationInfo;
+    }
 
-    ValueType mValueType = ValueType::Unknown;
+    static inline const ValueAllocationInfo kEmptyAllocationInfo{};
+
+    ValueId mId{-1};
 
-    std::optional<std::variant<int8_t,  int16_t,  int32_t,  int64_t,
-                  uint8_t, uint16_t, uint32_t, uint64_t, float, double>> mValue{};
+    // Constant payload, see ToBitPattern
+    uint64_t mData{0};
 
-    std::set<Instruction*> mUsers{};
     Instruction* mProducer{};
-    LiveInterval mLiveInterval{};
-    Location mLocation{};
+
+    // Head of the use-list
+    Use* mUses{nullptr};
+
+    ValueAllocationInfo* mAllocationInfo{};
+
+    ValueType mValueType = ValueType::Unknown;
+    bool mHasValue{false};
+
+    friend class Use;
 };
 
 
+inline void Use::Set(Value* value) {
+    if (mValue == value) {
+        return;
+    }
+
+    if ((mValue && mValue->mHasValue) || (value && value->mHasValue)) {
+        SetShared(value);
+        return;
+    }
+    Link(value);
+}
+
+inline void Use::Link(Value* value) {
+
+    // Unlink from the use-list of the old value
+    if (mValue) {
+        if (mPrev) {
+            mPrev->mNext = mNext;
+        }
+        else {
+            mValue->mUses = mNext;
+        }
+        if (mNext) {
+            mNext->mPrev = mPrev;
+        }
+        mPrev = nullptr;
+        mNext = nullptr;
+    }
+
+    // Push to the front of the use-list of the new value
+    mValue = value;
+    if (mValue) {
+        mNext = mValue->mUses;
+        if (mNext) {
+            mNext->mPrev = this;
+        }
+        mValue->mUses = this;
+    }
+}
+
+
 static inline bool IsValueZero(Value* value) {
     if (!value || !value->HasValue()) {
         return false;
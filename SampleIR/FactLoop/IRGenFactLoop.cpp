@@ -27,7 +27,6 @@ int main() {
     VMIR::Value* v4 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
     VMIR::Value* v5 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
     VMIR::Value* v6 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
-    VMIR::Value* v7 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
 
     // EntryBB
     IrBuilder->CreateAdd(EntryBB, zero, one, v1);
@@ -39,17 +38,16 @@ int main() {
 
     // LoopHeaderBB
     IrBuilder->CreatePhi(LoopHeaderBB, {v2, v6}, v3);
+    IrBuilder->CreatePhi(LoopHeaderBB, {v1, v5}, {LoopPreheaderBB, LoopBodyBB}, v4);
     IrBuilder->CreateBgt(LoopHeaderBB, v3, v0, LoopExitBB, LoopBodyBB);
 
     // LoopBodyBB
-    IrBuilder->CreatePhi(LoopBodyBB, {v1, v5}, v4);
     IrBuilder->CreateMul(LoopBodyBB, v4, v3, v5);
     IrBuilder->CreateAdd(LoopBodyBB, v3, one, v6);
     IrBuilder->CreateJump(LoopBodyBB, LoopHeaderBB);
 
     // LoopExitBB
-    IrBuilder->CreatePhi(LoopExitBB, {v1, v5}, v7);
-    IrBuilder->CreateRet(LoopExitBB, v7);
+    IrBuilder->CreateRet(LoopExitBB, v4);
 
     // Check validity
     if (!Fact->IsValid()) {
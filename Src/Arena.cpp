@@ -0,0 +1,40 @@
+#include <Arena.h>
+
+namespace VMIR {
+
+void* Arena::AllocateSlow(size_t size) {
+    // Big allocations get their own chunk, so the tail of the current chunk is not wasted
+    const bool isBigAllocation = size > mChunkSize / 4;
+    const size_t chunkSize = kChunkHeaderSize + (isBigAllocation ? size : mChunkSize);
+
+    char* memory = static_cast<char*>(::operator new(chunkSize, std::align_val_t{kAlignment}));
+    ChunkHeader* chunk = reinterpret_cast<ChunkHeader*>(memory);
+    chunk->prev = mLastChunk;
+    chunk->size = chunkSize;
+    mLastChunk = chunk;
+    mReservedBytes += chunkSize;
+
+    char* ptr = memory + kChunkHeaderSize;
+    if (!isBigAllocation) {
+        mCurrent = ptr + size;
+        mEnd = memory + chunkSize;
+    }
+    return ptr;
+}
+
+void Arena::Release() {
+    ChunkHeader* chunk = mLastChunk;
+    while (chunk != nullptr) {
+        ChunkHeader* prev = chunk->prev;
+        ::operator delete(chunk, std::align_val_t{kAlignment});
+        chunk = prev;
+    }
+
+    mLastChunk = nullptr;
+    mCurrent = nullptr;
+    mEnd = nullptr;
+    mReservedBytes = 0;
+    mFreeLists.fill(nullptr);
+}
+
+}   // namespace VMIR
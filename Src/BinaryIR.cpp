@@ -0,0 +1,772 @@
+#include <BinaryIR.h>
+#include <IRBuilder.h>
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace VMIR {
+
+static_assert(std::endian::native == std::endian::little, "Binary IR is stored in little-endian order");
+
+static constexpr char kBinaryIRMagic[8] = {'V', 'M', 'I', 'R', 'B', 'I', 'N', '\0'};
+static constexpr uint32_t kBinaryIRVersion = 1;
+
+// Operand refers to the constant pool if the bit is set, otherwise to a value of the function
+static constexpr uint32_t kConstantOperandBit = 1U << 31;
+static constexpr uint32_t kNoValue = UINT32_MAX;
+
+struct BinaryFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t functionCount;
+    uint32_t constantCount;
+    uint32_t reserved;
+    uint64_t constantPoolOffset;
+    uint64_t functionTableOffset;
+    uint64_t stringTableOffset;
+    uint64_t stringTableSize;
+};
+
+struct BinaryConstant {
+    uint64_t bits;
+    uint8_t type;
+    uint8_t reserved[7];
+};
+
+struct BinaryFunction {
+    uint64_t bodyOffset;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t argCount;
+    uint32_t valueCount;
+    uint32_t blockCount;
+    uint32_t instructionCount;
+    uint32_t operandCount;
+    uint32_t predecessorCount;
+    uint32_t entryBlock;
+    uint8_t returnType;
+    uint8_t reserved[3];
+};
+
+struct BinaryBasicBlock {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t firstInstruction;
+    uint32_t instructionCount;
+    uint32_t firstPredecessor;
+    uint32_t predecessorCount;
+};
+
+// Targets are basic blocks of jumps and branches, the callee of calls, or the element count of allocs
+struct BinaryInstruction {
+    uint8_t type;
+    uint8_t valueType;
+    uint16_t reserved;
+    uint32_t output;
+    uint32_t firstOperand;
+    uint32_t operandCount;
+    uint32_t target0;
+    uint32_t target1;
+};
+
+// Sections of a body follow each other in this order, each one starts at 8 bytes boundary
+struct BinaryBodyLayout {
+    uint64_t valueTypes;
+    uint64_t blocks;
+    uint64_t instructions;
+    uint64_t operands;
+    uint64_t predecessors;
+    uint64_t end;
+};
+
+static inline uint64_t AlignTo8(uint64_t size) {
+    return (size + 7) & ~uint64_t(7);
+}
+
+// Same shapes as the text format accepts. Calls are checked against the callee
+static bool HasValidShape(InstructionType type, uint32_t operandCount, bool hasOutput) {
+    switch (type) {
+        default:                            return false;
+
+        case InstructionType::Add:
+        case InstructionType::Sub:
+        case InstructionType::Mul:
+        case InstructionType::Div:
+        case InstructionType::Rem:
+        case InstructionType::And:
+        case InstructionType::Or:
+        case InstructionType::Xor:
+        case InstructionType::Shl:
+        case InstructionType::Shr:
+        case InstructionType::Ashr:         return operandCount == 2 && hasOutput;
+
+        case InstructionType::Beq:
+        case InstructionType::Bne:
+        case InstructionType::Bgt:
+        case InstructionType::Blt:
+        case InstructionType::Bge:
+        case InstructionType::Ble:
+        case InstructionType::Store:
+        case InstructionType::BoundsCheck:  return operandCount == 2 && !hasOutput;
+
+        case InstructionType::Load:
+        case InstructionType::Mv:           return operandCount == 1 && hasOutput;
+        case InstructionType::NullCheck:    return operandCount == 1 && !hasOutput;
+        case InstructionType::Jump:         return operandCount == 0 && !hasOutput;
+        case InstructionType::Alloc:        return operandCount == 0 && hasOutput;
+        case InstructionType::Ret:          return operandCount <= 1 && !hasOutput;
+        case InstructionType::Phi:          return operandCount >= 1 && hasOutput;
+        case InstructionType::Call:         return true;
+    }
+}
+
+static BinaryBodyLayout GetBodyLayout(const BinaryFunction& func) {
+    BinaryBodyLayout layout{};
+    layout.valueTypes = 0;
+    layout.blocks = AlignTo8(func.valueCount);
+    layout.instructions = layout.blocks + uint64_t(func.blockCount) * sizeof(BinaryBasicBlock);
+    layout.operands = layout.instructions + uint64_t(func.instructionCount) * sizeof(BinaryInstruction);
+    layout.predecessors = layout.operands + uint64_t(func.operandCount) * sizeof(uint32_t);
+    layout.end = AlignTo8(layout.predecessors + uint64_t(func.predecessorCount) * sizeof(uint32_t));
+    return layout;
+}
+
+template <typename T>
+static void AppendRecord(std::string& buffer, const T& record) {
+    buffer.append(reinterpret_cast<const char*>(&record), sizeof(T));
+}
+
+static void PadTo8(std::string& buffer) {
+    buffer.resize(AlignTo8(buffer.size()), '\0');
+}
+
+
+bool BinaryIRWriter::Error(const std::string& message) {
+    mError = message;
+    return false;
+}
+
+bool BinaryIRWriter::WriteFile(const std::string& filename) {
+    std::ofstream out(filename, std::ios::out | std::ios::binary);
+    if (!out) {
+        return Error("cannot open " + filename);
+    }
+    return Write(out) && static_cast<bool>(out.flush());
+}
+
+bool BinaryIRWriter::Write(std::ostream& out) {
+    mError.clear();
+
+    std::vector<Function*> functions(mContext->GetFunctions().begin(), mContext->GetFunctions().end());
+    std::unordered_map<const Function*, uint32_t> functionIds{};
+    for (size_t i = 0; i < functions.size(); ++i) {
+        functionIds.emplace(functions[i], static_cast<uint32_t>(i));
+    }
+
+    std::string strings{};
+    auto addString = [&strings](const std::string& str, uint32_t& offset, uint32_t& length) {
+        offset = static_cast<uint32_t>(strings.size());
+        length = static_cast<uint32_t>(str.size());
+        strings += str;
+    };
+
+    std::vector<BinaryConstant> constants{};
+    std::unordered_map<ConstantKey, uint32_t, ConstantKeyHash> constantIds{};
+
+    std::vector<BinaryFunction> records(functions.size());
+    std::string bodies{};
+
+    std::unordered_map<const Value*, uint32_t> valueIds{};
+    std::unordered_map<const BasicBlock*, uint32_t> blockIds{};
+    for (size_t f = 0; f < functions.size(); ++f) {
+        Function* func = functions[f];
+        BinaryFunction& record = records[f];
+        addString(func->GetName(), record.nameOffset, record.nameLength);
+        record.returnType = static_cast<uint8_t>(func->GetReturnType());
+        record.argCount = static_cast<uint32_t>(func->GetArgs().size());
+        record.entryBlock = kNoValue;
+
+        // Arguments go first, then outputs in order of instructions, so phis may refer to values defined below
+        valueIds.clear();
+        blockIds.clear();
+        std::string valueTypes{};
+        for (auto* arg : func->GetArgs()) {
+            valueIds.emplace(arg, static_cast<uint32_t>(valueTypes.size()));
+            valueTypes.push_back(static_cast<char>(arg->GetValueType()));
+        }
+        for (auto* bb : func->GetBasicBlocks()) {
+            blockIds.emplace(bb, static_cast<uint32_t>(blockIds.size()));
+            for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+                if (Value* output = inst->GetOutput(); output != nullptr) {
+                    valueIds.emplace(output, static_cast<uint32_t>(valueTypes.size()));
+                    valueTypes.push_back(static_cast<char>(output->GetValueType()));
+                }
+            }
+        }
+        if (func->GetEntryBasicBlock() != nullptr) {
+            record.entryBlock = blockIds.at(func->GetEntryBasicBlock());
+        }
+
+        std::vector<BinaryBasicBlock> blocks{};
+        std::vector<BinaryInstruction> instructions{};
+        std::vector<uint32_t> operands{};
+        std::vector<uint32_t> predecessors{};
+
+        auto getBlockId = [&blockIds](const BasicBlock* bb) {
+            auto it = blockIds.find(bb);
+            return it == blockIds.end() ? kNoValue : it->second;
+        };
+
+        for (auto* bb : func->GetBasicBlocks()) {
+            BinaryBasicBlock block{};
+            addString(bb->GetName(), block.nameOffset, block.nameLength);
+            block.firstInstruction = static_cast<uint32_t>(instructions.size());
+            block.firstPredecessor = static_cast<uint32_t>(predecessors.size());
+            for (auto* pred : bb->GetPredecessors()) {
+                const uint32_t predId = getBlockId(pred);
+                if (predId == kNoValue) {
+                    return Error("predecessor of " + bb->GetName() + " is not in #" + func->GetName());
+                }
+                predecessors.push_back(predId);
+            }
+            block.predecessorCount = static_cast<uint32_t>(predecessors.size()) - block.firstPredecessor;
+
+            for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+                BinaryInstruction binaryInst{};
+                binaryInst.type = static_cast<uint8_t>(inst->GetType());
+                binaryInst.output = inst->GetOutput() != nullptr ? valueIds.at(inst->GetOutput()) : kNoValue;
+                binaryInst.firstOperand = static_cast<uint32_t>(operands.size());
+                binaryInst.target0 = kNoValue;
+                binaryInst.target1 = kNoValue;
+
+                // Phi inputs are stored in the order of the predecessors, which the reader follows
+                const std::vector<Value*> instOperands = inst->IsPhi()
+                    ? static_cast<const InstructionPhi*>(inst)->GetInputsByPredecessors()
+                    : std::vector<Value*>(inst->operands().begin(), inst->operands().end());
+                for (Value* operand : instOperands) {
+                    if (operand == nullptr) {
+                        return Error("instruction with an empty operand in #" + func->GetName());
+                    }
+                    if (operand->HasValue()) {
+                        if (operand->IsPointer()) {
+                            return Error("pointer constants cannot be written, found one in #" + func->GetName());
+                        }
+                        const ConstantKey key{operand->GetValueType(), operand->GetBitPattern()};
+                        auto [it, inserted] = constantIds.try_emplace(key, static_cast<uint32_t>(constants.size()));
+                        if (inserted) {
+                            constants.push_back(BinaryConstant{key.bits, static_cast<uint8_t>(key.type), {}});
+                        }
+                        operands.push_back(it->second | kConstantOperandBit);
+                        continue;
+                    }
+                    auto it = valueIds.find(operand);
+                    if (it == valueIds.end()) {
+                        return Error(operand->GetValueStr() + " is used but not defined in #" + func->GetName());
+                    }
+                    operands.push_back(it->second);
+                }
+                binaryInst.operandCount = static_cast<uint32_t>(operands.size()) - binaryInst.firstOperand;
+
+                switch (inst->GetType()) {
+                    default:    break;
+                    case InstructionType::Jump: {
+                        binaryInst.target0 = getBlockId(static_cast<InstructionJump*>(inst)->GetJumpBasicBlock());
+                        break;
+                    }
+                    case InstructionType::Beq:
+                    case InstructionType::Bne:
+                    case InstructionType::Bgt:
+                    case InstructionType::Blt:
+                    case InstructionType::Bge:
+                    case InstructionType::Ble: {
+                        binaryInst.target0 = getBlockId(static_cast<InstructionBranch*>(inst)->GetTrueBasicBlock());
+                        binaryInst.target1 = getBlockId(static_cast<InstructionBranch*>(inst)->GetFalseBasicBlock());
+                        break;
+                    }
+                    case InstructionType::Call: {
+                        auto it = functionIds.find(static_cast<InstructionCall*>(inst)->GetFunction());
+                        if (it == functionIds.end()) {
+                            return Error("callee of a call in #" + func->GetName() + " is not in the context");
+                        }
+                        binaryInst.target0 = it->second;
+                        break;
+                    }
+                    case InstructionType::Alloc: {
+                        InstructionAlloc* alloc = static_cast<InstructionAlloc*>(inst);
+                        binaryInst.valueType = static_cast<uint8_t>(alloc->GetValueType());
+                        binaryInst.target0 = static_cast<uint32_t>(alloc->GetCount());
+                        break;
+                    }
+                }
+                instructions.push_back(binaryInst);
+            }
+            block.instructionCount = static_cast<uint32_t>(instructions.size()) - block.firstInstruction;
+            blocks.push_back(block);
+        }
+
+        record.valueCount = static_cast<uint32_t>(valueTypes.size());
+        record.blockCount = static_cast<uint32_t>(blocks.size());
+        record.instructionCount = static_cast<uint32_t>(instructions.size());
+        record.operandCount = static_cast<uint32_t>(operands.size());
+        record.predecessorCount = static_cast<uint32_t>(predecessors.size());
+
+        // Offset is relative to the first body until the size of the tables is known
+        record.bodyOffset = bodies.size();
+        bodies += valueTypes;
+        PadTo8(bodies);
+        for (const auto& block : blocks) {
+            AppendRecord(bodies, block);
+        }
+        for (const auto& binaryInst : instructions) {
+            AppendRecord(bodies, binaryInst);
+        }
+        bodies.append(reinterpret_cast<const char*>(operands.data()), operands.size() * sizeof(uint32_t));
+        bodies.append(reinterpret_cast<const char*>(predecessors.data()), predecessors.size() * sizeof(uint32_t));
+        PadTo8(bodies);
+    }
+
+    BinaryFileHeader header{};
+    std::memcpy(header.magic, kBinaryIRMagic, sizeof(kBinaryIRMagic));
+    header.version = kBinaryIRVersion;
+    header.functionCount = static_cast<uint32_t>(records.size());
+    header.constantCount = static_cast<uint32_t>(constants.size());
+    header.constantPoolOffset = sizeof(BinaryFileHeader);
+    header.functionTableOffset = header.constantPoolOffset + constants.size() * sizeof(BinaryConstant);
+    header.stringTableOffset = header.functionTableOffset + records.size() * sizeof(BinaryFunction);
+    header.stringTableSize = strings.size();
+
+    const uint64_t bodiesOffset = AlignTo8(header.stringTableOffset + header.stringTableSize);
+    for (auto& record : records) {
+        record.bodyOffset += bodiesOffset;
+    }
+
+    std::string tables{};
+    AppendRecord(tables, header);
+    for (const auto& constant : constants) {
+        AppendRecord(tables, constant);
+    }
+    for (const auto& record : records) {
+        AppendRecord(tables, record);
+    }
+    tables += strings;
+    PadTo8(tables);
+
+    out.write(tables.data(), static_cast<std::streamsize>(tables.size()));
+    out.write(bodies.data(), static_cast<std::streamsize>(bodies.size()));
+    return out.good() ? true : Error("failed to write binary IR");
+}
+
+
+BinaryIRModule::~BinaryIRModule() {
+    Unmap();
+}
+
+void BinaryIRModule::Unmap() {
+    if (mMapping != nullptr) {
+        munmap(mMapping, mMappingSize);
+    }
+    mMapping = nullptr;
+    mMappingSize = 0;
+}
+
+bool BinaryIRModule::Error(const std::string& message) {
+    mError = message;
+    return false;
+}
+
+bool BinaryIRModule::Open(const std::string& filename) {
+    Unmap();
+
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return Error("cannot open " + filename);
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return Error("cannot read " + filename);
+    }
+
+    // Pages of bodies are only read from the disk when their functions are materialized
+    void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return Error("cannot map " + filename);
+    }
+
+    mMapping = mapping;
+    mMappingSize = static_cast<size_t>(st.st_size);
+    return Load(std::string_view(static_cast<const char*>(mapping), mMappingSize));
+}
+
+bool BinaryIRModule::Load(std::string_view data) {
+    mData = data.data();
+    mSize = data.size();
+    mFunctions.clear();
+    mMaterialized.clear();
+    mMaterializedCount = 0;
+    mConstants.clear();
+    mFunctionsByName.clear();
+
+    if (mSize < sizeof(BinaryFileHeader) || reinterpret_cast<uintptr_t>(mData) % alignof(BinaryFileHeader) != 0) {
+        return Error("binary IR is truncated or misaligned");
+    }
+
+    const BinaryFileHeader* header = reinterpret_cast<const BinaryFileHeader*>(mData);
+    if (std::memcmp(header->magic, kBinaryIRMagic, sizeof(kBinaryIRMagic)) != 0) {
+        return Error("not a binary IR module");
+    }
+    if (header->version != kBinaryIRVersion) {
+        return Error("unsupported binary IR version " + std::to_string(header->version));
+    }
+    if (GetRecords<BinaryConstant>(header->constantPoolOffset, header->constantCount) == nullptr
+        || GetRecords<BinaryFunction>(header->functionTableOffset, header->functionCount) == nullptr
+        || GetRecords<char>(header->stringTableOffset, header->stringTableSize) == nullptr) {
+        return Error("tables of binary IR are out of bounds");
+    }
+
+    // Only the tables are touched here, bodies wait for their functions to be requested
+    mFunctions.resize(header->functionCount, nullptr);
+    mMaterialized.resize(header->functionCount, 0);
+    mConstants.resize(header->constantCount, nullptr);
+    return true;
+}
+
+template <typename T>
+const T* BinaryIRModule::GetRecords(uint64_t offset, uint64_t count) const {
+    if (offset > mSize || count > (mSize - offset) / sizeof(T) || offset % alignof(T) != 0) {
+        return nullptr;
+    }
+    return reinterpret_cast<const T*>(mData + offset);
+}
+
+size_t BinaryIRModule::GetFunctionCount() const {
+    return mFunctions.size();
+}
+
+std::string_view BinaryIRModule::GetFunctionName(size_t idx) const {
+    if (idx >= mFunctions.size()) {
+        return {};
+    }
+
+    const BinaryFileHeader* header = reinterpret_cast<const BinaryFileHeader*>(mData);
+    const BinaryFunction& record = GetRecords<BinaryFunction>(header->functionTableOffset, header->functionCount)[idx];
+    if (uint64_t(record.nameOffset) + record.nameLength > header->stringTableSize) {
+        return {};
+    }
+    return std::string_view(mData + header->stringTableOffset + record.nameOffset, record.nameLength);
+}
+
+Function* BinaryIRModule::GetFunction(size_t idx) {
+    if (idx >= mFunctions.size()) {
+        Error("no function with index " + std::to_string(idx));
+        return nullptr;
+    }
+    if (!mMaterialized[idx] && !Materialize(idx)) {
+        return nullptr;
+    }
+    return mFunctions[idx];
+}
+
+Function* BinaryIRModule::GetFunction(std::string_view name) {
+    if (mFunctionsByName.empty()) {
+        for (size_t i = 0; i < mFunctions.size(); ++i) {
+            mFunctionsByName.try_emplace(GetFunctionName(i), i);
+        }
+    }
+
+    auto it = mFunctionsByName.find(name);
+    if (it == mFunctionsByName.end()) {
+        Error("no function #" + std::string(name));
+        return nullptr;
+    }
+    return GetFunction(it->second);
+}
+
+bool BinaryIRModule::MaterializeAll() {
+    for (size_t i = 0; i < mFunctions.size(); ++i) {
+        if (GetFunction(i) == nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+Function* BinaryIRModule::GetOrDeclareFunction(size_t idx) {
+    if (mFunctions[idx] != nullptr) {
+        return mFunctions[idx];
+    }
+
+    const BinaryFileHeader* header = reinterpret_cast<const BinaryFileHeader*>(mData);
+    const BinaryFunction& record = GetRecords<BinaryFunction>(header->functionTableOffset, header->functionCount)[idx];
+    const char* valueTypes = GetRecords<char>(record.bodyOffset, record.valueCount);
+    if (valueTypes == nullptr || record.argCount > record.valueCount || record.returnType >= static_cast<uint8_t>(ValueType::Unknown)) {
+        Error("function record " + std::to_string(idx) + " is corrupted");
+        return nullptr;
+    }
+
+    std::vector<ValueType> argTypes(record.argCount);
+    for (uint32_t i = 0; i < record.argCount; ++i) {
+        argTypes[i] = static_cast<ValueType>(valueTypes[i]);
+    }
+    mFunctions[idx] = mContext->CreateFunction(static_cast<ValueType>(record.returnType), argTypes, std::string(GetFunctionName(idx)));
+    return mFunctions[idx];
+}
+
+Value* BinaryIRModule::GetConstant(uint32_t idx) {
+    if (idx >= mConstants.size()) {
+        return nullptr;
+    }
+    if (mConstants[idx] != nullptr) {
+        return mConstants[idx];
+    }
+
+    const BinaryFileHeader* header = reinterpret_cast<const BinaryFileHeader*>(mData);
+    const BinaryConstant& constant = GetRecords<BinaryConstant>(header->constantPoolOffset, header->constantCount)[idx];
+
+    auto create = [this, &constant]<typename T>(T value) {
+        std::memcpy(&value, &constant.bits, sizeof(T));
+        return mContext->GetOrCreateValueWithData<T>(value);
+    };
+
+    Value* value = nullptr;
+    switch (static_cast<ValueType>(constant.type)) {
+        default:                    break;
+        case ValueType::Int8:       value = create(int8_t{}); break;
+        case ValueType::Int16:      value = create(int16_t{}); break;
+        case ValueType::Int32:      value = create(int32_t{}); break;
+        case ValueType::Int64:      value = create(int64_t{}); break;
+        case ValueType::Uint8:      value = create(uint8_t{}); break;
+        case ValueType::Uint16:     value = create(uint16_t{}); break;
+        case ValueType::Uint32:     value = create(uint32_t{}); break;
+        case ValueType::Uint64:     value = create(uint64_t{}); break;
+        case ValueType::Float32:    value = create(float{}); break;
+        case ValueType::Float64:    value = create(double{}); break;
+    }
+    mConstants[idx] = value;
+    return value;
+}
+
+bool BinaryIRModule::Materialize(size_t idx) {
+    Function* func = GetOrDeclareFunction(idx);
+    if (func == nullptr) {
+        return false;
+    }
+
+    const BinaryFileHeader* header = reinterpret_cast<const BinaryFileHeader*>(mData);
+    const BinaryFunction& record = GetRecords<BinaryFunction>(header->functionTableOffset, header->functionCount)[idx];
+    const BinaryBodyLayout layout = GetBodyLayout(record);
+    const std::string name = func->GetName();
+
+    std::vector<Value*> values(record.valueCount, nullptr);
+    std::vector<BasicBlock*> basicBlocks(record.blockCount, nullptr);
+
+    // Partial body is removed, so the next request starts from the declaration again
+    auto fail = [&](const std::string& message) {
+        for (auto* bb : func->GetBasicBlocks()) {
+            Instruction* inst = bb->Front();
+            while (inst != nullptr) {
+                Instruction* next = inst->GetNext();
+                bb->RemoveInstruction(inst);
+                mContext->RemoveInstruction(inst);
+                inst = next;
+            }
+            mContext->RemoveBasicBlock(bb);
+        }
+        func->ClearBasicBlocks();
+        for (uint32_t i = record.argCount; i < values.size(); ++i) {
+            mContext->RemoveValue(values[i]);
+        }
+        return Error(message);
+    };
+
+    const char* valueTypes = GetRecords<char>(record.bodyOffset + layout.valueTypes, record.valueCount);
+    const BinaryBasicBlock* blocks = GetRecords<BinaryBasicBlock>(record.bodyOffset + layout.blocks, record.blockCount);
+    const BinaryInstruction* instructions = GetRecords<BinaryInstruction>(record.bodyOffset + layout.instructions, record.instructionCount);
+    const uint32_t* operands = GetRecords<uint32_t>(record.bodyOffset + layout.operands, record.operandCount);
+    const uint32_t* predecessors = GetRecords<uint32_t>(record.bodyOffset + layout.predecessors, record.predecessorCount);
+    if (valueTypes == nullptr || blocks == nullptr || instructions == nullptr || operands == nullptr || predecessors == nullptr) {
+        return Error("body of #" + name + " is out of bounds");
+    }
+
+    for (uint32_t i = 0; i < record.valueCount; ++i) {
+        if (static_cast<uint8_t>(valueTypes[i]) >= static_cast<uint8_t>(ValueType::Unknown)) {
+            return fail("value of #" + name + " has unknown type");
+        }
+        values[i] = i < record.argCount ? func->GetArg(i) : mContext->CreateValue(static_cast<ValueType>(valueTypes[i]));
+    }
+
+    for (uint32_t i = 0; i < record.blockCount; ++i) {
+        const BinaryBasicBlock& block = blocks[i];
+        if (uint64_t(block.nameOffset) + block.nameLength > header->stringTableSize) {
+            return fail("name of a basic block of #" + name + " is out of bounds");
+        }
+        basicBlocks[i] = mContext->CreateBasicBlock(func, std::string(mData + header->stringTableOffset + block.nameOffset, block.nameLength));
+    }
+
+    auto getValue = [&](uint32_t ref) -> Value* {
+        if (ref & kConstantOperandBit) {
+            return GetConstant(ref & ~kConstantOperandBit);
+        }
+        return ref < values.size() ? values[ref] : nullptr;
+    };
+    auto getBlock = [&](uint32_t ref) -> BasicBlock* {
+        return ref < basicBlocks.size() ? basicBlocks[ref] : nullptr;
+    };
+
+    std::vector<Value*> instOperands{};
+    std::vector<uint8_t> defined(record.valueCount, 0);
+    for (uint32_t b = 0; b < record.blockCount; ++b) {
+        const BinaryBasicBlock& block = blocks[b];
+        BasicBlock* bb = basicBlocks[b];
+        if (uint64_t(block.firstInstruction) + block.instructionCount > record.instructionCount) {
+            return fail("instructions of " + bb->GetName() + " are out of bounds");
+        }
+
+        for (uint32_t i = block.firstInstruction; i < block.firstInstruction + block.instructionCount; ++i) {
+            const BinaryInstruction& inst = instructions[i];
+            if (uint64_t(inst.firstOperand) + inst.operandCount > record.operandCount) {
+                return fail("operands of an instruction in " + bb->GetName() + " are out of bounds");
+            }
+
+            instOperands.clear();
+            for (uint32_t o = inst.firstOperand; o < inst.firstOperand + inst.operandCount; ++o) {
+                Value* operand = getValue(operands[o]);
+                if (operand == nullptr) {
+                    return fail("invalid operand of an instruction in " + bb->GetName());
+                }
+                instOperands.push_back(operand);
+            }
+
+            const InstructionType type = static_cast<InstructionType>(inst.type);
+            if (type >= InstructionType::Unknown) {
+                return fail("unknown instruction in " + bb->GetName());
+            }
+            const std::string typeStr = InstructionTypeToStr(type);
+            if (!HasValidShape(type, inst.operandCount, inst.output != kNoValue)) {
+                return fail("wrong operands of " + typeStr + " in " + bb->GetName());
+            }
+
+            // Output is a value of the function, which is not an argument and is defined once
+            Value* output = nullptr;
+            if (inst.output != kNoValue) {
+                if (inst.output < record.argCount || inst.output >= record.valueCount || defined[inst.output]) {
+                    return fail("invalid output of " + typeStr + " in " + bb->GetName());
+                }
+                defined[inst.output] = 1;
+                output = values[inst.output];
+            }
+
+            BasicBlock* target0 = nullptr;
+            BasicBlock* target1 = nullptr;
+            if (type >= InstructionType::Jump && type <= InstructionType::Ble) {
+                target0 = getBlock(inst.target0);
+                target1 = type == InstructionType::Jump ? target0 : getBlock(inst.target1);
+                if (target0 == nullptr || target1 == nullptr) {
+                    return fail("invalid target of " + typeStr + " in " + bb->GetName());
+                }
+            }
+            auto operand = [&instOperands](size_t o) { return instOperands[o]; };
+
+            switch (type) {
+                default:    return fail("unknown instruction in " + bb->GetName());
+
+                case InstructionType::Add:      mContext->CreateAdd(bb, operand(0), operand(1), output); break;
+                case InstructionType::Sub:      mContext->CreateSub(bb, operand(0), operand(1), output); break;
+                case InstructionType::Mul:      mContext->CreateMul(bb, operand(0), operand(1), output); break;
+                case InstructionType::Div:      mContext->CreateDiv(bb, operand(0), operand(1), output); break;
+                case InstructionType::Rem:      mContext->CreateRem(bb, operand(0), operand(1), output); break;
+                case InstructionType::And:      mContext->CreateAnd(bb, operand(0), operand(1), output); break;
+                case InstructionType::Or:       mContext->CreateOr(bb, operand(0), operand(1), output); break;
+                case InstructionType::Xor:      mContext->CreateXor(bb, operand(0), operand(1), output); break;
+                case InstructionType::Shl:      mContext->CreateShl(bb, operand(0), operand(1), output); break;
+                case InstructionType::Shr:      mContext->CreateShr(bb, operand(0), operand(1), output); break;
+                case InstructionType::Ashr:     mContext->CreateAshr(bb, operand(0), operand(1), output); break;
+                case InstructionType::Load:     mContext->CreateLoad(bb, operand(0), output); break;
+                case InstructionType::Store:    mContext->CreateStore(bb, operand(0), operand(1)); break;
+                case InstructionType::Jump:     mContext->CreateJump(bb, target0); break;
+                case InstructionType::Beq:      mContext->CreateBeq(bb, operand(0), operand(1), target0, target1); break;
+                case InstructionType::Bne:      mContext->CreateBne(bb, operand(0), operand(1), target0, target1); break;
+                case InstructionType::Bgt:      mContext->CreateBgt(bb, operand(0), operand(1), target0, target1); break;
+                case InstructionType::Blt:      mContext->CreateBlt(bb, operand(0), operand(1), target0, target1); break;
+                case InstructionType::Bge:      mContext->CreateBge(bb, operand(0), operand(1), target0, target1); break;
+                case InstructionType::Ble:      mContext->CreateBle(bb, operand(0), operand(1), target0, target1); break;
+                case InstructionType::Phi:      mContext->CreatePhi(bb, instOperands, output); break;
+                case InstructionType::Mv:       mContext->CreateMv(bb, operand(0), output); break;
+                case InstructionType::NullCheck:    mContext->CreateNullCheck(bb, operand(0)); break;
+                case InstructionType::BoundsCheck:  mContext->CreateBoundsCheck(bb, operand(0), operand(1)); break;
+
+                case InstructionType::Alloc: {
+                    if (inst.valueType == static_cast<uint8_t>(ValueType::Void) || inst.valueType >= static_cast<uint8_t>(ValueType::Unknown)) {
+                        return fail("invalid type of Alloc in " + bb->GetName());
+                    }
+                    mContext->CreateAlloc(bb, output, static_cast<ValueType>(inst.valueType), inst.target0);
+                    break;
+                }
+                case InstructionType::Ret: {
+                    instOperands.empty() ? mContext->CreateRet(bb) : mContext->CreateRet(bb, operand(0));
+                    break;
+                }
+                case InstructionType::Call: {
+                    // Callee is only declared, its body is materialized when it is requested itself
+                    if (inst.target0 >= mFunctions.size()) {
+                        return fail("callee of a call in " + bb->GetName() + " is out of bounds");
+                    }
+                    Function* callee = GetOrDeclareFunction(inst.target0);
+                    if (callee == nullptr) {
+                        return fail(mError);
+                    }
+                    if (callee->GetArgs().size() != instOperands.size() || (output != nullptr && callee->GetReturnType() == ValueType::Void)) {
+                        return fail("call in " + bb->GetName() + " does not match the signature of #" + callee->GetName());
+                    }
+                    mContext->CreateCall(bb, callee, output, instOperands);
+                    break;
+                }
+            }
+        }
+
+        if (uint64_t(block.firstPredecessor) + block.predecessorCount > record.predecessorCount) {
+            return fail("predecessors of " + bb->GetName() + " are out of bounds");
+        }
+    }
+
+    // Builder adds predecessors in order of the branches, but phi inputs follow the stored order
+    for (uint32_t b = 0; b < record.blockCount; ++b) {
+        const BinaryBasicBlock& block = blocks[b];
+        std::vector<BasicBlock*> preds{};
+        for (uint32_t p = block.firstPredecessor; p < block.firstPredecessor + block.predecessorCount; ++p) {
+            BasicBlock* pred = getBlock(predecessors[p]);
+            if (pred == nullptr) {
+                return fail("invalid predecessor of " + basicBlocks[b]->GetName());
+            }
+            preds.push_back(pred);
+        }
+        basicBlocks[b]->SetPredecessors(preds);
+
+        for (auto* inst = basicBlocks[b]->Front(); inst != nullptr && inst->IsPhi(); inst = inst->GetNext()) {
+            InstructionPhi* phi = static_cast<InstructionPhi*>(inst);
+            for (size_t i = 0; i < phi->NumOperands(); ++i) {
+                phi->SetIncomingBlock(i, i < preds.size() ? preds[i] : nullptr);
+            }
+        }
+    }
+
+    if (getBlock(record.entryBlock) == nullptr) {
+        return fail("entry block of #" + name + " is out of bounds");
+    }
+    func->SetEntryBasicBlock(getBlock(record.entryBlock));
+
+    mMaterialized[idx] = 1;
+    ++mMaterializedCount;
+    return true;
+}
+
+}   // namespace VMIR
@@ -1,6 +1,7 @@
 #include <CheckEliminationPass.h>
 #include <ControlFlowGraph.h>
 #include <IRBuilder.h>
+#include <Trace.h>
 
 #include <unordered_set>
 
@@ -10,17 +11,30 @@ static const char CHECK_ELIMINATION_PASS_NAME[] = "Check Elimination Pass";
 
 CheckEliminationPass::CheckEliminationPass() : Pass(CHECK_ELIMINATION_PASS_NAME) {}
 
+PreservedAnalyses CheckEliminationPass::GetPreservedAnalyses() const {
+    // Only checks are removed, control flow stays the same
+    return PreservedAnalyses{}.Preserve(AnalysisKind::ControlFlowGraph).Preserve(AnalysisKind::DominatorTree).Preserve(AnalysisKind::LoopTree);
+}
+
+void CheckEliminationPass::ReportStatistics(TraceScope& scope) const {
+    scope.AddArg("null checks removed", static_cast<int64_t>(mRemovedNullChecks));
+    scope.AddArg("bounds checks removed", static_cast<int64_t>(mRemovedBoundsChecks));
+}
+
 void CheckEliminationPass::Run(Function* func) {
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
+    IRContext* IrContext = func->GetContext();
+    mRemovedNullChecks = 0;
+    mRemovedBoundsChecks = 0;
 
-    ControlFlowGraph* cfg = IrBuilder->GetOrCreateControlFlowGraph(func);
-    cfg->BuildDominatorTree();
+    ControlFlowGraph* cfg = IrContext->GetOrCreateControlFlowGraph(func);
+    if (!cfg->IsDominatorTreeBuilt()) {
+        cfg->BuildDominatorTree();
+    }
 
     size_t bbCount = cfg->GetBasicBlocks().size();
 
     RPO rpo{};
     rpo.Run(cfg->GetEntryBasicBlock(), &bbCount);
-    rpo.UnmarkAll();
 
     auto& rpoBasicBlocks = rpo.GetBasicBlocks();
 
@@ -47,9 +61,9 @@ void CheckEliminationPass::Run(Function* func) {
                 for (auto* dominatedNullCheck : dominatedNullChecks) {
                     auto* checkBB = dominatedNullCheck->GetParentBasicBlock();
 
-                    input->RemoveUser(dominatedNullCheck);
                     checkBB->RemoveInstruction(dominatedNullCheck);
-                    IrBuilder->RemoveInstruction(dominatedNullCheck);
+                    IrContext->RemoveInstruction(dominatedNullCheck);
+                    ++mRemovedNullChecks;
                 }
             }
             else if (inst->GetType() == InstructionType::BoundsCheck) {
@@ -75,13 +89,16 @@ void CheckEliminationPass::Run(Function* func) {
                     }
                 }
 
+                // Check of the array start is listed twice since it uses inputArray as both inputs
+                std::sort(dominatedBoundsChecks.begin(), dominatedBoundsChecks.end());
+                dominatedBoundsChecks.erase(std::unique(dominatedBoundsChecks.begin(), dominatedBoundsChecks.end()), dominatedBoundsChecks.end());
+
                 for (auto* dominatedBoundsCheck : dominatedBoundsChecks) {
                     auto* checkBB = dominatedBoundsCheck->GetParentBasicBlock();
 
-                    inputPtr->RemoveUser(dominatedBoundsCheck);
-                    inputArray->RemoveUser(dominatedBoundsCheck);
                     checkBB->RemoveInstruction(dominatedBoundsCheck);
-                    IrBuilder->RemoveInstruction(dominatedBoundsCheck);
+                    IrContext->RemoveInstruction(dominatedBoundsCheck);
+                    ++mRemovedBoundsChecks;
                 }
             }
             inst = inst->GetNext();
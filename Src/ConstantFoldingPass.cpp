@@ -1,5 +1,6 @@
 #include <ConstantFoldingPass.h>
 #include <IRBuilder.h>
+#include <Trace.h>
 
 namespace VMIR {
 
@@ -8,6 +9,7 @@ static const char CONSTANT_FOLDING_PASS_NAME[] = "Constant Folding Pass";
 ConstantFoldingPass::ConstantFoldingPass() : Pass(CONSTANT_FOLDING_PASS_NAME) {}
 
 void ConstantFoldingPass::Run(Function* func) {
+    mFoldedInstructions = 0;
     for (auto* bb : func->GetBasicBlocks()) {
         Instruction* inst = bb->Front();
         while (inst) {
@@ -17,6 +19,16 @@ void ConstantFoldingPass::Run(Function* func) {
 }
 
 
+PreservedAnalyses ConstantFoldingPass::GetPreservedAnalyses() const {
+    // Instructions are replaced inside their blocks, control flow stays the same
+    return PreservedAnalyses{}.Preserve(AnalysisKind::ControlFlowGraph).Preserve(AnalysisKind::DominatorTree).Preserve(AnalysisKind::LoopTree);
+}
+
+void ConstantFoldingPass::ReportStatistics(TraceScope& scope) const {
+    scope.AddArg("instructions folded", static_cast<int64_t>(mFoldedInstructions));
+}
+
+
 /*
     Optimize in a tree like structure:
     - If instruction is arithmetic with both inputs appeared to be constant, replace it with move with resulting constant
@@ -28,8 +40,8 @@ void ConstantFoldingPass::Run(Function* func) {
                 - ...
                 - ...
 */
-Instruction* ConstantFoldingPass::OptimizeInstructionAndGetNext(Instruction* inst) const {
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
+Instruction* ConstantFoldingPass::OptimizeInstructionAndGetNext(Instruction* inst) {
+    IRContext* IrContext = inst->GetParentBasicBlock()->GetParentFunction()->GetContext();
 
     Instruction* currInst = inst;
     if (currInst->IsArithmetic()) {
@@ -46,11 +58,14 @@ Instruction* ConstantFoldingPass::OptimizeInstructionAndGetNext(Instruction* ins
         Value* outputMv = instMv->GetOutput();
         if (inputMv->HasValue()) {
             BasicBlock* bb = currInst->GetParentBasicBlock();
-            auto users = outputMv->GetUsers();
+            // Instruction is listed once per input, but it must be visited only once
+            std::vector<Instruction*> users(outputMv->GetUsers().begin(), outputMv->GetUsers().end());
+            std::sort(users.begin(), users.end());
+            users.erase(std::unique(users.begin(), users.end()), users.end());
             for (Instruction* user : users) {
                 // Do not touch phi at all
                 if (user->GetType() != InstructionType::Phi) {
-                    ReplaceMoveUserInputWithConstant(user, instMv);
+                    user->ReplaceInput(outputMv, inputMv);
                 }
 
                 // If user is arithmetic or move, then optimize it recursively
@@ -61,10 +76,9 @@ Instruction* ConstantFoldingPass::OptimizeInstructionAndGetNext(Instruction* ins
 
             next = instMv->GetNext();
             if (outputMv->GetUsers().empty()) {
-                inputMv->RemoveUser(instMv);
                 outputMv->SetProducer(nullptr);
                 bb->RemoveInstruction(instMv);
-                IrBuilder->RemoveInstruction(instMv);
+                IrContext->RemoveInstruction(instMv);
             }
         }
     }
@@ -73,9 +87,7 @@ Instruction* ConstantFoldingPass::OptimizeInstructionAndGetNext(Instruction* ins
 }
 
 
-Instruction* ConstantFoldingPass::OptimizeInstructionArithmetic(InstructionArithmetic* inst) const {
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
-
+Instruction* ConstantFoldingPass::OptimizeInstructionArithmetic(InstructionArithmetic* inst) {
     Value* input1 = inst->GetInput1();
     Value* input2 = inst->GetInput2();
     Value* output = inst->GetOutput();
@@ -84,30 +96,26 @@ Instruction* ConstantFoldingPass::OptimizeInstructionArithmetic(InstructionArith
     }
 
     BasicBlock* bb = inst->GetParentBasicBlock();
-    Value* inputMv = GetOrCreateConstantForMove(input1, input2, inst->GetType());
+    IRContext* IrContext = bb->GetParentFunction()->GetContext();
+    Value* inputMv = GetOrCreateConstantForMove(IrContext, input1, input2, inst->GetType());
 
-    InstructionMv* instMv = IrBuilder->CreateMv();
+    InstructionMv* instMv = IrContext->CreateMv();
     instMv->SetInput(inputMv);
     instMv->SetOutput(output);
 
-    input1->RemoveUser(inst);
-    input2->RemoveUser(inst);
-
-    inputMv->AddUser(instMv);
     output->SetProducer(instMv);
 
     bb->InsertInstructionBefore(instMv, inst);
     bb->RemoveInstruction(inst);
 
-    IrBuilder->RemoveInstruction(inst);
+    IrContext->RemoveInstruction(inst);
+    ++mFoldedInstructions;
 
     return instMv;
 }
 
 
-Value* ConstantFoldingPass::GetOrCreateConstantForMove(Value* input1, Value* input2, InstructionType op) const {
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
-
+Value* ConstantFoldingPass::GetOrCreateConstantForMove(IRContext* IrContext, Value* input1, Value* input2, InstructionType op) const {
     switch (input1->GetValueType()) {
         default: {
             return nullptr;
@@ -116,164 +124,61 @@ Value* ConstantFoldingPass::GetOrCreateConstantForMove(Value* input1, Value* inp
             int8_t a = input1->GetValue<int8_t>().value();
             int8_t b = input2->GetValue<int8_t>().value();
             int8_t res = PerformValueOperation(a, b, op);
-            return IrBuilder->GetOrCreateValueWithData<int8_t>(res);
+            return IrContext->GetOrCreateValueWithData<int8_t>(res);
         }
         case ValueType::Int16: {
             int16_t a = input1->GetValue<int16_t>().value();
             int16_t b = input2->GetValue<int16_t>().value();
             int16_t res = PerformValueOperation(a, b, op);
-            return IrBuilder->GetOrCreateValueWithData<int16_t>(res);
+            return IrContext->GetOrCreateValueWithData<int16_t>(res);
         }
         case ValueType::Int32: {
             int32_t a = input1->GetValue<int32_t>().value();
             int32_t b = input2->GetValue<int32_t>().value();
             int32_t res = PerformValueOperation(a, b, op);
-            return IrBuilder->GetOrCreateValueWithData<int32_t>(res);
+            return IrContext->GetOrCreateValueWithData<int32_t>(res);
         }
         case ValueType::Int64: {
             int64_t a = input1->GetValue<int64_t>().value();
             int64_t b = input2->GetValue<int64_t>().value();
             int64_t res = PerformValueOperation(a, b, op);
-            return IrBuilder->GetOrCreateValueWithData<int64_t>(res);
+            return IrContext->GetOrCreateValueWithData<int64_t>(res);
         }
         case ValueType::Uint8: {
             uint8_t a = input1->GetValue<uint8_t>().value();
             uint8_t b = input2->GetValue<uint8_t>().value();
             uint8_t res = PerformValueOperation(a, b, op);
-            return IrBuilder->GetOrCreateValueWithData<uint8_t>(res);
+            return IrContext->GetOrCreateValueWithData<uint8_t>(res);
         }
         case ValueType::Uint16: {
             uint16_t a = input1->GetValue<uint16_t>().value();
             uint16_t b = input2->GetValue<uint16_t>().value();
             uint16_t res = PerformValueOperation(a, b, op);
-            return IrBuilder->GetOrCreateValueWithData<uint16_t>(res);
+            return IrContext->GetOrCreateValueWithData<uint16_t>(res);
         }
         case ValueType::Uint32: {
             uint32_t a = input1->GetValue<uint32_t>().value();
             uint32_t b = input2->GetValue<uint32_t>().value();
             uint32_t res = PerformValueOperation(a, b, op);
-            return IrBuilder->GetOrCreateValueWithData<uint32_t>(res);
+            return IrContext->GetOrCreateValueWithData<uint32_t>(res);
         }
         case ValueType::Uint64: {
             uint64_t a = input1->GetValue<uint64_t>().value();
             uint64_t b = input2->GetValue<uint64_t>().value();
             uint64_t res = PerformValueOperation(a, b, op);
-            return IrBuilder->GetOrCreateValueWithData<uint64_t>(res);
+            return IrContext->GetOrCreateValueWithData<uint64_t>(res);
         }
         case ValueType::Float32: {
             float a = input1->GetValue<float>().value();
             float b = input2->GetValue<float>().value();
             float res = PerformValueOperation(a, b, op);
-            return IrBuilder->GetOrCreateValueWithData<float>(res);
+            return IrContext->GetOrCreateValueWithData<float>(res);
         }
         case ValueType::Float64: {
             double a = input1->GetValue<double>().value();
             double b = input2->GetValue<double>().value();
             double res = PerformValueOperation(a, b, op);
-            return IrBuilder->GetOrCreateValueWithData<double>(res);
-        }
-    }
-}
-
-
-void ConstantFoldingPass::ReplaceMoveUserInputWithConstant(Instruction* user, InstructionMv* instMv) const {
-    Value* inputMv = instMv->GetInput();
-    Value* outputMv = instMv->GetOutput();
-
-    if (user->IsArithmetic()) {
-        InstructionArithmetic* instArith = static_cast<InstructionArithmetic*>(user);
-        Value* userInput1 = instArith->GetInput1();
-        Value* userInput2 = instArith->GetInput2();
-
-        outputMv->RemoveUser(instArith);
-        inputMv->AddUser(instArith);
-        if (userInput1 == outputMv) {
-            instArith->SetInput1(inputMv);
-        }
-        if (userInput2 == outputMv) {
-            instArith->SetInput2(inputMv);
-        }
-    }
-    else if (user->GetType() == InstructionType::Load) {
-        InstructionLoad* instLoad = static_cast<InstructionLoad*>(user);
-
-        outputMv->RemoveUser(instLoad);
-        inputMv->AddUser(instLoad);
-        instLoad->SetLoadPtr(inputMv);
-    }
-    else if (user->GetType() == InstructionType::Store) {
-        InstructionStore* instStore = static_cast<InstructionStore*>(user);
-        Value* userInput1 = instStore->GetStorePtr();
-        Value* userInput2 = instStore->GetInput();
-
-        outputMv->RemoveUser(instStore);
-        inputMv->AddUser(instStore);
-        if (userInput1 == outputMv) {
-            instStore->SetStorePtr(inputMv);
-        }
-        if (userInput2 == outputMv) {
-            instStore->SetInput(inputMv);
-        }
-    }
-    else if (user->IsBranch()) {
-        InstructionBranch* instBranch = static_cast<InstructionBranch*>(user);
-        Value* userInput1 = instBranch->GetInput1();
-        Value* userInput2 = instBranch->GetInput2();
-
-        outputMv->RemoveUser(instBranch);
-        inputMv->AddUser(instBranch);
-        if (userInput1 == outputMv) {
-            instBranch->SetInput1(inputMv);
-        }
-        if (userInput2 == outputMv) {
-            instBranch->SetInput2(inputMv);
-        }
-    }
-    else if (user->GetType() == InstructionType::Call) {
-        InstructionCall* instCall = static_cast<InstructionCall*>(user);
-        auto args = instCall->GetArguments();
-
-        outputMv->RemoveUser(instCall);
-        inputMv->AddUser(instCall);
-        for (size_t i = 0; i < args.size(); ++i) {
-            if (args[i] == outputMv) {
-                instCall->SetArgument(i, inputMv);
-            }
-        }
-    }
-    else if (user->GetType() == InstructionType::Ret) {
-        InstructionRet* instRet = static_cast<InstructionRet*>(user);
-
-        outputMv->RemoveUser(instRet);
-        inputMv->AddUser(instRet);
-        instRet->SetReturnValue(inputMv);
-    }
-    else if (user->GetType() == InstructionType::Mv) {
-        InstructionMv* instMv = static_cast<InstructionMv*>(user);
-
-        outputMv->RemoveUser(instMv);
-        inputMv->AddUser(instMv);
-        instMv->SetInput(inputMv);
-    }
-    else if (user->GetType() == InstructionType::NullCheck) {
-        InstructionNullCheck* instNullCheck = static_cast<InstructionNullCheck*>(user);
-
-        outputMv->RemoveUser(instMv);
-        inputMv->AddUser(instNullCheck);
-        instNullCheck->SetInput(inputMv);
-    }
-    else if (user->GetType() == InstructionType::BoundsCheck) {
-        InstructionBoundsCheck* instBoundsCheck = static_cast<InstructionBoundsCheck*>(user);
-        Value* userInputPtr = instBoundsCheck->GetInputPtr();
-        Value* userInputArray = instBoundsCheck->GetInputArray();
-
-        outputMv->RemoveUser(instBoundsCheck);
-        inputMv->AddUser(instBoundsCheck);
-        if (userInputPtr == outputMv) {
-            instBoundsCheck->SetInputPtr(inputMv);
-        }
-        if (userInputArray == outputMv) {
-            instBoundsCheck->SetInputArray(inputMv);
+            return IrContext->GetOrCreateValueWithData<double>(res);
         }
     }
 }
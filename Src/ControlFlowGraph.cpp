@@ -3,39 +3,40 @@
 #include <algorithm>
 
 #include <ControlFlowGraph.h>
+#include <IRBuilder.h>
 
 namespace VMIR {
 
 void DFS::Run(BasicBlock* entryBB, BasicBlock* ignoredBB) {
-    DFSInternal(entryBB, ignoredBB);
-}
-
-void DFS::UnmarkAll() {
-    for (auto* bb : mDFSVector) {
-        bb->SetUnmarked(mMarker);
-    }
-}
-
-void DFS::DFSInternal(BasicBlock* block, BasicBlock* ignoredBB) {
-    if (block == ignoredBB) {
+    if (entryBB == ignoredBB) {
         return;
     }
 
-    block->SetMarked(mMarker);
-    mDFSVector.push_back(block);
-
-    if (mReverse) {
-        for (auto* pred : block->GetPredecessors()) {
-            if (!pred->IsMarked(mMarker)) {
-                DFSInternal(pred, ignoredBB);
-            }
+    // Pre-order, edges are taken in the same order as recursive walk would take them
+    auto GetEdges = [this](const BasicBlock* block) -> std::span<BasicBlock* const> {
+        if (mReverse) {
+            const auto& preds = block->GetPredecessors();
+            return {preds.data(), preds.size()};
         }
-    }
-    else {
-        for (auto* succ : block->GetSuccessors()) {
-            if (!succ->IsMarked(mMarker)) {
-                DFSInternal(succ, ignoredBB);
-            }
+        return block->GetSuccessors();
+    };
+
+    mVisited.NextEpoch();
+    mVisited.Visit(entryBB);
+    mDFSVector.push_back(entryBB);
+    mStack.push_back({entryBB, 0});
+    while (!mStack.empty()) {
+        Frame& frame = mStack.back();
+        const auto edges = GetEdges(frame.block);
+        if (frame.nextEdge == edges.size()) {
+            mStack.pop_back();
+            continue;
+        }
+
+        BasicBlock* next = edges[frame.nextEdge++];
+        if (next != ignoredBB && mVisited.Visit(next)) {
+            mDFSVector.push_back(next);
+            mStack.push_back({next, 0});
         }
     }
 }
@@ -43,29 +44,28 @@ void DFS::DFSInternal(BasicBlock* block, BasicBlock* ignoredBB) {
 
 void RPO::Run(BasicBlock* entryBB, size_t* pCount, BasicBlock* ignoredBB) {
     mRPOVector.resize(*pCount);
-    RPOInternal(entryBB, pCount, ignoredBB);
-}
-
-void RPO::UnmarkAll() {
-    for (auto* bb : mRPOVector) {
-        bb->SetUnmarked(mMarker);
-    }
-}
-
-void RPO::RPOInternal(BasicBlock* block, size_t* pCount, BasicBlock* ignoredBB) {
-    if (block == ignoredBB) {
+    if (entryBB == ignoredBB) {
         return;
     }
 
-    block->SetMarked(mMarker);
+    // Blocks are written from the back in post-order
+    mVisited.NextEpoch();
+    mVisited.Visit(entryBB);
+    mStack.push_back({entryBB, 0});
+    while (!mStack.empty()) {
+        Frame& frame = mStack.back();
+        const auto succs = frame.block->GetSuccessors();
+        if (frame.nextSucc == succs.size()) {
+            mRPOVector[--(*pCount)] = frame.block;
+            mStack.pop_back();
+            continue;
+        }
 
-    for (auto* succ : block->GetSuccessors()) {
-        if (!succ->IsMarked(mMarker)) {
-            RPOInternal(succ, pCount, ignoredBB);
+        BasicBlock* succ = succs[frame.nextSucc++];
+        if (succ != ignoredBB && mVisited.Visit(succ)) {
+            mStack.push_back({succ, 0});
         }
     }
-
-    mRPOVector[--(*pCount)] = block;
 }
 
 
@@ -74,9 +74,8 @@ ControlFlowGraph::ControlFlowGraph(const Function* function) {
         return;
     }
 
-    // Copy
-    mGraph = function->GetBasicBlocks();
-    mEntry = function->GetEntryBasicBlock();
+    mFunction = function;
+    Refresh();
 }
 
 ControlFlowGraph::ControlFlowGraph(const std::vector<BasicBlock*> basicBlocks) {
@@ -87,6 +86,15 @@ ControlFlowGraph::ControlFlowGraph(const std::vector<BasicBlock*> basicBlocks) {
     }
 }
 
+void ControlFlowGraph::Refresh() {
+    if (mFunction != nullptr) {
+        // Copy
+        mGraph = mFunction->GetBasicBlocks();
+        mEntry = mFunction->GetEntryBasicBlock();
+    }
+    mDomTreeBuilt = false;
+}
+
 bool ControlFlowGraph::GenerateDotFileCFG(const std::string& filename) {
     std::ofstream out(filename + ".dot", std::ofstream::out);
     if (!out.is_open()) {
@@ -135,67 +143,127 @@ bool ControlFlowGraph::GenerateDotFileDomTree(const std::string& filename) {
     return true;
 }
 
+TraceRecorder* ControlFlowGraph::GetTraceRecorder() const {
+    if (mFunction == nullptr || mFunction->GetContext() == nullptr) {
+        return nullptr;
+    }
+    return mFunction->GetContext()->GetTraceRecorder();
+}
+
 void ControlFlowGraph::BuildDominatorTree() {
-    // Run DFS to check all reachable blocks from entry basic block
-    DFS dfs{};
-    dfs.Run(mEntry);
-    dfs.UnmarkAll();
-    auto& allReachableBlocks = mEntry->GetDominatedBasicBlocks();
-    auto& dfsVec = dfs.GetBasicBlocks();
-
-    allReachableBlocks = std::move(std::set<BasicBlock*>(dfsVec.begin(), dfsVec.end()));
-    dfsVec.clear();
-
-    // Now, for every vertex != entry:
-    // - Remove this vertex from the graph (dfs.Run(mEntry, bb) means do DFS but ignore bb)
-    // - Obtain all reachable vertices from entry vertex without removed vertex
-    // - The difference between all reachable vertices and reachable vertices without removed one
-    // is a set of vertices dominated by removed vertex
+    TraceScope scope{GetTraceRecorder(), "BuildDominatorTree", "analysis", mFunction};
+    scope.AddArg("blocks", static_cast<int64_t>(mGraph.size()));
+
+    // Cooper, Harvey, Kennedy. "A Simple, Fast Dominance Algorithm"
     for (auto* bb : mGraph) {
-        if (bb == mEntry) {
-            continue;
-        }
-        dfs.Run(mEntry, bb);
-        dfs.UnmarkAll();
+        bb->SetImmediateDominator(nullptr);
+        bb->ClearDominatorTreeChildren();
+        bb->SetDominatorTreeInterval(0, 0);
+    }
 
-        auto& allDominated = bb->GetDominatedBasicBlocks();
+    if (mEntry == nullptr) {
+        return;
+    }
 
-        std::set<BasicBlock*> reachable(dfsVec.begin(), dfsVec.end());
-        std::set_difference(allReachableBlocks.begin(),
-                            allReachableBlocks.end(),
-                            reachable.begin(),
-                            reachable.end(),
-                            std::inserter(allDominated, allDominated.end()));
-        dfsVec.clear();
+    // Number reachable blocks in reverse post-order, so entry gets 0 and every
+    // dominator has smaller number than blocks it dominates
+    size_t unreachableCount = mGraph.size();
+    RPO rpo{};
+    rpo.Run(mEntry, &unreachableCount);
+    auto& rpoVec = rpo.GetBasicBlocks();
+    rpoVec.erase(rpoVec.begin(), rpoVec.begin() + static_cast<std::ptrdiff_t>(unreachableCount));
+
+    const uint32_t count = static_cast<uint32_t>(rpoVec.size());
+    std::unordered_map<const BasicBlock*, uint32_t> rpoNumbers{};
+    rpoNumbers.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        rpoNumbers.emplace(rpoVec[i], i);
     }
 
-    // By this moment we have a set of dominated vertices for every vertex in the graph
-    // But we need immediately dominated vertices to build a dominator tree
-    // So, remove dominated vertices which are dominated by another dominated vertex
-    for (auto* bb : mGraph) {
-        const auto& allDominated = bb->GetDominatedBasicBlocks();
-        std::set<BasicBlock*> immDominated = allDominated;
-        immDominated.erase(bb);
-        for (auto* dominatedBB : allDominated) {
-            if (dominatedBB == bb) {
-                continue;
+    // Predecessors by their numbers, packed in one array. Unreachable ones are dropped
+    std::vector<uint32_t> predOffsets(count + 1, 0);
+    std::vector<uint32_t> preds{};
+    for (uint32_t i = 0; i < count; ++i) {
+        for (auto* pred : rpoVec[i]->GetPredecessors()) {
+            auto it = rpoNumbers.find(pred);
+            if (it != rpoNumbers.end()) {
+                preds.push_back(it->second);
             }
+        }
+        predOffsets[i + 1] = static_cast<uint32_t>(preds.size());
+    }
+
+    constexpr uint32_t Undefined = UINT32_MAX;
+    std::vector<uint32_t> idoms(count, Undefined);
+    idoms[0] = 0;
 
-            const auto& dominatedBBAllDominated = dominatedBB->GetDominatedBasicBlocks();
-            for (auto* dominatedBBDominatedBB : dominatedBBAllDominated) {
-                if (dominatedBBDominatedBB == dominatedBB) {
+    auto Intersect = [&idoms](uint32_t finger1, uint32_t finger2) {
+        while (finger1 != finger2) {
+            while (finger1 > finger2) {
+                finger1 = idoms[finger1];
+            }
+            while (finger2 > finger1) {
+                finger2 = idoms[finger2];
+            }
+        }
+        return finger1;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = 1; i < count; ++i) {
+            uint32_t newIdom = Undefined;
+            for (uint32_t p = predOffsets[i]; p < predOffsets[i + 1]; ++p) {
+                const uint32_t pred = preds[p];
+                if (idoms[pred] == Undefined) {
                     continue;
                 }
-                immDominated.erase(dominatedBBDominatedBB);
+                newIdom = newIdom == Undefined ? pred : Intersect(pred, newIdom);
             }
-        }
 
-        for (auto* dominatedBB : immDominated) {
-            dominatedBB->SetImmediateDominator(bb);
+            if (idoms[i] != newIdom) {
+                idoms[i] = newIdom;
+                changed = true;
+            }
         }
     }
 
+    // Children are listed in reverse post-order
+    for (uint32_t i = 1; i < count; ++i) {
+        BasicBlock* idom = rpoVec[idoms[i]];
+        rpoVec[i]->SetImmediateDominator(idom);
+        idom->AddDominatorTreeChild(rpoVec[i]);
+    }
+
+    NumberDominatorTree();
     mDomTreeBuilt = true;
 }
 
+void ControlFlowGraph::NumberDominatorTree() {
+    // Enter and exit times of DFS over dominator tree, starting from 1.
+    // Block is dominated by another one iff its interval is nested into the other's interval
+    struct Frame {
+        BasicBlock* block;
+        uint32_t enter;
+        uint32_t nextChild;
+    };
+
+    uint32_t time = 0;
+    std::vector<Frame> stack{};
+    stack.push_back({mEntry, ++time, 0});
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        const auto& children = frame.block->GetDominatorTreeChildren();
+        if (frame.nextChild < children.size()) {
+            BasicBlock* child = children[frame.nextChild++];
+            stack.push_back({child, ++time, 0});
+            continue;
+        }
+
+        frame.block->SetDominatorTreeInterval(frame.enter, ++time);
+        stack.pop_back();
+    }
+}
+
 }   // namespace VMIR
@@ -3,17 +3,13 @@
 
 namespace VMIR {
 
-Function::Function(const std::vector<ValueType>& argsTypes, const std::string& name) : mName{name}, mRetType{ValueType::Void} {
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
-    for (size_t i = 0; i < argsTypes.size(); ++i) {
-        mArgs.push_back(IrBuilder->CreateValue(argsTypes[i]));
-    }
-};
+Function::Function(IRContext* context, const std::vector<ValueType>& argsTypes, const std::string& name)
+: Function(context, ValueType::Void, argsTypes, name) {}
 
-Function::Function(const ValueType retType, const std::vector<ValueType>& argsTypes, const std::string& name) : mName{name}, mRetType{retType} {
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
+Function::Function(IRContext* context, const ValueType retType, const std::vector<ValueType>& argsTypes, const std::string& name)
+: mContext{context}, mName{name}, mRetType{retType} {
     for (size_t i = 0; i < argsTypes.size(); ++i) {
-        mArgs.push_back(IrBuilder->CreateValue(argsTypes[i]));
+        mArgs.push_back(mContext->CreateValue(argsTypes[i]));
     }
 };
 
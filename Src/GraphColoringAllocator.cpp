@@ -0,0 +1,660 @@
+#include <limits>
+
+#include <GraphColoringAllocator.h>
+#include <RegisterAllocator.h>
+#include <LivenessAnalyzer.h>
+
+
+namespace VMIR {
+
+void GraphColoringAllocator::PerformRegisterAllocation(uint32_t firstStackLocation) {
+    mNextStackLocation = firstStackLocation;
+    mStackLocationCount = 0;
+    mCoalescedMoveCount = 0;
+    mInterferenceCount = 0;
+    mSplitCount = 0;
+    mInstructionMoves.clear();
+
+    AllocateClass(true);
+    AllocateClass(false);
+}
+
+
+void GraphColoringAllocator::AllocateClass(bool isGP) {
+    mRegisterCount = isGP ? mGPRegisterCount : mFPRegisterCount;
+    mRewritten.Resize(mLivenessAnalyzer->GetValueCount());
+
+    // Every round colors the code rewritten around the values spilled by the previous ones
+    for (uint32_t round = 1; ; ++round) {
+        CreateNodes(isGP);
+        if (mNodes.empty()) {
+            break;
+        }
+
+        Build();
+        MakeWorklists();
+
+        while (true) {
+            if (HasNode(mSimplifyWorklist, NodeState::Simplify)) {
+                Simplify();
+            }
+            else if (HasMove()) {
+                Coalesce();
+            }
+            else if (HasNode(mFreezeWorklist, NodeState::Freeze)) {
+                Freeze();
+            }
+            else if (HasNode(mSpillWorklist, NodeState::Spill)) {
+                SelectSpill();
+            }
+            else {
+                break;
+            }
+        }
+
+        AssignColors();
+        if (round == kMaxRewriteRounds || !RewriteSpilled()) {
+            break;
+        }
+    }
+
+    AssignLocations(isGP);
+}
+
+
+// Outputs of unreachable code have no live ranges and get no location. Rewritten values have no nodes of their own,
+// only their temporaries do. Value read only by the next instruction frees no register when spilled
+void GraphColoringAllocator::CreateNodes(bool isGP) {
+    mNodes.clear();
+    mMoves.clear();
+    mTemporaries.clear();
+    mSimplifyWorklist.clear();
+    mFreezeWorklist.clear();
+    mSpillWorklist.clear();
+    mMoveWorklist.clear();
+    mSelectStack.clear();
+
+    mNodeByValueIndex.assign(mLivenessAnalyzer->GetValueCount(), kNoNode);
+    for (auto* bb : mLivenessAnalyzer->GetBasicBlocksLinearOrder()) {
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            Value* output = inst->GetOutput();
+            if (output != nullptr && !output->GetLiveRanges().IsEmpty() && output->IsIntegralValueType() == isGP) {
+                if (const size_t idx = mLivenessAnalyzer->GetValueIndex(output); !mRewritten.Test(idx)) {
+                    mNodeByValueIndex[idx] = mNodes.size();
+                    mNodes.push_back(Node{output});
+                    if (IsUsedByNextOnly(output)) {
+                        mNodes.back().cost = std::numeric_limits<double>::infinity();
+                    }
+                }
+            }
+        }
+        CreateTemporaries(bb);
+    }
+    mAdjacency.Resize(mNodes.size() * mNodes.size());
+}
+
+
+// Temporary pays off when it replaces at least two stack accesses: the store and one use of the definition, or the
+// load and two uses. Single use is read from the stack slot directly. Temporaries are never chosen for spilling
+void GraphColoringAllocator::CreateTemporaries(const BasicBlock* bb) {
+    if (mRewritten.None()) {
+        return;
+    }
+
+    struct Uses {
+        Value* value{nullptr};
+        const Instruction* definition{nullptr};
+        const Instruction* first{nullptr};
+        const Instruction* last{nullptr};
+        uint32_t count{0};
+        bool isEdgeUse{false};
+    };
+    std::map<size_t, Uses> uses{};
+
+    for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+        if (Value* output = inst->GetOutput(); output != nullptr) {
+            if (const size_t idx = mLivenessAnalyzer->GetValueIndex(output); idx != LivenessAnalyzer::kNoValueIndex && mRewritten.Test(idx)) {
+                uses[idx].value = output;
+                uses[idx].definition = inst;
+            }
+        }
+        if (inst->IsPhi()) {
+            continue;
+        }
+        for (Value* input : inst->operands()) {
+            if (const size_t idx = mLivenessAnalyzer->GetValueIndex(input); idx != LivenessAnalyzer::kNoValueIndex && mRewritten.Test(idx)) {
+                Uses& valueUses = uses[idx];
+                if (valueUses.last != inst) {
+                    valueUses.value = input;
+                    valueUses.first = valueUses.first != nullptr ? valueUses.first : inst;
+                    valueUses.last = inst;
+                    ++valueUses.count;
+                }
+            }
+        }
+    }
+
+    // Phis of the successors read their inputs at the end of the block
+    for (auto* succ : bb->GetSuccessors()) {
+        for (auto* phi = succ->Front(); phi != nullptr && phi->IsPhi(); phi = phi->GetNext()) {
+            Value* input = static_cast<InstructionPhi*>(phi)->GetInputFrom(bb);
+            if (const size_t idx = mLivenessAnalyzer->GetValueIndex(input); idx != LivenessAnalyzer::kNoValueIndex && mRewritten.Test(idx)) {
+                uses[idx].value = input;
+                uses[idx].isEdgeUse = true;
+            }
+        }
+    }
+
+    for (const auto& [idx, valueUses] : uses) {
+        const uint32_t count = valueUses.count + valueUses.isEdgeUse;
+        if (valueUses.definition != nullptr ? count == 0 : count < 2) {
+            continue;
+        }
+        const Instruction* first = valueUses.definition != nullptr ? valueUses.definition : valueUses.first;
+        mTemporaries.emplace(std::pair{bb, idx}, Temporary{mNodes.size(), first, valueUses.last, valueUses.definition != nullptr, valueUses.isEdgeUse});
+        mNodes.push_back(Node{valueUses.value, bb});
+        mNodes.back().cost = std::numeric_limits<double>::infinity();
+    }
+}
+
+
+// Values whose nodes got no register are rewritten for the next round. Temporary of a value which does not leave
+// its block would be as long as the value, so such values and temporaries without a register stay in the stack
+bool GraphColoringAllocator::RewriteSpilled() {
+    bool isRewritten = false;
+    for (size_t node = 0; node < mNodes.size(); ++node) {
+        if (mNodes[node].block == nullptr && mNodes[GetAlias(node)].state == NodeState::Spilled && IsLiveOutOfDefinition(mNodes[node].value)) {
+            mRewritten.Set(mLivenessAnalyzer->GetValueIndex(mNodes[node].value));
+            isRewritten = true;
+        }
+    }
+    return isRewritten;
+}
+
+
+// Livesets are walked backwards through every block. Definition interferes with all values live after it, the inputs
+// which die at the instruction may share its register. Phis of a block are defined at once at the block start.
+// Bit of a rewritten value stands for its temporary in the block, the value is not live where it has none
+void GraphColoringAllocator::Build() {
+    // Value which leaves its block costs a store after the definition and a load in every other block using it once
+    // rewritten. Other values cost an access per definition and use
+    std::vector<const BasicBlock*> definitionBlocks(mNodes.size(), nullptr);
+    std::vector<const BasicBlock*> chargedBlocks(mNodes.size(), nullptr);
+    for (size_t node = 0; node < mNodes.size(); ++node) {
+        if (mNodes[node].block == nullptr && IsLiveOutOfDefinition(mNodes[node].value)) {
+            definitionBlocks[node] = mNodes[node].value->GetProducer()->GetParentBasicBlock();
+        }
+    }
+    auto charge = [this, &definitionBlocks, &chargedBlocks](size_t node, const BasicBlock* bb, double weight) {
+        if (definitionBlocks[node] != nullptr) {
+            if (definitionBlocks[node] == bb || chargedBlocks[node] == bb) {
+                return;
+            }
+            chargedBlocks[node] = bb;
+        }
+        mNodes[node].cost += weight;
+    };
+
+    BitVector liveset{mLivenessAnalyzer->GetValueCount()};
+    const BasicBlock* block = nullptr;
+    auto define = [this, &liveset, &block](size_t node) {
+        liveset.ForEach([this, node, &block](size_t idx) {
+            if (size_t other = GetNode(idx, block); other != kNoNode && other != node) {
+                AddEdge(node, other);
+            }
+        });
+    };
+    auto use = [this, &liveset, &block, &charge](const Value* input, double weight) {
+        if (size_t idx = mLivenessAnalyzer->GetValueIndex(input); idx != LivenessAnalyzer::kNoValueIndex) {
+            const size_t node = GetNode(idx, block);
+            if (node != kNoNode) {
+                charge(node, block, weight);
+            }
+            if (node != kNoNode || !mRewritten.Test(idx)) {
+                liveset.Set(idx);
+            }
+        }
+    };
+
+    for (auto* bb : mLivenessAnalyzer->GetBasicBlocksLinearOrder()) {
+        const double weight = RegisterAllocator::GetBlockWeight(bb);
+        block = bb;
+        liveset = mLivenessAnalyzer->GetLiveOut(bb);
+
+        // Rewritten values leave the block in their stack slots, unless phis of the successors read the temporary
+        mRewritten.ForEach([this, bb, &liveset](size_t idx) {
+            if (auto it = mTemporaries.find({bb, idx}); it == mTemporaries.end() || !it->second.isEdgeUse) {
+                liveset.Reset(idx);
+            }
+        });
+
+        Instruction* inst = bb->Back();
+        for (; inst != nullptr && !inst->IsPhi(); inst = inst->GetPrev()) {
+            if (Value* output = inst->GetOutput(); output != nullptr) {
+                if (size_t node = GetNode(output, bb); node != kNoNode) {
+                    define(node);
+                    mNodes[node].cost += weight;
+                    if (inst->GetType() == InstructionType::Mv) {
+                        AddMove(node, GetNode(static_cast<InstructionMv*>(inst)->GetInput(), bb));
+                    }
+                }
+                liveset.Reset(mLivenessAnalyzer->GetValueIndex(output));
+            }
+            for (Value* input : inst->operands()) {
+                use(input, weight);
+            }
+
+            // Temporary is loaded right before the first use
+            for (Value* input : inst->operands()) {
+                const size_t idx = mLivenessAnalyzer->GetValueIndex(input);
+                if (idx == LivenessAnalyzer::kNoValueIndex || !mRewritten.Test(idx) || !liveset.Test(idx)) {
+                    continue;
+                }
+                if (const Temporary& temporary = mTemporaries.at({bb, idx}); !temporary.isDefinition && temporary.first == inst) {
+                    define(temporary.node);
+                    liveset.Reset(idx);
+                }
+            }
+        }
+
+        // Outputs of all phis are live at the block start, even the unused ones are written there
+        for (auto* phi = bb->Front(); phi != nullptr && phi->IsPhi(); phi = phi->GetNext()) {
+            const size_t idx = mLivenessAnalyzer->GetValueIndex(phi->GetOutput());
+            if (!mRewritten.Test(idx) || GetNode(idx, bb) != kNoNode) {
+                liveset.Set(idx);
+            }
+        }
+        for (auto* phi = bb->Front(); phi != nullptr && phi->IsPhi(); phi = phi->GetNext()) {
+            const size_t node = GetNode(phi->GetOutput(), bb);
+            if (node == kNoNode) {
+                continue;
+            }
+            define(node);
+            mNodes[node].cost += weight;
+
+            // Inputs are read on the edges, at the end of the predecessors
+            for (auto* pred : bb->GetPredecessors()) {
+                const size_t inputNode = GetNode(static_cast<InstructionPhi*>(phi)->GetInputFrom(pred), pred);
+                AddMove(node, inputNode);
+                if (inputNode != kNoNode) {
+                    charge(inputNode, pred, std::min(weight, RegisterAllocator::GetBlockWeight(pred)));
+                }
+            }
+        }
+    }
+}
+
+
+void GraphColoringAllocator::MakeWorklists() {
+    for (size_t node = 0; node < mNodes.size(); ++node) {
+        if (IsSignificant(node)) {
+            PushNode(NodeState::Spill, node);
+        }
+        else if (IsMoveRelated(node)) {
+            PushNode(NodeState::Freeze, node);
+        }
+        else {
+            PushNode(NodeState::Simplify, node);
+        }
+    }
+    for (size_t move = mMoves.size(); move-- > 0;) {
+        mMoveWorklist.push_back(move);
+    }
+}
+
+
+void GraphColoringAllocator::Simplify() {
+    const size_t node = mSimplifyWorklist.back();
+    mSimplifyWorklist.pop_back();
+
+    mNodes[node].state = NodeState::Selected;
+    mSelectStack.push_back(node);
+    ForEachAdjacent(node, [this](size_t adjacent) { DecrementDegree(adjacent); });
+}
+
+
+void GraphColoringAllocator::Coalesce() {
+    CopyMove& move = mMoves[mMoveWorklist.back()];
+    mMoveWorklist.pop_back();
+
+    const size_t u = GetAlias(move.dst);
+    const size_t v = GetAlias(move.src);
+    if (u == v) {
+        move.state = MoveState::Coalesced;
+        ++mCoalescedMoveCount;
+        AddToSimplify(u);
+    }
+    else if (IsAdjacent(u, v)) {
+        move.state = MoveState::Constrained;
+        AddToSimplify(u);
+        AddToSimplify(v);
+    }
+    else if (GeorgeTest(u, v) || BriggsTest(u, v)) {
+        move.state = MoveState::Coalesced;
+        ++mCoalescedMoveCount;
+        Combine(u, v);
+        AddToSimplify(u);
+    }
+    else {
+        move.state = MoveState::Active;
+    }
+}
+
+
+void GraphColoringAllocator::Freeze() {
+    const size_t node = mFreezeWorklist.back();
+    mFreezeWorklist.pop_back();
+
+    PushNode(NodeState::Simplify, node);
+    FreezeMoves(node);
+}
+
+
+// Cheapest value per removed interference goes to the stack
+void GraphColoringAllocator::SelectSpill() {
+    std::erase_if(mSpillWorklist, [this](size_t node) { return mNodes[node].state != NodeState::Spill; });
+
+    auto priority = [this](size_t node) { return mNodes[node].cost / static_cast<double>(std::max(mNodes[node].degree, 1u)); };
+    auto best = std::min_element(mSpillWorklist.begin(), mSpillWorklist.end(), [&priority](size_t a, size_t b) { return priority(a) < priority(b); });
+    const size_t node = *best;
+    mSpillWorklist.erase(best);
+
+    PushNode(NodeState::Simplify, node);
+    FreezeMoves(node);
+}
+
+
+void GraphColoringAllocator::AssignColors() {
+    std::vector<bool> usedColors{};
+    while (!mSelectStack.empty()) {
+        const size_t node = mSelectStack.back();
+        mSelectStack.pop_back();
+
+        usedColors.assign(mRegisterCount, false);
+        for (size_t adjacent : mNodes[node].adjacent) {
+            const Node& other = mNodes[GetAlias(adjacent)];
+            if (other.state == NodeState::Colored) {
+                usedColors[other.color] = true;
+            }
+        }
+
+        auto freeColor = std::find(usedColors.begin(), usedColors.end(), false);
+        if (freeColor == usedColors.end()) {
+            mNodes[node].state = NodeState::Spilled;
+            mNodes[node].color = kNoStackLocation;
+        }
+        else {
+            mNodes[node].state = NodeState::Colored;
+            mNodes[node].color = static_cast<uint32_t>(freeColor - usedColors.begin());
+        }
+    }
+}
+
+
+// Coalesced values share the register or the stack slot of their alias, they do not interfere
+void GraphColoringAllocator::AssignLocations(bool isGP) {
+    std::unordered_map<const Value*, std::vector<const Temporary*>> temporaries{};
+    for (size_t idx = 0; idx < mNodes.size(); ++idx) {
+        Node& node = mNodes[idx];
+        if (node.block != nullptr) {
+            temporaries[node.value].push_back(&mTemporaries.at({node.block, mLivenessAnalyzer->GetValueIndex(node.value)}));
+            continue;
+        }
+
+        Node& alias = mNodes[GetAlias(idx)];
+        node.value->SetLocation(alias.state == NodeState::Spilled ? Location(GetStackLocation(alias)) : GetRegisterLocation(alias, isGP));
+        node.value->SetLocationSplits({});
+    }
+
+    // Nodes are created in the linear order, so are the temporaries of every value
+    mRewritten.ForEach([this, isGP, &temporaries](size_t idx) {
+        Value* value = mLivenessAnalyzer->GetValueByIndex(idx);
+        AssignRewrittenLocation(value, temporaries[value], isGP);
+    });
+}
+
+
+// Rewritten value is in the register of its temporary from the definition or the load to the end of the temporary,
+// and in its stack slot elsewhere. Value which is used only by the temporary of its definition needs no slot
+void GraphColoringAllocator::AssignRewrittenLocation(Value* value, const std::vector<const Temporary*>& temporaries, bool isGP) {
+    auto isColored = [this](const Temporary* temporary) { return mNodes[GetAlias(temporary->node)].state == NodeState::Colored; };
+    const Temporary* definition = !temporaries.empty() && temporaries.front()->isDefinition ? temporaries.front() : nullptr;
+
+    const bool needsSlot = definition == nullptr || !isColored(definition) || IsLiveOutOfDefinition(value);
+    Location slot{};
+    if (needsSlot) {
+        slot = StackLocation(mNextStackLocation++);
+        ++mStackLocationCount;
+    }
+
+    value->SetLocation(definition != nullptr && isColored(definition) ? GetRegisterLocation(mNodes[GetAlias(definition->node)], isGP) : slot);
+    std::vector<LocationSplit> splits{};
+    for (const Temporary* temporary : temporaries) {
+        if (!isColored(temporary)) {
+            continue;
+        }
+        const Location location = GetRegisterLocation(mNodes[GetAlias(temporary->node)], isGP);
+        if (temporary->isDefinition) {
+            // Phis are stored together after the last of them
+            const Instruction* next = temporary->first->GetNext();
+            while (next->IsPhi()) {
+                next = next->GetNext();
+            }
+            if (needsSlot) {
+                mInstructionMoves[next].push_back(RegisterAllocator::Move{value, location, slot});
+            }
+        }
+        else {
+            splits.push_back(LocationSplit{temporary->first->GetLiveNumber() - 1, location});
+            mInstructionMoves[temporary->first].push_back(RegisterAllocator::Move{value, slot, location});
+        }
+
+        if (needsSlot) {
+            const BasicBlock* bb = mNodes[temporary->node].block;
+            splits.push_back(LocationSplit{temporary->isEdgeUse ? bb->GetLiveRange().end : temporary->last->GetLiveNumber(), slot});
+        }
+    }
+    mSplitCount += splits.size();
+    value->SetLocationSplits(std::move(splits));
+}
+
+
+void GraphColoringAllocator::AddEdge(size_t u, size_t v) {
+    if (u == v || IsAdjacent(u, v)) {
+        return;
+    }
+    mAdjacency.Set(u * mNodes.size() + v);
+    mAdjacency.Set(v * mNodes.size() + u);
+    mNodes[u].adjacent.push_back(v);
+    mNodes[v].adjacent.push_back(u);
+    ++mNodes[u].degree;
+    ++mNodes[v].degree;
+    ++mInterferenceCount;
+}
+
+
+void GraphColoringAllocator::AddMove(size_t dst, size_t src) {
+    if (dst == kNoNode || src == kNoNode || dst == src) {
+        return;
+    }
+    mNodes[dst].moves.push_back(mMoves.size());
+    mNodes[src].moves.push_back(mMoves.size());
+    mMoves.push_back(CopyMove{dst, src});
+}
+
+
+void GraphColoringAllocator::DecrementDegree(size_t node) {
+    if (mNodes[node].degree-- != mRegisterCount) {
+        return;
+    }
+
+    // Node has got a free color, moves of it and of its neighbours may be coalesced now
+    EnableMoves(node);
+    ForEachAdjacent(node, [this](size_t adjacent) { EnableMoves(adjacent); });
+    if (mNodes[node].state == NodeState::Spill) {
+        PushNode(IsMoveRelated(node) ? NodeState::Freeze : NodeState::Simplify, node);
+    }
+}
+
+
+void GraphColoringAllocator::EnableMoves(size_t node) {
+    ForEachNodeMove(node, [this](size_t move) {
+        if (mMoves[move].state == MoveState::Active) {
+            mMoves[move].state = MoveState::Worklist;
+            mMoveWorklist.push_back(move);
+        }
+    });
+}
+
+
+void GraphColoringAllocator::AddToSimplify(size_t node) {
+    if (mNodes[node].state == NodeState::Freeze && !IsMoveRelated(node) && !IsSignificant(node)) {
+        PushNode(NodeState::Simplify, node);
+    }
+}
+
+
+void GraphColoringAllocator::Combine(size_t u, size_t v) {
+    mNodes[v].state = NodeState::Coalesced;
+    mNodes[v].alias = u;
+    mNodes[u].cost += mNodes[v].cost;
+    mNodes[u].moves.insert(mNodes[u].moves.end(), mNodes[v].moves.begin(), mNodes[v].moves.end());
+    EnableMoves(v);
+
+    ForEachAdjacent(v, [this, u](size_t adjacent) {
+        AddEdge(adjacent, u);
+        DecrementDegree(adjacent);
+    });
+    if (IsSignificant(u) && mNodes[u].state == NodeState::Freeze) {
+        PushNode(NodeState::Spill, u);
+    }
+}
+
+
+// Gives up coalescing of the node, it is simplified as an ordinary one
+void GraphColoringAllocator::FreezeMoves(size_t node) {
+    ForEachNodeMove(node, [this, node](size_t move) {
+        const size_t src = GetAlias(mMoves[move].src);
+        const size_t other = src == GetAlias(node) ? GetAlias(mMoves[move].dst) : src;
+        mMoves[move].state = MoveState::Frozen;
+
+        if (mNodes[other].state == NodeState::Freeze && !IsMoveRelated(other) && !IsSignificant(other)) {
+            PushNode(NodeState::Simplify, other);
+        }
+    });
+}
+
+
+bool GraphColoringAllocator::IsMoveRelated(size_t node) const {
+    return std::any_of(mNodes[node].moves.begin(), mNodes[node].moves.end(), [this](size_t move) {
+        return mMoves[move].state == MoveState::Worklist || mMoves[move].state == MoveState::Active;
+    });
+}
+
+
+// Combined node has fewer significant neighbours than registers
+bool GraphColoringAllocator::BriggsTest(size_t u, size_t v) const {
+    uint32_t significant = 0;
+    ForEachAdjacent(u, [this, &significant](size_t adjacent) { significant += IsSignificant(adjacent); });
+    ForEachAdjacent(v, [this, u, &significant](size_t adjacent) { significant += IsSignificant(adjacent) && !IsAdjacent(adjacent, u); });
+    return significant < mRegisterCount;
+}
+
+
+// Every significant neighbour of v already interferes with u
+bool GraphColoringAllocator::GeorgeTest(size_t u, size_t v) const {
+    bool canCombine = true;
+    ForEachAdjacent(v, [this, u, &canCombine](size_t adjacent) { canCombine &= !IsSignificant(adjacent) || IsAdjacent(adjacent, u); });
+    return canCombine;
+}
+
+
+size_t GraphColoringAllocator::GetAlias(size_t node) const {
+    while (mNodes[node].state == NodeState::Coalesced) {
+        node = mNodes[node].alias;
+    }
+    return node;
+}
+
+
+void GraphColoringAllocator::PushNode(NodeState state, size_t node) {
+    mNodes[node].state = state;
+    switch (state) {
+        case NodeState::Simplify:
+            mSimplifyWorklist.push_back(node);
+            break;
+        case NodeState::Freeze:
+            mFreezeWorklist.push_back(node);
+            break;
+        case NodeState::Spill:
+            mSpillWorklist.push_back(node);
+            break;
+        default:
+            break;
+    }
+}
+
+
+bool GraphColoringAllocator::HasNode(std::vector<size_t>& worklist, NodeState state) {
+    while (!worklist.empty() && mNodes[worklist.back()].state != state) {
+        worklist.pop_back();
+    }
+    return !worklist.empty();
+}
+
+
+bool GraphColoringAllocator::HasMove() {
+    while (!mMoveWorklist.empty() && mMoves[mMoveWorklist.back()].state != MoveState::Worklist) {
+        mMoveWorklist.pop_back();
+    }
+    return !mMoveWorklist.empty();
+}
+
+
+size_t GraphColoringAllocator::GetNode(const Value* value, const BasicBlock* bb) const {
+    return GetNode(mLivenessAnalyzer->GetValueIndex(value), bb);
+}
+
+
+// Rewritten value is represented by its temporary in the block
+size_t GraphColoringAllocator::GetNode(size_t valueIdx, const BasicBlock* bb) const {
+    if (valueIdx == LivenessAnalyzer::kNoValueIndex) {
+        return kNoNode;
+    }
+    if (!mRewritten.Test(valueIdx)) {
+        return mNodeByValueIndex[valueIdx];
+    }
+    auto it = mTemporaries.find({bb, valueIdx});
+    return it != mTemporaries.end() ? it->second.node : kNoNode;
+}
+
+
+bool GraphColoringAllocator::IsUsedByNextOnly(const Value* value) const {
+    const Instruction* next = value->GetProducer()->GetNext();
+    const auto users = value->GetUsers();
+    return next != nullptr && !next->IsPhi() && !users.empty() && std::all_of(users.begin(), users.end(), [next](const Instruction* user) { return user == next; });
+}
+
+
+// Phis of the successors do not make the value live out, they read it at the end of the block
+bool GraphColoringAllocator::IsLiveOutOfDefinition(const Value* value) const {
+    const auto successors = value->GetProducer()->GetParentBasicBlock()->GetSuccessors();
+    return std::any_of(successors.begin(), successors.end(), [this, value](const BasicBlock* succ) { return mLivenessAnalyzer->IsLiveIn(succ, value); });
+}
+
+
+Location GraphColoringAllocator::GetRegisterLocation(const Node& node, bool isGP) const {
+    return isGP ? Location(GPRegisterLocation(node.color)) : Location(FPRegisterLocation(node.color));
+}
+
+
+// Slot is taken when a value of the spilled node needs it
+StackLocation GraphColoringAllocator::GetStackLocation(Node& node) {
+    if (node.color == kNoStackLocation) {
+        node.color = mNextStackLocation++;
+        ++mStackLocationCount;
+    }
+    return StackLocation(node.color);
+}
+
+}   // namespace VMIR
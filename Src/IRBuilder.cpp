@@ -1,479 +1,382 @@
 #include <IRBuilder.h>
+#include <IRPrinter.h>
 
 #include <iomanip>
 
 namespace VMIR {
 
-IRBuilder* IRBuilder::mInstancePtr = nullptr;
-IRBuilder::IRBuilder() {}
+IRContext::IRContext() {}
 
 
-Function* IRBuilder::CreateFunction(const std::string& name) {
+Function* IRContext::CreateFunction(const std::string& name) {
     return CreateFunction(ValueType::Void, name);
 }
 
-Function* IRBuilder::CreateFunction(const ValueType retType, const std::string& name) {
-    Function* func = new Function(retType, name);
+Function* IRContext::CreateFunction(const ValueType retType, const std::string& name) {
+    std::lock_guard lock{mMutex};
+    Function* func = mArena.New<Function>(this, retType, name);
     mFunctions.push_back(func);
     return func;
 }
 
-Function* IRBuilder::CreateFunction(const std::vector<ValueType>& argsTypes, const std::string& name) {
+Function* IRContext::CreateFunction(const std::vector<ValueType>& argsTypes, const std::string& name) {
     return CreateFunction(ValueType::Void, argsTypes, name);
 }
 
-Function* IRBuilder::CreateFunction(const ValueType retType, const std::vector<ValueType>& argsTypes, const std::string& name) {
-    Function* func = new Function(retType, argsTypes, name);
+Function* IRContext::CreateFunction(const ValueType retType, const std::vector<ValueType>& argsTypes, const std::string& name) {
+    std::lock_guard lock{mMutex};
+    Function* func = mArena.New<Function>(this, retType, argsTypes, name);
     mFunctions.push_back(func);
     return func;
 }
 
 
 
-BasicBlock* IRBuilder::CreateBasicBlock() {
+BasicBlock* IRContext::CreateBasicBlock() {
     return CreateBasicBlock(nullptr, "");
 }
 
-BasicBlock* IRBuilder::CreateBasicBlock(Function* parentFunction) {
+BasicBlock* IRContext::CreateBasicBlock(Function* parentFunction) {
     return CreateBasicBlock(parentFunction, "");
 }
 
-BasicBlock* IRBuilder::CreateBasicBlock(const std::string& name) {
+BasicBlock* IRContext::CreateBasicBlock(const std::string& name) {
     return CreateBasicBlock(nullptr, name);
 }
 
-BasicBlock* IRBuilder::CreateBasicBlock(Function* parentFunction, const std::string& name) {
-    BasicBlockId id = GenerateNewBasicBlockId();
-    BasicBlock* bb = new BasicBlock(id, parentFunction, name);
+BasicBlock* IRContext::CreateBasicBlock(Function* parentFunction, const std::string& name) {
+    BasicBlock* bb = nullptr;
+    {
+        std::lock_guard lock{mMutex};
+        bb = mArena.New<BasicBlock>(GenerateNewBasicBlockId(), parentFunction, name);
+        mBasicBlocks.push_back(bb);
+    }
     if (parentFunction != nullptr) {
         parentFunction->AppendBasicBlock(bb);
     }
-    mBasicBlocks.emplace(id, bb);
     return bb;
 }
 
 
-InstructionAdd* IRBuilder::CreateAdd() {
+InstructionAdd* IRContext::CreateAdd() {
     return CreateAdd(nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionAdd* IRBuilder::CreateAdd(Value* input1, Value* input2, Value* output) {
+InstructionAdd* IRContext::CreateAdd(Value* input1, Value* input2, Value* output) {
     return CreateAdd(nullptr, input1, input2, output);
 }
 
-InstructionAdd* IRBuilder::CreateAdd(BasicBlock* parentBasicBlock) {
+InstructionAdd* IRContext::CreateAdd(BasicBlock* parentBasicBlock) {
     return CreateAdd(parentBasicBlock, nullptr, nullptr, nullptr);
 }
 
-InstructionAdd* IRBuilder::CreateAdd(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionAdd* inst = new InstructionAdd(id, input1, input2, output);
+InstructionAdd* IRContext::CreateAdd(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
+    InstructionAdd* inst = NewInstruction<InstructionAdd>(input1, input2, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionSub* IRBuilder::CreateSub() {
+InstructionSub* IRContext::CreateSub() {
     return CreateSub(nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionSub* IRBuilder::CreateSub(Value* input1, Value* input2, Value* output) {
+InstructionSub* IRContext::CreateSub(Value* input1, Value* input2, Value* output) {
     return CreateSub(nullptr, input1, input2, output);
 }
 
-InstructionSub* IRBuilder::CreateSub(BasicBlock* parentBasicBlock) {
+InstructionSub* IRContext::CreateSub(BasicBlock* parentBasicBlock) {
     return CreateSub(parentBasicBlock, nullptr, nullptr, nullptr);
 }
 
-InstructionSub* IRBuilder::CreateSub(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionSub* inst = new InstructionSub(id, input1, input2, output);
+InstructionSub* IRContext::CreateSub(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
+    InstructionSub* inst = NewInstruction<InstructionSub>(input1, input2, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionMul* IRBuilder::CreateMul() {
+InstructionMul* IRContext::CreateMul() {
     return CreateMul(nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionMul* IRBuilder::CreateMul(Value* input1, Value* input2, Value* output) {
+InstructionMul* IRContext::CreateMul(Value* input1, Value* input2, Value* output) {
     return CreateMul(nullptr, input1, input2, output);
 }
 
-InstructionMul* IRBuilder::CreateMul(BasicBlock* parentBasicBlock) {
+InstructionMul* IRContext::CreateMul(BasicBlock* parentBasicBlock) {
     return CreateMul(parentBasicBlock, nullptr, nullptr, nullptr);
 }
 
-InstructionMul* IRBuilder::CreateMul(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionMul* inst = new InstructionMul(id, input1, input2, output);
+InstructionMul* IRContext::CreateMul(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
+    InstructionMul* inst = NewInstruction<InstructionMul>(input1, input2, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionDiv* IRBuilder::CreateDiv() {
+InstructionDiv* IRContext::CreateDiv() {
     return CreateDiv(nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionDiv* IRBuilder::CreateDiv(Value* input1, Value* input2, Value* output) {
+InstructionDiv* IRContext::CreateDiv(Value* input1, Value* input2, Value* output) {
     return CreateDiv(nullptr, input1, input2, output);
 }
 
-InstructionDiv* IRBuilder::CreateDiv(BasicBlock* parentBasicBlock) {
+InstructionDiv* IRContext::CreateDiv(BasicBlock* parentBasicBlock) {
     return CreateDiv(parentBasicBlock, nullptr, nullptr, nullptr);
 }
 
-InstructionDiv* IRBuilder::CreateDiv(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionDiv* inst = new InstructionDiv(id, input1, input2, output);
+InstructionDiv* IRContext::CreateDiv(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
+    InstructionDiv* inst = NewInstruction<InstructionDiv>(input1, input2, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionRem* IRBuilder::CreateRem() {
+InstructionRem* IRContext::CreateRem() {
     return CreateRem(nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionRem* IRBuilder::CreateRem(Value* input1, Value* input2, Value* output) {
+InstructionRem* IRContext::CreateRem(Value* input1, Value* input2, Value* output) {
     return CreateRem(nullptr, input1, input2, output);
 }
 
-InstructionRem* IRBuilder::CreateRem(BasicBlock* parentBasicBlock) {
+InstructionRem* IRContext::CreateRem(BasicBlock* parentBasicBlock) {
     return CreateRem(parentBasicBlock, nullptr, nullptr, nullptr);
 }
 
-InstructionRem* IRBuilder::CreateRem(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionRem* inst = new InstructionRem(id, input1, input2, output);
+InstructionRem* IRContext::CreateRem(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
+    InstructionRem* inst = NewInstruction<InstructionRem>(input1, input2, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionAnd* IRBuilder::CreateAnd() {
+InstructionAnd* IRContext::CreateAnd() {
     return CreateAnd(nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionAnd* IRBuilder::CreateAnd(Value* input1, Value* input2, Value* output) {
+InstructionAnd* IRContext::CreateAnd(Value* input1, Value* input2, Value* output) {
     return CreateAnd(nullptr, input1, input2, output);
 }
 
-InstructionAnd* IRBuilder::CreateAnd(BasicBlock* parentBasicBlock) {
+InstructionAnd* IRContext::CreateAnd(BasicBlock* parentBasicBlock) {
     return CreateAnd(parentBasicBlock, nullptr, nullptr, nullptr);
 }
 
-InstructionAnd* IRBuilder::CreateAnd(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionAnd* inst = new InstructionAnd(id, input1, input2, output);
+InstructionAnd* IRContext::CreateAnd(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
+    InstructionAnd* inst = NewInstruction<InstructionAnd>(input1, input2, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionOr* IRBuilder::CreateOr() {
+InstructionOr* IRContext::CreateOr() {
     return CreateOr(nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionOr* IRBuilder::CreateOr(Value* input1, Value* input2, Value* output) {
+InstructionOr* IRContext::CreateOr(Value* input1, Value* input2, Value* output) {
     return CreateOr(nullptr, input1, input2, output);
 }
 
-InstructionOr* IRBuilder::CreateOr(BasicBlock* parentBasicBlock) {
+InstructionOr* IRContext::CreateOr(BasicBlock* parentBasicBlock) {
     return CreateOr(parentBasicBlock, nullptr, nullptr, nullptr);
 }
 
-InstructionOr* IRBuilder::CreateOr(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionOr* inst = new InstructionOr(id, input1, input2, output);
+InstructionOr* IRContext::CreateOr(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
+    InstructionOr* inst = NewInstruction<InstructionOr>(input1, input2, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionXor* IRBuilder::CreateXor() {
+InstructionXor* IRContext::CreateXor() {
     return CreateXor(nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionXor* IRBuilder::CreateXor(Value* input1, Value* input2, Value* output) {
+InstructionXor* IRContext::CreateXor(Value* input1, Value* input2, Value* output) {
     return CreateXor(nullptr, input1, input2, output);
 }
 
-InstructionXor* IRBuilder::CreateXor(BasicBlock* parentBasicBlock) {
+InstructionXor* IRContext::CreateXor(BasicBlock* parentBasicBlock) {
     return CreateXor(parentBasicBlock, nullptr, nullptr, nullptr);
 }
 
-InstructionXor* IRBuilder::CreateXor(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionXor* inst = new InstructionXor(id, input1, input2, output);
+InstructionXor* IRContext::CreateXor(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
+    InstructionXor* inst = NewInstruction<InstructionXor>(input1, input2, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionShl* IRBuilder::CreateShl() {
+InstructionShl* IRContext::CreateShl() {
     return CreateShl(nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionShl* IRBuilder::CreateShl(Value* input1, Value* input2, Value* output) {
+InstructionShl* IRContext::CreateShl(Value* input1, Value* input2, Value* output) {
     return CreateShl(nullptr, input1, input2, output);
 }
 
-InstructionShl* IRBuilder::CreateShl(BasicBlock* parentBasicBlock) {
+InstructionShl* IRContext::CreateShl(BasicBlock* parentBasicBlock) {
     return CreateShl(parentBasicBlock, nullptr, nullptr, nullptr);
 }
 
-InstructionShl* IRBuilder::CreateShl(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionShl* inst = new InstructionShl(id, input1, input2, output);
+InstructionShl* IRContext::CreateShl(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
+    InstructionShl* inst = NewInstruction<InstructionShl>(input1, input2, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionShr* IRBuilder::CreateShr() {
+InstructionShr* IRContext::CreateShr() {
     return CreateShr(nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionShr* IRBuilder::CreateShr(Value* input1, Value* input2, Value* output) {
+InstructionShr* IRContext::CreateShr(Value* input1, Value* input2, Value* output) {
     return CreateShr(nullptr, input1, input2, output);
 }
 
-InstructionShr* IRBuilder::CreateShr(BasicBlock* parentBasicBlock) {
+InstructionShr* IRContext::CreateShr(BasicBlock* parentBasicBlock) {
     return CreateShr(parentBasicBlock, nullptr, nullptr, nullptr);
 }
 
-InstructionShr* IRBuilder::CreateShr(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionShr* inst = new InstructionShr(id, input1, input2, output);
+InstructionShr* IRContext::CreateShr(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
+    InstructionShr* inst = NewInstruction<InstructionShr>(input1, input2, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionAshr* IRBuilder::CreateAshr() {
+InstructionAshr* IRContext::CreateAshr() {
     return CreateAshr(nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionAshr* IRBuilder::CreateAshr(Value* input1, Value* input2, Value* output) {
+InstructionAshr* IRContext::CreateAshr(Value* input1, Value* input2, Value* output) {
     return CreateAshr(nullptr, input1, input2, output);
 }
 
-InstructionAshr* IRBuilder::CreateAshr(BasicBlock* parentBasicBlock) {
+InstructionAshr* IRContext::CreateAshr(BasicBlock* parentBasicBlock) {
     return CreateAshr(parentBasicBlock, nullptr, nullptr, nullptr);
 }
 
-InstructionAshr* IRBuilder::CreateAshr(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionAshr* inst = new InstructionAshr(id, input1, input2, output);
+InstructionAshr* IRContext::CreateAshr(BasicBlock* parentBasicBlock, Value* input1, Value* input2, Value* output) {
+    InstructionAshr* inst = NewInstruction<InstructionAshr>(input1, input2, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionLoad* IRBuilder::CreateLoad() {
+InstructionLoad* IRContext::CreateLoad() {
     return CreateLoad(nullptr, nullptr, nullptr);
 }
 
-InstructionLoad* IRBuilder::CreateLoad(Value* loadPtr, Value* output) {
+InstructionLoad* IRContext::CreateLoad(Value* loadPtr, Value* output) {
     return CreateLoad(nullptr, loadPtr, output);
 }
 
-InstructionLoad* IRBuilder::CreateLoad(BasicBlock* parentBasicBlock) {
+InstructionLoad* IRContext::CreateLoad(BasicBlock* parentBasicBlock) {
     return CreateLoad(parentBasicBlock, nullptr, nullptr);
 }
 
-InstructionLoad* IRBuilder::CreateLoad(BasicBlock* parentBasicBlock, Value* loadPtr, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionLoad* inst = new InstructionLoad(id, loadPtr, output);
+InstructionLoad* IRContext::CreateLoad(BasicBlock* parentBasicBlock, Value* loadPtr, Value* output) {
+    InstructionLoad* inst = NewInstruction<InstructionLoad>(loadPtr, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (loadPtr != nullptr) {
-        loadPtr->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionStore* IRBuilder::CreateStore() {
+InstructionStore* IRContext::CreateStore() {
     return CreateStore(nullptr, nullptr, nullptr);
 }
 
-InstructionStore* IRBuilder::CreateStore(Value* storePtr, Value* input) {
+InstructionStore* IRContext::CreateStore(Value* storePtr, Value* input) {
     return CreateStore(nullptr, storePtr, input);
 }
 
-InstructionStore* IRBuilder::CreateStore(BasicBlock* parentBasicBlock) {
+InstructionStore* IRContext::CreateStore(BasicBlock* parentBasicBlock) {
     return CreateStore(parentBasicBlock, nullptr, nullptr);
 }
 
-InstructionStore* IRBuilder::CreateStore(BasicBlock* parentBasicBlock, Value* storePtr, Value* input) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionStore* inst = new InstructionStore(id, storePtr, input);
+InstructionStore* IRContext::CreateStore(BasicBlock* parentBasicBlock, Value* storePtr, Value* input) {
+    InstructionStore* inst = NewInstruction<InstructionStore>(storePtr, input);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (storePtr != nullptr) {
-        storePtr->AddUser(inst);
-    }
-    if (input != nullptr) {
-        input->AddUser(inst);
-    }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionJump* IRBuilder::CreateJump() {
+InstructionJump* IRContext::CreateJump() {
     return CreateJump(nullptr, nullptr);
 }
 
-InstructionJump* IRBuilder::CreateJump(BasicBlock* parentBasicBlock) {
+InstructionJump* IRContext::CreateJump(BasicBlock* parentBasicBlock) {
     return CreateJump(parentBasicBlock, nullptr);
 }
 
-InstructionJump* IRBuilder::CreateJump(BasicBlock* parentBasicBlock, BasicBlock *jumpBB) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionJump* inst = new InstructionJump(id, jumpBB);
+InstructionJump* IRContext::CreateJump(BasicBlock* parentBasicBlock, BasicBlock *jumpBB) {
+    InstructionJump* inst = NewInstruction<InstructionJump>(jumpBB);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
         if (jumpBB != nullptr) {
@@ -481,26 +384,24 @@ InstructionJump* IRBuilder::CreateJump(BasicBlock* parentBasicBlock, BasicBlock
             jumpBB->AddPredecessor(parentBasicBlock);
         }
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionBeq* IRBuilder::CreateBeq() {
+InstructionBeq* IRContext::CreateBeq() {
     return CreateBeq(nullptr, nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionBeq* IRBuilder::CreateBeq(Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
+InstructionBeq* IRContext::CreateBeq(Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
     return CreateBeq(nullptr, input1, input2, trueBB, falseBB);
 }
 
-InstructionBeq* IRBuilder::CreateBeq(BasicBlock* parentBasicBlock) {
+InstructionBeq* IRContext::CreateBeq(BasicBlock* parentBasicBlock) {
     return CreateBeq(parentBasicBlock, nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionBeq* IRBuilder::CreateBeq(BasicBlock* parentBasicBlock, Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionBeq* inst = new InstructionBeq(id, input1, input2, trueBB, falseBB);
+InstructionBeq* IRContext::CreateBeq(BasicBlock* parentBasicBlock, Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
+    InstructionBeq* inst = NewInstruction<InstructionBeq>(input1, input2, trueBB, falseBB);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
         if (trueBB != nullptr) {
@@ -512,32 +413,24 @@ InstructionBeq* IRBuilder::CreateBeq(BasicBlock* parentBasicBlock, Value* input1
             falseBB->AddPredecessor(parentBasicBlock);
         }
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionBne* IRBuilder::CreateBne() {
+InstructionBne* IRContext::CreateBne() {
     return CreateBne(nullptr, nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionBne* IRBuilder::CreateBne(Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
+InstructionBne* IRContext::CreateBne(Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
     return CreateBne(nullptr, input1, input2, trueBB, falseBB);
 }
 
-InstructionBne* IRBuilder::CreateBne(BasicBlock* parentBasicBlock) {
+InstructionBne* IRContext::CreateBne(BasicBlock* parentBasicBlock) {
     return CreateBne(parentBasicBlock, nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionBne* IRBuilder::CreateBne(BasicBlock* parentBasicBlock, Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionBne* inst = new InstructionBne(id, input1, input2, trueBB, falseBB);
+InstructionBne* IRContext::CreateBne(BasicBlock* parentBasicBlock, Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
+    InstructionBne* inst = NewInstruction<InstructionBne>(input1, input2, trueBB, falseBB);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
         if (trueBB != nullptr) {
@@ -549,32 +442,24 @@ InstructionBne* IRBuilder::CreateBne(BasicBlock* parentBasicBlock, Value* input1
             falseBB->AddPredecessor(parentBasicBlock);
         }
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionBgt* IRBuilder::CreateBgt() {
+InstructionBgt* IRContext::CreateBgt() {
     return CreateBgt(nullptr, nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionBgt* IRBuilder::CreateBgt(Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
+InstructionBgt* IRContext::CreateBgt(Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
     return CreateBgt(nullptr, input1, input2, trueBB, falseBB);
 }
 
-InstructionBgt* IRBuilder::CreateBgt(BasicBlock* parentBasicBlock) {
+InstructionBgt* IRContext::CreateBgt(BasicBlock* parentBasicBlock) {
     return CreateBgt(parentBasicBlock, nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionBgt* IRBuilder::CreateBgt(BasicBlock* parentBasicBlock, Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionBgt* inst = new InstructionBgt(id, input1, input2, trueBB, falseBB);
+InstructionBgt* IRContext::CreateBgt(BasicBlock* parentBasicBlock, Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
+    InstructionBgt* inst = NewInstruction<InstructionBgt>(input1, input2, trueBB, falseBB);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
         if (trueBB != nullptr) {
@@ -586,32 +471,24 @@ InstructionBgt* IRBuilder::CreateBgt(BasicBlock* parentBasicBlock, Value* input1
             falseBB->AddPredecessor(parentBasicBlock);
         }
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionBlt* IRBuilder::CreateBlt() {
+InstructionBlt* IRContext::CreateBlt() {
     return CreateBlt(nullptr, nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionBlt* IRBuilder::CreateBlt(Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
+InstructionBlt* IRContext::CreateBlt(Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
     return CreateBlt(nullptr, input1, input2, trueBB, falseBB);
 }
 
-InstructionBlt* IRBuilder::CreateBlt(BasicBlock* parentBasicBlock) {
+InstructionBlt* IRContext::CreateBlt(BasicBlock* parentBasicBlock) {
     return CreateBlt(parentBasicBlock, nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionBlt* IRBuilder::CreateBlt(BasicBlock* parentBasicBlock, Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionBlt* inst = new InstructionBlt(id, input1, input2, trueBB, falseBB);
+InstructionBlt* IRContext::CreateBlt(BasicBlock* parentBasicBlock, Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
+    InstructionBlt* inst = NewInstruction<InstructionBlt>(input1, input2, trueBB, falseBB);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
         if (trueBB != nullptr) {
@@ -623,32 +500,24 @@ InstructionBlt* IRBuilder::CreateBlt(BasicBlock* parentBasicBlock, Value* input1
             falseBB->AddPredecessor(parentBasicBlock);
         }
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionBge* IRBuilder::CreateBge() {
+InstructionBge* IRContext::CreateBge() {
     return CreateBge(nullptr, nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionBge* IRBuilder::CreateBge(Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
+InstructionBge* IRContext::CreateBge(Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
     return CreateBge(nullptr, input1, input2, trueBB, falseBB);
 }
 
-InstructionBge* IRBuilder::CreateBge(BasicBlock* parentBasicBlock) {
+InstructionBge* IRContext::CreateBge(BasicBlock* parentBasicBlock) {
     return CreateBge(parentBasicBlock, nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionBge* IRBuilder::CreateBge(BasicBlock* parentBasicBlock, Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionBge* inst = new InstructionBge(id, input1, input2, trueBB, falseBB);
+InstructionBge* IRContext::CreateBge(BasicBlock* parentBasicBlock, Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
+    InstructionBge* inst = NewInstruction<InstructionBge>(input1, input2, trueBB, falseBB);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
         if (trueBB != nullptr) {
@@ -660,32 +529,24 @@ InstructionBge* IRBuilder::CreateBge(BasicBlock* parentBasicBlock, Value* input1
             falseBB->AddPredecessor(parentBasicBlock);
         }
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionBle* IRBuilder::CreateBle() {
+InstructionBle* IRContext::CreateBle() {
     return CreateBle(nullptr, nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionBle* IRBuilder::CreateBle(Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
+InstructionBle* IRContext::CreateBle(Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
     return CreateBle(nullptr, input1, input2, trueBB, falseBB);
 }
 
-InstructionBle* IRBuilder::CreateBle(BasicBlock* parentBasicBlock) {
+InstructionBle* IRContext::CreateBle(BasicBlock* parentBasicBlock) {
     return CreateBle(parentBasicBlock, nullptr, nullptr, nullptr, nullptr);
 }
 
-InstructionBle* IRBuilder::CreateBle(BasicBlock* parentBasicBlock, Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionBle* inst = new InstructionBle(id, input1, input2, trueBB, falseBB);
+InstructionBle* IRContext::CreateBle(BasicBlock* parentBasicBlock, Value* input1, Value* input2, BasicBlock *trueBB, BasicBlock *falseBB) {
+    InstructionBle* inst = NewInstruction<InstructionBle>(input1, input2, trueBB, falseBB);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
         if (trueBB != nullptr) {
@@ -697,250 +558,294 @@ InstructionBle* IRBuilder::CreateBle(BasicBlock* parentBasicBlock, Value* input1
             falseBB->AddPredecessor(parentBasicBlock);
         }
     }
-    if (input1 != nullptr) {
-        input1->AddUser(inst);
-    }
-    if (input2 != nullptr) {
-        input2->AddUser(inst);
-    }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionCall* IRBuilder::CreateCall() {
+InstructionCall* IRContext::CreateCall() {
     return CreateCall(nullptr, nullptr, nullptr);
 }
 
-InstructionCall* IRBuilder::CreateCall(Function* function) {
+InstructionCall* IRContext::CreateCall(Function* function) {
     return CreateCall(nullptr, function, nullptr);
 }
 
-InstructionCall* IRBuilder::CreateCall(Function* function, Value* ret) {
+InstructionCall* IRContext::CreateCall(Function* function, Value* ret) {
     return CreateCall(nullptr, function, ret);
 }
 
-InstructionCall* IRBuilder::CreateCall(Function* function, const std::vector<Value*>& args) {
+InstructionCall* IRContext::CreateCall(Function* function, const std::vector<Value*>& args) {
     return CreateCall(nullptr, function, nullptr, args);
 }
 
-InstructionCall* IRBuilder::CreateCall(Function* function, Value* ret, const std::vector<Value*>& args) {
+InstructionCall* IRContext::CreateCall(Function* function, Value* ret, const std::vector<Value*>& args) {
     return CreateCall(nullptr, function, ret, args);
 }
 
-InstructionCall* IRBuilder::CreateCall(BasicBlock* parentBasicBlock) {
+InstructionCall* IRContext::CreateCall(BasicBlock* parentBasicBlock) {
     return CreateCall(parentBasicBlock, nullptr, nullptr);
 }
 
-InstructionCall* IRBuilder::CreateCall(BasicBlock* parentBasicBlock, Function* function) {
+InstructionCall* IRContext::CreateCall(BasicBlock* parentBasicBlock, Function* function) {
     return CreateCall(parentBasicBlock, function, nullptr);
 }
 
-InstructionCall* IRBuilder::CreateCall(BasicBlock* parentBasicBlock, Function* function, Value* ret) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionCall* inst = new InstructionCall(id, function, ret);
+InstructionCall* IRContext::CreateCall(BasicBlock* parentBasicBlock, Function* function, Value* ret) {
+    InstructionCall* inst = NewInstruction<InstructionCall>(function, ret);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
     if (ret != nullptr) {
         ret->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
-InstructionCall* IRBuilder::CreateCall(BasicBlock* parentBasicBlock, Function* function, const std::vector<Value*>& args) {
+InstructionCall* IRContext::CreateCall(BasicBlock* parentBasicBlock, Function* function, const std::vector<Value*>& args) {
     return CreateCall(parentBasicBlock, function, nullptr, args);
 }
 
-InstructionCall* IRBuilder::CreateCall(BasicBlock* parentBasicBlock, Function* function, Value* ret, const std::vector<Value*>& args) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionCall* inst = new InstructionCall(id, function, ret, args);
+InstructionCall* IRContext::CreateCall(BasicBlock* parentBasicBlock, Function* function, Value* ret, const std::vector<Value*>& args) {
+    const TrailingOperands trailing{static_cast<uint32_t>(args.size())};
+    InstructionCall* inst = NewInstructionWithExtraStorage<InstructionCall>(InstructionVariadic::GetTrailingSize(trailing), trailing, function, ret, args);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    for (auto* a : args) {
-        a->AddUser(inst);
-    }
     if (ret != nullptr) {
         ret->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionRet* IRBuilder::CreateRet() {
+InstructionRet* IRContext::CreateRet() {
     return CreateRet(nullptr, nullptr);
 }
 
-InstructionRet* IRBuilder::CreateRet(Value* returnValue) {
+InstructionRet* IRContext::CreateRet(Value* returnValue) {
     return CreateRet(nullptr, returnValue);
 }
 
-InstructionRet* IRBuilder::CreateRet(BasicBlock* parentBasicBlock) {
+InstructionRet* IRContext::CreateRet(BasicBlock* parentBasicBlock) {
     return CreateRet(parentBasicBlock, nullptr);
 }
 
-InstructionRet* IRBuilder::CreateRet(BasicBlock* parentBasicBlock, Value* returnValue) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionRet* inst = new InstructionRet(id, returnValue);
+InstructionRet* IRContext::CreateRet(BasicBlock* parentBasicBlock, Value* returnValue) {
+    InstructionRet* inst = NewInstruction<InstructionRet>(returnValue);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (returnValue != nullptr) {
-        returnValue->AddUser(inst);
-    }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionAlloc* IRBuilder::CreateAlloc() {
+InstructionAlloc* IRContext::CreateAlloc() {
     return CreateAlloc(nullptr, nullptr, ValueType::Unknown, 0);
 }
 
-InstructionAlloc* IRBuilder::CreateAlloc(Value* output, ValueType type, size_t count) {
+InstructionAlloc* IRContext::CreateAlloc(Value* output, ValueType type, size_t count) {
     return CreateAlloc(nullptr, output, type, count);
 }
 
-InstructionAlloc* IRBuilder::CreateAlloc(BasicBlock* parentBasicBlock) {
+InstructionAlloc* IRContext::CreateAlloc(BasicBlock* parentBasicBlock) {
     return CreateAlloc(parentBasicBlock, nullptr, ValueType::Unknown, 0);
 }
 
-InstructionAlloc* IRBuilder::CreateAlloc(BasicBlock* parentBasicBlock, Value* output, ValueType type, size_t count) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionAlloc* inst = new InstructionAlloc(id, output, type, count);
+InstructionAlloc* IRContext::CreateAlloc(BasicBlock* parentBasicBlock, Value* output, ValueType type, size_t count) {
+    InstructionAlloc* inst = NewInstruction<InstructionAlloc>(output, type, count);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionPhi* IRBuilder::CreatePhi() {
+InstructionPhi* IRContext::CreatePhi() {
     return CreatePhi(nullptr, {}, nullptr);
 }
 
-InstructionPhi* IRBuilder::CreatePhi(const std::list<Value*>& inputs, Value* output) {
+InstructionPhi* IRContext::CreatePhi(const std::vector<Value*>& inputs, Value* output) {
     return CreatePhi(nullptr, inputs, output);
 }
 
-InstructionPhi* IRBuilder::CreatePhi(BasicBlock* parentBasicBlock) {
+InstructionPhi* IRContext::CreatePhi(BasicBlock* parentBasicBlock) {
     return CreatePhi(parentBasicBlock, {}, nullptr);
 }
 
-InstructionPhi* IRBuilder::CreatePhi(BasicBlock* parentBasicBlock, const std::list<Value*>& inputs, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionPhi* inst = new InstructionPhi(id, inputs, output);
+InstructionPhi* IRContext::CreatePhi(BasicBlock* parentBasicBlock, const std::vector<Value*>& inputs, Value* output) {
+    return CreatePhi(parentBasicBlock, inputs, {}, output);
+}
+
+InstructionPhi* IRContext::CreatePhi(BasicBlock* parentBasicBlock, const std::vector<Value*>& inputs, const std::vector<BasicBlock*>& incomingBlocks, Value* output) {
+    const TrailingOperands trailing{static_cast<uint32_t>(inputs.size())};
+    InstructionPhi* inst = NewInstructionWithExtraStorage<InstructionPhi>(InstructionVariadic::GetTrailingSize(trailing), trailing, inputs, incomingBlocks, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
-    }
-    for (auto* i : inputs) {
-        i->AddUser(inst);
+        for (auto* pred : parentBasicBlock->GetPredecessors()) {
+            inst->AssignIncomingBlock(pred);
+        }
     }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionMv* IRBuilder::CreateMv() {
+InstructionMv* IRContext::CreateMv() {
     return CreateMv(nullptr, nullptr, nullptr);
 }
 
-InstructionMv* IRBuilder::CreateMv(Value* input, Value* output) {
+InstructionMv* IRContext::CreateMv(Value* input, Value* output) {
     return CreateMv(nullptr, input, output);
 }
 
-InstructionMv* IRBuilder::CreateMv(BasicBlock* parentBasicBlock) {
+InstructionMv* IRContext::CreateMv(BasicBlock* parentBasicBlock) {
     return CreateMv(parentBasicBlock, nullptr, nullptr);
 }
 
-InstructionMv* IRBuilder::CreateMv(BasicBlock* parentBasicBlock, Value* input, Value* output) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionMv* inst = new InstructionMv(id, input, output);
+InstructionMv* IRContext::CreateMv(BasicBlock* parentBasicBlock, Value* input, Value* output) {
+    InstructionMv* inst = NewInstruction<InstructionMv>(input, output);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input != nullptr) {
-        input->AddUser(inst);
-    }
     if (output != nullptr) {
         output->SetProducer(inst);
     }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionNullCheck* IRBuilder::CreateNullCheck() {
+InstructionNullCheck* IRContext::CreateNullCheck() {
     return CreateNullCheck(nullptr, nullptr);
 }
 
-InstructionNullCheck* IRBuilder::CreateNullCheck(Value* input) {
+InstructionNullCheck* IRContext::CreateNullCheck(Value* input) {
     return CreateNullCheck(nullptr, input);
 }
 
-InstructionNullCheck* IRBuilder::CreateNullCheck(BasicBlock* parentBasicBlock) {
+InstructionNullCheck* IRContext::CreateNullCheck(BasicBlock* parentBasicBlock) {
     return CreateNullCheck(parentBasicBlock, nullptr);
 }
 
-InstructionNullCheck* IRBuilder::CreateNullCheck(BasicBlock* parentBasicBlock, Value* input) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionNullCheck* inst = new InstructionNullCheck(id, input);
+InstructionNullCheck* IRContext::CreateNullCheck(BasicBlock* parentBasicBlock, Value* input) {
+    InstructionNullCheck* inst = NewInstruction<InstructionNullCheck>(input);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (input != nullptr) {
-        input->AddUser(inst);
-    }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-InstructionBoundsCheck* IRBuilder::CreateBoundsCheck() {
+InstructionBoundsCheck* IRContext::CreateBoundsCheck() {
     return CreateBoundsCheck(nullptr, nullptr, nullptr);
 }
 
-InstructionBoundsCheck* IRBuilder::CreateBoundsCheck(Value* inputPtr, Value* inputArray) {
+InstructionBoundsCheck* IRContext::CreateBoundsCheck(Value* inputPtr, Value* inputArray) {
     return CreateBoundsCheck(nullptr, inputPtr, inputArray);
 }
 
-InstructionBoundsCheck* IRBuilder::CreateBoundsCheck(BasicBlock* parentBasicBlock) {
+InstructionBoundsCheck* IRContext::CreateBoundsCheck(BasicBlock* parentBasicBlock) {
     return CreateBoundsCheck(parentBasicBlock, nullptr, nullptr);
 }
 
-InstructionBoundsCheck* IRBuilder::CreateBoundsCheck(BasicBlock* parentBasicBlock, Value* inputPtr, Value* inputArray) {
-    InstructionId id = GenerateNewInstructionId();
-    InstructionBoundsCheck* inst = new InstructionBoundsCheck(id, inputPtr, inputArray);
+InstructionBoundsCheck* IRContext::CreateBoundsCheck(BasicBlock* parentBasicBlock, Value* inputPtr, Value* inputArray) {
+    InstructionBoundsCheck* inst = NewInstruction<InstructionBoundsCheck>(inputPtr, inputArray);
     if (parentBasicBlock != nullptr) {
         parentBasicBlock->AppendInstruction(inst);
     }
-    if (inputPtr != nullptr) {
-        inputPtr->AddUser(inst);
-    }
-    if (inputArray != nullptr) {
-        inputArray->AddUser(inst);
-    }
-    mInstructions.insert({id, inst});
     return inst;
 }
 
 
-IRBuilder::~IRBuilder() {
+IRContext::~IRContext() {
     Cleanup();
 }
 
 
-Value* IRBuilder::CopyValue(Value* src) {
+void IRContext::ForgetConstant(Value* value) {
+    auto it = mConstantPool.find(ConstantKey{value->GetValueType(), value->GetBitPattern()});
+    if (it != mConstantPool.end() && it->second == value) {
+        mConstantPool.erase(it);
+    }
+}
+
+
+static size_t GetInstructionObjectSize(const Instruction* inst) {
+    switch (inst->GetType()) {
+        default:
+        case InstructionType::Unknown:      return sizeof(Instruction);
+        case InstructionType::Add:          return sizeof(InstructionAdd);
+        case InstructionType::Sub:          return sizeof(InstructionSub);
+        case InstructionType::Mul:          return sizeof(InstructionMul);
+        case InstructionType::Div:          return sizeof(InstructionDiv);
+        case InstructionType::Rem:          return sizeof(InstructionRem);
+        case InstructionType::And:          return sizeof(InstructionAnd);
+        case InstructionType::Or:           return sizeof(InstructionOr);
+        case InstructionType::Xor:          return sizeof(InstructionXor);
+        case InstructionType::Shl:          return sizeof(InstructionShl);
+        case InstructionType::Shr:          return sizeof(InstructionShr);
+        case InstructionType::Ashr:         return sizeof(InstructionAshr);
+        case InstructionType::Load:         return sizeof(InstructionLoad);
+        case InstructionType::Store:        return sizeof(InstructionStore);
+        case InstructionType::Jump:         return sizeof(InstructionJump);
+        case InstructionType::Beq:          return sizeof(InstructionBeq);
+        case InstructionType::Bne:          return sizeof(InstructionBne);
+        case InstructionType::Bgt:          return sizeof(InstructionBgt);
+        case InstructionType::Blt:          return sizeof(InstructionBlt);
+        case InstructionType::Bge:          return sizeof(InstructionBge);
+        case InstructionType::Ble:          return sizeof(InstructionBle);
+        case InstructionType::Call:         return sizeof(InstructionCall) + InstructionVariadic::GetTrailingSize(static_cast<const InstructionCall*>(inst)->GetTrailingOperands());
+        case InstructionType::Ret:          return sizeof(InstructionRet);
+        case InstructionType::Alloc:        return sizeof(InstructionAlloc);
+        case InstructionType::Phi:          return sizeof(InstructionPhi) + InstructionVariadic::GetTrailingSize(static_cast<const InstructionPhi*>(inst)->GetTrailingOperands());
+        case InstructionType::Mv:           return sizeof(InstructionMv);
+        case InstructionType::NullCheck:    return sizeof(InstructionNullCheck);
+        case InstructionType::BoundsCheck:  return sizeof(InstructionBoundsCheck);
+    }
+}
+
+void IRContext::DestroyInstruction(Instruction* inst) {
+    // Type must be taken before the destructor runs
+    const size_t size = GetInstructionObjectSize(inst);
+    inst->~Instruction();
+    mArena.Deallocate(inst, size);
+}
+
+
+void IRContext::InvalidateAnalyses(Function* function, const PreservedAnalyses& preserved) {
+    std::lock_guard lock{mMutex};
+
+    auto graphIt = mGraphs.find(function);
+    if (graphIt == mGraphs.end()) {
+        return;
+    }
+    ControlFlowGraph* cfg = graphIt->second;
+
+    // Dependent analyses go first, while the graph still has the old blocks
+    if (!preserved.IsPreserved(AnalysisKind::Liveness)) {
+        if (auto it = mLivenessAnalyzers.find(cfg); it != mLivenessAnalyzers.end()) {
+            it->second->Invalidate();
+        }
+    }
+    if (!preserved.IsPreserved(AnalysisKind::LoopTree)) {
+        if (auto it = mLoopAnalyzers.find(cfg); it != mLoopAnalyzers.end()) {
+            it->second->Invalidate();
+        }
+    }
+    if (!preserved.IsPreserved(AnalysisKind::ControlFlowGraph)) {
+        cfg->Refresh();
+    }
+    else if (!preserved.IsPreserved(AnalysisKind::DominatorTree)) {
+        cfg->InvalidateDominatorTree();
+    }
+}
+
+
+Value* IRContext::CopyValue(Value* src) {
     if (!src) {
         return nullptr;
     }
@@ -954,7 +859,7 @@ Value* IRBuilder::CopyValue(Value* src) {
 }
 
 
-Instruction* IRBuilder::CopyInstruction(Instruction* src) {
+Instruction* IRContext::CopyInstruction(Instruction* src) {
     if (!src) {
         return nullptr;
     }
@@ -982,10 +887,10 @@ Instruction* IRBuilder::CopyInstruction(Instruction* src) {
         case InstructionType::Blt:          return CreateBlt();
         case InstructionType::Bge:          return CreateBge();
         case InstructionType::Ble:          return CreateBle();
-        case InstructionType::Call:         return CreateCall();
+        case InstructionType::Call:         return CreateCall(nullptr, nullptr, nullptr, std::vector<Value*>(src->NumOperands(), nullptr));
         case InstructionType::Ret:          return CreateRet();
         case InstructionType::Alloc:        return CreateAlloc();
-        case InstructionType::Phi:          return CreatePhi();
+        case InstructionType::Phi:          return CreatePhi(nullptr, std::vector<Value*>(src->NumOperands(), nullptr), nullptr);
         case InstructionType::Mv:           return CreateMv();
         case InstructionType::NullCheck:    return CreateNullCheck();
         case InstructionType::BoundsCheck:  return CreateBoundsCheck();
@@ -993,7 +898,7 @@ Instruction* IRBuilder::CopyInstruction(Instruction* src) {
 }
 
 
-BasicBlock* IRBuilder::CopyBasicBlock(BasicBlock* src) {
+BasicBlock* IRContext::CopyBasicBlock(BasicBlock* src) {
     if (!src) {
         return nullptr;
     }
@@ -1003,7 +908,7 @@ BasicBlock* IRBuilder::CopyBasicBlock(BasicBlock* src) {
 }
 
 
-Function* IRBuilder::CopyFunction(Function* src) {
+Function* IRContext::CopyFunction(Function* src) {
     if (!src) {
         return nullptr;
     }
@@ -1095,8 +1000,6 @@ Function* IRBuilder::CopyFunction(Function* src) {
                 dstArith->SetInput2(dstInput2);
                 dstArith->SetOutput(dstOutput);
 
-                dstInput1->AddUser(dstArith);
-                dstInput2->AddUser(dstArith);
                 dstOutput->SetProducer(dstArith);
             }
             else if (srcInst->GetType() == InstructionType::Load) {
@@ -1112,7 +1015,6 @@ Function* IRBuilder::CopyFunction(Function* src) {
                 dstLoad->SetLoadPtr(dstLoadPtr);
                 dstLoad->SetOutput(dstOutput);
 
-                dstLoadPtr->AddUser(dstLoad);
                 dstOutput->SetProducer(dstLoad);
             }
             else if (srcInst->GetType() == InstructionType::Store) {
@@ -1127,9 +1029,6 @@ Function* IRBuilder::CopyFunction(Function* src) {
 
                 dstStore->SetStorePtr(dstStorePtr);
                 dstStore->SetInput(dstInput);
-
-                dstStorePtr->AddUser(dstStore);
-                dstInput->AddUser(dstStore);
             }
             else if (srcInst->GetType() == InstructionType::Jump) {
                 InstructionJump* srcJump = static_cast<InstructionJump*>(srcInst);
@@ -1153,10 +1052,6 @@ Function* IRBuilder::CopyFunction(Function* src) {
                 dstBranch->SetInput1(dstInput1);
                 dstBranch->SetInput2(dstInput2);
 
-                dstInput1->AddUser(dstBranch);
-                dstInput2->AddUser(dstBranch);
-
-
                 BasicBlock* srcTrueBasicBlock  = srcBranch->GetTrueBasicBlock();
                 BasicBlock* srcFalseBasicBlock = srcBranch->GetFalseBasicBlock();
 
@@ -1180,13 +1075,10 @@ Function* IRBuilder::CopyFunction(Function* src) {
                     dstReturnValue->SetProducer(dstCall);
                 }
 
+                // Copy is created with the same number of arguments
                 const auto& srcArgs = srcCall->GetArguments();
                 for (size_t i = 0; i < srcArgs.size(); ++i) {
-                    Value* srcArg = srcArgs[i];
-                    Value* dstArg = GetOrCopyValue(srcArg);
-
-                    dstCall->SetArgument(i, dstArg);
-                    dstArg->AddUser(dstCall);
+                    dstCall->SetArgument(i, GetOrCopyValue(srcArgs[i]));
                 }
             }
             else if (srcInst->GetType() == InstructionType::Ret) {
@@ -1197,7 +1089,6 @@ Function* IRBuilder::CopyFunction(Function* src) {
                 if (srcReturnValue) {
                     Value* dstReturnValue = GetOrCopyValue(srcReturnValue);
                     dstRet->SetReturnValue(dstReturnValue);
-                    dstReturnValue->AddUser(dstRet);
                 }
             }
             else if (srcInst->GetType() == InstructionType::Phi) {
@@ -1210,11 +1101,11 @@ Function* IRBuilder::CopyFunction(Function* src) {
                 dstPhi->SetOutput(dstOutput);
                 dstOutput->SetProducer(dstPhi);
 
-                for (Value* srcInput : srcPhi->GetInputs()) {
-                    Value* dstInput = GetOrCopyValue(srcInput);
-
-                    dstPhi->AddInput(dstInput);
-                    dstInput->AddUser(dstPhi);
+                const auto& srcInputs = srcPhi->GetInputs();
+                for (size_t i = 0; i < srcInputs.size(); ++i) {
+                    dstPhi->SetOperand(i, GetOrCopyValue(srcInputs[i]));
+                    BasicBlock* srcIncoming = srcPhi->GetIncomingBlock(i);
+                    dstPhi->SetIncomingBlock(i, srcIncoming != nullptr ? basicBlocksMap[srcIncoming] : nullptr);
                 }
             }
             else if (srcInst->GetType() == InstructionType::Mv) {
@@ -1230,7 +1121,6 @@ Function* IRBuilder::CopyFunction(Function* src) {
                 dstMv->SetInput(dstInput);
                 dstMv->SetOutput(dstOutput);
 
-                dstInput->AddUser(dstMv);
                 dstOutput->SetProducer(dstMv);
             }
             else if (srcInst->GetType() == InstructionType::NullCheck) {
@@ -1241,7 +1131,6 @@ Function* IRBuilder::CopyFunction(Function* src) {
                 Value* dstInput = GetOrCopyValue(srcInput);
 
                 dstNullCheck->SetInput(dstInput);
-                dstInput->AddUser(dstNullCheck);
             }
             else if (srcInst->GetType() == InstructionType::BoundsCheck) {
                 InstructionBoundsCheck* srcBoundsCheck = static_cast<InstructionBoundsCheck*>(srcInst);
@@ -1255,9 +1144,6 @@ Function* IRBuilder::CopyFunction(Function* src) {
 
                 dstBoundsCheck->SetInputPtr(dstInputPtr);
                 dstBoundsCheck->SetInputArray(dstInputArray);
-
-                dstInputPtr->AddUser(dstBoundsCheck);
-                dstInputArray->AddUser(dstBoundsCheck);
             }
 
             srcInst = srcInst->GetNext();
@@ -1268,7 +1154,7 @@ Function* IRBuilder::CopyFunction(Function* src) {
 }
 
 
-bool IRBuilder::CompareFunctions(Function* lhs, Function* rhs) const {
+bool IRContext::CompareFunctions(Function* lhs, Function* rhs) const {
     if (!lhs || !rhs) {
         return false;
     }
@@ -1388,11 +1274,8 @@ bool IRBuilder::CompareFunctions(Function* lhs, Function* rhs) const {
                 }
             }
 
-            std::vector<Value*> lhsInputs{};
-            std::vector<Value*> rhsInputs{};
-            lhsInst->PopulateInputs(lhsInputs);
-            rhsInst->PopulateInputs(rhsInputs);
-
+            const auto& lhsInputs = lhsInst->operands();
+            const auto& rhsInputs = rhsInst->operands();
             if (lhsInputs.size() != rhsInputs.size()) {
                 return false;
             }
@@ -1456,7 +1339,7 @@ bool IRBuilder::CompareFunctions(Function* lhs, Function* rhs) const {
             if (lhsUserBB->GetParentFunction() != lhs) {
                 continue;
             }
-            if (!rhsUsers.contains(instructionMap[lhsUser])) {
+            if (!rhsValue->HasUser(instructionMap[lhsUser])) {
                 return false;
             }
         }
@@ -1466,17 +1349,17 @@ bool IRBuilder::CompareFunctions(Function* lhs, Function* rhs) const {
 }
 
 
-void IRBuilder::PrintIR(std::ostream& out) {
-    for (auto* f : mFunctions) {
-        f->Print(out);
-        out << "\n\n";
-    }
+void IRContext::PrintIR(std::ostream& out) {
+    IRPrinter printer{};
+    printer.PrintIR(this, out);
 }
 
-void IRBuilder::PrintDebug(std::ostream& out) {
+void IRContext::PrintDebug(std::ostream& out) {
     out << "Constants:\n";
-    for (const auto& pair : mValuesWithData) {
-        auto* v = pair.second;
+    for (auto* v : mValuesWithData) {
+        if (!v) {
+            continue;
+        }
         out << "    " << v->GetValueStr() << "\n";
     }
     out << "\n\n";
@@ -1493,8 +1376,10 @@ void IRBuilder::PrintDebug(std::ostream& out) {
         out << "]\n\n";
 
         out << "    Predecessors:\n";
-        for (const auto& pair : mBasicBlocks) {
-            auto* bb = pair.second;
+        for (auto* bb : mBasicBlocks) {
+            if (!bb) {
+                continue;
+            }
             if (bb->GetParentFunction() != f) {
                 continue;
             }
@@ -1506,8 +1391,10 @@ void IRBuilder::PrintDebug(std::ostream& out) {
         out << "\n";
 
         out << "    Successors:\n";
-        for (const auto& pair : mBasicBlocks) {
-            auto* bb = pair.second;
+        for (auto* bb : mBasicBlocks) {
+            if (!bb) {
+                continue;
+            }
             if (bb->GetParentFunction() != f) {
                 continue;
             }
@@ -1519,8 +1406,10 @@ void IRBuilder::PrintDebug(std::ostream& out) {
         out << "\n";
 
         out << "    Users:\n";
-        for (const auto& pair : mValuesWithData) {
-            auto* v = pair.second;
+        for (auto* v : mValuesWithData) {
+            if (!v) {
+                continue;
+            }
             for (auto* u : v->GetUsers()) {
                 BasicBlock* bb = u->GetParentBasicBlock();
                 if (!bb || bb->GetParentFunction() != f) {
@@ -1530,8 +1419,10 @@ void IRBuilder::PrintDebug(std::ostream& out) {
             }
 
         }
-        for (const auto& pair : mValues) {
-            auto* v = pair.second;
+        for (auto* v : mValues) {
+            if (!v) {
+                continue;
+            }
             for (auto* u : v->GetUsers()) {
                 BasicBlock* bb = u->GetParentBasicBlock();
                 if (!bb || bb->GetParentFunction() != f) {
@@ -1544,8 +1435,10 @@ void IRBuilder::PrintDebug(std::ostream& out) {
         out << "\n";
 
         out << "    Producers:\n";
-        for (const auto& pair : mValues) {
-            auto* v = pair.second;
+        for (auto* v : mValues) {
+            if (!v) {
+                continue;
+            }
             if (auto it = std::find(args.begin(), args.end(), v); it != args.end()) {
                 size_t argNo = std::distance(args.begin(), it);
                 out << "        " << v->GetValueStr() << " -> [Arg#" << argNo << "]\n";
@@ -1579,14 +1472,25 @@ void IRBuilder::PrintDebug(std::ostream& out) {
         }
         out << "\n";
 
+        // Every block dominates its whole subtree in the dominator tree
+        std::vector<BasicBlock*> subtree{};
         for (auto* bb : graph->GetBasicBlocks()) {
-            auto& allDominated = bb->GetDominatedBasicBlocks();
+            if (bb != graph->GetEntryBasicBlock() && bb->GetImmediateDominator() == nullptr) {
+                out << "        " << bb->GetName() << " >> []\n";
+                continue;
+            }
+
             out << "        " << bb->GetName() << " >> [";
-            for (auto it = allDominated.begin(), end = allDominated.end(); it != end; ++it) {
-                if (it != allDominated.begin()) {
-                    out << ", ";
-                }
-                out << (*it)->GetName();
+            subtree.push_back(bb);
+            bool first = true;
+            while (!subtree.empty()) {
+                BasicBlock* dominated = subtree.back();
+                subtree.pop_back();
+                out << (first ? "" : ", ") << dominated->GetName();
+                first = false;
+
+                const auto& children = dominated->GetDominatorTreeChildren();
+                subtree.insert(subtree.end(), children.begin(), children.end());
             }
             out << "]\n";
         }
@@ -1616,8 +1520,10 @@ void IRBuilder::PrintDebug(std::ostream& out) {
         out << "\n";
 
         out << "        Live intervals:\n";
-        for (const auto& pair : mValues) {
-            auto* v = pair.second;
+        for (auto* v : mValues) {
+            if (!v) {
+                continue;
+            }
             auto it = std::find(args.begin(), args.end(), v);
             if (it == args.end()) {
                 Instruction* prod = v->GetProducer();
@@ -1639,8 +1545,10 @@ void IRBuilder::PrintDebug(std::ostream& out) {
             RegisterAllocator* registerAllocator = it->second;
 
             out << "    Register Allocation (GPR = " << registerAllocator->GetGPRegisterCount() << ", FPR = " << registerAllocator->GetFPRegisterCount() << "):\n";
-            for (const auto& pair : mValues) {
-                auto* v = pair.second;
+            for (auto* v : mValues) {
+                if (!v) {
+                    continue;
+                }
 
                 // TODO: function argument values. Should I account for function argument values? Or their locations are assured by calling convention?
                 Instruction* prod = v->GetProducer();
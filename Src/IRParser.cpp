@@ -0,0 +1,815 @@
+#include <IRParser.h>
+#include <IRBuilder.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <iterator>
+
+namespace VMIR {
+
+// Everything except whitespace and punctuation of the format belongs to a word
+static constexpr std::array<bool, 256> kWordChars = []() {
+    std::array<bool, 256> table{};
+    for (size_t c = 0x21; c < 0x7F; ++c) {
+        table[c] = true;
+    }
+    for (unsigned char c : std::string_view{",()[]:?#={}"}) {
+        table[c] = false;
+    }
+    for (size_t c = 0x80; c < table.size(); ++c) {
+        table[c] = true;
+    }
+    return table;
+}();
+
+static inline bool IsWordChar(char c) {
+    return kWordChars[static_cast<unsigned char>(c)];
+}
+
+static InstructionType ParseInstructionType(std::string_view word) {
+    if (word.empty()) {
+        return InstructionType::Unknown;
+    }
+
+    auto match = [word](InstructionType type) {
+        return word == InstructionTypeToStr(type) ? type : InstructionType::Unknown;
+    };
+
+    switch (word[0]) {
+        default:    return InstructionType::Unknown;
+        case 'A': {
+            if (word.size() == 3) {
+                InstructionType type = match(InstructionType::Add);
+                return type != InstructionType::Unknown ? type : match(InstructionType::And);
+            }
+            return word.size() == 4 ? match(InstructionType::Ashr) : match(InstructionType::Alloc);
+        }
+        case 'S': {
+            if (word.size() == 3) {
+                InstructionType type = match(InstructionType::Sub);
+                if (type == InstructionType::Unknown) {
+                    type = match(InstructionType::Shl);
+                }
+                return type != InstructionType::Unknown ? type : match(InstructionType::Shr);
+            }
+            return match(InstructionType::Store);
+        }
+        case 'M':   return word.size() == 3 ? match(InstructionType::Mul) : match(InstructionType::Mv);
+        case 'D':   return match(InstructionType::Div);
+        case 'R': {
+            const InstructionType type = match(InstructionType::Rem);
+            return type != InstructionType::Unknown ? type : match(InstructionType::Ret);
+        }
+        case 'O':   return match(InstructionType::Or);
+        case 'X':   return match(InstructionType::Xor);
+        case 'L':   return match(InstructionType::Load);
+        case 'J':   return match(InstructionType::Jump);
+        case 'C':   return match(InstructionType::Call);
+        case 'P':   return match(InstructionType::Phi);
+        case 'N':   return match(InstructionType::NullCheck);
+        case 'B': {
+            if (word.size() == 11) {
+                return match(InstructionType::BoundsCheck);
+            }
+            for (auto type : {InstructionType::Beq, InstructionType::Bne, InstructionType::Bgt, InstructionType::Blt, InstructionType::Bge, InstructionType::Ble}) {
+                if (word == InstructionTypeToStr(type)) {
+                    return type;
+                }
+            }
+            return InstructionType::Unknown;
+        }
+    }
+}
+
+static bool IsArithmetic(InstructionType type) {
+    return type >= InstructionType::Add && type <= InstructionType::Ashr;
+}
+
+static bool IsBranch(InstructionType type) {
+    return type >= InstructionType::Beq && type <= InstructionType::Ble;
+}
+
+
+bool IRParser::ParseFile(const std::string& filename) {
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    if (!in) {
+        mError = "cannot open " + filename;
+        return false;
+    }
+
+    in.seekg(0, std::ios::end);
+    std::string text(static_cast<size_t>(in.tellg()), '\0');
+    in.seekg(0, std::ios::beg);
+    in.read(text.data(), static_cast<std::streamsize>(text.size()));
+    return Parse(text);
+}
+
+bool IRParser::Parse(std::string_view text) {
+    mText = text;
+    mPos = 0;
+    mError.clear();
+
+    for (auto* func : mContext->GetFunctions()) {
+        mFunctionsByName.try_emplace(func->GetName(), func);
+    }
+
+    bool ok = true;
+    while (ok) {
+        SkipSpace();
+        if (mPos == mText.size()) {
+            break;
+        }
+        ok = ParseFunction();
+    }
+
+    // Names of blocks point into the text, which may not outlive this call
+    mBasicBlocks.clear();
+    mPredecessorNames.clear();
+    mText = {};
+    return ok;
+}
+
+
+bool IRParser::Error(const std::string& message) {
+    if (!mError.empty()) {
+        return false;
+    }
+
+    // Position is only needed for errors, so lines are not counted while parsing
+    const size_t pos = std::min(mPos, mText.size());
+    const size_t line = 1 + static_cast<size_t>(std::count(mText.begin(), mText.begin() + static_cast<std::ptrdiff_t>(pos), '\n'));
+    const size_t lineStart = mText.rfind('\n', pos == 0 ? 0 : pos - 1);
+    const size_t column = lineStart == std::string_view::npos || pos == 0 ? pos + 1 : pos - lineStart;
+    mError = std::to_string(line) + ":" + std::to_string(column) + ": " + message;
+    return false;
+}
+
+void IRParser::SkipSpace() {
+    while (mPos < mText.size()) {
+        const char c = mText[mPos];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            ++mPos;
+        }
+        else if (c == '/' && mPos + 1 < mText.size() && mText[mPos + 1] == '/') {
+            while (mPos < mText.size() && mText[mPos] != '\n') {
+                ++mPos;
+            }
+        }
+        else {
+            break;
+        }
+    }
+}
+
+void IRParser::SkipInlineSpace() {
+    while (mPos < mText.size() && (mText[mPos] == ' ' || mText[mPos] == '\t' || mText[mPos] == '\r')) {
+        ++mPos;
+    }
+}
+
+bool IRParser::IsAtLineEnd() {
+    SkipInlineSpace();
+    return mPos == mText.size() || mText[mPos] == '\n' || mText[mPos] == '}' || mText[mPos] == '/';
+}
+
+bool IRParser::Consume(char c) {
+    SkipSpace();
+    if (mPos < mText.size() && mText[mPos] == c) {
+        ++mPos;
+        return true;
+    }
+    return false;
+}
+
+bool IRParser::Expect(char c) {
+    if (Consume(c)) {
+        return true;
+    }
+    return Error(std::string("expected '") + c + "'");
+}
+
+std::string_view IRParser::ReadWord() {
+    SkipSpace();
+    const size_t begin = mPos;
+    while (mPos < mText.size() && IsWordChar(mText[mPos])) {
+        ++mPos;
+    }
+    return mText.substr(begin, mPos - begin);
+}
+
+bool IRParser::ParseType(ValueType& type) {
+    const std::string_view word = ReadWord();
+    for (uint8_t vt = static_cast<uint8_t>(ValueType::Void); vt < static_cast<uint8_t>(ValueType::Unknown); ++vt) {
+        if (word == ValueTypeToIdStr(static_cast<ValueType>(vt))) {
+            type = static_cast<ValueType>(vt);
+            return true;
+        }
+    }
+    return Error("expected type, got '" + std::string(word) + "'");
+}
+
+
+bool IRParser::ParseFunction() {
+    if (ReadWord() != "function") {
+        return Error("expected 'function'");
+    }
+
+    ValueType retType{};
+    if (!ParseType(retType) || !Expect('#')) {
+        return false;
+    }
+    const std::string name{ReadWord()};
+    if (name.empty()) {
+        return Error("expected function name");
+    }
+
+    // Argument names are bound after the function is found or created
+    std::vector<std::string_view> argNames{};
+    mTypes.clear();
+    if (!Expect('(')) {
+        return false;
+    }
+    if (!Consume(')')) {
+        do {
+            ValueType argType{};
+            if (!ParseType(argType)) {
+                return false;
+            }
+            mTypes.push_back(argType);
+            argNames.push_back(ReadWord());
+        } while (Consume(','));
+
+        if (!Expect(')')) {
+            return false;
+        }
+    }
+
+    Function* func = nullptr;
+    if (auto it = mFunctionsByName.find(name); it != mFunctionsByName.end()) {
+        // Declared by a call above or created before parsing
+        func = it->second;
+        if (func->Size() != 0) {
+            return Error("redefinition of function #" + name);
+        }
+        if (func->GetReturnType() != retType || func->GetArgs().size() != mTypes.size()) {
+            return Error("definition of #" + name + " does not match its calls");
+        }
+        for (size_t i = 0; i < mTypes.size(); ++i) {
+            if (func->GetArg(i)->GetValueType() != mTypes[i]) {
+                return Error("definition of #" + name + " does not match its calls");
+            }
+        }
+        mContext->MoveFunctionToBack(func);
+    }
+    else {
+        func = mContext->CreateFunction(retType, mTypes, name);
+        mFunctionsByName.emplace(name, func);
+    }
+    mFunctions.push_back(func);
+
+    mFunction = func;
+    mBasicBlock = nullptr;
+    ++mEpoch;
+    mForwardReferences = 0;
+    mBasicBlocks.clear();
+    mPredecessorLists.clear();
+    mPredecessorNames.clear();
+
+    for (size_t i = 0; i < argNames.size(); ++i) {
+        if (!DefineValue(argNames[i], func->GetArg(i))) {
+            return false;
+        }
+    }
+
+    if (!Expect('{')) {
+        return false;
+    }
+
+    while (true) {
+        if (Consume('}')) {
+            return FinishFunction();
+        }
+        if (mPos == mText.size()) {
+            return Error("expected '}'");
+        }
+
+        const std::string_view word = ReadWord();
+        if (word.empty()) {
+            return Error("unexpected character");
+        }
+
+        SkipInlineSpace();
+        const bool ok = mPos < mText.size() && mText[mPos] == ':' ? ParseBasicBlockHeader(word) : ParseInstruction(word);
+        if (!ok) {
+            return false;
+        }
+    }
+}
+
+bool IRParser::ParseBasicBlockHeader(std::string_view name) {
+    ++mPos;     // ':'
+
+    BasicBlock* bb = GetBasicBlock(name);
+    BasicBlockSlot& slot = mBasicBlocks[name];
+    if (slot.isDefined) {
+        return Error("redefinition of basic block " + std::string(name));
+    }
+    slot.isDefined = true;
+
+    mFunction->AppendBasicBlock(bb);
+    if (mFunction->GetEntryBasicBlock() == nullptr) {
+        mFunction->SetEntryBasicBlock(bb);
+    }
+    mBasicBlock = bb;
+
+    // Builder adds predecessors in order of the branches, but phi inputs follow the printed order
+    if (!IsAtLineEnd() && mText[mPos] == '(') {
+        ++mPos;
+        if (ReadWord() != "preds" || !Expect(':')) {
+            return Error("expected 'preds:'");
+        }
+
+        PredecessorList list{bb, static_cast<uint32_t>(mPredecessorNames.size()), 0};
+        do {
+            const std::string_view pred = ReadWord();
+            if (pred.empty()) {
+                return Error("expected basic block name");
+            }
+            mPredecessorNames.push_back(pred);
+        } while (Consume(','));
+
+        if (!Expect(')')) {
+            return false;
+        }
+        list.end = static_cast<uint32_t>(mPredecessorNames.size());
+        mPredecessorLists.push_back(list);
+    }
+    return true;
+}
+
+bool IRParser::ParseInstruction(std::string_view first) {
+    if (mBasicBlock == nullptr) {
+        return Error("instruction outside of a basic block");
+    }
+
+    std::string_view outputName{};
+    std::string_view opcode = first;
+    if (mPos < mText.size() && mText[mPos] == '=') {
+        ++mPos;
+        outputName = first;
+        opcode = ReadWord();
+    }
+
+    const InstructionType type = ParseInstructionType(opcode);
+    if (type == InstructionType::Unknown) {
+        return Error("unknown instruction '" + std::string(opcode) + "'");
+    }
+
+    const bool hasOutput = IsArithmetic(type) || type == InstructionType::Load || type == InstructionType::Alloc
+                        || type == InstructionType::Phi || type == InstructionType::Mv;
+    if (type != InstructionType::Call && hasOutput == outputName.empty()) {
+        return Error(std::string(hasOutput ? "missing" : "unexpected") + " output of " + InstructionTypeToStr(type));
+    }
+
+    if (IsArithmetic(type)) {
+        ValueType vt{};
+        if (!ParseType(vt)) {
+            return false;
+        }
+        Value* input1 = ParseOperand(vt);
+        if (input1 == nullptr || !Expect(',')) {
+            return false;
+        }
+        // Only the type of the first input is printed. Offsets added to pointers are 64-bit integers
+        Value* input2 = ParseOperand(vt == ValueType::Pointer ? ValueType::Int64 : vt);
+        if (input2 == nullptr) {
+            return false;
+        }
+
+        const bool isPointer = input1->IsPointer() || input2->IsPointer();
+        Value* output = mContext->CreateValue(isPointer ? ValueType::Pointer : vt);
+        switch (type) {
+            default:                        break;
+            case InstructionType::Add:      mContext->CreateAdd(mBasicBlock, input1, input2, output); break;
+            case InstructionType::Sub:      mContext->CreateSub(mBasicBlock, input1, input2, output); break;
+            case InstructionType::Mul:      mContext->CreateMul(mBasicBlock, input1, input2, output); break;
+            case InstructionType::Div:      mContext->CreateDiv(mBasicBlock, input1, input2, output); break;
+            case InstructionType::Rem:      mContext->CreateRem(mBasicBlock, input1, input2, output); break;
+            case InstructionType::And:      mContext->CreateAnd(mBasicBlock, input1, input2, output); break;
+            case InstructionType::Or:       mContext->CreateOr(mBasicBlock, input1, input2, output); break;
+            case InstructionType::Xor:      mContext->CreateXor(mBasicBlock, input1, input2, output); break;
+            case InstructionType::Shl:      mContext->CreateShl(mBasicBlock, input1, input2, output); break;
+            case InstructionType::Shr:      mContext->CreateShr(mBasicBlock, input1, input2, output); break;
+            case InstructionType::Ashr:     mContext->CreateAshr(mBasicBlock, input1, input2, output); break;
+        }
+        return DefineValue(outputName, output);
+    }
+
+    if (IsBranch(type)) {
+        ValueType vt{};
+        if (!ParseType(vt)) {
+            return false;
+        }
+        Value* input1 = ParseOperand(vt);
+        if (input1 == nullptr || !Expect(',')) {
+            return false;
+        }
+        Value* input2 = ParseOperand(vt);
+        if (input2 == nullptr || !Expect('?')) {
+            return false;
+        }
+        BasicBlock* trueBB = ParseBasicBlockReference();
+        if (trueBB == nullptr || !Expect(':')) {
+            return false;
+        }
+        BasicBlock* falseBB = ParseBasicBlockReference();
+        if (falseBB == nullptr) {
+            return false;
+        }
+
+        switch (type) {
+            default:                        break;
+            case InstructionType::Beq:      mContext->CreateBeq(mBasicBlock, input1, input2, trueBB, falseBB); break;
+            case InstructionType::Bne:      mContext->CreateBne(mBasicBlock, input1, input2, trueBB, falseBB); break;
+            case InstructionType::Bgt:      mContext->CreateBgt(mBasicBlock, input1, input2, trueBB, falseBB); break;
+            case InstructionType::Blt:      mContext->CreateBlt(mBasicBlock, input1, input2, trueBB, falseBB); break;
+            case InstructionType::Bge:      mContext->CreateBge(mBasicBlock, input1, input2, trueBB, falseBB); break;
+            case InstructionType::Ble:      mContext->CreateBle(mBasicBlock, input1, input2, trueBB, falseBB); break;
+        }
+        return true;
+    }
+
+    switch (type) {
+        default:    return Error("unknown instruction");
+
+        case InstructionType::Load: {
+            ValueType vt{};
+            ValueType ptrType{};
+            if (!ParseType(vt) || !Expect(',') || !ParseType(ptrType)) {
+                return false;
+            }
+            Value* loadPtr = ParseOperand(ptrType);
+            if (loadPtr == nullptr) {
+                return false;
+            }
+            Value* output = mContext->CreateValue(vt);
+            mContext->CreateLoad(mBasicBlock, loadPtr, output);
+            return DefineValue(outputName, output);
+        }
+        case InstructionType::Store: {
+            ValueType vt{};
+            if (!ParseType(vt)) {
+                return false;
+            }
+            Value* input = ParseOperand(vt);
+            ValueType ptrType{};
+            if (input == nullptr || !Expect(',') || !ParseType(ptrType)) {
+                return false;
+            }
+            Value* storePtr = ParseOperand(ptrType);
+            if (storePtr == nullptr) {
+                return false;
+            }
+            mContext->CreateStore(mBasicBlock, storePtr, input);
+            return true;
+        }
+        case InstructionType::Jump: {
+            BasicBlock* jumpBB = ParseBasicBlockReference();
+            if (jumpBB == nullptr) {
+                return false;
+            }
+            mContext->CreateJump(mBasicBlock, jumpBB);
+            return true;
+        }
+        case InstructionType::Call: {
+            return ParseCall(outputName);
+        }
+        case InstructionType::Ret: {
+            if (IsAtLineEnd()) {
+                mContext->CreateRet(mBasicBlock);
+                return true;
+            }
+            ValueType vt{};
+            if (!ParseType(vt)) {
+                return false;
+            }
+            Value* returnValue = ParseOperand(vt);
+            if (returnValue == nullptr) {
+                return false;
+            }
+            mContext->CreateRet(mBasicBlock, returnValue);
+            return true;
+        }
+        case InstructionType::Alloc: {
+            ValueType vt{};
+            if (!ParseType(vt)) {
+                return false;
+            }
+            size_t count = 1;
+            if (Consume(',')) {
+                const std::string_view word = ReadWord();
+                auto [ptr, ec] = std::from_chars(word.data(), word.data() + word.size(), count);
+                if (ec != std::errc{} || ptr != word.data() + word.size()) {
+                    return Error("expected element count");
+                }
+            }
+            Value* output = mContext->CreateValue(ValueType::Pointer);
+            mContext->CreateAlloc(mBasicBlock, output, vt, count);
+            return DefineValue(outputName, output);
+        }
+        case InstructionType::Phi: {
+            ValueType vt{};
+            if (!ParseType(vt)) {
+                return false;
+            }
+            mOperands.clear();
+            do {
+                Value* input = ParseOperand(vt);
+                if (input == nullptr) {
+                    return false;
+                }
+                mOperands.push_back(input);
+            } while (Consume(','));
+
+            Value* output = mContext->CreateValue(vt);
+            mContext->CreatePhi(mBasicBlock, mOperands, output);
+            return DefineValue(outputName, output);
+        }
+        case InstructionType::Mv: {
+            ValueType vt{};
+            if (!ParseType(vt)) {
+                return false;
+            }
+            Value* input = ParseOperand(vt);
+            if (input == nullptr) {
+                return false;
+            }
+            Value* output = mContext->CreateValue(vt);
+            mContext->CreateMv(mBasicBlock, input, output);
+            return DefineValue(outputName, output);
+        }
+        case InstructionType::NullCheck: {
+            ValueType vt{};
+            if (!ParseType(vt)) {
+                return false;
+            }
+            Value* input = ParseOperand(vt);
+            if (input == nullptr) {
+                return false;
+            }
+            mContext->CreateNullCheck(mBasicBlock, input);
+            return true;
+        }
+        case InstructionType::BoundsCheck: {
+            ValueType vt{};
+            if (!ParseType(vt)) {
+                return false;
+            }
+            Value* inputPtr = ParseOperand(vt);
+            ValueType arrayType{};
+            if (inputPtr == nullptr || !Expect(',') || !Expect('[') || !ParseType(arrayType)) {
+                return false;
+            }
+            Value* inputArray = ParseOperand(arrayType);
+            // Size of the array is printed for readability only, it is taken from its Alloc
+            if (inputArray == nullptr || !Expect(',') || ReadWord().empty() || !Expect(']')) {
+                return false;
+            }
+            mContext->CreateBoundsCheck(mBasicBlock, inputPtr, inputArray);
+            return true;
+        }
+    }
+}
+
+bool IRParser::ParseCall(std::string_view outputName) {
+    ValueType retType = ValueType::Void;
+    if (!outputName.empty() && !ParseType(retType)) {
+        return false;
+    }
+    if (!Expect('#')) {
+        return false;
+    }
+    const std::string_view name = ReadWord();
+    if (name.empty() || !Expect('(')) {
+        return Error("expected function name");
+    }
+
+    mOperands.clear();
+    mTypes.clear();
+    if (!Consume(')')) {
+        do {
+            ValueType argType{};
+            if (!ParseType(argType)) {
+                return false;
+            }
+            Value* arg = ParseOperand(argType);
+            if (arg == nullptr) {
+                return false;
+            }
+            mOperands.push_back(arg);
+            mTypes.push_back(argType);
+        } while (Consume(','));
+
+        if (!Expect(')')) {
+            return false;
+        }
+    }
+
+    // Callee defined further in the text is declared with the signature of the call
+    Function* callee = nullptr;
+    if (auto it = mFunctionsByName.find(std::string(name)); it != mFunctionsByName.end()) {
+        callee = it->second;
+        if (callee->GetReturnType() != retType || callee->GetArgs().size() != mOperands.size()) {
+            return Error("call does not match the signature of #" + std::string(name));
+        }
+    }
+    else {
+        callee = mContext->CreateFunction(retType, mTypes, std::string(name));
+        mFunctionsByName.emplace(std::string(name), callee);
+    }
+
+    if (outputName.empty()) {
+        mContext->CreateCall(mBasicBlock, callee, mOperands);
+        return true;
+    }
+
+    Value* output = mContext->CreateValue(retType);
+    mContext->CreateCall(mBasicBlock, callee, output, mOperands);
+    return DefineValue(outputName, output);
+}
+
+bool IRParser::FinishFunction() {
+    for (const auto& [name, slot] : mBasicBlocks) {
+        if (!slot.isDefined) {
+            return Error("basic block " + std::string(name) + " is used but not defined in #" + mFunction->GetName());
+        }
+    }
+
+    if (mForwardReferences != 0) {
+        for (size_t i = 0; i < mValueSlots.size(); ++i) {
+            if (mValueSlots[i].epoch == mEpoch && mValueSlots[i].isForwardReference) {
+                return Error("value v" + std::to_string(i) + " is used but not defined in #" + mFunction->GetName());
+            }
+        }
+    }
+
+    for (const auto& list : mPredecessorLists) {
+        BasicBlock* bb = list.block;
+        std::vector<BasicBlock*> preds{};
+        for (uint32_t i = list.begin; i < list.end; ++i) {
+            auto it = mBasicBlocks.find(mPredecessorNames[i]);
+            if (it == mBasicBlocks.end() || !bb->HasPredecessor(it->second.block)) {
+                return Error("predecessors of " + bb->GetName() + " do not match the branches to it");
+            }
+            preds.push_back(it->second.block);
+        }
+        if (preds.size() != bb->GetPredecessors().size()) {
+            return Error("predecessors of " + bb->GetName() + " do not match the branches to it");
+        }
+        bb->SetPredecessors(preds);
+    }
+
+    // Phi inputs follow the predecessors of the block by position
+    for (auto* bb : mFunction->GetBasicBlocks()) {
+        const auto& preds = bb->GetPredecessors();
+        for (auto* inst = bb->Front(); inst != nullptr && inst->IsPhi(); inst = inst->GetNext()) {
+            InstructionPhi* phi = static_cast<InstructionPhi*>(inst);
+            for (size_t i = 0; i < phi->NumOperands(); ++i) {
+                phi->SetIncomingBlock(i, i < preds.size() ? preds[i] : nullptr);
+            }
+        }
+    }
+
+    mFunction = nullptr;
+    mBasicBlock = nullptr;
+    return true;
+}
+
+
+IRParser::ValueSlot* IRParser::GetValueSlot(std::string_view name) {
+    if (name.size() < 2 || name[0] != 'v') {
+        return nullptr;
+    }
+
+    size_t idx = 0;
+    auto [ptr, ec] = std::from_chars(name.data() + 1, name.data() + name.size(), idx);
+    if (ec != std::errc{} || ptr != name.data() + name.size()) {
+        return nullptr;
+    }
+
+    // Slots are indexed by the name, so the index is bounded by the text size to keep a huge name from allocating them
+    if (idx > mText.size()) {
+        Error("value index of " + std::string(name) + " is out of range");
+        return nullptr;
+    }
+
+    if (idx >= mValueSlots.size()) {
+        mValueSlots.resize(std::max(idx + 1, 2 * mValueSlots.size()));
+    }
+    ValueSlot* slot = &mValueSlots[idx];
+    if (slot->epoch != mEpoch) {
+        *slot = ValueSlot{nullptr, mEpoch, false};
+    }
+    return slot;
+}
+
+bool IRParser::DefineValue(std::string_view name, Value* value) {
+    ValueSlot* slot = GetValueSlot(name);
+    if (slot == nullptr) {
+        return Error("expected value name, got '" + std::string(name) + "'");
+    }
+
+    if (slot->value != nullptr && !slot->isForwardReference) {
+        return Error("redefinition of value " + std::string(name));
+    }
+
+    if (slot->isForwardReference) {
+        Value* placeholder = slot->value;
+        placeholder->ReplaceAllUsesWith(value);
+        mContext->RemoveValue(placeholder);
+        slot->isForwardReference = false;
+        --mForwardReferences;
+    }
+    slot->value = value;
+    return true;
+}
+
+Value* IRParser::ParseOperand(ValueType type) {
+    const std::string_view word = ReadWord();
+    if (word.empty()) {
+        Error("expected operand");
+        return nullptr;
+    }
+
+    if (word[0] != 'v') {
+        return ParseConstant(word, type);
+    }
+
+    ValueSlot* slot = GetValueSlot(word);
+    if (slot == nullptr) {
+        Error("expected operand, got '" + std::string(word) + "'");
+        return nullptr;
+    }
+
+    // Used before definition, e.g. by a phi in a loop header. Uses are moved to the real value once it is defined
+    if (slot->value == nullptr) {
+        slot->value = mContext->CreateValue(ValueType::Unknown);
+        slot->isForwardReference = true;
+        ++mForwardReferences;
+    }
+    return slot->value;
+}
+
+Value* IRParser::ParseConstant(std::string_view word, ValueType type) {
+    auto parse = [this, word]<typename T>(T value) -> Value* {
+        auto [ptr, ec] = std::from_chars(word.data(), word.data() + word.size(), value);
+        if (ec != std::errc{} || ptr != word.data() + word.size()) {
+            Error("invalid constant '" + std::string(word) + "' of type " + ValueTypeToIdStr(TypeToValueType<T>()));
+            return nullptr;
+        }
+        return mContext->GetOrCreateValueWithData<T>(value);
+    };
+
+    switch (type) {
+        case ValueType::Int8:       return parse(int8_t{});
+        case ValueType::Int16:      return parse(int16_t{});
+        case ValueType::Int32:      return parse(int32_t{});
+        case ValueType::Int64:      return parse(int64_t{});
+        case ValueType::Uint8:      return parse(uint8_t{});
+        case ValueType::Uint16:     return parse(uint16_t{});
+        case ValueType::Uint32:     return parse(uint32_t{});
+        case ValueType::Uint64:     return parse(uint64_t{});
+        case ValueType::Float32:    return parse(float{});
+        case ValueType::Float64:    return parse(double{});
+        default: {
+            Error("constants of type " + std::string(ValueTypeToIdStr(type)) + " are not supported");
+            return nullptr;
+        }
+    }
+}
+
+
+BasicBlock* IRParser::GetBasicBlock(std::string_view name) {
+    BasicBlockSlot& slot = mBasicBlocks[name];
+    if (slot.block == nullptr) {
+        // Block is attached to the function once its label is reached, so blocks keep the printed order
+        slot.block = mContext->CreateBasicBlock(std::string(name));
+    }
+    return slot.block;
+}
+
+BasicBlock* IRParser::ParseBasicBlockReference() {
+    if (!Expect('#')) {
+        return nullptr;
+    }
+    const std::string_view name = ReadWord();
+    if (name.empty()) {
+        Error("expected basic block name");
+        return nullptr;
+    }
+    return GetBasicBlock(name);
+}
+
+}   // namespace VMIR
@@ -0,0 +1,262 @@
+#include <IRPrinter.h>
+#include <IRBuilder.h>
+
+#include <charconv>
+
+namespace VMIR {
+
+template <typename T>
+void IRPrinter::AppendNumber(T number) {
+    char digits[64];
+    std::to_chars_result result{};
+    if constexpr (std::is_floating_point_v<T>) {
+        // Same as std::to_string, which prints with "%f"
+        result = std::to_chars(digits, digits + sizeof(digits), static_cast<double>(number), std::chars_format::fixed, 6);
+    }
+    else {
+        result = std::to_chars(digits, digits + sizeof(digits), number);
+    }
+    mBuffer.append(digits, result.ptr);
+}
+
+void IRPrinter::PrintValue(const Value* value) {
+    if (value->HasValue()) {
+        switch (value->GetValueType()) {
+            default:
+            case ValueType::Pointer:    break;
+            case ValueType::Int8:       return AppendNumber(value->GetValue<int8_t>().value());
+            case ValueType::Int16:      return AppendNumber(value->GetValue<int16_t>().value());
+            case ValueType::Int32:      return AppendNumber(value->GetValue<int32_t>().value());
+            case ValueType::Int64:      return AppendNumber(value->GetValue<int64_t>().value());
+            case ValueType::Uint8:      return AppendNumber(value->GetValue<uint8_t>().value());
+            case ValueType::Uint16:     return AppendNumber(value->GetValue<uint16_t>().value());
+            case ValueType::Uint32:     return AppendNumber(value->GetValue<uint32_t>().value());
+            case ValueType::Uint64:     return AppendNumber(value->GetValue<uint64_t>().value());
+            case ValueType::Float32:    return AppendNumber(value->GetValue<float>().value());
+            case ValueType::Float64:    return AppendNumber(value->GetValue<double>().value());
+        }
+    }
+    Append('v');
+    AppendNumber(value->GetId());
+}
+
+void IRPrinter::AppendTypedValue(const Value* value) {
+    Append(ValueTypeToIdStr(value->GetValueType()));
+    Append(' ');
+    PrintValue(value);
+}
+
+void IRPrinter::AppendBasicBlockName(const BasicBlock* bb) {
+    if (!bb->GetRawName().empty()) {
+        return Append(bb->GetRawName());
+    }
+    Append("<Unnamed BB#");
+    AppendNumber(bb->GetId());
+    Append('>');
+}
+
+
+void IRPrinter::PrintInstruction(const Instruction* inst) {
+    const auto operands = inst->operands();
+    const InstructionType type = inst->GetType();
+
+    if (Value* output = inst->GetOutput(); output != nullptr) {
+        PrintValue(output);
+        Append(" = ");
+    }
+
+    switch (type) {
+        default:    break;
+
+        case InstructionType::Add:
+        case InstructionType::Sub:
+        case InstructionType::Mul:
+        case InstructionType::Div:
+        case InstructionType::Rem:
+        case InstructionType::And:
+        case InstructionType::Or:
+        case InstructionType::Xor:
+        case InstructionType::Shl:
+        case InstructionType::Shr:
+        case InstructionType::Ashr: {
+            Append(InstructionTypeToStr(type));
+            Append(' ');
+            AppendTypedValue(operands[0]);
+            Append(", ");
+            PrintValue(operands[1]);
+            break;
+        }
+        case InstructionType::Load: {
+            Append("Load ");
+            Append(ValueTypeToIdStr(inst->GetOutput()->GetValueType()));
+            Append(", ptr ");
+            PrintValue(operands[0]);
+            break;
+        }
+        case InstructionType::Store: {
+            Append("Store ");
+            AppendTypedValue(operands[1]);
+            Append(", ptr ");
+            PrintValue(operands[0]);
+            break;
+        }
+        case InstructionType::Jump: {
+            Append("Jump #");
+            AppendBasicBlockName(static_cast<const InstructionJump*>(inst)->GetJumpBasicBlock());
+            break;
+        }
+        case InstructionType::Beq:
+        case InstructionType::Bne:
+        case InstructionType::Bgt:
+        case InstructionType::Blt:
+        case InstructionType::Bge:
+        case InstructionType::Ble: {
+            const InstructionBranch* branch = static_cast<const InstructionBranch*>(inst);
+            Append(InstructionTypeToStr(type));
+            Append(' ');
+            AppendTypedValue(operands[0]);
+            Append(", ");
+            PrintValue(operands[1]);
+            Append(" ? #");
+            AppendBasicBlockName(branch->GetTrueBasicBlock());
+            Append(" : #");
+            AppendBasicBlockName(branch->GetFalseBasicBlock());
+            break;
+        }
+        case InstructionType::Call: {
+            Append("Call ");
+            if (inst->GetOutput() != nullptr) {
+                Append(ValueTypeToIdStr(inst->GetOutput()->GetValueType()));
+                Append(' ');
+            }
+            Append('#');
+            Append(static_cast<const InstructionCall*>(inst)->GetFunction()->GetName());
+            Append('(');
+            for (auto it = operands.begin(), end = operands.end(); it != end; ++it) {
+                if (it != operands.begin()) {
+                    Append(", ");
+                }
+                AppendTypedValue(*it);
+            }
+            Append(')');
+            break;
+        }
+        case InstructionType::Ret: {
+            Append("Ret");
+            if (operands.size() > 0) {
+                Append(' ');
+                AppendTypedValue(operands[0]);
+            }
+            break;
+        }
+        case InstructionType::Alloc: {
+            const InstructionAlloc* alloc = static_cast<const InstructionAlloc*>(inst);
+            Append("Alloc ");
+            Append(ValueTypeToIdStr(alloc->GetValueType()));
+            if (alloc->GetCount() > 1) {
+                Append(", ");
+                AppendNumber(alloc->GetCount());
+            }
+            break;
+        }
+        case InstructionType::Phi: {
+            Append("Phi ");
+            Append(ValueTypeToIdStr(inst->GetOutput()->GetValueType()));
+            Append(' ');
+            const std::vector<Value*> inputs = static_cast<const InstructionPhi*>(inst)->GetInputsByPredecessors();
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                if (i != 0) {
+                    Append(", ");
+                }
+                PrintValue(inputs[i]);
+            }
+            break;
+        }
+        case InstructionType::Mv:
+        case InstructionType::NullCheck: {
+            Append(InstructionTypeToStr(type));
+            Append(' ');
+            AppendTypedValue(operands[0]);
+            break;
+        }
+        case InstructionType::BoundsCheck: {
+            Append("BoundsCheck ");
+            AppendTypedValue(operands[0]);
+            Append(", [ptr ");
+            PrintValue(operands[1]);
+            Append(", ");
+            AppendNumber(static_cast<InstructionAlloc*>(operands[1]->GetProducer())->GetCount());
+            Append(']');
+            break;
+        }
+    }
+}
+
+void IRPrinter::PrintBasicBlock(const BasicBlock* bb) {
+    AppendBasicBlockName(bb);
+    Append(':');
+
+    const auto& preds = bb->GetPredecessors();
+    if (preds.size() > 0) {
+        Append(" (preds: ");
+        for (auto it = preds.begin(), end = preds.end(); it != end; ++it) {
+            if (it != preds.begin()) {
+                Append(", ");
+            }
+            AppendBasicBlockName(*it);
+        }
+        Append(')');
+    }
+    Append('\n');
+
+    for (const Instruction* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+        Append("    ");
+        PrintInstruction(inst);
+        Append('\n');
+    }
+}
+
+void IRPrinter::PrintFunction(const Function* func) {
+    Append("function ");
+    Append(ValueTypeToIdStr(func->GetReturnType()));
+    Append(" #");
+    Append(func->GetName());
+    Append('(');
+
+    const auto& args = func->GetArgs();
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (i > 0) {
+            Append(", ");
+        }
+        AppendTypedValue(args[i]);
+    }
+    Append(") {\n");
+
+    const auto& blocks = func->GetBasicBlocks();
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (i > 0) {
+            Append('\n');
+        }
+        PrintBasicBlock(blocks[i]);
+    }
+    Append('}');
+}
+
+void IRPrinter::PrintIR(const IRContext* context, std::ostream& out) {
+    for (const Function* func : context->GetFunctions()) {
+        PrintFunction(func);
+        Append("\n\n");
+        if (mBuffer.size() >= kFlushThreshold) {
+            Flush(out);
+        }
+    }
+    Flush(out);
+}
+
+void IRPrinter::Flush(std::ostream& out) {
+    out.write(mBuffer.data(), static_cast<std::streamsize>(mBuffer.size()));
+    // Capacity is kept, so the next functions are printed without allocations
+    mBuffer.clear();
+}
+
+}   // namespace VMIR
@@ -2,22 +2,31 @@
 #include <BasicBlock.h>
 #include <Function.h>
 
+#include <new>
+
 namespace VMIR {
 
+bool Instruction::ComesBefore(const Instruction* other) const {
+    if (!mParentBasicBlock->IsInstructionOrderValid()) {
+        mParentBasicBlock->RenumberInstructions();
+    }
+    return mOrder < other->mOrder;
+}
+
 bool Instruction::IsDominatedBy(Instruction* inst) {
     BasicBlock* instBB = inst->GetParentBasicBlock();
     if (mParentBasicBlock != instBB) {
         return mParentBasicBlock->IsDominatedBy(instBB);
     }
-    return mParentBasicBlock->IndexOfInstruction(inst) < mParentBasicBlock->IndexOfInstruction(this);
+    return inst->ComesBefore(this);
 }
 
 
 std::string InstructionArithmetic::GetAsString() const {
-    const std::string in1Name = mInput1->GetValueStr();
-    const std::string in2Name = mInput2->GetValueStr();
+    const std::string in1Name = mOperands[0]->GetValueStr();
+    const std::string in2Name = mOperands[1]->GetValueStr();
     const std::string outName = mOutput->GetValueStr();
-    const std::string in1IdStr = ValueTypeToIdStr(mInput1->GetValueType());
+    const std::string in1IdStr = ValueTypeToIdStr(mOperands[0]->GetValueType());
     const std::string opTypeStr = InstructionTypeToStr(mType);
     return outName + " = " + opTypeStr + " " + in1IdStr + " " + in1Name + ", " + in2Name;
 }
@@ -40,17 +49,12 @@ bool InstructionArithmetic::IsValid() const {
     };
 
     return mId != -1 && mParentBasicBlock != nullptr
-        && mInput1 != nullptr && mInput2 != nullptr && mOutput != nullptr
-        && mInput1->IsValid() && mInput2->IsValid() && mOutput->IsValid()
-        && mInput1->GetValueType() != ValueType::Unknown
-        && mInput2->GetValueType() != ValueType::Unknown
+        && mOperands[0] != nullptr && mOperands[1] != nullptr && mOutput != nullptr
+        && mOperands[0]->IsValid() && mOperands[1]->IsValid() && mOutput->IsValid()
+        && mOperands[0]->GetValueType() != ValueType::Unknown
+        && mOperands[1]->GetValueType() != ValueType::Unknown
         && mOutput->GetValueType() != ValueType::Unknown
-        && (IsValidSimple(mInput1, mInput2, mOutput) || IsValidPointer(mInput1, mInput2, mOutput, mType));
-}
-
-void InstructionArithmetic::PopulateInputs(std::vector<Value*>& inputs) const {
-    inputs.push_back(mInput1);
-    inputs.push_back(mInput2);
+        && (IsValidSimple(mOperands[0], mOperands[1], mOutput) || IsValidPointer(mOperands[0], mOperands[1], mOutput, mType));
 }
 
 
@@ -76,28 +80,19 @@ bool InstructionLoad::IsValid() const {
         && mLoadPtr->GetValueType() == ValueType::Pointer;
 }
 
-void InstructionLoad::PopulateInputs(std::vector<Value*>& inputs) const {
-    inputs.push_back(mLoadPtr);
-}
-
 
 std::string InstructionStore::GetAsString() const {
-    const std::string inName = mInput->GetValueStr();
-    const std::string inTypeStr = ValueTypeToIdStr(mInput->GetValueType());
-    const std::string storePtrName = mStorePtr->GetValueStr();
+    const std::string inName = mOperands[1]->GetValueStr();
+    const std::string inTypeStr = ValueTypeToIdStr(mOperands[1]->GetValueType());
+    const std::string storePtrName = mOperands[0]->GetValueStr();
     return "Store " + inTypeStr + " " + inName + ", ptr " + storePtrName;
 }
 
 bool InstructionStore::IsValid() const {
     return mId != -1 && mParentBasicBlock != nullptr
-        && mStorePtr != nullptr && mInput != nullptr
-        && mStorePtr->IsValid() && mInput->IsValid()
-        && mStorePtr->GetValueType() == ValueType::Pointer;
-}
-
-void InstructionStore::PopulateInputs(std::vector<Value*>& inputs) const {
-    inputs.push_back(mStorePtr);
-    inputs.push_back(mInput);
+        && mOperands[0] != nullptr && mOperands[1] != nullptr
+        && mOperands[0]->IsValid() && mOperands[1]->IsValid()
+        && mOperands[0]->GetValueType() == ValueType::Pointer;
 }
 
 
@@ -111,9 +106,9 @@ bool InstructionJump::IsValid() const {
 
 
 std::string InstructionBranch::GetAsString() const {
-    const std::string in1Name = mInput1->GetValueStr();
-    const std::string in2Name = mInput2->GetValueStr();
-    const std::string typeIdStr = ValueTypeToIdStr(mInput1->GetValueType());
+    const std::string in1Name = mOperands[0]->GetValueStr();
+    const std::string in2Name = mOperands[1]->GetValueStr();
+    const std::string typeIdStr = ValueTypeToIdStr(mOperands[0]->GetValueType());
     const std::string trueBBName = mTrueBB->GetName();
     const std::string falseBBName = mFalseBB->GetName();
     const std::string opTypeStr = InstructionTypeToStr(mType);
@@ -122,15 +117,77 @@ std::string InstructionBranch::GetAsString() const {
 
 bool InstructionBranch::IsValid() const {
     return mId != -1 && mParentBasicBlock != nullptr
-        && mInput1 != nullptr && mInput2 != nullptr
-        && mInput1->IsValid() && mInput2->IsValid()
-        && mInput1->GetValueType() == mInput2->GetValueType()
+        && mOperands[0] != nullptr && mOperands[1] != nullptr
+        && mOperands[0]->IsValid() && mOperands[1]->IsValid()
+        && mOperands[0]->GetValueType() == mOperands[1]->GetValueType()
         && mTrueBB != nullptr && mFalseBB != nullptr;
 }
 
-void InstructionBranch::PopulateInputs(std::vector<Value*>& inputs) const {
-    inputs.push_back(mInput1);
-    inputs.push_back(mInput2);
+
+InstructionVariadic::~InstructionVariadic() {
+    ClearOperands();
+    if (mIsSpilled) {
+        ::operator delete(mOperands);
+    }
+}
+
+void InstructionVariadic::AppendOperand(Value* value) {
+    if (mNumOperands == mCapacity) {
+        GrowOperands(mCapacity == 0 ? 2 : 2 * mCapacity);
+    }
+    new (mOperands + mNumOperands) Use(this, value);
+    ++mNumOperands;
+}
+
+void InstructionVariadic::AssignOperands(const std::vector<Value*>& values) {
+    ClearOperands();
+    if (values.size() > mCapacity) {
+        GrowOperands(static_cast<uint32_t>(values.size()));
+    }
+    for (auto* value : values) {
+        new (mOperands + mNumOperands) Use(this, value);
+        ++mNumOperands;
+    }
+}
+
+void InstructionVariadic::EraseOperands(Value* value) {
+    // Keep the order of the remaining operands
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < mNumOperands; ++i) {
+        if (mOperands[i].Get() == value) {
+            continue;
+        }
+        if (count != i) {
+            mOperands[count] = std::move(mOperands[i]);
+        }
+        ++count;
+    }
+    for (uint32_t i = count; i < mNumOperands; ++i) {
+        mOperands[i].~Use();
+    }
+    mNumOperands = count;
+}
+
+void InstructionVariadic::ClearOperands() {
+    for (uint32_t i = 0; i < mNumOperands; ++i) {
+        mOperands[i].~Use();
+    }
+    mNumOperands = 0;
+}
+
+void InstructionVariadic::GrowOperands(uint32_t capacity) {
+    Use* operands = static_cast<Use*>(::operator new(capacity * sizeof(Use)));
+    for (uint32_t i = 0; i < mNumOperands; ++i) {
+        new (operands + i) Use(std::move(mOperands[i]));
+        mOperands[i].~Use();
+    }
+    if (mIsSpilled) {
+        ::operator delete(mOperands);
+    }
+
+    mOperands = operands;
+    mCapacity = capacity;
+    mIsSpilled = true;
 }
 
 
@@ -148,12 +205,12 @@ std::string InstructionCall::GetAsString() const {
     }
 
     outStr += "#" + mFunction->GetName() + "(";
-    for (size_t i = 0; i < mInputs.size(); ++i) {
+    for (size_t i = 0; i < mNumOperands; ++i) {
         if (i > 0) {
             outStr += ", ";
         }
-        const std::string argTypeStr = ValueTypeToIdStr(mInputs[i]->GetValueType());
-        const std::string argName = mInputs[i]->GetValueStr();
+        const std::string argTypeStr = ValueTypeToIdStr(mOperands[i]->GetValueType());
+        const std::string argName = mOperands[i]->GetValueStr();
         outStr += argTypeStr + " " + argName;
     }
     outStr += ")";
@@ -179,15 +236,15 @@ bool InstructionCall::IsValid() const {
         return false;
     }
 
-    if (mFunction->GetArgs().size() != mInputs.size()) {
+    if (mFunction->GetArgs().size() != mNumOperands) {
         return false;
     }
 
-    for (size_t i = 0; i < mInputs.size(); ++i) {
-        if (!mFunction->GetArg(i)->IsValid() || !mInputs[i]->IsValid()) {
+    for (size_t i = 0; i < mNumOperands; ++i) {
+        if (!mFunction->GetArg(i)->IsValid() || !mOperands[i]->IsValid()) {
             return false;
         }
-        if (mFunction->GetArg(i)->GetValueType() != mInputs[i]->GetValueType()) {
+        if (mFunction->GetArg(i)->GetValueType() != mOperands[i]->GetValueType()) {
             return false;
         }
     }
@@ -195,10 +252,6 @@ bool InstructionCall::IsValid() const {
     return true;
 }
 
-void InstructionCall::PopulateInputs(std::vector<Value*>& inputs) const {
-    inputs = mInputs;
-}
-
 
 std::string InstructionRet::GetAsString() const {
     std::string outStr = "Ret";
@@ -234,12 +287,6 @@ bool InstructionRet::IsValid() const {
     return true;
 }
 
-void InstructionRet::PopulateInputs(std::vector<Value*>& inputs) const {
-    if (mReturnValue) {
-        inputs.push_back(mReturnValue);
-    }
-}
-
 
 std::string InstructionAlloc::GetAsString() const {
     std::string outStr = "";
@@ -269,8 +316,8 @@ std::string InstructionPhi::GetAsString() const {
     const std::string idStr = ValueTypeToIdStr(mOutput->GetValueType());
 
     outStr = outName + " = Phi " + idStr + " ";
-    for (auto it = mInputs.begin(), end = mInputs.end(); it != end; ++it) {
-        if (it != mInputs.begin()) {
+    for (auto it = operands().begin(), end = operands().end(); it != end; ++it) {
+        if (it != operands().begin()) {
             outStr += ", ";
         }
         outStr += (*it)->GetValueStr();
@@ -288,7 +335,7 @@ bool InstructionPhi::IsValid() const {
         return false;
     }
 
-    if (mOutput == nullptr || mInputs.size() < 2) {
+    if (mOutput == nullptr || mNumOperands < 2) {
         return false;
     }
 
@@ -296,7 +343,7 @@ bool InstructionPhi::IsValid() const {
         return false;
     }
 
-    for (auto* i : mInputs) {
+    for (Value* i : operands()) {
         if (!i->IsValid()) {
             return false;
         }
@@ -305,15 +352,104 @@ bool InstructionPhi::IsValid() const {
         }
     }
 
+    // Exactly one input comes along the edge from each predecessor
+    const auto& preds = mParentBasicBlock->GetPredecessors();
+    if (preds.size() != mNumOperands) {
+        return false;
+    }
+    for (auto* pred : preds) {
+        if (std::count(mIncomingBlocks.begin(), mIncomingBlocks.end(), pred) != 1) {
+            return false;
+        }
+    }
+
     return true;
 }
 
-void InstructionPhi::PopulateInputs(std::vector<Value*>& inputs) const {
-    for (auto* i : mInputs) {
-        inputs.push_back(i);
+Value* InstructionPhi::GetInputFrom(const BasicBlock* pred) const {
+    for (size_t i = 0; i < mIncomingBlocks.size(); ++i) {
+        if (mIncomingBlocks[i] == pred) {
+            return operands()[i];
+        }
+    }
+    return nullptr;
+}
+
+std::vector<Value*> InstructionPhi::GetInputsByPredecessors() const {
+    std::vector<Value*> inputs{};
+    for (auto* pred : mParentBasicBlock->GetPredecessors()) {
+        if (Value* input = GetInputFrom(pred); input != nullptr) {
+            inputs.push_back(input);
+        }
+    }
+    if (inputs.size() != mNumOperands) {
+        inputs.assign(operands().begin(), operands().end());
+    }
+    return inputs;
+}
+
+void InstructionPhi::SetInputs(const std::vector<Value*>& inputs, const std::vector<BasicBlock*>& incomingBlocks) {
+    AssignOperands(inputs);
+    mIncomingBlocks.clear();
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        mIncomingBlocks.push_back(i < incomingBlocks.size() ? incomingBlocks[i] : nullptr);
+    }
+}
+
+void InstructionPhi::AddInput(Value* input, BasicBlock* incomingBlock) {
+    AppendOperand(input);
+    mIncomingBlocks.push_back(incomingBlock);
+}
+
+void InstructionPhi::RemoveInput(Value* input) {
+    // Keep the order of the remaining blocks, as operands do
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < mNumOperands; ++i) {
+        if (operands()[i] != input) {
+            mIncomingBlocks[count++] = mIncomingBlocks[i];
+        }
+    }
+    while (mIncomingBlocks.size() > count) {
+        mIncomingBlocks.pop_back();
+    }
+    EraseOperands(input);
+}
+
+void InstructionPhi::ReplaceIncomingBlock(const BasicBlock* oldBlock, BasicBlock* newBlock) {
+    for (auto& bb : mIncomingBlocks) {
+        if (bb == oldBlock) {
+            bb = newBlock;
+        }
     }
 }
 
+void InstructionPhi::AssignIncomingBlock(BasicBlock* pred) {
+    if (std::find(mIncomingBlocks.begin(), mIncomingBlocks.end(), pred) == mIncomingBlocks.end()) {
+        for (size_t i = 0; i < mIncomingBlocks.size(); ++i) {
+            if (mIncomingBlocks[i] == nullptr && pred->IsProducerOf(operands()[i])) {
+                mIncomingBlocks[i] = pred;
+                break;
+            }
+        }
+    }
+
+    // Constants, arguments and values of farther blocks are left, they take the edge left once all edges are there
+    const auto& preds = mParentBasicBlock->GetPredecessors();
+    if (preds.size() != mNumOperands || std::count(mIncomingBlocks.begin(), mIncomingBlocks.end(), nullptr) != 1) {
+        return;
+    }
+    BasicBlock* lastPred = nullptr;
+    for (auto* bb : preds) {
+        if (std::find(mIncomingBlocks.begin(), mIncomingBlocks.end(), bb) == mIncomingBlocks.end()) {
+            if (lastPred != nullptr) {
+                return;
+            }
+            lastPred = bb;
+        }
+    }
+    *std::find(mIncomingBlocks.begin(), mIncomingBlocks.end(), nullptr) = lastPred;
+}
+
 
 std::string InstructionMv::GetAsString() const {
     const std::string inName = mInput->GetValueStr();
@@ -331,10 +467,6 @@ bool InstructionMv::IsValid() const {
         && mInput->GetValueType() != ValueType::Unknown;
 }
 
-void InstructionMv::PopulateInputs(std::vector<Value*>& inputs) const {
-    inputs.push_back(mInput);
-}
-
 
 std::string InstructionNullCheck::GetAsString() const {
     const std::string inName = mInput->GetValueStr();
@@ -348,33 +480,24 @@ bool InstructionNullCheck::IsValid() const {
         && mInput->GetValueType() == ValueType::Pointer;
 }
 
-void InstructionNullCheck::PopulateInputs(std::vector<Value*>& inputs) const {
-    inputs.push_back(mInput);
-}
-
 
 std::string InstructionBoundsCheck::GetAsString() const {
-    const std::string ptrName = mInputPtr->GetValueStr();
-    const std::string arrayName = mInputArray->GetValueStr();
-    const std::string ptrIdStr = ValueTypeToIdStr(mInputPtr->GetValueType());
-    size_t arraySize = static_cast<InstructionAlloc*>(mInputArray->GetProducer())->GetCount();
+    const std::string ptrName = mOperands[0]->GetValueStr();
+    const std::string arrayName = mOperands[1]->GetValueStr();
+    const std::string ptrIdStr = ValueTypeToIdStr(mOperands[0]->GetValueType());
+    size_t arraySize = static_cast<InstructionAlloc*>(mOperands[1]->GetProducer())->GetCount();
     return "BoundsCheck " + ptrIdStr + " " + ptrName + ", [ptr " + arrayName + ", " + std::to_string(arraySize) + "]";
 }
 
 bool InstructionBoundsCheck::IsValid() const {
     return mId != -1 && mParentBasicBlock != nullptr
-        && mInputPtr != nullptr && mInputArray != nullptr
-        && mInputPtr->IsValid() && mInputArray->IsValid()
-        && mInputPtr->GetValueType() == ValueType::Pointer
-        && mInputArray->GetValueType() == ValueType::Pointer
-        && mInputArray->GetProducer() != nullptr
-        && mInputArray->GetProducer()->GetType() == InstructionType::Alloc
-        && mInputArray->GetProducer()->IsValid();
-}
-
-void InstructionBoundsCheck::PopulateInputs(std::vector<Value*>& inputs) const {
-    inputs.push_back(mInputPtr);
-    inputs.push_back(mInputArray);
+        && mOperands[0] != nullptr && mOperands[1] != nullptr
+        && mOperands[0]->IsValid() && mOperands[1]->IsValid()
+        && mOperands[0]->GetValueType() == ValueType::Pointer
+        && mOperands[1]->GetValueType() == ValueType::Pointer
+        && mOperands[1]->GetProducer() != nullptr
+        && mOperands[1]->GetProducer()->GetType() == InstructionType::Alloc
+        && mOperands[1]->GetProducer()->IsValid();
 }
 
 }   // namespace VMIR
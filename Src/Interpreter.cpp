@@ -0,0 +1,746 @@
+#include <Interpreter.h>
+#include <IRBuilder.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if !defined(__GNUC__)
+#error "Interpreter dispatches with computed goto, which needs GCC or Clang"
+#endif
+
+namespace VMIR {
+
+#define VMIR_INTERPRETER_OPCODES(X)                                                         \
+    X(AddI) X(SubI) X(MulI) X(DivS) X(DivU) X(RemS) X(RemU)                                 \
+    X(AndI) X(OrI) X(XorI) X(ShlI) X(ShrI) X(AshrI)                                         \
+    X(AddF32) X(SubF32) X(MulF32) X(DivF32) X(RemF32)                                       \
+    X(AddF64) X(SubF64) X(MulF64) X(DivF64) X(RemF64)                                       \
+    X(LoadS8) X(LoadU8) X(LoadS16) X(LoadU16) X(LoadS32) X(LoadU32) X(Load64)               \
+    X(Store8) X(Store16) X(Store32) X(Store64)                                              \
+    X(Jump)                                                                                 \
+    X(BeqI) X(BneI) X(BeqF32) X(BneF32) X(BeqF64) X(BneF64)                                 \
+    X(BgtS) X(BltS) X(BgeS) X(BleS) X(BgtU) X(BltU) X(BgeU) X(BleU)                         \
+    X(BgtF32) X(BltF32) X(BgeF32) X(BleF32) X(BgtF64) X(BltF64) X(BgeF64) X(BleF64)         \
+    X(Call) X(Ret) X(RetVoid) X(Alloc) X(Mv) X(NullCheck) X(BoundsCheck)                    \
+    X(PhiMoves)
+
+enum class Opcode : uint8_t {
+#define VMIR_OPCODE_ENUM(name) name,
+    VMIR_INTERPRETER_OPCODES(VMIR_OPCODE_ENUM)
+#undef VMIR_OPCODE_ENUM
+};
+
+static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+/*
+    Operands are slots of the frame: arguments, outputs and constants, in this order.
+    Integers are kept sign- or zero-extended to 64 bits, results are extended back with `shift`.
+    Branches keep the true target in `dst` and the false one in `c`
+*/
+struct Operation {
+    Opcode op;
+    uint8_t shift;
+    uint8_t isSigned;
+    uint8_t reserved;
+    uint32_t dst;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+};
+static_assert(sizeof(Operation) == 20);
+
+struct Interpreter::DecodedFunction {
+    const Function* func{nullptr};
+    std::vector<Operation> code{};
+    // Arguments of calls and (dst, src) pairs of edge moves
+    std::vector<uint32_t> extra{};
+    std::vector<uint64_t> constants{};
+    uint32_t argCount{0};
+    uint32_t constantBase{0};
+    uint32_t frameSize{0};
+    ValueType retType{ValueType::Void};
+};
+
+
+static inline bool IsSignedType(ValueType type) {
+    return type == ValueType::Int8 || type == ValueType::Int16 || type == ValueType::Int32 || type == ValueType::Int64;
+}
+
+static inline uint32_t TypeSize(ValueType type) {
+    switch (type) {
+        default:                    return 0;
+        case ValueType::Int8:
+        case ValueType::Uint8:      return 1;
+        case ValueType::Int16:
+        case ValueType::Uint16:     return 2;
+        case ValueType::Int32:
+        case ValueType::Uint32:
+        case ValueType::Float32:    return 4;
+        case ValueType::Int64:
+        case ValueType::Uint64:
+        case ValueType::Float64:
+        case ValueType::Pointer:    return 8;
+    }
+}
+
+// Shift which extends the integer of this type from the low bits to 64 bits
+static inline uint8_t ExtensionShift(ValueType type) {
+    if (type == ValueType::Float32 || type == ValueType::Float64) {
+        return 0;
+    }
+    return static_cast<uint8_t>(64 - 8 * TypeSize(type));
+}
+
+static inline uint64_t Extend(uint64_t bits, uint8_t shift, bool isSigned) {
+    return isSigned ? static_cast<uint64_t>(static_cast<int64_t>(bits << shift) >> shift) : (bits << shift) >> shift;
+}
+
+static inline uint64_t ExtendToSlot(uint64_t bits, ValueType type) {
+    return Extend(bits, ExtensionShift(type), IsSignedType(type));
+}
+
+static inline uint64_t TruncateFromSlot(uint64_t bits, ValueType type) {
+    return Extend(bits, ExtensionShift(type), false);
+}
+
+static inline float AsF32(uint64_t bits) { return std::bit_cast<float>(static_cast<uint32_t>(bits)); }
+static inline double AsF64(uint64_t bits) { return std::bit_cast<double>(bits); }
+static inline uint64_t FromF32(float value) { return std::bit_cast<uint32_t>(value); }
+static inline uint64_t FromF64(double value) { return std::bit_cast<uint64_t>(value); }
+
+
+Interpreter::Interpreter(IRContext* context, size_t stackSlotCount, size_t memorySize)
+    : mContext{context}, mStack{new uint64_t[stackSlotCount]}, mStackSlotCount{stackSlotCount},
+      mMemory{new uint8_t[memorySize]}, mMemorySize{memorySize} {}
+
+Interpreter::~Interpreter() = default;
+
+bool Interpreter::Error(const std::string& message) {
+    mError = message;
+    return false;
+}
+
+void Interpreter::Invalidate() {
+    mDecoded.clear();
+    mDecodedIds.clear();
+}
+
+bool Interpreter::Run(Function* func, const std::vector<uint64_t>& args) {
+    mError.clear();
+    std::optional<uint32_t> funcIdx = Decode(func);
+    if (!funcIdx.has_value()) {
+        Invalidate();
+        return false;
+    }
+    return Execute(funcIdx.value(), args);
+}
+
+
+std::optional<uint32_t> Interpreter::Decode(Function* func) {
+    if (auto it = mDecodedIds.find(func); it != mDecodedIds.end()) {
+        return it->second;
+    }
+
+    const uint32_t idx = static_cast<uint32_t>(mDecoded.size());
+    mDecodedIds.emplace(func, idx);
+    mDecoded.push_back(std::make_unique<DecodedFunction>());
+
+    DecodedFunction& decoded = *mDecoded.back();
+    decoded.func = func;
+    decoded.argCount = static_cast<uint32_t>(func->GetArgs().size());
+    decoded.retType = func->GetReturnType();
+
+    // Declarations are only an error when they are called
+    if (func->GetBasicBlocks().empty()) {
+        return idx;
+    }
+    if (!func->IsValid()) {
+        Error("#" + func->GetName() + " is not valid");
+        return std::nullopt;
+    }
+    if (!DecodeBody(func, decoded)) {
+        return std::nullopt;
+    }
+    return idx;
+}
+
+bool Interpreter::DecodeBody(Function* func, DecodedFunction& decoded) {
+    const std::string& name = func->GetName();
+
+    std::unordered_map<const Value*, uint32_t> slots{};
+    uint32_t slotCount = 0;
+    for (auto* arg : func->GetArgs()) {
+        slots.emplace(arg, slotCount++);
+    }
+    for (auto* bb : func->GetBasicBlocks()) {
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            if (Value* output = inst->GetOutput(); output != nullptr) {
+                slots.emplace(output, slotCount++);
+            }
+        }
+    }
+
+    decoded.constantBase = slotCount;
+
+    std::unordered_map<const Value*, uint32_t> constantSlots{};
+    bool hasUndefinedValue = false;
+    auto slotOf = [&](const Value* value) -> uint32_t {
+        if (value->HasValue()) {
+            auto [it, inserted] = constantSlots.try_emplace(value, decoded.constantBase + static_cast<uint32_t>(decoded.constants.size()));
+            if (inserted) {
+                decoded.constants.push_back(ExtendToSlot(value->GetBitPattern(), value->GetValueType()));
+            }
+            return it->second;
+        }
+        auto it = slots.find(value);
+        if (it == slots.end()) {
+            hasUndefinedValue = true;
+            return 0;
+        }
+        return it->second;
+    };
+
+    auto& code = decoded.code;
+    auto emit = [&code](Opcode op, uint32_t dst = kNoSlot, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0) -> Operation& {
+        code.push_back(Operation{op, 0, 0, 0, dst, a, b, c});
+        return code.back();
+    };
+
+    // Prologue goes to the entry block, unless it is the first one
+    struct Fixup {
+        size_t operation;
+        bool isFalseTarget;
+        const BasicBlock* pred;
+        const BasicBlock* succ;
+    };
+    std::vector<Fixup> fixups{};
+    if (func->GetEntryBasicBlock() != func->GetBasicBlocks().front() || !code.empty()) {
+        emit(Opcode::Jump);
+        fixups.push_back(Fixup{code.size() - 1, false, nullptr, func->GetEntryBasicBlock()});
+    }
+
+    std::unordered_map<const BasicBlock*, uint32_t> blockStarts{};
+    for (auto* bb : func->GetBasicBlocks()) {
+        blockStarts.emplace(bb, static_cast<uint32_t>(code.size()));
+
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            const auto operands = inst->operands();
+            const InstructionType type = inst->GetType();
+            Value* output = inst->GetOutput();
+            const uint32_t dst = output != nullptr ? slotOf(output) : kNoSlot;
+
+            switch (type) {
+                default:    return Error("unknown instruction in #" + name);
+
+                case InstructionType::Add:
+                case InstructionType::Sub:
+                case InstructionType::Mul:
+                case InstructionType::Div:
+                case InstructionType::Rem:
+                case InstructionType::And:
+                case InstructionType::Or:
+                case InstructionType::Xor:
+                case InstructionType::Shl:
+                case InstructionType::Shr:
+                case InstructionType::Ashr: {
+                    const ValueType vt = output->GetValueType();
+                    const bool isF32 = vt == ValueType::Float32;
+                    const bool isF64 = vt == ValueType::Float64;
+                    const bool isSigned = IsSignedType(vt);
+
+                    Opcode op{};
+                    switch (type) {
+                        default:
+                        case InstructionType::Add:  op = isF32 ? Opcode::AddF32 : isF64 ? Opcode::AddF64 : Opcode::AddI; break;
+                        case InstructionType::Sub:  op = isF32 ? Opcode::SubF32 : isF64 ? Opcode::SubF64 : Opcode::SubI; break;
+                        case InstructionType::Mul:  op = isF32 ? Opcode::MulF32 : isF64 ? Opcode::MulF64 : Opcode::MulI; break;
+                        case InstructionType::Div:  op = isF32 ? Opcode::DivF32 : isF64 ? Opcode::DivF64 : isSigned ? Opcode::DivS : Opcode::DivU; break;
+                        case InstructionType::Rem:  op = isF32 ? Opcode::RemF32 : isF64 ? Opcode::RemF64 : isSigned ? Opcode::RemS : Opcode::RemU; break;
+                        case InstructionType::And:  op = Opcode::AndI; break;
+                        case InstructionType::Or:   op = Opcode::OrI; break;
+                        case InstructionType::Xor:  op = Opcode::XorI; break;
+                        case InstructionType::Shl:  op = Opcode::ShlI; break;
+                        case InstructionType::Shr:  op = Opcode::ShrI; break;
+                        case InstructionType::Ashr: op = Opcode::AshrI; break;
+                    }
+                    if ((isF32 || isF64) && op >= Opcode::AndI && op <= Opcode::AshrI) {
+                        return Error(std::string(InstructionTypeToStr(type)) + " of floating point values in #" + name);
+                    }
+
+                    Operation& operation = emit(op, dst, slotOf(operands[0]), slotOf(operands[1]));
+                    operation.shift = ExtensionShift(vt);
+                    operation.isSigned = isSigned;
+                    // Shift amounts are masked with the bit width
+                    operation.c = 64u - operation.shift - 1u;
+                    break;
+                }
+                case InstructionType::Load: {
+                    const ValueType vt = output->GetValueType();
+                    Opcode op{};
+                    switch (TypeSize(vt)) {
+                        default:
+                        case 8: op = Opcode::Load64; break;
+                        case 4: op = IsSignedType(vt) ? Opcode::LoadS32 : Opcode::LoadU32; break;
+                        case 2: op = IsSignedType(vt) ? Opcode::LoadS16 : Opcode::LoadU16; break;
+                        case 1: op = IsSignedType(vt) ? Opcode::LoadS8 : Opcode::LoadU8; break;
+                    }
+                    emit(op, dst, slotOf(operands[0]));
+                    break;
+                }
+                case InstructionType::Store: {
+                    Opcode op{};
+                    switch (TypeSize(operands[1]->GetValueType())) {
+                        default:
+                        case 8: op = Opcode::Store64; break;
+                        case 4: op = Opcode::Store32; break;
+                        case 2: op = Opcode::Store16; break;
+                        case 1: op = Opcode::Store8; break;
+                    }
+                    emit(op, kNoSlot, slotOf(operands[0]), slotOf(operands[1]));
+                    break;
+                }
+                case InstructionType::Jump: {
+                    emit(Opcode::Jump);
+                    fixups.push_back(Fixup{code.size() - 1, false, bb, static_cast<const InstructionJump*>(inst)->GetJumpBasicBlock()});
+                    break;
+                }
+                case InstructionType::Beq:
+                case InstructionType::Bne:
+                case InstructionType::Bgt:
+                case InstructionType::Blt:
+                case InstructionType::Bge:
+                case InstructionType::Ble: {
+                    const ValueType vt = operands[0]->GetValueType();
+                    // Rows are integer, F32 and F64 for equality, signed, unsigned, F32 and F64 for the rest
+                    const size_t column = vt == ValueType::Float32 ? 2 : vt == ValueType::Float64 ? 3 : IsSignedType(vt) ? 0 : 1;
+                    static constexpr Opcode kEquality[2][4] = {
+                        {Opcode::BeqI, Opcode::BeqI, Opcode::BeqF32, Opcode::BeqF64},
+                        {Opcode::BneI, Opcode::BneI, Opcode::BneF32, Opcode::BneF64},
+                    };
+                    static constexpr Opcode kOrdering[4][4] = {
+                        {Opcode::BgtS, Opcode::BgtU, Opcode::BgtF32, Opcode::BgtF64},
+                        {Opcode::BltS, Opcode::BltU, Opcode::BltF32, Opcode::BltF64},
+                        {Opcode::BgeS, Opcode::BgeU, Opcode::BgeF32, Opcode::BgeF64},
+                        {Opcode::BleS, Opcode::BleU, Opcode::BleF32, Opcode::BleF64},
+                    };
+
+                    Opcode op{};
+                    switch (type) {
+                        default:
+                        case InstructionType::Beq:  op = kEquality[0][column]; break;
+                        case InstructionType::Bne:  op = kEquality[1][column]; break;
+                        case InstructionType::Bgt:  op = kOrdering[0][column]; break;
+                        case InstructionType::Blt:  op = kOrdering[1][column]; break;
+                        case InstructionType::Bge:  op = kOrdering[2][column]; break;
+                        case InstructionType::Ble:  op = kOrdering[3][column]; break;
+                    }
+
+                    const InstructionBranch* branch = static_cast<const InstructionBranch*>(inst);
+                    emit(op, kNoSlot, slotOf(operands[0]), slotOf(operands[1]));
+                    fixups.push_back(Fixup{code.size() - 1, false, bb, branch->GetTrueBasicBlock()});
+                    fixups.push_back(Fixup{code.size() - 1, true, bb, branch->GetFalseBasicBlock()});
+                    break;
+                }
+                case InstructionType::Call: {
+                    std::optional<uint32_t> callee = Decode(static_cast<const InstructionCall*>(inst)->GetFunction());
+                    if (!callee.has_value()) {
+                        return false;
+                    }
+                    const uint32_t firstArg = static_cast<uint32_t>(decoded.extra.size());
+                    for (Value* arg : operands) {
+                        decoded.extra.push_back(slotOf(arg));
+                    }
+                    emit(Opcode::Call, dst, firstArg, static_cast<uint32_t>(operands.size()), callee.value());
+                    break;
+                }
+                case InstructionType::Ret: {
+                    if (operands.empty()) {
+                        emit(Opcode::RetVoid);
+                    }
+                    else {
+                        emit(Opcode::Ret, kNoSlot, slotOf(operands[0]));
+                    }
+                    break;
+                }
+                case InstructionType::Alloc: {
+                    const InstructionAlloc* alloc = static_cast<const InstructionAlloc*>(inst);
+                    const uint64_t size = (uint64_t(TypeSize(alloc->GetValueType())) * alloc->GetCount() + 7) & ~uint64_t(7);
+                    if (size > mMemorySize) {
+                        return Error("alloc in #" + name + " is larger than the memory of the interpreter");
+                    }
+                    emit(Opcode::Alloc, dst, static_cast<uint32_t>(size));
+                    break;
+                }
+                case InstructionType::Phi: {
+                    // Phis take their inputs on the edges
+                    break;
+                }
+                case InstructionType::Mv: {
+                    emit(Opcode::Mv, dst, slotOf(operands[0]));
+                    break;
+                }
+                case InstructionType::NullCheck: {
+                    emit(Opcode::NullCheck, kNoSlot, slotOf(operands[0]));
+                    break;
+                }
+                case InstructionType::BoundsCheck: {
+                    const Instruction* producer = operands[1]->GetProducer();
+                    if (producer == nullptr || producer->GetType() != InstructionType::Alloc) {
+                        return Error("bounds check in #" + name + " is not over an alloc");
+                    }
+                    const InstructionAlloc* alloc = static_cast<const InstructionAlloc*>(producer);
+                    const uint64_t size = uint64_t(TypeSize(alloc->GetValueType())) * alloc->GetCount();
+                    emit(Opcode::BoundsCheck, kNoSlot, slotOf(operands[0]), slotOf(operands[1]), static_cast<uint32_t>(size));
+                    break;
+                }
+            }
+
+        }
+    }
+
+    if (hasUndefinedValue) {
+        return Error("value used in #" + name + " is not defined in it");
+    }
+
+    // Edges into blocks with phis go through a stub, which moves the inputs of the edge into the phis
+    std::unordered_map<const BasicBlock*, std::unordered_map<const BasicBlock*, uint32_t>> stubs{};
+    for (const Fixup& fixup : fixups) {
+        uint32_t target = blockStarts.at(fixup.succ);
+
+        std::vector<uint32_t> moves{};
+        for (auto* inst = fixup.succ->Front(); fixup.pred != nullptr && inst != nullptr && inst->GetType() == InstructionType::Phi; inst = inst->GetNext()) {
+            Value* input = static_cast<InstructionPhi*>(inst)->GetInputFrom(fixup.pred);
+            if (input == nullptr) {
+                continue;
+            }
+            moves.push_back(slotOf(inst->GetOutput()));
+            moves.push_back(slotOf(input));
+        }
+
+        if (!moves.empty()) {
+            auto [it, inserted] = stubs[fixup.pred].try_emplace(fixup.succ, static_cast<uint32_t>(code.size()));
+            if (inserted) {
+                const uint32_t firstMove = static_cast<uint32_t>(decoded.extra.size());
+                decoded.extra.insert(decoded.extra.end(), moves.begin(), moves.end());
+                emit(Opcode::PhiMoves, kNoSlot, firstMove, static_cast<uint32_t>(moves.size() / 2));
+                emit(Opcode::Jump, target);
+                mMaxPhiMoves = std::max(mMaxPhiMoves, moves.size() / 2);
+            }
+            target = it->second;
+        }
+
+        if (fixup.isFalseTarget) {
+            code[fixup.operation].c = target;
+        }
+        else {
+            code[fixup.operation].dst = target;
+        }
+    }
+
+    decoded.frameSize = decoded.constantBase + static_cast<uint32_t>(decoded.constants.size());
+    return true;
+}
+
+
+bool Interpreter::Execute(uint32_t funcIdx, const std::vector<uint64_t>& args) {
+    const DecodedFunction* fn = mDecoded[funcIdx].get();
+    if (args.size() != fn->argCount) {
+        return Error("#" + fn->func->GetName() + " takes " + std::to_string(fn->argCount) + " arguments");
+    }
+    if (fn->code.empty()) {
+        return Error("#" + fn->func->GetName() + " has no body");
+    }
+    if (fn->frameSize > mStackSlotCount) {
+        return Error("stack overflow in #" + fn->func->GetName());
+    }
+
+    static const void* const kLabels[] = {
+#define VMIR_OPCODE_LABEL(name) &&Op_##name,
+        VMIR_INTERPRETER_OPCODES(VMIR_OPCODE_LABEL)
+#undef VMIR_OPCODE_LABEL
+    };
+
+    mFrames.clear();
+    mPhiScratch.resize(mMaxPhiMoves);
+    uint64_t* const scratch = mPhiScratch.data();
+    uint64_t* const stackEnd = mStack.get() + mStackSlotCount;
+    uint8_t* const memory = mMemory.get();
+    size_t memoryTop = 0;
+
+    uint64_t* regs = mStack.get();
+    const Operation* code = fn->code.data();
+    const uint32_t* extra = fn->extra.data();
+    const Operation* pc = code;
+
+    // Empty vector may give a null pointer, which memcpy does not accept even for zero bytes
+    auto enterFrame = [](const DecodedFunction* callee, uint64_t* calleeRegs) {
+        if (!callee->constants.empty()) {
+            std::memcpy(calleeRegs + callee->constantBase, callee->constants.data(), callee->constants.size() * sizeof(uint64_t));
+        }
+    };
+    enterFrame(fn, regs);
+    for (size_t i = 0; i < args.size(); ++i) {
+        regs[i] = ExtendToSlot(args[i], fn->func->GetArgs()[i]->GetValueType());
+    }
+
+    const char* trap = nullptr;
+
+#define R(slot) regs[slot]
+#define DISPATCH() goto *kLabels[static_cast<size_t>(pc->op)]
+#define NEXT() do { ++pc; DISPATCH(); } while (0)
+#define TRAP(message) do { trap = message; goto Trap; } while (0)
+#define INT_OP(name, expr)                                                  \
+    Op_##name: {                                                            \
+        const uint64_t a = R(pc->a);                                        \
+        const uint64_t b = R(pc->b);                                        \
+        R(pc->dst) = Extend((expr), pc->shift, pc->isSigned);               \
+        NEXT();                                                             \
+    }
+#define FLOAT_OP(name, As, From, expr)                                      \
+    Op_##name: {                                                            \
+        const auto a = As(R(pc->a));                                        \
+        const auto b = As(R(pc->b));                                        \
+        R(pc->dst) = From(expr);                                            \
+        NEXT();                                                             \
+    }
+#define LOAD_OP(name, T)                                                    \
+    Op_##name: {                                                            \
+        T value{};                                                          \
+        std::memcpy(&value, reinterpret_cast<const void*>(R(pc->a)), sizeof(T)); \
+        R(pc->dst) = static_cast<uint64_t>(value);                          \
+        NEXT();                                                             \
+    }
+#define STORE_OP(name, T)                                                   \
+    Op_##name: {                                                            \
+        const T value = static_cast<T>(R(pc->b));                           \
+        std::memcpy(reinterpret_cast<void*>(R(pc->a)), &value, sizeof(T));  \
+        NEXT();                                                             \
+    }
+#define BRANCH_OP(name, As, cmp)                                            \
+    Op_##name: {                                                            \
+        pc = code + ((As(R(pc->a)) cmp As(R(pc->b))) ? pc->dst : pc->c);    \
+        DISPATCH();                                                         \
+    }
+
+    DISPATCH();
+
+    INT_OP(AddI, a + b)
+    INT_OP(SubI, a - b)
+    INT_OP(MulI, a * b)
+    INT_OP(AndI, a & b)
+    INT_OP(OrI, a | b)
+    INT_OP(XorI, a ^ b)
+    INT_OP(ShlI, a << (b & pc->c))
+    INT_OP(ShrI, Extend(a, pc->shift, false) >> (b & pc->c))
+    INT_OP(AshrI, static_cast<uint64_t>(static_cast<int64_t>(Extend(a, pc->shift, true)) >> (b & pc->c)))
+
+    Op_DivS: {
+        const int64_t a = static_cast<int64_t>(R(pc->a));
+        const int64_t b = static_cast<int64_t>(R(pc->b));
+        if (b == 0) {
+            TRAP("division by zero");
+        }
+        const uint64_t result = b == -1 ? 0 - static_cast<uint64_t>(a) : static_cast<uint64_t>(a / b);
+        R(pc->dst) = Extend(result, pc->shift, true);
+        NEXT();
+    }
+    Op_RemS: {
+        const int64_t a = static_cast<int64_t>(R(pc->a));
+        const int64_t b = static_cast<int64_t>(R(pc->b));
+        if (b == 0) {
+            TRAP("division by zero");
+        }
+        R(pc->dst) = b == -1 ? 0 : static_cast<uint64_t>(a % b);
+        NEXT();
+    }
+    Op_DivU: {
+        if (R(pc->b) == 0) {
+            TRAP("division by zero");
+        }
+        R(pc->dst) = R(pc->a) / R(pc->b);
+        NEXT();
+    }
+    Op_RemU: {
+        if (R(pc->b) == 0) {
+            TRAP("division by zero");
+        }
+        R(pc->dst) = R(pc->a) % R(pc->b);
+        NEXT();
+    }
+
+    FLOAT_OP(AddF32, AsF32, FromF32, a + b)
+    FLOAT_OP(SubF32, AsF32, FromF32, a - b)
+    FLOAT_OP(MulF32, AsF32, FromF32, a * b)
+    FLOAT_OP(DivF32, AsF32, FromF32, a / b)
+    FLOAT_OP(RemF32, AsF32, FromF32, std::fmod(a, b))
+    FLOAT_OP(AddF64, AsF64, FromF64, a + b)
+    FLOAT_OP(SubF64, AsF64, FromF64, a - b)
+    FLOAT_OP(MulF64, AsF64, FromF64, a * b)
+    FLOAT_OP(DivF64, AsF64, FromF64, a / b)
+    FLOAT_OP(RemF64, AsF64, FromF64, std::fmod(a, b))
+
+    LOAD_OP(LoadS8, int8_t)
+    LOAD_OP(LoadU8, uint8_t)
+    LOAD_OP(LoadS16, int16_t)
+    LOAD_OP(LoadU16, uint16_t)
+    LOAD_OP(LoadS32, int32_t)
+    LOAD_OP(LoadU32, uint32_t)
+    LOAD_OP(Load64, uint64_t)
+
+    STORE_OP(Store8, uint8_t)
+    STORE_OP(Store16, uint16_t)
+    STORE_OP(Store32, uint32_t)
+    STORE_OP(Store64, uint64_t)
+
+    Op_Jump: {
+        pc = code + pc->dst;
+        DISPATCH();
+    }
+
+    BRANCH_OP(BeqI, static_cast<uint64_t>, ==)
+    BRANCH_OP(BneI, static_cast<uint64_t>, !=)
+    BRANCH_OP(BeqF32, AsF32, ==)
+    BRANCH_OP(BneF32, AsF32, !=)
+    BRANCH_OP(BeqF64, AsF64, ==)
+    BRANCH_OP(BneF64, AsF64, !=)
+    BRANCH_OP(BgtS, static_cast<int64_t>, >)
+    BRANCH_OP(BltS, static_cast<int64_t>, <)
+    BRANCH_OP(BgeS, static_cast<int64_t>, >=)
+    BRANCH_OP(BleS, static_cast<int64_t>, <=)
+    BRANCH_OP(BgtU, static_cast<uint64_t>, >)
+    BRANCH_OP(BltU, static_cast<uint64_t>, <)
+    BRANCH_OP(BgeU, static_cast<uint64_t>, >=)
+    BRANCH_OP(BleU, static_cast<uint64_t>, <=)
+    BRANCH_OP(BgtF32, AsF32, >)
+    BRANCH_OP(BltF32, AsF32, <)
+    BRANCH_OP(BgeF32, AsF32, >=)
+    BRANCH_OP(BleF32, AsF32, <=)
+    BRANCH_OP(BgtF64, AsF64, >)
+    BRANCH_OP(BltF64, AsF64, <)
+    BRANCH_OP(BgeF64, AsF64, >=)
+    BRANCH_OP(BleF64, AsF64, <=)
+
+    Op_Call: {
+        const DecodedFunction* callee = mDecoded[pc->c].get();
+        if (callee->code.empty()) {
+            fn = callee;
+            TRAP("function has no body");
+        }
+
+        uint64_t* calleeRegs = regs + fn->frameSize;
+        if (calleeRegs + callee->frameSize > stackEnd) {
+            TRAP("stack overflow");
+        }
+        enterFrame(callee, calleeRegs);
+        const uint32_t* args = extra + pc->a;
+        for (uint32_t i = 0; i < pc->b; ++i) {
+            calleeRegs[i] = R(args[i]);
+        }
+
+        mFrames.push_back(Frame{fn, regs, static_cast<uint32_t>(pc + 1 - code), pc->dst, memoryTop});
+        fn = callee;
+        regs = calleeRegs;
+        code = callee->code.data();
+        extra = callee->extra.data();
+        pc = code;
+        DISPATCH();
+    }
+
+    Op_Ret: {
+        const uint64_t value = R(pc->a);
+        if (mFrames.empty()) {
+            mResult = TruncateFromSlot(value, fn->retType);
+            return true;
+        }
+
+        const Frame& frame = mFrames.back();
+        fn = frame.func;
+        regs = frame.regs;
+        code = fn->code.data();
+        extra = fn->extra.data();
+        pc = code + frame.returnPc;
+        memoryTop = frame.memoryTop;
+        if (frame.outSlot != kNoSlot) {
+            R(frame.outSlot) = value;
+        }
+        mFrames.pop_back();
+        DISPATCH();
+    }
+
+    Op_RetVoid: {
+        if (mFrames.empty()) {
+            mResult = 0;
+            return true;
+        }
+
+        const Frame& frame = mFrames.back();
+        fn = frame.func;
+        regs = frame.regs;
+        code = fn->code.data();
+        extra = fn->extra.data();
+        pc = code + frame.returnPc;
+        memoryTop = frame.memoryTop;
+        mFrames.pop_back();
+        DISPATCH();
+    }
+
+    Op_Alloc: {
+        if (pc->a > mMemorySize - memoryTop) {
+            TRAP("out of memory");
+        }
+        uint8_t* ptr = memory + memoryTop;
+        std::memset(ptr, 0, pc->a);
+        memoryTop += pc->a;
+        R(pc->dst) = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(ptr));
+        NEXT();
+    }
+
+    Op_Mv: {
+        R(pc->dst) = R(pc->a);
+        NEXT();
+    }
+
+    Op_NullCheck: {
+        if (R(pc->a) == 0) {
+            TRAP("null check failed");
+        }
+        NEXT();
+    }
+
+    Op_BoundsCheck: {
+        const uint64_t ptr = R(pc->a);
+        const uint64_t array = R(pc->b);
+        if (ptr < array || ptr - array >= pc->c) {
+            TRAP("bounds check failed");
+        }
+        NEXT();
+    }
+
+    Op_PhiMoves: {
+        // Inputs are read before any phi is written, as all phis of a block take their values at once
+        const uint32_t* moves = extra + pc->a;
+        for (uint32_t i = 0; i < pc->b; ++i) {
+            scratch[i] = R(moves[2 * i + 1]);
+        }
+        for (uint32_t i = 0; i < pc->b; ++i) {
+            R(moves[2 * i]) = scratch[i];
+        }
+        NEXT();
+    }
+
+#undef R
+#undef DISPATCH
+#undef NEXT
+#undef TRAP
+#undef INT_OP
+#undef FLOAT_OP
+#undef LOAD_OP
+#undef STORE_OP
+#undef BRANCH_OP
+
+Trap:
+    return Error(std::string(trap) + " in #" + fn->func->GetName());
+}
+
+}   // namespace VMIR
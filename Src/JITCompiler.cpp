@@ -0,0 +1,1086 @@
+#include <JITCompiler.h>
+#include <IRBuilder.h>
+#include <RegisterAllocator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace VMIR {
+
+namespace {
+
+enum Register : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// XMM registers are encoded with the same numbers, xmm14 and xmm15 are scratch registers
+constexpr uint8_t XMM0 = 0;
+constexpr uint8_t XMM14 = 14;
+constexpr uint8_t XMM15 = 15;
+
+enum Condition : uint8_t { CondB = 0x2, CondAE = 0x3, CondE = 0x4, CondNE = 0x5, CondBE = 0x6, CondA = 0x7,
+                           CondP = 0xA, CondL = 0xC, CondGE = 0xD, CondLE = 0xE, CondG = 0xF };
+
+// Locations of RegisterAllocator are indices in these arrays. Callee-saved registers go first
+constexpr uint8_t kGPRegisters[JITCompiler::kGPRegisterCount] = {RBX, R12, R13, R14, R15, RSI, RDI, R8, R9, R10};
+constexpr uint8_t kFPRegisters[JITCompiler::kFPRegisterCount] = {8, 9, 10, 11, 12, 13};
+constexpr uint32_t kCalleeSavedCount = 5;
+
+constexpr uint8_t kIntArgRegisters[] = {RDI, RSI, RDX, RCX, R8, R9};
+constexpr uint32_t kFPArgRegisterCount = 8;
+
+constexpr uint32_t kMaxFrameSize = 1 << 20;
+
+enum TrapKind : uint32_t { TrapNullCheck, TrapBoundsCheck, TrapDivisionByZero, TrapCount };
+
+struct TrapState {
+    std::jmp_buf* target{nullptr};
+    std::string message{};
+};
+thread_local TrapState gTrapState{};
+
+// Called from compiled code, so there must be no objects with destructors here
+[[noreturn]] void TrapHandler(uint32_t kind, const char* name) {
+    static const char* const kMessages[TrapCount] = {"null check failed", "bounds check failed", "division by zero"};
+    gTrapState.message.assign(kMessages[kind]);
+    gTrapState.message.append(" in #");
+    gTrapState.message.append(name);
+
+    if (gTrapState.target == nullptr) {
+        std::fprintf(stderr, "%s\n", gTrapState.message.c_str());
+        std::abort();
+    }
+    std::longjmp(*gTrapState.target, 1);
+}
+
+
+// r/m operand of an instruction: register, slot of the frame or memory at r11
+struct RM {
+    enum Kind : uint8_t { Direct, Frame, AtR11 } kind;
+    uint8_t reg;
+    int32_t disp;
+};
+
+inline RM Direct(uint8_t reg) { return RM{RM::Direct, reg, 0}; }
+inline RM Frame(int32_t disp) { return RM{RM::Frame, RBP, disp}; }
+inline RM AtR11() { return RM{RM::AtR11, R11, 0}; }
+
+class Assembler {
+public:
+    inline size_t Size() const { return mCode.size(); }
+    inline const std::vector<uint8_t>& GetCode() const { return mCode; }
+
+    inline void Byte(uint8_t byte) { mCode.push_back(byte); }
+    inline void Imm32(uint32_t imm) { Append(&imm, sizeof(imm)); }
+    inline void Imm64(uint64_t imm) { Append(&imm, sizeof(imm)); }
+
+    inline void PatchImm32(size_t pos, uint32_t imm) { std::memcpy(mCode.data() + pos, &imm, sizeof(imm)); }
+
+    // [prefix] [REX] opcode ModRM [disp32]
+    void Instr(uint8_t prefix, bool w, std::initializer_list<uint8_t> opcode, uint8_t reg, RM rm) {
+        if (prefix != 0) {
+            Byte(prefix);
+        }
+        const uint8_t rex = static_cast<uint8_t>(0x40 | (w ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0) | ((rm.reg & 8) ? 0x01 : 0));
+        if (rex != 0x40) {
+            Byte(rex);
+        }
+        for (uint8_t byte : opcode) {
+            Byte(byte);
+        }
+        switch (rm.kind) {
+            case RM::Direct:    Byte(static_cast<uint8_t>(0xC0 | (reg & 7) << 3 | (rm.reg & 7))); break;
+            case RM::AtR11:     Byte(static_cast<uint8_t>(0x00 | (reg & 7) << 3 | (rm.reg & 7))); break;
+            case RM::Frame:     Byte(static_cast<uint8_t>(0x80 | (reg & 7) << 3 | (rm.reg & 7)));
+                                Imm32(static_cast<uint32_t>(rm.disp)); break;
+        }
+    }
+
+    // 64-bit moves between general purpose registers and memory
+    inline void Mov(RM dst, uint8_t src) { Instr(0, true, {0x89}, src, dst); }
+    inline void Mov(uint8_t dst, RM src) { Instr(0, true, {0x8B}, dst, src); }
+    inline void MovRR(uint8_t dst, uint8_t src) {
+        if (dst != src) {
+            Mov(Direct(dst), src);
+        }
+    }
+
+    // movq/movd between general purpose and XMM registers
+    inline void MovToXmm(uint8_t xmm, uint8_t gp) { Instr(0x66, true, {0x0F, 0x6E}, xmm, Direct(gp)); }
+    inline void MovFromXmm(uint8_t gp, uint8_t xmm, bool is64) { Instr(0x66, is64, {0x0F, 0x7E}, xmm, Direct(gp)); }
+
+    void MovImm(uint8_t reg, uint64_t imm) {
+        if (imm == 0) {
+            Instr(0, false, {0x31}, reg, Direct(reg));
+        }
+        else if (imm <= UINT32_MAX) {
+            if (reg & 8) {
+                Byte(0x41);
+            }
+            Byte(static_cast<uint8_t>(0xB8 + (reg & 7)));
+            Imm32(static_cast<uint32_t>(imm));
+        }
+        else if (static_cast<int64_t>(imm) >= INT32_MIN && static_cast<int64_t>(imm) < 0) {
+            Instr(0, true, {0xC7}, 0, Direct(reg));
+            Imm32(static_cast<uint32_t>(imm));
+        }
+        else {
+            Byte(static_cast<uint8_t>((reg & 8) ? 0x49 : 0x48));
+            Byte(static_cast<uint8_t>(0xB8 + (reg & 7)));
+            Imm64(imm);
+        }
+    }
+
+    inline void CallAbsolute(const void* target) {
+        MovImm(R11, reinterpret_cast<uintptr_t>(target));
+        Instr(0, false, {0xFF}, 2, Direct(R11));
+    }
+
+    inline uint32_t NewLabel() {
+        mLabels.push_back(SIZE_MAX);
+        return static_cast<uint32_t>(mLabels.size() - 1);
+    }
+    inline void Bind(uint32_t label) { mLabels[label] = Size(); }
+
+    inline void Jump(uint32_t label) {
+        Byte(0xE9);
+        AddFixup(label);
+    }
+    inline void JumpIf(Condition cond, uint32_t label) {
+        Byte(0x0F);
+        Byte(static_cast<uint8_t>(0x80 | cond));
+        AddFixup(label);
+    }
+
+    // Writes offsets of all jumps, labels must be bound by then
+    void ResolveLabels() {
+        for (auto [pos, label] : mFixups) {
+            PatchImm32(pos, static_cast<uint32_t>(static_cast<int64_t>(mLabels[label]) - static_cast<int64_t>(pos + 4)));
+        }
+        mFixups.clear();
+    }
+
+private:
+    inline void Append(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        mCode.insert(mCode.end(), bytes, bytes + size);
+    }
+
+    inline void AddFixup(uint32_t label) {
+        mFixups.emplace_back(Size(), label);
+        Imm32(0);
+    }
+
+    std::vector<uint8_t> mCode{};
+    std::vector<size_t> mLabels{};
+    std::vector<std::pair<size_t, uint32_t>> mFixups{};
+};
+
+
+// Functions compiled together, calls between them are patched once all of them are emitted
+struct Batch {
+    const std::unordered_map<const Function*, void*>& compiled;
+    std::vector<Function*> functions{};
+    std::unordered_map<const Function*, uint32_t> ids{};
+    std::vector<std::pair<size_t, uint32_t>> calls{};
+
+    uint32_t GetId(Function* func) {
+        auto [it, inserted] = ids.try_emplace(func, static_cast<uint32_t>(functions.size()));
+        if (inserted) {
+            functions.push_back(func);
+        }
+        return it->second;
+    }
+};
+
+
+inline bool IsSignedType(ValueType type) {
+    return type == ValueType::Int8 || type == ValueType::Int16 || type == ValueType::Int32 || type == ValueType::Int64;
+}
+
+inline bool IsFPType(ValueType type) {
+    return type == ValueType::Float32 || type == ValueType::Float64;
+}
+
+inline uint32_t TypeSize(ValueType type) {
+    switch (type) {
+        default:                    return 0;
+        case ValueType::Int8:
+        case ValueType::Uint8:      return 1;
+        case ValueType::Int16:
+        case ValueType::Uint16:     return 2;
+        case ValueType::Int32:
+        case ValueType::Uint32:
+        case ValueType::Float32:    return 4;
+        case ValueType::Int64:
+        case ValueType::Uint64:
+        case ValueType::Float64:
+        case ValueType::Pointer:    return 8;
+    }
+}
+
+// Integers are kept sign- or zero-extended to 64 bits, like in the Interpreter
+inline uint64_t ExtendToRegister(uint64_t bits, ValueType type) {
+    const uint32_t shift = IsFPType(type) ? 0 : 64 - 8 * TypeSize(type);
+    return IsSignedType(type) ? static_cast<uint64_t>(static_cast<int64_t>(bits << shift) >> shift) : (bits << shift) >> shift;
+}
+
+
+class FunctionLowering {
+public:
+    FunctionLowering(IRContext* context, Function* func, const char* name, Assembler& as, Batch& batch)
+        : mContext{context}, mFunc{func}, mName{name}, mAs{as}, mBatch{batch} {}
+
+    bool Lower();
+    inline const std::string& GetError() const { return mError; }
+
+private:
+    inline bool Error(const std::string& message) {
+        mError = message;
+        return false;
+    }
+
+    bool AllocateRegisters();
+    bool LayoutFrame();
+
+    // Frame slots are addressed from rbp, slot 0 is right below the saved rbp
+    static inline int32_t SlotDisp(uint32_t slot) { return -8 * static_cast<int32_t>(slot + 1); }
+    inline int32_t SaveDisp(uint32_t gpId) const { return SlotDisp(gpId); }
+    inline int32_t FPSaveDisp(uint32_t fpId) const { return SlotDisp(JITCompiler::kGPRegisterCount + fpId); }
+
+    // Values are read at mReadPosition and written at mWritePosition, as their locations change along the code
+    void LoadBits(uint8_t reg, const Value* value, bool fromSaveArea = false);
+    void StoreBits(const Value* value, uint8_t reg);
+    void LoadLocation(uint8_t reg, const Location& location);
+    void StoreLocation(const Location& location, uint8_t reg);
+    void Normalize(ValueType type, bool isSigned);
+    void EmitMoves(size_t count, const std::function<void(uint32_t)>& load, const std::function<void(uint32_t)>& store);
+
+    void SaveCallerSaved();
+    void RestoreCallerSaved();
+
+    void EmitPrologue();
+    void EmitEpilogue();
+    bool EmitInstruction(Instruction* inst, const BasicBlock* next);
+    void EmitArithmetic(Instruction* inst);
+    void EmitBranch(Instruction* inst, const BasicBlock* next);
+    void EmitCall(Instruction* inst);
+    void EmitEdge(const BasicBlock* pred, const BasicBlock* succ, const BasicBlock* next);
+    void EmitEdgeStubs();
+    void EmitTraps();
+
+    uint32_t TrapLabel(TrapKind kind);
+
+    IRContext* mContext{nullptr};
+    Function* mFunc{nullptr};
+    const char* mName{nullptr};
+    Assembler& mAs;
+    Batch& mBatch;
+    std::string mError{};
+
+    std::unique_ptr<RegisterAllocator> mAllocator{};
+    uint64_t mReadPosition{0};
+    uint64_t mWritePosition{0};
+
+    uint32_t mUsedGP{0};
+    uint32_t mUsedFP{0};
+    uint32_t mSpillBase{0};
+    uint32_t mScratchBase{0};
+    uint32_t mFrameSize{0};
+
+    std::unordered_map<const Value*, uint32_t> mArgSlots{};
+    std::unordered_map<const Instruction*, int32_t> mAllocDisps{};
+
+    std::unordered_map<const BasicBlock*, uint32_t> mBlockLabels{};
+    struct EdgeStub {
+        const BasicBlock* pred;
+        const BasicBlock* succ;
+        uint32_t label;
+    };
+    std::vector<EdgeStub> mEdgeStubs{};
+    uint32_t mTrapLabels[TrapCount]{UINT32_MAX, UINT32_MAX, UINT32_MAX};
+};
+
+
+bool FunctionLowering::AllocateRegisters() {
+    ControlFlowGraph* graph = mContext->GetOrCreateControlFlowGraph(mFunc);
+    mAllocator = std::make_unique<RegisterAllocator>(mContext, graph, JITCompiler::kGPRegisterCount, JITCompiler::kFPRegisterCount);
+    if (!mAllocator->PerformRegisterAllocation()) {
+        return Error("register allocation failed for #" + mFunc->GetName());
+    }
+    return true;
+}
+
+bool FunctionLowering::LayoutFrame() {
+    uint32_t spillCount = 0;
+    size_t maxMoves = 0;
+    uint32_t allocBytes = 0;
+    for (auto* bb : mFunc->GetBasicBlocks()) {
+        size_t phiCount = 0;
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            if (inst->IsPhi()) {
+                ++phiCount;
+            }
+            maxMoves = std::max(maxMoves, mAllocator->GetMovesBefore(inst).size());
+            if (inst->GetType() == InstructionType::Alloc) {
+                const InstructionAlloc* alloc = static_cast<const InstructionAlloc*>(inst);
+                const uint64_t size = (uint64_t(TypeSize(alloc->GetValueType())) * alloc->GetCount() + 7) & ~uint64_t(7);
+                if (size + allocBytes > kMaxFrameSize) {
+                    return Error("allocs of #" + mFunc->GetName() + " do not fit into the frame");
+                }
+                allocBytes += static_cast<uint32_t>(size);
+                mAllocDisps.emplace(inst, -static_cast<int32_t>(allocBytes));
+            }
+
+            const Value* output = inst->GetOutput();
+            if (output == nullptr) {
+                continue;
+            }
+            std::vector<Location> locations{output->GetLocation()};
+            for (const LocationSplit& split : output->GetLocationSplits()) {
+                locations.push_back(split.location);
+            }
+            for (const Location& location : locations) {
+                if (const auto* gp = std::get_if<GPRegisterLocation>(&location); gp != nullptr) {
+                    if (gp->registerId >= JITCompiler::kGPRegisterCount) {
+                        return Error("invalid register location in #" + mFunc->GetName());
+                    }
+                    mUsedGP |= 1u << gp->registerId;
+                }
+                else if (const auto* fp = std::get_if<FPRegisterLocation>(&location); fp != nullptr) {
+                    if (fp->registerId >= JITCompiler::kFPRegisterCount) {
+                        return Error("invalid register location in #" + mFunc->GetName());
+                    }
+                    mUsedFP |= 1u << fp->registerId;
+                }
+                else {
+                    spillCount = std::max(spillCount, std::get<StackLocation>(location).stackLocationId + 1);
+                }
+            }
+        }
+        for (auto* pred : bb->GetPredecessors()) {
+            maxMoves = std::max(maxMoves, phiCount + mAllocator->GetEdgeMoves(pred, bb).size());
+        }
+    }
+
+    // Save areas of all allocatable registers, spills, arguments and move scratch
+    uint32_t slotCount = JITCompiler::kGPRegisterCount + JITCompiler::kFPRegisterCount;
+    mSpillBase = slotCount;
+    slotCount += spillCount;
+    for (auto* arg : mFunc->GetArgs()) {
+        mArgSlots.emplace(arg, slotCount++);
+    }
+    mScratchBase = slotCount;
+    slotCount += static_cast<uint32_t>(maxMoves);
+
+    const uint32_t slotBytes = 8 * slotCount;
+    for (auto& [inst, disp] : mAllocDisps) {
+        disp -= static_cast<int32_t>(slotBytes);
+    }
+    mFrameSize = (slotBytes + allocBytes + 15) & ~15u;
+    if (mFrameSize > kMaxFrameSize) {
+        return Error("frame of #" + mFunc->GetName() + " is too large");
+    }
+    return true;
+}
+
+
+void FunctionLowering::LoadBits(uint8_t reg, const Value* value, bool fromSaveArea) {
+    if (value->HasValue()) {
+        return mAs.MovImm(reg, ExtendToRegister(value->GetBitPattern(), value->GetValueType()));
+    }
+    if (auto it = mArgSlots.find(value); it != mArgSlots.end()) {
+        return mAs.Mov(reg, Frame(SlotDisp(it->second)));
+    }
+
+    const Location location = value->GetLocationAt(mReadPosition);
+    if (fromSaveArea) {
+        if (const auto* gp = std::get_if<GPRegisterLocation>(&location); gp != nullptr && gp->registerId >= kCalleeSavedCount) {
+            return mAs.Mov(reg, Frame(SaveDisp(gp->registerId)));
+        }
+        if (const auto* fp = std::get_if<FPRegisterLocation>(&location); fp != nullptr) {
+            return mAs.Mov(reg, Frame(FPSaveDisp(fp->registerId)));
+        }
+    }
+    LoadLocation(reg, location);
+}
+
+void FunctionLowering::StoreBits(const Value* value, uint8_t reg) {
+    StoreLocation(value->GetLocationAt(mWritePosition), reg);
+}
+
+void FunctionLowering::LoadLocation(uint8_t reg, const Location& location) {
+    if (const auto* gp = std::get_if<GPRegisterLocation>(&location); gp != nullptr) {
+        return mAs.MovRR(reg, kGPRegisters[gp->registerId]);
+    }
+    if (const auto* fp = std::get_if<FPRegisterLocation>(&location); fp != nullptr) {
+        return mAs.MovFromXmm(reg, kFPRegisters[fp->registerId], true);
+    }
+    mAs.Mov(reg, Frame(SlotDisp(mSpillBase + std::get<StackLocation>(location).stackLocationId)));
+}
+
+void FunctionLowering::StoreLocation(const Location& location, uint8_t reg) {
+    if (const auto* gp = std::get_if<GPRegisterLocation>(&location); gp != nullptr) {
+        mAs.MovRR(kGPRegisters[gp->registerId], reg);
+    }
+    else if (const auto* fp = std::get_if<FPRegisterLocation>(&location); fp != nullptr) {
+        mAs.MovToXmm(kFPRegisters[fp->registerId], reg);
+    }
+    else {
+        mAs.Mov(Frame(SlotDisp(mSpillBase + std::get<StackLocation>(location).stackLocationId)), reg);
+    }
+}
+
+
+// Moves are done at once: with several moves all sources are read into the scratch slots first
+void FunctionLowering::EmitMoves(size_t count, const std::function<void(uint32_t)>& load, const std::function<void(uint32_t)>& store) {
+    if (count == 1) {
+        load(0);
+        return store(0);
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        load(i);
+        mAs.Mov(Frame(SlotDisp(mScratchBase + i)), RAX);
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        mAs.Mov(RAX, Frame(SlotDisp(mScratchBase + i)));
+        store(i);
+    }
+}
+
+// Extends rax from the width of the type to 64 bits
+void FunctionLowering::Normalize(ValueType type, bool isSigned) {
+    switch (TypeSize(type)) {
+        default:    break;
+        case 4:     isSigned ? mAs.Instr(0, true, {0x63}, RAX, Direct(RAX)) : mAs.Instr(0, false, {0x89}, RAX, Direct(RAX)); break;
+        case 2:     mAs.Instr(0, isSigned, {0x0F, static_cast<uint8_t>(isSigned ? 0xBF : 0xB7)}, RAX, Direct(RAX)); break;
+        case 1:     mAs.Instr(0, isSigned, {0x0F, static_cast<uint8_t>(isSigned ? 0xBE : 0xB6)}, RAX, Direct(RAX)); break;
+    }
+}
+
+void FunctionLowering::SaveCallerSaved() {
+    for (uint32_t id = kCalleeSavedCount; id < JITCompiler::kGPRegisterCount; ++id) {
+        if (mUsedGP & (1u << id)) {
+            mAs.Mov(Frame(SaveDisp(id)), kGPRegisters[id]);
+        }
+    }
+    for (uint32_t id = 0; id < JITCompiler::kFPRegisterCount; ++id) {
+        if (mUsedFP & (1u << id)) {
+            // movq m64, xmm
+            mAs.Instr(0x66, false, {0x0F, 0xD6}, kFPRegisters[id], Frame(FPSaveDisp(id)));
+        }
+    }
+}
+
+void FunctionLowering::RestoreCallerSaved() {
+    for (uint32_t id = kCalleeSavedCount; id < JITCompiler::kGPRegisterCount; ++id) {
+        if (mUsedGP & (1u << id)) {
+            mAs.Mov(kGPRegisters[id], Frame(SaveDisp(id)));
+        }
+    }
+    for (uint32_t id = 0; id < JITCompiler::kFPRegisterCount; ++id) {
+        if (mUsedFP & (1u << id)) {
+            // movq xmm, m64
+            mAs.Instr(0xF3, false, {0x0F, 0x7E}, kFPRegisters[id], Frame(FPSaveDisp(id)));
+        }
+    }
+}
+
+
+void FunctionLowering::EmitPrologue() {
+    mAs.Byte(0x55);                                         // push rbp
+    mAs.Mov(Direct(RBP), RSP);                              // mov rbp, rsp
+    mAs.Instr(0, true, {0x81}, 5, Direct(RSP));             // sub rsp, imm32
+    mAs.Imm32(mFrameSize);
+
+    for (uint32_t id = 0; id < kCalleeSavedCount; ++id) {
+        if (mUsedGP & (1u << id)) {
+            mAs.Mov(Frame(SaveDisp(id)), kGPRegisters[id]);
+        }
+    }
+
+    // Callers are not required to extend narrow integers, so arguments are extended here
+    uint32_t intIdx = 0;
+    uint32_t fpIdx = 0;
+    for (auto* arg : mFunc->GetArgs()) {
+        const ValueType type = arg->GetValueType();
+        if (IsFPType(type)) {
+            mAs.MovFromXmm(RAX, static_cast<uint8_t>(XMM0 + fpIdx++), type == ValueType::Float64);
+        }
+        else {
+            mAs.MovRR(RAX, kIntArgRegisters[intIdx++]);
+            Normalize(type, IsSignedType(type));
+        }
+        mAs.Mov(Frame(SlotDisp(mArgSlots.at(arg))), RAX);
+    }
+
+    if (mFunc->GetEntryBasicBlock() != mFunc->GetBasicBlocks().front()) {
+        mAs.Jump(mBlockLabels.at(mFunc->GetEntryBasicBlock()));
+    }
+}
+
+void FunctionLowering::EmitEpilogue() {
+    for (uint32_t id = 0; id < kCalleeSavedCount; ++id) {
+        if (mUsedGP & (1u << id)) {
+            mAs.Mov(kGPRegisters[id], Frame(SaveDisp(id)));
+        }
+    }
+    mAs.Byte(0xC9);                                         // leave
+    mAs.Byte(0xC3);                                         // ret
+}
+
+
+uint32_t FunctionLowering::TrapLabel(TrapKind kind) {
+    if (mTrapLabels[kind] == UINT32_MAX) {
+        mTrapLabels[kind] = mAs.NewLabel();
+    }
+    return mTrapLabels[kind];
+}
+
+void FunctionLowering::EmitTraps() {
+    for (uint32_t kind = 0; kind < TrapCount; ++kind) {
+        if (mTrapLabels[kind] == UINT32_MAX) {
+            continue;
+        }
+        mAs.Bind(mTrapLabels[kind]);
+        mAs.MovImm(RDI, kind);
+        mAs.MovImm(RSI, reinterpret_cast<uintptr_t>(mName));
+        mAs.CallAbsolute(reinterpret_cast<const void*>(&TrapHandler));
+    }
+}
+
+
+// Jumps along the edge, through a stub with moves if the successor has phis or values change locations
+void FunctionLowering::EmitEdge(const BasicBlock* pred, const BasicBlock* succ, const BasicBlock* next) {
+    const bool hasMoves = !mAllocator->GetEdgeMoves(pred, succ).empty() || (succ->Front() != nullptr && succ->Front()->IsPhi());
+    if (!hasMoves) {
+        if (succ != next) {
+            mAs.Jump(mBlockLabels.at(succ));
+        }
+        return;
+    }
+
+    for (const EdgeStub& stub : mEdgeStubs) {
+        if (stub.pred == pred && stub.succ == succ) {
+            return mAs.Jump(stub.label);
+        }
+    }
+    mEdgeStubs.push_back(EdgeStub{pred, succ, mAs.NewLabel()});
+    mAs.Jump(mEdgeStubs.back().label);
+}
+
+void FunctionLowering::EmitEdgeStubs() {
+    for (const EdgeStub& stub : mEdgeStubs) {
+        mAs.Bind(stub.label);
+
+        std::vector<std::pair<const Value*, const Value*>> phis{};
+        for (auto* inst = stub.succ->Front(); inst != nullptr && inst->IsPhi(); inst = inst->GetNext()) {
+            phis.emplace_back(inst->GetOutput(), static_cast<InstructionPhi*>(inst)->GetInputFrom(stub.pred));
+        }
+        const auto& moves = mAllocator->GetEdgeMoves(stub.pred, stub.succ);
+
+        // All phis take their inputs at once, together with the values which change locations on the edge
+        mReadPosition = stub.pred->GetLiveRange().end - 1;
+        mWritePosition = stub.succ->GetLiveRange().start;
+        EmitMoves(phis.size() + moves.size(),
+            [&](uint32_t i) { i < phis.size() ? LoadBits(RAX, phis[i].second) : LoadLocation(RAX, moves[i - phis.size()].from); },
+            [&](uint32_t i) { i < phis.size() ? StoreBits(phis[i].first, RAX) : StoreLocation(moves[i - phis.size()].to, RAX); });
+        mAs.Jump(mBlockLabels.at(stub.succ));
+    }
+}
+
+
+void FunctionLowering::EmitArithmetic(Instruction* inst) {
+    const InstructionType type = inst->GetType();
+    Value* output = inst->GetOutput();
+    const ValueType vt = output->GetValueType();
+    const bool isSigned = IsSignedType(vt);
+    const uint8_t mask = static_cast<uint8_t>(8 * TypeSize(vt) - 1);
+
+    LoadBits(RAX, inst->operands()[0]);
+    LoadBits(RCX, inst->operands()[1]);
+
+    if (IsFPType(vt)) {
+        const bool is64 = vt == ValueType::Float64;
+        if (type == InstructionType::Rem) {
+            SaveCallerSaved();
+            mAs.MovToXmm(XMM0, RAX);
+            mAs.MovToXmm(1, RCX);
+            double (*fmod64)(double, double) = &std::fmod;
+            float (*fmod32)(float, float) = &std::fmod;
+            mAs.CallAbsolute(is64 ? reinterpret_cast<const void*>(fmod64) : reinterpret_cast<const void*>(fmod32));
+            mAs.MovFromXmm(RAX, XMM0, is64);
+            RestoreCallerSaved();
+            return StoreBits(output, RAX);
+        }
+
+        uint8_t opcode = 0;
+        switch (type) {
+            default:
+            case InstructionType::Add:  opcode = 0x58; break;
+            case InstructionType::Sub:  opcode = 0x5C; break;
+            case InstructionType::Mul:  opcode = 0x59; break;
+            case InstructionType::Div:  opcode = 0x5E; break;
+        }
+        mAs.MovToXmm(XMM14, RAX);
+        mAs.MovToXmm(XMM15, RCX);
+        mAs.Instr(is64 ? 0xF2 : 0xF3, false, {0x0F, opcode}, XMM14, Direct(XMM15));
+        mAs.MovFromXmm(RAX, XMM14, is64);
+        return StoreBits(output, RAX);
+    }
+
+    switch (type) {
+        default:    break;
+        case InstructionType::Add:  mAs.Instr(0, true, {0x01}, RCX, Direct(RAX)); break;
+        case InstructionType::Sub:  mAs.Instr(0, true, {0x29}, RCX, Direct(RAX)); break;
+        case InstructionType::And:  mAs.Instr(0, true, {0x21}, RCX, Direct(RAX)); break;
+        case InstructionType::Or:   mAs.Instr(0, true, {0x09}, RCX, Direct(RAX)); break;
+        case InstructionType::Xor:  mAs.Instr(0, true, {0x31}, RCX, Direct(RAX)); break;
+        case InstructionType::Mul:  mAs.Instr(0, true, {0x0F, 0xAF}, RAX, Direct(RCX)); break;
+
+        // Shift amounts are masked with the bit width, Shr is unsigned and Ashr is signed for any type
+        case InstructionType::Shl:
+        case InstructionType::Shr:
+        case InstructionType::Ashr: {
+            mAs.Instr(0, false, {0x83}, 4, Direct(RCX));        // and ecx, imm8
+            mAs.Byte(mask);
+            uint8_t ext = 4;
+            if (type == InstructionType::Shr) {
+                Normalize(vt, false);
+                ext = 5;
+            }
+            else if (type == InstructionType::Ashr) {
+                Normalize(vt, true);
+                ext = 7;
+            }
+            mAs.Instr(0, true, {0xD3}, ext, Direct(RAX));
+            break;
+        }
+
+        case InstructionType::Div:
+        case InstructionType::Rem: {
+            const bool isRem = type == InstructionType::Rem;
+            mAs.Instr(0, true, {0x85}, RCX, Direct(RCX));       // test rcx, rcx
+            mAs.JumpIf(CondE, TrapLabel(TrapDivisionByZero));
+            if (isSigned) {
+                // Division by -1 is a negation, which wraps instead of faulting on the minimal value
+                const uint32_t divide = mAs.NewLabel();
+                const uint32_t done = mAs.NewLabel();
+                mAs.Instr(0, true, {0x83}, 7, Direct(RCX));     // cmp rcx, -1
+                mAs.Byte(0xFF);
+                mAs.JumpIf(CondNE, divide);
+                if (isRem) {
+                    mAs.MovImm(RAX, 0);
+                }
+                else {
+                    mAs.Instr(0, true, {0xF7}, 3, Direct(RAX)); // neg rax
+                }
+                mAs.Jump(done);
+                mAs.Bind(divide);
+                mAs.Byte(0x48);                                 // cqo
+                mAs.Byte(0x99);
+                mAs.Instr(0, true, {0xF7}, 7, Direct(RCX));     // idiv rcx
+                if (isRem) {
+                    mAs.MovRR(RAX, RDX);
+                }
+                mAs.Bind(done);
+            }
+            else {
+                mAs.MovImm(RDX, 0);
+                mAs.Instr(0, true, {0xF7}, 6, Direct(RCX));     // div rcx
+                if (isRem) {
+                    mAs.MovRR(RAX, RDX);
+                }
+            }
+            break;
+        }
+    }
+
+    Normalize(vt, isSigned);
+    StoreBits(output, RAX);
+}
+
+void FunctionLowering::EmitBranch(Instruction* inst, const BasicBlock* next) {
+    const InstructionBranch* branch = static_cast<const InstructionBranch*>(inst);
+    const BasicBlock* bb = inst->GetParentBasicBlock();
+    const InstructionType type = inst->GetType();
+    const ValueType vt = inst->operands()[0]->GetValueType();
+
+    LoadBits(RAX, inst->operands()[0]);
+    LoadBits(RCX, inst->operands()[1]);
+
+    // Each edge gets its own jump, so phi stubs can be placed on any of them
+    const uint32_t onTrue = mAs.NewLabel();
+    const uint32_t onFalse = mAs.NewLabel();
+
+    if (IsFPType(vt)) {
+        const uint8_t prefix = vt == ValueType::Float64 ? 0x66 : 0;
+        mAs.MovToXmm(XMM14, RAX);
+        mAs.MovToXmm(XMM15, RCX);
+
+        // Comparisons with NaN are false, so only "above" conditions are used, with swapped operands for Lt and Le
+        const bool swap = type == InstructionType::Blt || type == InstructionType::Ble;
+        mAs.Instr(prefix, false, {0x0F, 0x2E}, swap ? XMM15 : XMM14, Direct(swap ? XMM14 : XMM15));
+        switch (type) {
+            default:
+            case InstructionType::Beq:
+                mAs.JumpIf(CondP, onFalse);
+                mAs.JumpIf(CondE, onTrue);
+                break;
+            case InstructionType::Bne:
+                mAs.JumpIf(CondP, onTrue);
+                mAs.JumpIf(CondNE, onTrue);
+                break;
+            case InstructionType::Bgt:
+            case InstructionType::Blt:
+                mAs.JumpIf(CondA, onTrue);
+                break;
+            case InstructionType::Bge:
+            case InstructionType::Ble:
+                mAs.JumpIf(CondAE, onTrue);
+                break;
+        }
+    }
+    else {
+        // Pointers and unsigned integers are compared as unsigned
+        const bool isSigned = IsSignedType(vt);
+        Condition cond{};
+        switch (type) {
+            default:
+            case InstructionType::Beq:  cond = CondE; break;
+            case InstructionType::Bne:  cond = CondNE; break;
+            case InstructionType::Bgt:  cond = isSigned ? CondG : CondA; break;
+            case InstructionType::Blt:  cond = isSigned ? CondL : CondB; break;
+            case InstructionType::Bge:  cond = isSigned ? CondGE : CondAE; break;
+            case InstructionType::Ble:  cond = isSigned ? CondLE : CondBE; break;
+        }
+        mAs.Instr(0, true, {0x39}, RCX, Direct(RAX));           // cmp rax, rcx
+        mAs.JumpIf(cond, onTrue);
+    }
+
+    mAs.Bind(onFalse);
+    EmitEdge(bb, branch->GetFalseBasicBlock(), nullptr);
+    mAs.Bind(onTrue);
+    EmitEdge(bb, branch->GetTrueBasicBlock(), next);
+}
+
+void FunctionLowering::EmitCall(Instruction* inst) {
+    Function* callee = static_cast<const InstructionCall*>(inst)->GetFunction();
+    Value* output = inst->GetOutput();
+
+    SaveCallerSaved();
+
+    // Arguments are read from the save area, as argument registers are overwritten on the way
+    uint32_t intIdx = 0;
+    uint32_t fpIdx = 0;
+    for (Value* arg : inst->operands()) {
+        LoadBits(RAX, arg, true);
+        if (IsFPType(arg->GetValueType())) {
+            mAs.MovToXmm(static_cast<uint8_t>(XMM0 + fpIdx++), RAX);
+        }
+        else {
+            mAs.MovRR(kIntArgRegisters[intIdx++], RAX);
+        }
+    }
+
+    if (auto it = mBatch.compiled.find(callee); it != mBatch.compiled.end()) {
+        mAs.CallAbsolute(it->second);
+    }
+    else {
+        mAs.Byte(0xE8);
+        mBatch.calls.emplace_back(mAs.Size(), mBatch.GetId(callee));
+        mAs.Imm32(0);
+    }
+
+    if (output != nullptr && IsFPType(output->GetValueType())) {
+        mAs.MovFromXmm(RAX, XMM0, output->GetValueType() == ValueType::Float64);
+    }
+    RestoreCallerSaved();
+    if (output != nullptr) {
+        StoreBits(output, RAX);
+    }
+}
+
+bool FunctionLowering::EmitInstruction(Instruction* inst, const BasicBlock* next) {
+    const auto operands = inst->operands();
+    Value* output = inst->GetOutput();
+
+    switch (inst->GetType()) {
+        default:    return Error("unknown instruction in #" + mFunc->GetName());
+
+        case InstructionType::Add:
+        case InstructionType::Sub:
+        case InstructionType::Mul:
+        case InstructionType::Div:
+        case InstructionType::Rem:
+        case InstructionType::And:
+        case InstructionType::Or:
+        case InstructionType::Xor:
+        case InstructionType::Shl:
+        case InstructionType::Shr:
+        case InstructionType::Ashr: {
+            if (IsFPType(output->GetValueType()) && inst->GetType() >= InstructionType::And) {
+                return Error(std::string(InstructionTypeToStr(inst->GetType())) + " of floating point values in #" + mFunc->GetName());
+            }
+            EmitArithmetic(inst);
+            break;
+        }
+        case InstructionType::Load: {
+            const ValueType vt = output->GetValueType();
+            const bool isSigned = IsSignedType(vt);
+            LoadBits(R11, operands[0]);
+            switch (TypeSize(vt)) {
+                default:
+                case 8: mAs.Instr(0, true, {0x8B}, RAX, AtR11()); break;
+                case 4: isSigned ? mAs.Instr(0, true, {0x63}, RAX, AtR11()) : mAs.Instr(0, false, {0x8B}, RAX, AtR11()); break;
+                case 2: mAs.Instr(0, isSigned, {0x0F, static_cast<uint8_t>(isSigned ? 0xBF : 0xB7)}, RAX, AtR11()); break;
+                case 1: mAs.Instr(0, isSigned, {0x0F, static_cast<uint8_t>(isSigned ? 0xBE : 0xB6)}, RAX, AtR11()); break;
+            }
+            StoreBits(output, RAX);
+            break;
+        }
+        case InstructionType::Store: {
+            LoadBits(R11, operands[0]);
+            LoadBits(RAX, operands[1]);
+            switch (TypeSize(operands[1]->GetValueType())) {
+                default:
+                case 8: mAs.Instr(0, true, {0x89}, RAX, AtR11()); break;
+                case 4: mAs.Instr(0, false, {0x89}, RAX, AtR11()); break;
+                case 2: mAs.Instr(0x66, false, {0x89}, RAX, AtR11()); break;
+                case 1: mAs.Instr(0, false, {0x88}, RAX, AtR11()); break;
+            }
+            break;
+        }
+        case InstructionType::Jump: {
+            EmitEdge(inst->GetParentBasicBlock(), static_cast<const InstructionJump*>(inst)->GetJumpBasicBlock(), next);
+            break;
+        }
+        case InstructionType::Beq:
+        case InstructionType::Bne:
+        case InstructionType::Bgt:
+        case InstructionType::Blt:
+        case InstructionType::Bge:
+        case InstructionType::Ble: {
+            EmitBranch(inst, next);
+            break;
+        }
+        case InstructionType::Call: {
+            EmitCall(inst);
+            break;
+        }
+        case InstructionType::Ret: {
+            if (!operands.empty()) {
+                LoadBits(RAX, operands[0]);
+                if (IsFPType(operands[0]->GetValueType())) {
+                    mAs.MovToXmm(XMM0, RAX);
+                }
+            }
+            EmitEpilogue();
+            break;
+        }
+        case InstructionType::Alloc: {
+            // Memory of allocs is zeroed, the same as in the Interpreter
+            const InstructionAlloc* alloc = static_cast<const InstructionAlloc*>(inst);
+            const int32_t disp = mAllocDisps.at(inst);
+            const uint32_t qwords = static_cast<uint32_t>((uint64_t(TypeSize(alloc->GetValueType())) * alloc->GetCount() + 7) / 8);
+            mAs.MovImm(RAX, 0);
+            if (qwords <= 16) {
+                for (uint32_t i = 0; i < qwords; ++i) {
+                    mAs.Mov(Frame(disp + 8 * static_cast<int32_t>(i)), RAX);
+                }
+            }
+            else {
+                const uint32_t loop = mAs.NewLabel();
+                mAs.Instr(0, true, {0x8D}, R11, Frame(disp));   // lea r11, [rbp + disp]
+                mAs.MovImm(RCX, qwords);
+                mAs.Bind(loop);
+                mAs.Instr(0, true, {0x89}, RAX, AtR11());       // mov [r11], rax
+                mAs.Instr(0, true, {0x83}, 0, Direct(R11));     // add r11, 8
+                mAs.Byte(8);
+                mAs.Instr(0, false, {0xFF}, 1, Direct(RCX));    // dec ecx
+                mAs.JumpIf(CondNE, loop);
+            }
+            mAs.Instr(0, true, {0x8D}, RAX, Frame(disp));       // lea rax, [rbp + disp]
+            StoreBits(output, RAX);
+            break;
+        }
+        case InstructionType::Phi: {
+            // Phis take their inputs on the edges
+            break;
+        }
+        case InstructionType::Mv: {
+            LoadBits(RAX, operands[0]);
+            StoreBits(output, RAX);
+            break;
+        }
+        case InstructionType::NullCheck: {
+            LoadBits(RAX, operands[0]);
+            mAs.Instr(0, true, {0x85}, RAX, Direct(RAX));           // test rax, rax
+            mAs.JumpIf(CondE, TrapLabel(TrapNullCheck));
+            break;
+        }
+        case InstructionType::BoundsCheck: {
+            const InstructionAlloc* alloc = static_cast<const InstructionAlloc*>(operands[1]->GetProducer());
+            const uint64_t size = uint64_t(TypeSize(alloc->GetValueType())) * alloc->GetCount();
+            LoadBits(RAX, operands[0]);
+            LoadBits(RCX, operands[1]);
+            mAs.Instr(0, true, {0x29}, RCX, Direct(RAX));           // sub rax, rcx
+            mAs.Instr(0, true, {0x81}, 7, Direct(RAX));             // cmp rax, imm32
+            mAs.Imm32(static_cast<uint32_t>(size));
+            mAs.JumpIf(CondAE, TrapLabel(TrapBoundsCheck));
+            break;
+        }
+    }
+    return true;
+}
+
+
+bool FunctionLowering::Lower() {
+    const std::string& name = mFunc->GetName();
+    if (mFunc->GetBasicBlocks().empty()) {
+        return Error("#" + name + " has no body");
+    }
+    if (!mFunc->IsValid()) {
+        return Error("#" + name + " is not valid");
+    }
+
+    uint32_t intArgs = 0;
+    uint32_t fpArgs = 0;
+    for (auto* arg : mFunc->GetArgs()) {
+        if (IsFPType(arg->GetValueType())) {
+            ++fpArgs;
+        }
+        else {
+            ++intArgs;
+        }
+    }
+    if (intArgs > std::size(kIntArgRegisters) || fpArgs > kFPArgRegisterCount) {
+        return Error("#" + name + " has more arguments than fit into registers");
+    }
+
+    if (!AllocateRegisters() || !LayoutFrame()) {
+        return false;
+    }
+
+    const auto& blocks = mFunc->GetBasicBlocks();
+    for (auto* bb : blocks) {
+        mBlockLabels.emplace(bb, mAs.NewLabel());
+    }
+
+    EmitPrologue();
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        BasicBlock* bb = blocks[i];
+        const BasicBlock* next = i + 1 < blocks.size() ? blocks[i + 1] : nullptr;
+        mAs.Bind(mBlockLabels.at(bb));
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            mReadPosition = inst->GetLiveNumber() - 1;
+            mWritePosition = inst->GetLiveNumber();
+            if (const auto& moves = mAllocator->GetMovesBefore(inst); !moves.empty()) {
+                EmitMoves(moves.size(), [&](uint32_t i) { LoadLocation(RAX, moves[i].from); }, [&](uint32_t i) { StoreLocation(moves[i].to, RAX); });
+            }
+            if (!EmitInstruction(inst, next)) {
+                return false;
+            }
+        }
+    }
+    EmitEdgeStubs();
+    EmitTraps();
+    return true;
+}
+
+}   // namespace
+
+
+JITCompiler::~JITCompiler() {
+    for (const CodeRegion& region : mRegions) {
+        munmap(region.memory, region.size);
+    }
+}
+
+bool JITCompiler::Error(const std::string& message) {
+    mError = message;
+    return false;
+}
+
+void* JITCompiler::GetEntry(Function* func) {
+    if (!Compile(func)) {
+        return nullptr;
+    }
+    return mEntries.at(func);
+}
+
+bool JITCompiler::Invoke(void (*callback)(void*), void* data) {
+    std::jmp_buf target;
+    std::jmp_buf* const previous = gTrapState.target;
+    gTrapState.target = &target;
+    if (setjmp(target) != 0) {
+        gTrapState.target = previous;
+        return Error(gTrapState.message);
+    }
+    callback(data);
+    gTrapState.target = previous;
+    return true;
+}
+
+bool JITCompiler::Compile(Function* func) {
+#if !defined(__x86_64__)
+    (void)func;
+    return Error("JIT compiler supports only x86-64");
+#else
+    if (mEntries.contains(func)) {
+        return true;
+    }
+
+    Assembler as{};
+    Batch batch{mEntries};
+    batch.GetId(func);
+
+    // Callees join the batch while their callers are lowered
+    std::vector<size_t> starts{};
+    std::vector<std::unique_ptr<std::string>> names{};
+    for (size_t i = 0; i < batch.functions.size(); ++i) {
+        Function* current = batch.functions[i];
+        starts.push_back(as.Size());
+        names.push_back(std::make_unique<std::string>(current->GetName()));
+
+        FunctionLowering lowering{mContext, current, names.back()->c_str(), as, batch};
+        if (!lowering.Lower()) {
+            return Error(lowering.GetError());
+        }
+    }
+    as.ResolveLabels();
+    for (auto [pos, calleeId] : batch.calls) {
+        as.PatchImm32(pos, static_cast<uint32_t>(static_cast<int64_t>(starts[calleeId]) - static_cast<int64_t>(pos + 4)));
+    }
+
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t size = (as.Size() + pageSize - 1) / pageSize * pageSize;
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return Error("failed to map memory for the code");
+    }
+    std::memcpy(memory, as.GetCode().data(), as.Size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return Error("failed to make the code executable");
+    }
+
+    mRegions.push_back(CodeRegion{memory, size});
+    mCodeSize += as.Size();
+    for (size_t i = 0; i < batch.functions.size(); ++i) {
+        mEntries.emplace(batch.functions[i], static_cast<uint8_t*>(memory) + starts[i]);
+    }
+    for (auto& name : names) {
+        mNames.push_back(std::move(name));
+    }
+    return true;
+#endif
+}
+
+}   // namespace VMIR
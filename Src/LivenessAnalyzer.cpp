@@ -6,8 +6,10 @@
 namespace VMIR {
 
 bool LivenessAnalyzer::PerformLivenessAnalysis() {
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
-    mLoopAnalyzer = IrBuilder->GetOrCreateLoopAnalyzer(mGraph);
+    TraceScope scope{mContext->GetTraceRecorder(), "PerformLivenessAnalysis", "analysis", mGraph->GetFunction()};
+    scope.AddArg("blocks", static_cast<int64_t>(mGraph->GetBasicBlocks().size()));
+
+    mLoopAnalyzer = mContext->GetOrCreateLoopAnalyzer(mGraph);
 
     if (!mLoopAnalyzer->IsLoopTreeBuilt()) {
         mLoopAnalyzer->BuildLoopTree();
@@ -18,14 +20,26 @@ bool LivenessAnalyzer::PerformLivenessAnalysis() {
         return false;
     }
 
+    // Intervals are only extended below, so drop the ones left from the previous run
+    for (auto* bb : mGraph->GetBasicBlocks()) {
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            if (Value* output = inst->GetOutput(); output != nullptr) {
+                output->GetLiveInterval() = LiveInterval{0, 0};
+            }
+            for (Value* input : inst->operands()) {
+                if (!input->HasValue()) {
+                    input->GetLiveInterval() = LiveInterval{0, 0};
+                }
+            }
+        }
+    }
+
+    mBBLinearOrder.clear();
+    mVisited.NextEpoch();
     CreateBasicBlocksLinearOrder(mGraph->GetEntryBasicBlock());
     AssignLinearAndLiveNumbers();
     CalculateLiveRanges();
 
-    for (auto* bb : mBBLinearOrder) {
-        bb->SetUnmarked();
-    }
-
     mIsAnalysisDone = true;
     return true;
 }
@@ -45,7 +59,7 @@ bool LivenessAnalyzer::CheckIfBlockCanBeVisited(BasicBlock* block) {
             if (std::find(latches.cbegin(), latches.cend(), bb) != latches.cend()) {
                 continue;
             }
-            if (!bb->IsMarked(BasicBlock::Marker::Black)) {
+            if (!mVisited.IsVisited(bb)) {
                 return false;
             }
         }
@@ -54,7 +68,7 @@ bool LivenessAnalyzer::CheckIfBlockCanBeVisited(BasicBlock* block) {
         // block is not a loop header. So, it is regular basic block
         // Check that all predecessors are visited
         for (auto* bb : block->GetPredecessors()) {
-            if (!bb->IsMarked(BasicBlock::Marker::Black)) {
+            if (!mVisited.IsVisited(bb)) {
                 return false;
             }
         }
@@ -65,18 +79,18 @@ bool LivenessAnalyzer::CheckIfBlockCanBeVisited(BasicBlock* block) {
 
 
 void LivenessAnalyzer::VisitLoopBlock(BasicBlock* bb, std::set<BasicBlock*>& exitBlocks) {
-    if (bb == nullptr || bb->IsMarked(BasicBlock::Marker::Black)) {
+    if (bb == nullptr || mVisited.IsVisited(bb)) {
         return;
     }
 
     mBBLinearOrder.push_back(bb);
-    bb->SetMarked(BasicBlock::Marker::Black);
+    mVisited.Visit(bb);
 
     BasicBlock* trueSucc = bb->GetTrueSuccessor();
     BasicBlock* falseSucc = bb->GetFalseSuccessor();
 
     auto VisitSuccessor = [this, bb, &exitBlocks](BasicBlock* succ) {
-        if (succ == nullptr || succ->IsMarked(BasicBlock::Marker::Black)) {
+        if (succ == nullptr || mVisited.IsVisited(succ)) {
             return;
         }
 
@@ -95,13 +109,13 @@ void LivenessAnalyzer::VisitLoopBlock(BasicBlock* bb, std::set<BasicBlock*>& exi
     };
 
     // Try false successor first and then true one. Then false again, since it can be allowed to visit after true one was visited
-    if (falseSucc != nullptr && !falseSucc->IsMarked(BasicBlock::Marker::Black) && CheckIfBlockCanBeVisited(falseSucc)) {
+    if (falseSucc != nullptr && !mVisited.IsVisited(falseSucc) && CheckIfBlockCanBeVisited(falseSucc)) {
         VisitSuccessor(falseSucc);
     }
-    if (trueSucc != nullptr && !trueSucc->IsMarked(BasicBlock::Marker::Black) && CheckIfBlockCanBeVisited(trueSucc)) {
+    if (trueSucc != nullptr && !mVisited.IsVisited(trueSucc) && CheckIfBlockCanBeVisited(trueSucc)) {
         VisitSuccessor(trueSucc);
     }
-    if (falseSucc != nullptr && !falseSucc->IsMarked(BasicBlock::Marker::Black) && CheckIfBlockCanBeVisited(falseSucc)) {
+    if (falseSucc != nullptr && !mVisited.IsVisited(falseSucc) && CheckIfBlockCanBeVisited(falseSucc)) {
         VisitSuccessor(falseSucc);
     }
 }
@@ -109,7 +123,7 @@ void LivenessAnalyzer::VisitLoopBlock(BasicBlock* bb, std::set<BasicBlock*>& exi
 
 void LivenessAnalyzer::VisitLoop(Loop* loop, std::set<BasicBlock*>& exitBlocks) {
     auto* header = loop->GetHeader();
-    if (header->IsMarked(BasicBlock::Marker::Black)) {
+    if (mVisited.IsVisited(header)) {
         return;
     }
 
@@ -190,7 +204,7 @@ void LivenessAnalyzer::CreateBasicBlocksLinearOrder(BasicBlock* entry) {
         // Visit all real exit blocks according to linear order
         while (!exitBlocks.empty()) {
             for (auto* exit : exitBlocks) {
-                if (exit->IsMarked(BasicBlock::Marker::Black)) {
+                if (mVisited.IsVisited(exit)) {
                     exitBlocks.erase(exit);
                     break;
                 }
@@ -203,13 +217,13 @@ void LivenessAnalyzer::CreateBasicBlocksLinearOrder(BasicBlock* entry) {
         }
     }
     else {
-        if (entry->IsMarked(BasicBlock::Marker::Black)) {
+        if (mVisited.IsVisited(entry)) {
             return;
         }
 
         // Mark visited basic blocks as black
         mBBLinearOrder.push_back(entry);
-        entry->SetMarked(BasicBlock::Marker::Black);
+        mVisited.Visit(entry);
 
         // Explicitly differentiate false and true successors, because
         // we would like to process false successor first if it is possible
@@ -217,33 +231,68 @@ void LivenessAnalyzer::CreateBasicBlocksLinearOrder(BasicBlock* entry) {
         BasicBlock* falseSucc = entry->GetFalseSuccessor();
 
         // Try false successor first, then true successor
-        if (falseSucc != nullptr && !falseSucc->IsMarked(BasicBlock::Marker::Black) && CheckIfBlockCanBeVisited(falseSucc)) {
+        if (falseSucc != nullptr && !mVisited.IsVisited(falseSucc) && CheckIfBlockCanBeVisited(falseSucc)) {
             CreateBasicBlocksLinearOrder(falseSucc);
         }
-        if (trueSucc != nullptr && !trueSucc->IsMarked(BasicBlock::Marker::Black) && CheckIfBlockCanBeVisited(trueSucc)) {
+        if (trueSucc != nullptr && !mVisited.IsVisited(trueSucc) && CheckIfBlockCanBeVisited(trueSucc)) {
             CreateBasicBlocksLinearOrder(trueSucc);
         }
 
         // Try false successor again. We either visited it already, or it can be visited after true successor is visited
-        if (falseSucc != nullptr && !falseSucc->IsMarked(BasicBlock::Marker::Black) && CheckIfBlockCanBeVisited(falseSucc)) {
+        if (falseSucc != nullptr && !mVisited.IsVisited(falseSucc) && CheckIfBlockCanBeVisited(falseSucc)) {
             CreateBasicBlocksLinearOrder(falseSucc);
         }
     }
 }
 
 
+const BitVector& LivenessAnalyzer::GetLiveIn(const BasicBlock* bb) const {
+    auto it = mBBLinearIndices.find(bb);
+    return it != mBBLinearIndices.end() && it->second < mLiveIn.size() ? mLiveIn[it->second] : mEmptySet;
+}
+
+const BitVector& LivenessAnalyzer::GetLiveOut(const BasicBlock* bb) const {
+    auto it = mBBLinearIndices.find(bb);
+    return it != mBBLinearIndices.end() && it->second < mLiveOut.size() ? mLiveOut[it->second] : mEmptySet;
+}
+
+size_t LivenessAnalyzer::GetValueIndex(const Value* value) const {
+    if (value == nullptr || value->HasValue()) {
+        return kNoValueIndex;
+    }
+
+    size_t idx = kNoValueIndex;
+    if (const Instruction* producer = value->GetProducer(); producer != nullptr) {
+        idx = mArgCount + producer->GetLinearNumber();
+    }
+    else {
+        idx = static_cast<size_t>(std::find(mValues.begin(), mValues.begin() + static_cast<ptrdiff_t>(mArgCount), value) - mValues.begin());
+    }
+
+    // Values out of the analyzed blocks have no index
+    return idx < mValues.size() && mValues[idx] == value ? idx : kNoValueIndex;
+}
+
+
 void LivenessAnalyzer::AssignLinearAndLiveNumbers() {
+    const auto& args = mGraph->GetFunction()->GetArgs();
+    mValues.assign(args.begin(), args.end());
+    mArgCount = args.size();
+    mBBLinearIndices.clear();
+
     uint64_t linearNumber = 0;
     uint64_t liveNumber = 0;
     for (auto* bb : mBBLinearOrder) {
         LiveRange& lr = bb->GetLiveRange();
         Instruction* inst = bb->Front();
+        mBBLinearIndices.emplace(bb, mBBLinearIndices.size());
 
         lr.start = liveNumber;
         liveNumber += kInstructionLiveDiffSpillFill;
         while (inst != nullptr) {
             inst->SetLinearNumber(linearNumber);
             ++linearNumber;
+            mValues.push_back(inst->GetOutput());
 
             if (inst->IsPhi()) {
                 inst->SetLiveNumber(lr.start);
@@ -261,42 +310,55 @@ void LivenessAnalyzer::AssignLinearAndLiveNumbers() {
 
 
 void LivenessAnalyzer::CalculateLiveRanges() {
-    std::unordered_map<BasicBlock*, std::set<Value*>> bbLivesets;
-    for (auto it = mBBLinearOrder.rbegin(), end = mBBLinearOrder.rend(); it != end; ++it) {
-        BasicBlock* bb = *it;
-        auto& liveset = bbLivesets[bb];
+    const size_t valueCount = mValues.size();
+    mLiveIn.assign(mBBLinearOrder.size(), BitVector{valueCount});
+    mLiveOut.assign(mBBLinearOrder.size(), BitVector{valueCount});
+    mEmptySet.Resize(valueCount);
+
+    auto insert = [this](BitVector& set, const Value* value) {
+        if (size_t idx = GetValueIndex(value); idx != kNoValueIndex) {
+            set.Set(idx);
+        }
+    };
+
+    for (Value* value : mValues) {
+        if (value != nullptr) {
+            value->GetLiveRanges().Clear();
+        }
+    }
+
+    BitVector liveset{valueCount};
+    for (size_t bbIdx = mBBLinearOrder.size(); bbIdx-- > 0;) {
+        BasicBlock* bb = mBBLinearOrder[bbIdx];
+        BitVector& liveOut = mLiveOut[bbIdx];
         LiveRange& bbLiveRange = bb->GetLiveRange();
 
         // Calculate initial liveset for the block
         for (auto* succ : bb->GetSuccessors()) {
-            // Union of livesets of the successors' livesets
-            if (auto succIt = bbLivesets.find(succ); succIt != bbLivesets.end()) {
-                auto& succLiveset = succIt->second;
-                for (auto* value : succLiveset) {
-                    liveset.insert(value);
-                }
-            }
+            // Union of livesets of the successors' livesets. Loop headers are not done yet, loops are handled below
+            liveOut.UniteWith(GetLiveIn(succ));
 
-            // Successors' phi real inputs
+            // Successors' phis read the input of this edge at the end of the block, the use goes to the terminator
             auto* succInst = succ->Front();
             while (succInst != nullptr && succInst->IsPhi()) {
-                const auto& phiInputs = static_cast<InstructionPhi*>(succInst)->GetInputs();
-                for (auto* value : phiInputs) {
-                    Instruction* producer = value->GetProducer();
-                    if (producer != nullptr && producer->GetParentBasicBlock() == bb) {
-                        liveset.insert(value);
+                Value* input = static_cast<InstructionPhi*>(succInst)->GetInputFrom(bb);
+                if (input != nullptr) {
+                    insert(liveOut, input);
+                    if (!input->HasValue() && bb->Back() != nullptr) {
+                        input->GetLiveRanges().AddUse(bb->Back()->GetLiveNumber());
                     }
                 }
                 succInst = succInst->GetNext();
             }
         }
+        liveset = liveOut;
 
         // For each value in the liveset append liverange of the block
-        for (auto* value : liveset) {
-            // Ignore potential live holes
-            LiveInterval& valueLI = value->GetLiveInterval();
-            valueLI.UniteWith(bbLiveRange);
-        }
+        liveset.ForEach([this, &bbLiveRange](size_t idx) {
+            // Interval ignores potential live holes, range list keeps them
+            mValues[idx]->GetLiveInterval().UniteWith(bbLiveRange);
+            mValues[idx]->GetLiveRanges().AddRange(bbLiveRange);
+        });
 
         // Reverse iterate over block non-phi instructions
         Instruction* bbInst = bb->Back();
@@ -309,122 +371,23 @@ void LivenessAnalyzer::CalculateLiveRanges() {
 
                 // Minimal value liverange is [Ln, Ln + 2) (kInstructionLiveDiffSpillFill == 2)
                 bbValueLI.UniteWith(LiveInterval(bbValueLI.start, bbValueLI.start + kInstructionLiveDiffSpillFill));
+                instOutput->GetLiveRanges().SetDefinition(bbInst->GetLiveNumber());
 
                 // Remove the instruction from the liveset
-                liveset.erase(instOutput);
+                liveset.Reset(mArgCount + bbInst->GetLinearNumber());
             }
 
-            // Iterate over instruction's inputs (it's pity we don't have unified interface for that)
             // Add input to liveset and append [BB_START, inst_live_num) to input live range
             const LiveRange liveRangeBBToInst = LiveRange(bbLiveRange.start, bbInst->GetLiveNumber());
-            switch (bbInst->GetType()) {
-                default: break;
-                case InstructionType::Add:
-                case InstructionType::Sub:
-                case InstructionType::Mul:
-                case InstructionType::Div:
-                case InstructionType::Rem:
-                case InstructionType::And:
-                case InstructionType::Or:
-                case InstructionType::Xor:
-                case InstructionType::Shl:
-                case InstructionType::Shr:
-                case InstructionType::Ashr: {
-                    InstructionArithmetic* instArith = static_cast<InstructionArithmetic*>(bbInst);
-
-                    Value* input1 = instArith->GetInput1();
-                    liveset.insert(input1);
-                    input1->GetLiveInterval().UniteWith(liveRangeBBToInst);
-
-                    Value* input2 = instArith->GetInput2();
-                    liveset.insert(input2);
-                    input2->GetLiveInterval().UniteWith(liveRangeBBToInst);
-
-                    break;
-                }
-                case InstructionType::Load: {
-                    InstructionLoad* instLoad = static_cast<InstructionLoad*>(bbInst);
-                    Value* loadPtr = instLoad->GetLoadPtr();
-                    liveset.insert(loadPtr);
-                    loadPtr->GetLiveInterval().UniteWith(liveRangeBBToInst);
-                    break;
-                }
-                case InstructionType::Store: {
-                    InstructionStore* instStore = static_cast<InstructionStore*>(bbInst);
-
-                    Value* storePtr = instStore->GetStorePtr();
-                    liveset.insert(storePtr);
-                    storePtr->GetLiveInterval().UniteWith(liveRangeBBToInst);
-
-                    Value* input = instStore->GetInput();
-                    liveset.insert(input);
-                    input->GetLiveInterval().UniteWith(liveRangeBBToInst);
-
-                    break;
-                }
-                case InstructionType::Beq:
-                case InstructionType::Bne:
-                case InstructionType::Bgt:
-                case InstructionType::Blt:
-                case InstructionType::Bge:
-                case InstructionType::Ble: {
-                    InstructionBranch* instBranch = static_cast<InstructionBranch*>(bbInst);
-
-                    Value* input1 = instBranch->GetInput1();
-                    liveset.insert(input1);
-                    input1->GetLiveInterval().UniteWith(liveRangeBBToInst);
-
-                    Value* input2 = instBranch->GetInput2();
-                    liveset.insert(input2);
-                    input2->GetLiveInterval().UniteWith(liveRangeBBToInst);
-
-                    break;
-                }
-                case InstructionType::Call: {
-                    InstructionCall* instCall = static_cast<InstructionCall*>(bbInst);
-                    const auto& args = instCall->GetArguments();
-                    for (auto* arg : args) {
-                        liveset.insert(arg);
-                        arg->GetLiveInterval().UniteWith(liveRangeBBToInst);
-                    }
-                    break;
-                }
-                case InstructionType::Ret: {
-                    InstructionRet* instRet = static_cast<InstructionRet*>(bbInst);
-                    Value* returnValue = instRet->GetReturnValue();
-                    if (returnValue != nullptr) {
-                        liveset.insert(returnValue);
-                        returnValue->GetLiveInterval().UniteWith(liveRangeBBToInst);
-                    }
-                    break;
-                }
-                case InstructionType::Mv: {
-                    InstructionMv* instMv = static_cast<InstructionMv*>(bbInst);
-                    Value* input = instMv->GetInput();
-                    liveset.insert(input);
-                    input->GetLiveInterval().UniteWith(liveRangeBBToInst);
-                    break;
-                }
-                case InstructionType::NullCheck: {
-                    InstructionNullCheck* instNullCheck = static_cast<InstructionNullCheck*>(bbInst);
-                    Value* input = instNullCheck->GetInput();
-                    liveset.insert(input);
-                    input->GetLiveInterval().UniteWith(liveRangeBBToInst);
-                    break;
-                }
-                case InstructionType::BoundsCheck: {
-                    InstructionBoundsCheck* instBoundsCheck = static_cast<InstructionBoundsCheck*>(bbInst);
-
-                    Value* inputPtr = instBoundsCheck->GetInputPtr();
-                    liveset.insert(inputPtr);
-                    inputPtr->GetLiveInterval().UniteWith(liveRangeBBToInst);
-
-                    Value* inputArray = instBoundsCheck->GetInputArray();
-                    liveset.insert(inputArray);
-                    inputArray->GetLiveInterval().UniteWith(liveRangeBBToInst);
-
-                    break;
+            for (Value* input : bbInst->operands()) {
+                // Constants are immediates, besides they are shared between functions
+                if (input->HasValue()) {
+                    continue;
                 }
+                insert(liveset, input);
+                input->GetLiveInterval().UniteWith(liveRangeBBToInst);
+                input->GetLiveRanges().AddRange(liveRangeBBToInst);
+                input->GetLiveRanges().AddUse(bbInst->GetLiveNumber());
             }
 
             bbInst = bbInst->GetPrev();
@@ -433,7 +396,8 @@ void LivenessAnalyzer::CalculateLiveRanges() {
         // After iterating over instructions remove phi in current block from liveset
         bbInst = bb->Front();
         while (bbInst != nullptr && bbInst->IsPhi()) {
-            liveset.erase(bbInst->GetOutput());
+            liveset.Reset(mArgCount + bbInst->GetLinearNumber());
+            bbInst->GetOutput()->GetLiveRanges().SetDefinition(bbInst->GetLiveNumber());
             bbInst = bbInst->GetNext();
         }
 
@@ -446,10 +410,28 @@ void LivenessAnalyzer::CalculateLiveRanges() {
                 loopLiveRange.end = std::max(loopLiveRange.end, latch->GetLiveRange().end);
             }
 
-            for (auto* value : liveset) {
-                LiveInterval& valueLI = value->GetLiveInterval();
-                valueLI.UniteWith(loopLiveRange);
+            liveset.ForEach([this, &loopLiveRange](size_t idx) {
+                mValues[idx]->GetLiveInterval().UniteWith(loopLiveRange);
+                mValues[idx]->GetLiveRanges().AddRange(loopLiveRange);
+            });
+
+            // Loop blocks follow the header in the linear order, values live at the header are live in all of them
+            for (size_t loopIdx = bbIdx + 1; loopIdx < mBBLinearOrder.size(); ++loopIdx) {
+                if (mBBLinearOrder[loopIdx]->GetLiveRange().start >= loopLiveRange.end) {
+                    break;
+                }
+                mLiveIn[loopIdx].UniteWith(liveset);
+                mLiveOut[loopIdx].UniteWith(liveset);
             }
+            liveOut.UniteWith(liveset);
+        }
+
+        mLiveIn[bbIdx] = liveset;
+    }
+
+    for (Value* value : mValues) {
+        if (value != nullptr) {
+            value->GetLiveRanges().Finalize();
         }
     }
 }
@@ -2,6 +2,7 @@
 #include <fstream>
 
 #include <LoopAnalyzer.h>
+#include <Trace.h>
 
 namespace VMIR {
 
@@ -55,21 +56,18 @@ void LoopAnalyzer::BuildLoopTree() {
         mGraph->BuildDominatorTree();
     }
 
+    TraceScope scope{mGraph->GetTraceRecorder(), "BuildLoopTree", "analysis", mGraph->GetFunction()};
+
     // Collect back edges
     BasicBlock* entry = mGraph->GetEntryBasicBlock();
     auto& allBasicBlocks = mGraph->GetBasicBlocks();
     DFSBlackAndGrey(entry);
 
-    for (auto* bb : allBasicBlocks) {
-        bb->SetUnmarked();
-    }
-
     // Populate loops
     size_t bbCount = allBasicBlocks.size();
 
     RPO rpo{};
     rpo.Run(entry, &bbCount);
-    rpo.UnmarkAll();
     auto& rpoVec = rpo.GetBasicBlocks();
 
     for (auto it = rpoVec.rbegin(), end = rpoVec.rend(); it != end; ++it) {
@@ -122,15 +120,38 @@ void LoopAnalyzer::BuildLoopTree() {
         }
     }
 
+    scope.AddArg("loops", static_cast<int64_t>(mLoops.size()));
     mIsLoopTreeBuilt = true;
 }
 
 void LoopAnalyzer::DFSBlackAndGrey(BasicBlock* entryBB) {
-    entryBB->SetMarked(BasicBlock::Marker::Grey | BasicBlock::Marker::Black);
-    for (auto* succ : entryBB->GetSuccessors()) {
-        if (succ->IsMarked(BasicBlock::Marker::Grey)) {
+    // Black blocks are visited ones, grey blocks are on the stack of the walk
+    struct Frame {
+        BasicBlock* block;
+        uint32_t nextSucc;
+    };
+
+    VisitedBlocks black{};
+    VisitedBlocks grey{};
+    std::vector<Frame> stack{};
+
+    black.Visit(entryBB);
+    grey.Visit(entryBB);
+    stack.push_back({entryBB, 0});
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        BasicBlock* block = frame.block;
+        const auto succs = block->GetSuccessors();
+        if (frame.nextSucc == succs.size()) {
+            grey.Unvisit(block);
+            stack.pop_back();
+            continue;
+        }
+
+        BasicBlock* succ = succs[frame.nextSucc++];
+        if (grey.IsVisited(succ)) {
             // This is back edge:
-            // - entryBB is loop latch
+            // - block is loop latch
             // - succ is loop header
             Loop* loop = nullptr;
             auto it = mLoops.find(succ);
@@ -142,28 +163,24 @@ void LoopAnalyzer::DFSBlackAndGrey(BasicBlock* entryBB) {
             }
 
             loop->SetHeader(succ);
-            loop->GetLatches().push_back(entryBB);
-            loop->SetReducible(loop->IsReducible() && succ->IsDominatorOf(entryBB));
-            continue;
+            loop->GetLatches().push_back(block);
+            loop->SetReducible(loop->IsReducible() && succ->IsDominatorOf(block));
         }
-        else if (!succ->IsMarked(BasicBlock::Marker::Black)) {
-            DFSBlackAndGrey(succ);
+        else if (black.Visit(succ)) {
+            grey.Visit(succ);
+            stack.push_back({succ, 0});
         }
     }
-    entryBB->SetUnmarked(BasicBlock::Marker::Grey);
 }
 
 void LoopAnalyzer::LoopSearch(BasicBlock* latch, Loop* loop) {
-    // This time we can use almost default DFS (just different marker and we iterate over predecessors)
+    // This time we can use default DFS over predecessors which does not go through the header
     DFS dfs{};
-    dfs.SetMarker(BasicBlock::Marker::Green);
     dfs.SetReverse();
 
-    BasicBlock* loopHeader = loop->GetHeader();
     auto& loopBlocks = loop->GetBasicBlocks();
 
-    loopHeader->SetMarked(BasicBlock::Marker::Green);
-    dfs.Run(latch);
+    dfs.Run(latch, loop->GetHeader());
     for (auto* bb : dfs.GetBasicBlocks()) {
         Loop* bbLoop = bb->GetLoop();
         if (bbLoop == nullptr) {
@@ -189,8 +206,6 @@ void LoopAnalyzer::LoopSearch(BasicBlock* latch, Loop* loop) {
             }
         }
     }
-    dfs.UnmarkAll();
-    loopHeader->SetUnmarked(BasicBlock::Marker::Green);
 }
 
 }   // namespace VMIR
@@ -0,0 +1,26 @@
+#include <PassManager.h>
+#include <IRBuilder.h>
+
+namespace VMIR {
+
+void PassManager::Run(Function* func) {
+    IRContext* IrContext = func->GetContext();
+    for (const auto& pass : mPasses) {
+        TraceScope scope{IrContext->GetTraceRecorder(), pass->GetName().c_str(), "pass", func};
+        if (scope.IsEnabled()) {
+            scope.AddArg("blocks before", static_cast<int64_t>(func->Size()));
+            scope.AddArg("instructions before", static_cast<int64_t>(func->GetInstructionCount()));
+        }
+
+        pass->Run(func);
+        IrContext->InvalidateAnalyses(func, pass->GetPreservedAnalyses());
+
+        if (scope.IsEnabled()) {
+            scope.AddArg("blocks after", static_cast<int64_t>(func->Size()));
+            scope.AddArg("instructions after", static_cast<int64_t>(func->GetInstructionCount()));
+            pass->ReportStatistics(scope);
+        }
+    }
+}
+
+}   // namespace VMIR
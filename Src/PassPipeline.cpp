@@ -0,0 +1,109 @@
+#include <PassPipeline.h>
+#include <PassManager.h>
+#include <IRBuilder.h>
+#include <StaticInliningPass.h>
+#include <ConstantFoldingPass.h>
+#include <PeepholesPass.h>
+#include <CheckEliminationPass.h>
+
+#include <unordered_set>
+
+namespace VMIR {
+
+bool PassPipeline::Run(ThreadPool* pool) {
+    std::vector<Function*> functions = GetCallGraphPostOrder();
+
+    // Inlining changes callers with bodies of their callees, so it cannot run in parallel
+    PassManager inliningManager{};
+    inliningManager.AddPass<StaticInliningPass>();
+    for (auto* func : functions) {
+        inliningManager.Run(func);
+    }
+    // Inlining into a function inlines into its callees first, so any of them may have changed
+    for (auto* func : functions) {
+        mContext->InvalidateAnalyses(func, PreservedAnalyses::None());
+    }
+
+    // Results are not packed into bits, so every task writes to its own byte
+    std::vector<uint8_t> results(functions.size(), 0);
+    if (pool == nullptr) {
+        for (size_t i = 0; i < functions.size(); ++i) {
+            results[i] = RunFunctionPasses(functions[i]);
+        }
+    }
+    else {
+        for (size_t i = 0; i < functions.size(); ++i) {
+            pool->Submit([this, &results, &functions, i]() { results[i] = RunFunctionPasses(functions[i]); });
+        }
+        pool->Wait();
+    }
+
+    return std::all_of(results.begin(), results.end(), [](uint8_t ok) { return ok != 0; });
+}
+
+
+std::vector<Function*> PassPipeline::GetCallGraphPostOrder() const {
+    struct Frame {
+        Function* func;
+        std::vector<Function*> callees;
+        size_t next;
+    };
+
+    auto collectCallees = [](Function* func) {
+        std::vector<Function*> callees{};
+        for (const auto* bb : func->GetBasicBlocks()) {
+            for (Instruction* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+                if (inst->GetType() == InstructionType::Call) {
+                    callees.push_back(static_cast<InstructionCall*>(inst)->GetFunction());
+                }
+            }
+        }
+        return callees;
+    };
+
+    std::vector<Function*> order{};
+    std::unordered_set<Function*> visited{};
+    std::vector<Frame> stack{};
+
+    for (auto* root : mContext->GetFunctions()) {
+        if (!visited.insert(root).second) {
+            continue;
+        }
+
+        stack.push_back({root, collectCallees(root), 0});
+        while (!stack.empty()) {
+            Frame& frame = stack.back();
+            if (frame.next < frame.callees.size()) {
+                Function* callee = frame.callees[frame.next++];
+                if (callee != nullptr && visited.insert(callee).second) {
+                    stack.push_back({callee, collectCallees(callee), 0});
+                }
+                continue;
+            }
+
+            order.push_back(frame.func);
+            stack.pop_back();
+        }
+    }
+    return order;
+}
+
+
+bool PassPipeline::RunFunctionPasses(Function* func) const {
+    if (func->GetEntryBasicBlock() == nullptr) {
+        return true;
+    }
+
+    // Passes are created per function, so tasks share no pass state
+    PassManager passManager{};
+    passManager.AddPass<ConstantFoldingPass>();
+    passManager.AddPass<PeepholesPass>();
+    passManager.AddPass<CheckEliminationPass>();
+    passManager.Run(func);
+
+    ControlFlowGraph* cfg = mContext->GetOrCreateControlFlowGraph(func);
+    RegisterAllocator* registerAllocator = mContext->GetOrCreateRegisterAllocator(cfg, mGPRegisterCount, mFPRegisterCount);
+    return registerAllocator->PerformRegisterAllocation();
+}
+
+}   // namespace VMIR
@@ -1,4 +1,5 @@
 #include <PeepholesPass.h>
+#include <Trace.h>
 
 namespace VMIR {
 
@@ -6,6 +7,15 @@ static const char PEEPHOLES_PASS_NAME[] = "Peepholes Pass";
 
 PeepholesPass::PeepholesPass() : Pass(PEEPHOLES_PASS_NAME) {}
 
+PreservedAnalyses PeepholesPass::GetPreservedAnalyses() const {
+    // Instructions are replaced inside their blocks, control flow stays the same
+    return PreservedAnalyses{}.Preserve(AnalysisKind::ControlFlowGraph).Preserve(AnalysisKind::DominatorTree).Preserve(AnalysisKind::LoopTree);
+}
+
+void PeepholesPass::ReportStatistics(TraceScope& scope) const {
+    scope.AddArg("peepholes applied", static_cast<int64_t>(mAppliedPeepholes));
+}
+
 // Main peepholes:
 /*
     Add:
@@ -26,30 +36,39 @@ PeepholesPass::PeepholesPass() : Pass(PEEPHOLES_PASS_NAME) {}
         [ v2 = And ui64 v1, v1 ]    -->     [ v2 = Mv ui64 v1 ]
 */
 void PeepholesPass::Run(Function* func) {
+    mAppliedPeepholes = 0;
     for (auto* bb : func->GetBasicBlocks()) {
         Instruction* inst = bb->Front();
         while (inst) {
+            // Peepholes free the instruction they replace, so the next one is taken beforehand
+            Instruction* next = inst->GetNext();
             switch (inst->GetType()) {
                 default: {
                     break;
                 }
                 case InstructionType::Add: {
-                    PerformSingleAddPeephole(static_cast<InstructionAdd*>(inst));
+                    mAppliedPeepholes += PerformSingleAddPeephole(static_cast<InstructionAdd*>(inst));
                     break;
                 }
                 case InstructionType::Ashr: {
-                    if (!PerformComplexAshrPeephole(static_cast<InstructionAshr*>(inst))) {
-                        PerformSingleAshrPeephole(static_cast<InstructionAshr*>(inst));
+                    // Complex peephole also replaces the following Shl, the replacement needs no peepholes
+                    Instruction* afterNext = next != nullptr ? next->GetNext() : nullptr;
+                    if (PerformComplexAshrPeephole(static_cast<InstructionAshr*>(inst))) {
+                        ++mAppliedPeepholes;
+                        next = afterNext;
+                    }
+                    else {
+                        mAppliedPeepholes += PerformSingleAshrPeephole(static_cast<InstructionAshr*>(inst));
                     }
                     break;
                 }
                 case InstructionType::And: {
-                    PerformSingleAndPeephole(static_cast<InstructionAnd*>(inst));
+                    mAppliedPeepholes += PerformSingleAndPeephole(static_cast<InstructionAnd*>(inst));
                     break;
                 }
             }
 
-            inst = inst->GetNext();
+            inst = next;
         }
     }
 }
@@ -61,29 +80,23 @@ void PeepholesPass::Run(Function* func) {
     [ v2 = Add ui64 v1, v1 ]    -->     [ v2 = Shl ui64 v1, 1 ]
 */
 bool PeepholesPass::PerformSingleAddPeephole(InstructionAdd* inst) const {
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
-
     BasicBlock* bb = inst->GetParentBasicBlock();
+    IRContext* IrContext = bb->GetParentFunction()->GetContext();
     Value* input1 = inst->GetInput1();
     Value* input2 = inst->GetInput2();
     Value* output = inst->GetOutput();
 
     // Check if second value is zero and replace Add with Mv ...
     if (IsValueZero(input2)) {
-        InstructionMv* instMv = IrBuilder->CreateMv();
+        InstructionMv* instMv = IrContext->CreateMv();
         instMv->SetInput(input1);
         instMv->SetOutput(output);
-
-        input1->RemoveUser(inst);
-        input2->RemoveUser(inst);
-
-        input1->AddUser(instMv);
         output->SetProducer(instMv);
 
         bb->InsertInstructionBefore(instMv, inst);
         bb->RemoveInstruction(inst);
 
-        IrBuilder->RemoveInstruction(inst);
+        IrContext->RemoveInstruction(inst);
 
         return true;
     }
@@ -94,55 +107,49 @@ bool PeepholesPass::PerformSingleAddPeephole(InstructionAdd* inst) const {
         switch (input1->GetValueType()) {
             default: break;
             case ValueType::Int8: {
-                shift1 = IrBuilder->GetOrCreateValueWithData<int8_t>(1);
+                shift1 = IrContext->GetOrCreateValueWithData<int8_t>(1);
                 break;
             }
             case ValueType::Int16: {
-                shift1 = IrBuilder->GetOrCreateValueWithData<int16_t>(1);
+                shift1 = IrContext->GetOrCreateValueWithData<int16_t>(1);
                 break;
             }
             case ValueType::Int32: {
-                shift1 = IrBuilder->GetOrCreateValueWithData<int32_t>(1);
+                shift1 = IrContext->GetOrCreateValueWithData<int32_t>(1);
                 break;
             }
             case ValueType::Int64: {
-                shift1 = IrBuilder->GetOrCreateValueWithData<int64_t>(1);
+                shift1 = IrContext->GetOrCreateValueWithData<int64_t>(1);
                 break;
             }
             case ValueType::Uint8: {
-                shift1 = IrBuilder->GetOrCreateValueWithData<uint8_t>(1);
+                shift1 = IrContext->GetOrCreateValueWithData<uint8_t>(1);
                 break;
             }
             case ValueType::Uint16: {
-                shift1 = IrBuilder->GetOrCreateValueWithData<uint16_t>(1);
+                shift1 = IrContext->GetOrCreateValueWithData<uint16_t>(1);
                 break;
             }
             case ValueType::Uint32: {
-                shift1 = IrBuilder->GetOrCreateValueWithData<uint32_t>(1);
+                shift1 = IrContext->GetOrCreateValueWithData<uint32_t>(1);
                 break;
             }
             case ValueType::Uint64: {
-                shift1 = IrBuilder->GetOrCreateValueWithData<uint64_t>(1);
+                shift1 = IrContext->GetOrCreateValueWithData<uint64_t>(1);
                 break;
             }
         }
 
-        InstructionShl* instShl = IrBuilder->CreateShl();
+        InstructionShl* instShl = IrContext->CreateShl();
         instShl->SetInput1(input1);
         instShl->SetInput2(shift1);
         instShl->SetOutput(output);
-
-        // input1 == input2
-        input1->RemoveUser(inst);
-
-        input1->AddUser(instShl);
-        shift1->AddUser(instShl);
         output->SetProducer(instShl);
 
         bb->InsertInstructionBefore(instShl, inst);
         bb->RemoveInstruction(inst);
 
-        IrBuilder->RemoveInstruction(inst);
+        IrContext->RemoveInstruction(inst);
 
         return true;
     }
@@ -155,29 +162,23 @@ bool PeepholesPass::PerformSingleAddPeephole(InstructionAdd* inst) const {
     [ v2 = Ashr i64 v1, 0 ]     -->     [ v2 = Mv i64 v1 ]
 */
 bool PeepholesPass::PerformSingleAshrPeephole(InstructionAshr* inst) const {
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
-
     BasicBlock* bb = inst->GetParentBasicBlock();
+    IRContext* IrContext = bb->GetParentFunction()->GetContext();
     Value* input1 = inst->GetInput1();
     Value* input2 = inst->GetInput2();
     Value* output = inst->GetOutput();
 
     // Check if second value is zero and replace Ashr with Mv ...
     if (IsValueZero(input2)) {
-        InstructionMv* instMv = IrBuilder->CreateMv();
+        InstructionMv* instMv = IrContext->CreateMv();
         instMv->SetInput(input1);
         instMv->SetOutput(output);
-
-        input1->RemoveUser(inst);
-        input2->RemoveUser(inst);
-
-        input1->AddUser(instMv);
         output->SetProducer(instMv);
 
         bb->InsertInstructionBefore(instMv, inst);
         bb->RemoveInstruction(inst);
 
-        IrBuilder->RemoveInstruction(inst);
+        IrContext->RemoveInstruction(inst);
 
         return true;
     }
@@ -198,12 +199,10 @@ bool PeepholesPass::PerformComplexAshrPeephole(InstructionAshr* inst) const {
         return false;
     }
 
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
-
     BasicBlock* bb = inst->GetParentBasicBlock();
+    IRContext* IrContext = bb->GetParentFunction()->GetContext();
     InstructionShl* lShift = static_cast<InstructionShl*>(next);
 
-    Value* rShiftInput1 = inst->GetInput1();
     Value* rShiftInput2 = inst->GetInput2();
     Value* rShiftOutput = inst->GetOutput();
 
@@ -273,13 +272,11 @@ bool PeepholesPass::PerformComplexAshrPeephole(InstructionAshr* inst) const {
 
     // Check if Ashr output has users after these operations and if not, erase the instruction
     if (rShiftOutput->GetUsers().empty()) {
-        rShiftInput1->RemoveUser(inst);
-        rShiftInput2->RemoveUser(inst);
         rShiftOutput->SetProducer(nullptr);
 
         bb->RemoveInstruction(inst);
 
-        IrBuilder->RemoveInstruction(inst);
+        IrContext->RemoveInstruction(inst);
     }
 
     return true;
@@ -292,49 +289,38 @@ bool PeepholesPass::PerformComplexAshrPeephole(InstructionAshr* inst) const {
     [ v2 = And ui64 v1, v1 ]    -->     [ v2 = Mv ui64 v1 ]
 */
 bool PeepholesPass::PerformSingleAndPeephole(InstructionAnd* inst) const {
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
-
     BasicBlock* bb = inst->GetParentBasicBlock();
+    IRContext* IrContext = bb->GetParentFunction()->GetContext();
     Value* input1 = inst->GetInput1();
     Value* input2 = inst->GetInput2();
     Value* output = inst->GetOutput();
 
     // Check if second value is zero and replace And with Mv ...
     if (IsValueZero(input2)) {
-        InstructionMv* instMv = IrBuilder->CreateMv();
+        InstructionMv* instMv = IrContext->CreateMv();
         instMv->SetInput(input2);
         instMv->SetOutput(output);
-
-        input1->RemoveUser(inst);
-        input2->RemoveUser(inst);
-
-        input2->AddUser(instMv);
         output->SetProducer(instMv);
 
         bb->InsertInstructionBefore(instMv, inst);
         bb->RemoveInstruction(inst);
 
-        IrBuilder->RemoveInstruction(inst);
+        IrContext->RemoveInstruction(inst);
 
         return true;
     }
 
     // Replace And with Mv ...
     if (input1 == input2) {
-        InstructionMv* instMv = IrBuilder->CreateMv();
+        InstructionMv* instMv = IrContext->CreateMv();
         instMv->SetInput(input1);
         instMv->SetOutput(output);
-
-        // input1 == input2
-        input1->RemoveUser(inst);
-
-        input1->AddUser(instMv);
         output->SetProducer(instMv);
 
         bb->InsertInstructionBefore(instMv, inst);
         bb->RemoveInstruction(inst);
 
-        IrBuilder->RemoveInstruction(inst);
+        IrContext->RemoveInstruction(inst);
 
         return true;
     }
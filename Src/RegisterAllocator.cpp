@@ -1,6 +1,8 @@
 #include <RegisterAllocator.h>
+#include <GraphColoringAllocator.h>
 #include <IRBuilder.h>
 
+#include <cmath>
 #include <ranges>
 
 namespace ranges = std::ranges;
@@ -9,114 +11,548 @@ namespace views = ranges::views;
 
 namespace VMIR {
 
+static uint32_t GetLoopDepth(const BasicBlock* bb) {
+    uint32_t depth = 0;
+    for (Loop* loop = bb->GetLoop(); loop != nullptr && loop->GetOuterLoop() != nullptr; loop = loop->GetOuterLoop()) {
+        ++depth;
+    }
+    return depth;
+}
+
+
 bool RegisterAllocator::PerformRegisterAllocation() {
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
-    LivenessAnalyzer* livenessAnalyzer = IrBuilder->GetOrCreateLivenessAnalyzer(mGraph);
+    TraceScope scope{mContext->GetTraceRecorder(), "PerformRegisterAllocation", "analysis", mGraph->GetFunction()};
+    const uint32_t stackLocationsBefore = mStackLocations;
+
+    LivenessAnalyzer* livenessAnalyzer = mContext->GetOrCreateLivenessAnalyzer(mGraph);
 
     if (!livenessAnalyzer->IsAnalysisDone() && !livenessAnalyzer->PerformLivenessAnalysis()) {
         return false;
     }
 
-    struct IncreasingStartComparator {
-        bool operator() (Value* a, Value* b) const {
-            return a->GetLiveInterval().start < b->GetLiveInterval().start;
-        }
-    };
-
-    std::multiset<Value*, IncreasingStartComparator> increasingStartValues{};
-    for (auto* bb : mGraph->GetBasicBlocks()) {
-        auto* inst = bb->Front();
-        while (inst) {
-            Value* instOutput = inst->GetOutput();
-            if (instOutput) {
-                increasingStartValues.insert(instOutput);
-            }
-            inst = inst->GetNext();
-        }
+    if (mGraph->GetFunction()->GetRegisterAllocationMode() == RegisterAllocationMode::GraphColoring) {
+        PerformGraphColoring(livenessAnalyzer);
+        scope.AddArg("values spilled", static_cast<int64_t>(mStackLocations - stackLocationsBefore));
+        scope.AddArg("coalesced moves", static_cast<int64_t>(mStatistics.coalescedMoves));
+        return true;
     }
 
+    BuildIntervals(livenessAnalyzer);
+    const size_t valueCount = mIntervals.size();
+
     /*
     // TODO: Should I account for function argument values? Or their locations are assured by calling convention?
     const auto& funcArgs = mGraph->GetEntryBasicBlock()->GetParentFunction()->GetArgs();
-    for (const auto* v : funcArgs) {
-        increasingStartValues.insert(v);
-    }
     */
 
-    for (auto* v : increasingStartValues) {
-        ExpireOldIntervals(v);
-        if ((v->IsIntegralValueType() && AreAllGPRegistersOccupied()) || (v->IsFloatingPointValueType() && AreAllFPRegistersOccupied())) {
-            SpillAtInterval(v);
+    while (!mUnhandled.empty()) {
+        std::pop_heap(mUnhandled.begin(), mUnhandled.end(), LaterStartComparator{});
+        Interval* current = mUnhandled.back();
+        mUnhandled.pop_back();
+
+        RegisterClass& regClass = GetRegisterClass(current);
+        ExpireOldIntervals(regClass, current->Start());
+        if (!TryAllocateFreeRegister(current)) {
+            SpillAtInterval(current);
         }
-        else {
-            if (v->IsIntegralValueType()) {
-                std::optional<GPRegisterLocation> regLocation = GetFreeGPRegisterLocation();
-                v->SetLocation(regLocation.value());
-                SetGPRegisterOccupied(regLocation.value());
-            }
-            else {
-                std::optional<FPRegisterLocation> regLocation = GetFreeFPRegisterLocation();
-                v->SetLocation(regLocation.value());
-                SetFPRegisterOccupied(regLocation.value());
+        if (!std::holds_alternative<StackLocation>(current->location)) {
+            Activate(regClass, current, current->Start());
+        }
+    }
+
+    Resolve(livenessAnalyzer);
+
+    scope.AddArg("values", static_cast<int64_t>(valueCount));
+    scope.AddArg("values spilled", static_cast<int64_t>(mStackLocations - stackLocationsBefore));
+    scope.AddArg("splits", static_cast<int64_t>(mStatistics.splits));
+    return true;
+}
+
+
+void RegisterAllocator::BuildIntervals(LivenessAnalyzer* livenessAnalyzer) {
+    mIntervals.clear();
+    mUnhandled.clear();
+    mGPClass.Reset(mGPRegisterCount);
+    mFPClass.Reset(mFPRegisterCount);
+    mSpillSlots.clear();
+    mInstructionMoves.clear();
+    mEdgeMoves.clear();
+    mBlockStarts.clear();
+    mBlockDepths.clear();
+    mStatistics = Statistics{};
+
+    for (auto* bb : livenessAnalyzer->GetBasicBlocksLinearOrder()) {
+        // Moves at the block start are done on the incoming edges, the loop header is entered from outside
+        uint32_t depth = GetLoopDepth(bb);
+        for (auto* pred : bb->GetPredecessors()) {
+            depth = std::min(depth, GetLoopDepth(pred));
+        }
+        mBlockStarts.push_back(bb->GetLiveRange().start);
+        mBlockDepths.push_back(depth);
+
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            Value* output = inst->GetOutput();
+            if (output == nullptr || output->GetLiveRanges().IsEmpty()) {
+                continue;
             }
-            mActiveValues.insert(v);
+            output->SetLocationSplits({});
+            mIntervals.push_back(Interval{output, output->GetLiveRanges(), Location{}, mIntervals.size()});
+            AddUnhandled(&mIntervals.back());
+        }
+    }
+}
+
+
+// Intervals whose current range is over go to the next one, which is active if it covers the position
+void RegisterAllocator::ExpireOldIntervals(RegisterClass& regClass, uint64_t position) {
+    while (!regClass.active.empty() && (*regClass.active.begin())->CurrentEnd() <= position) {
+        Interval* interval = *regClass.active.begin();
+        regClass.active.erase(regClass.active.begin());
+        regClass.activeByRegister[interval->Register()] = nullptr;
+        Activate(regClass, interval, position);
+    }
+    while (!regClass.inactive.empty() && (*regClass.inactive.begin())->CurrentStart() <= position) {
+        Interval* interval = *regClass.inactive.begin();
+        regClass.inactive.erase(regClass.inactive.begin());
+        Activate(regClass, interval, position);
+    }
+}
+
+// Puts the interval into the active or the inactive ones by its ranges after the position, if any
+void RegisterAllocator::Activate(RegisterClass& regClass, Interval* interval, uint64_t position) {
+    const auto& ranges = interval->ranges.GetRanges();
+    while (interval->rangeIdx < ranges.size() && ranges[interval->rangeIdx].end <= position) {
+        ++interval->rangeIdx;
+    }
+    if (interval->rangeIdx >= ranges.size()) {
+        return;
+    }
+    if (interval->CurrentStart() <= position) {
+        regClass.activeByRegister[interval->Register()] = interval;
+        regClass.active.insert(interval);
+    }
+    else {
+        regClass.inactive.insert(interval);
+    }
+}
+
+
+bool RegisterAllocator::TryAllocateFreeRegister(Interval* current) {
+    const uint32_t registerCount = GetRegisterCount(current);
+    if (registerCount == 0) {
+        return false;
+    }
+
+    // Register is free up to the position where the current interval meets an interval in it. Inactive intervals
+    // which come back after the end of the current one do not matter
+    RegisterClass& regClass = GetRegisterClass(current);
+    std::vector<uint64_t> freeUntil(registerCount, UINT64_MAX);
+    for (uint32_t reg = 0; reg < registerCount; ++reg) {
+        if (regClass.activeByRegister[reg] != nullptr) {
+            freeUntil[reg] = 0;
+        }
+    }
+    for (Interval* interval : regClass.inactive) {
+        if (interval->CurrentStart() >= current->End()) {
+            break;
+        }
+        if (freeUntil[interval->Register()] <= interval->CurrentStart()) {
+            continue;
+        }
+        if (auto intersection = interval->ranges.FirstIntersection(current->ranges); intersection.has_value()) {
+            freeUntil[interval->Register()] = std::min(freeUntil[interval->Register()], intersection.value());
         }
     }
 
+    // The first of the registers which stay free for the longest, so the smallest ID possible is used
+    const uint32_t reg = static_cast<uint32_t>(std::max_element(freeUntil.begin(), freeUntil.end()) - freeUntil.begin());
+    if (freeUntil[reg] <= current->Start()) {
+        return false;
+    }
+
+    if (freeUntil[reg] < current->End()) {
+        // Register is free for the first part of the interval only
+        std::optional<uint64_t> position = FindSplitPosition(current->Start(), freeUntil[reg]);
+        if (!position.has_value()) {
+            return false;
+        }
+        if (Interval* rest = SplitInterval(current, position.value()); rest != nullptr) {
+            AddUnhandled(rest);
+        }
+    }
+    AssignRegister(current, reg);
     return true;
 }
 
 
-void RegisterAllocator::ExpireOldIntervals(Value* valueIn) {
-    auto it = mActiveValues.begin();
-    auto end = mActiveValues.end();
-    while (it != end) {
-        Value* i = valueIn;
-        Value* j = *it;
+void RegisterAllocator::SpillAtInterval(Interval* current) {
+    const uint32_t registerCount = GetRegisterCount(current);
+    const uint64_t start = current->Start();
+    // Definition itself can write to the stack, so the first use after the start decides
+    const uint64_t firstUse = current->ranges.NextUseFrom(start + 1).value_or(UINT64_MAX);
+
+    // Register whose intervals are used the latest is taken from them
+    RegisterClass& regClass = GetRegisterClass(current);
+    std::vector<uint64_t> nextUse(registerCount, UINT64_MAX);
+    for (uint32_t reg = 0; reg < registerCount; ++reg) {
+        if (const Interval* interval = regClass.activeByRegister[reg]; interval != nullptr) {
+            nextUse[reg] = interval->ranges.NextUseFrom(start).value_or(UINT64_MAX);
+        }
+    }
+    std::vector<Interval*> intersecting{};
+    for (Interval* interval : regClass.inactive) {
+        if (interval->CurrentStart() >= current->End()) {
+            break;
+        }
+        if (interval->ranges.FirstIntersection(current->ranges).has_value()) {
+            const uint32_t reg = interval->Register();
+            nextUse[reg] = std::min(nextUse[reg], interval->ranges.NextUseFrom(start).value_or(UINT64_MAX));
+            intersecting.push_back(interval);
+        }
+    }
 
-        // Skip values with diffrent type (GP/FP)
-        if (j->IsIntegralValueType() != i->IsIntegralValueType()) {
-            ++it;
+    const auto best = std::max_element(nextUse.begin(), nextUse.end());
+    if (best == nextUse.end() || *best < firstUse) {
+        // All the others are needed earlier, so the current interval waits in memory up to its use
+        AssignStackLocation(current);
+        SplitBeforeNextUse(current);
+        return;
+    }
+
+    const uint32_t reg = static_cast<uint32_t>(best - nextUse.begin());
+    AssignRegister(current, reg);
+
+    // Intervals in the register go to memory from the point where they meet the current one
+    if (Interval* interval = regClass.activeByRegister[reg]; interval != nullptr) {
+        EraseInterval(regClass.active, interval);
+        regClass.activeByRegister[reg] = nullptr;
+        SpillFrom(interval, start);
+    }
+    for (Interval* interval : intersecting) {
+        if (interval->Register() != reg) {
             continue;
         }
+        // Part before the split stays in the register
+        EraseInterval(regClass.inactive, interval);
+        SpillFrom(interval, interval->ranges.FirstIntersection(current->ranges).value());
+        if (!std::holds_alternative<StackLocation>(interval->location)) {
+            Activate(regClass, interval, start);
+        }
+    }
+}
+
 
-        if (j->GetLiveInterval().end > i->GetLiveInterval().start) {
+// Interval goes to the stack at the cheapest position after its last use before the position
+void RegisterAllocator::SpillFrom(Interval* interval, uint64_t position) {
+    const uint64_t latest = SplitPositionBefore(position);
+    const auto& uses = interval->ranges.GetUsePositions();
+    const auto lastUse = std::lower_bound(uses.begin(), uses.end(), latest);
+    const uint64_t after = lastUse == uses.begin() ? interval->Start() : std::max(interval->Start(), *std::prev(lastUse));
+
+    const uint64_t splitPosition = FindSplitPosition(after, latest).value_or(latest);
+    Interval* spilled = interval;
+    if (splitPosition > interval->Start()) {
+        spilled = SplitInterval(interval, splitPosition);
+        if (spilled == nullptr) {
             return;
         }
+    }
+    AssignStackLocation(spilled);
+    SplitBeforeNextUse(spilled);
+}
 
-        it = mActiveValues.erase(it);
 
-        Location jLocation = j->GetLocation();
-        if (i->IsIntegralValueType()) {
-            GPRegisterLocation registerLocation = std::get<GPRegisterLocation>(jLocation);
-            SetGPRegisterFree(registerLocation);
+// Spilled interval goes back to a register before its next use. The use right after the start reads the memory
+void RegisterAllocator::SplitBeforeNextUse(Interval* spilled) {
+    const uint64_t start = spilled->Start();
+    for (auto use = spilled->ranges.NextUseFrom(start + 2); use.has_value(); use = spilled->ranges.NextUseFrom(use.value() + 1)) {
+        if (std::optional<uint64_t> position = FindSplitPosition(start, use.value() - 1); position.has_value()) {
+            if (Interval* reloaded = SplitInterval(spilled, position.value()); reloaded != nullptr) {
+                AddUnhandled(reloaded);
+            }
+            return;
         }
-        else {
-            FPRegisterLocation registerLocation = std::get<FPRegisterLocation>(jLocation);
-            SetFPRegisterFree(registerLocation);
+    }
+}
+
+
+RegisterAllocator::Interval* RegisterAllocator::SplitInterval(Interval* interval, uint64_t position) {
+    LiveRangeList rest = interval->ranges.SplitAt(position);
+    if (rest.IsEmpty()) {
+        return nullptr;
+    }
+    mIntervals.push_back(Interval{interval->value, std::move(rest), Location{}, mIntervals.size()});
+    ++mStatistics.splits;
+    return &mIntervals.back();
+}
+
+
+// Position in (after, latest] where a move is cheap. Moves at block starts go to the edges, so a block start
+// of the lowest loop depth is taken, the later the better. Otherwise the move goes right before an instruction
+std::optional<uint64_t> RegisterAllocator::FindSplitPosition(uint64_t after, uint64_t latest) const {
+    if (latest <= after) {
+        return std::nullopt;
+    }
+
+    std::optional<uint64_t> blockStart = std::nullopt;
+    uint32_t blockStartDepth = UINT32_MAX;
+    const auto first = std::upper_bound(mBlockStarts.begin(), mBlockStarts.end(), after);
+    const auto last = std::upper_bound(mBlockStarts.begin(), mBlockStarts.end(), latest);
+    for (auto it = first; it != last; ++it) {
+        const uint32_t depth = mBlockDepths[static_cast<size_t>(it - mBlockStarts.begin())];
+        if (depth <= blockStartDepth) {
+            blockStart = *it;
+            blockStartDepth = depth;
         }
     }
+
+    // Odd positions are between instructions, the one right before a block start is after the terminator
+    uint64_t position = latest % 2 == 0 ? latest - 1 : latest;
+    if (IsBlockStart(position + 1)) {
+        position -= 2;
+    }
+    if (position <= after || position > latest) {
+        return blockStart;
+    }
+
+    const auto block = std::upper_bound(mBlockStarts.begin(), mBlockStarts.end(), position);
+    const uint32_t depth = block == mBlockStarts.begin() ? 0 : mBlockDepths[static_cast<size_t>(block - mBlockStarts.begin()) - 1];
+    if (blockStart.has_value() && blockStartDepth <= depth) {
+        return blockStart;
+    }
+    return position;
 }
 
 
-void RegisterAllocator::SpillAtInterval(Value* valueIn) {
-    // Find value in mActiveValues with the same type (GP/FP) and furthest end
-    auto view = mActiveValues | views::reverse | views::filter([valueIn](auto&& v){ return v->IsIntegralValueType() == valueIn->IsIntegralValueType(); }) | views::take(0);
-    Value* spill = *view.begin();
-    if (spill->GetLiveInterval().end > valueIn->GetLiveInterval().end) {
-        Location spillLoc = spill->GetLocation();
-        valueIn->SetLocation(spillLoc);
+uint64_t RegisterAllocator::SplitPositionBefore(uint64_t position) const {
+    if (IsBlockStart(position) || position % 2 != 0) {
+        return position;
+    }
+    return position - 1;
+}
 
-        StackLocation newSpillLoc = GenerateNewStackLocation();
-        spill->SetLocation(newSpillLoc);
+bool RegisterAllocator::IsBlockStart(uint64_t position) const {
+    return std::binary_search(mBlockStarts.begin(), mBlockStarts.end(), position);
+}
 
-        mActiveValues.erase(spill);
-        mActiveValues.insert(valueIn);
+
+void RegisterAllocator::AddUnhandled(Interval* interval) {
+    mUnhandled.push_back(interval);
+    std::push_heap(mUnhandled.begin(), mUnhandled.end(), LaterStartComparator{});
+}
+
+void RegisterAllocator::AssignRegister(Interval* interval, uint32_t reg) {
+    if (interval->IsGP()) {
+        interval->location = GPRegisterLocation(reg);
     }
     else {
-        StackLocation stackLocation = GenerateNewStackLocation();
-        valueIn->SetLocation(stackLocation);
+        interval->location = FPRegisterLocation(reg);
+    }
+}
+
+void RegisterAllocator::AssignStackLocation(Interval* interval) {
+    auto [it, inserted] = mSpillSlots.try_emplace(interval->value, StackLocation{});
+    if (inserted) {
+        it->second = GenerateNewStackLocation();
+    }
+    interval->location = it->second;
+}
+
+
+void RegisterAllocator::Resolve(LivenessAnalyzer* livenessAnalyzer) {
+    const auto& linearOrder = livenessAnalyzer->GetBasicBlocksLinearOrder();
+
+    // Non-phi instructions by their live numbers
+    std::vector<Instruction*> instructions{};
+    for (auto* bb : linearOrder) {
+        instructions.resize(bb->GetLiveRange().end / kInstructionLiveDiffSpillFill + 1, nullptr);
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            if (!inst->IsPhi()) {
+                instructions[inst->GetLiveNumber() / kInstructionLiveDiffSpillFill] = inst;
+            }
+        }
+    }
+
+    std::unordered_map<const Value*, std::vector<Interval*>> parts{};
+    for (Interval& interval : mIntervals) {
+        parts[interval.value].push_back(&interval);
+    }
+    for (auto& [value, intervals] : parts) {
+        std::sort(intervals.begin(), intervals.end(), [](const Interval* a, const Interval* b) { return a->Start() < b->Start(); });
+
+        Value* output = intervals.front()->value;
+        output->SetLocation(intervals.front()->location);
+        std::vector<LocationSplit> splits{};
+        for (size_t i = 1; i < intervals.size(); ++i) {
+            const Interval* prev = intervals[i - 1];
+            const Interval* next = intervals[i];
+            if (prev->location == next->location) {
+                continue;
+            }
+            splits.push_back(LocationSplit{next->Start(), next->location});
+
+            // Value which stays live inside a block is moved before the instruction. Edges are resolved below
+            if (prev->End() == next->Start() && !IsBlockStart(next->Start())) {
+                Instruction* inst = instructions[(next->Start() + 1) / kInstructionLiveDiffSpillFill];
+                mInstructionMoves[inst].push_back(Move{output, prev->location, next->location});
+            }
+        }
+        output->SetLocationSplits(std::move(splits));
+    }
+
+    for (auto* succ : linearOrder) {
+        const uint64_t succStart = succ->GetLiveRange().start;
+        for (auto* pred : succ->GetPredecessors()) {
+            if (!livenessAnalyzer->IsInLinearOrder(pred)) {
+                continue;
+            }
+            const uint64_t predEnd = pred->GetLiveRange().end - 1;
+            livenessAnalyzer->GetLiveIn(succ).ForEach([&](size_t idx) {
+                Value* value = livenessAnalyzer->GetValueByIndex(idx);
+                if (value->GetProducer() == nullptr) {
+                    return;
+                }
+                const Location from = value->GetLocationAt(predEnd);
+                const Location to = value->GetLocationAt(succStart);
+                if (from != to) {
+                    mEdgeMoves[{pred, succ}].push_back(Move{value, from, to});
+                }
+            });
+        }
+    }
+
+    StoreSpilledAtDefinition();
+    CountStackAccesses(livenessAnalyzer);
+}
+
+
+void RegisterAllocator::PerformGraphColoring(LivenessAnalyzer* livenessAnalyzer) {
+    mIntervals.clear();
+    mSpillSlots.clear();
+    mInstructionMoves.clear();
+    mEdgeMoves.clear();
+    mStatistics = Statistics{};
+
+    GraphColoringAllocator coloring{livenessAnalyzer, mGPRegisterCount, mFPRegisterCount};
+    coloring.PerformRegisterAllocation(mStackLocations);
+    mStackLocations += coloring.GetStackLocationCount();
+    mInstructionMoves = coloring.GetInstructionMoves();
+    mStatistics.coalescedMoves = coloring.GetCoalescedMoveCount();
+    mStatistics.splits = coloring.GetSplitCount();
+
+    CountStackAccesses(livenessAnalyzer);
+}
+
+
+void RegisterAllocator::CountStackAccesses(LivenessAnalyzer* livenessAnalyzer) {
+    // Stack accesses, loop blocks are weighted by the number of times they run
+    auto countAccess = [this](const Location& location, bool isStore, double weight) {
+        if (!std::holds_alternative<StackLocation>(location)) {
+            return;
+        }
+        (isStore ? mStatistics.stackStores : mStatistics.stackLoads) += 1;
+        (isStore ? mStatistics.weightedStackStores : mStatistics.weightedStackLoads) += weight;
+    };
+    auto countMoves = [this, &countAccess](const std::vector<Move>& moves, double weight) {
+        for (const Move& move : moves) {
+            ++mStatistics.moves;
+            countAccess(move.from, false, weight);
+            countAccess(move.to, true, weight);
+        }
+    };
+
+    for (auto* bb : livenessAnalyzer->GetBasicBlocksLinearOrder()) {
+        const double weight = GetBlockWeight(bb);
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            countMoves(GetMovesBefore(inst), weight);
+            if (!inst->IsPhi()) {
+                for (Value* input : inst->operands()) {
+                    if (!input->HasValue() && input->GetProducer() != nullptr) {
+                        countAccess(input->GetLocationAt(inst->GetLiveNumber() - 1), false, weight);
+                    }
+                }
+            }
+            if (Value* output = inst->GetOutput(); output != nullptr) {
+                countAccess(output->GetLocationAt(inst->GetLiveNumber()), true, weight);
+            }
+        }
+
+        // Inputs of phis are read on the edges
+        for (auto* pred : bb->GetPredecessors()) {
+            if (!livenessAnalyzer->IsInLinearOrder(pred)) {
+                continue;
+            }
+            const double edgeWeight = std::min(weight, GetBlockWeight(pred));
+            countMoves(GetEdgeMoves(pred, bb), edgeWeight);
+            for (auto* inst = bb->Front(); inst != nullptr && inst->IsPhi(); inst = inst->GetNext()) {
+                Value* input = static_cast<InstructionPhi*>(inst)->GetInputFrom(pred);
+                if (input != nullptr && !input->HasValue() && input->GetProducer() != nullptr) {
+                    const Location& location = input->GetLocationAt(pred->GetLiveRange().end - 1);
+                    countAccess(location, false, edgeWeight);
+                    mStatistics.phiCopies += location != inst->GetOutput()->GetLocation();
+                }
+            }
+        }
     }
 }
 
+
+// Stack slot of a value keeps it once stored, as the value does not change. Value is stored right after its
+// definition when that is cheaper than all its stores on the way, then the other stores are dropped
+void RegisterAllocator::StoreSpilledAtDefinition() {
+    std::unordered_map<Value*, double> storeWeights{};
+    for (auto& [inst, moves] : mInstructionMoves) {
+        for (const Move& move : moves | views::filter(IsStore)) {
+            storeWeights[move.value] += GetBlockWeight(inst->GetParentBasicBlock());
+        }
+    }
+    for (auto& [edge, moves] : mEdgeMoves) {
+        for (const Move& move : moves | views::filter(IsStore)) {
+            storeWeights[move.value] += std::min(GetBlockWeight(edge.first), GetBlockWeight(edge.second));
+        }
+    }
+
+    std::unordered_map<Value*, Instruction*> storedAtDefinition{};
+    for (auto& [value, weight] : storeWeights) {
+        // Definition writing to the stack is the store itself
+        if (std::holds_alternative<StackLocation>(value->GetLocation())) {
+            storedAtDefinition.emplace(value, nullptr);
+            continue;
+        }
+        const Instruction* producer = value->GetProducer();
+        if (GetBlockWeight(producer->GetParentBasicBlock()) > weight) {
+            continue;
+        }
+        Instruction* next = producer->GetNext();
+        while (next != nullptr && next->IsPhi()) {
+            next = next->GetNext();
+        }
+        if (next != nullptr) {
+            storedAtDefinition.emplace(value, next);
+        }
+    }
+    if (storedAtDefinition.empty()) {
+        return;
+    }
+
+    auto isDropped = [&storedAtDefinition](const Move& move) { return IsStore(move) && storedAtDefinition.contains(move.value); };
+    for (auto& [inst, moves] : mInstructionMoves) {
+        std::erase_if(moves, isDropped);
+    }
+    for (auto& [edge, moves] : mEdgeMoves) {
+        std::erase_if(moves, isDropped);
+    }
+    for (auto& [value, next] : storedAtDefinition) {
+        if (next != nullptr) {
+            mInstructionMoves[next].push_back(Move{value, value->GetLocation(), mSpillSlots.at(value)});
+        }
+    }
+    std::erase_if(mInstructionMoves, [](const auto& entry) { return entry.second.empty(); });
+    std::erase_if(mEdgeMoves, [](const auto& entry) { return entry.second.empty(); });
+}
+
+double RegisterAllocator::GetBlockWeight(const BasicBlock* bb) {
+    return std::pow(kLoopWeight, static_cast<double>(std::min(GetLoopDepth(bb), kMaxWeightedLoopDepth)));
+}
+
 }   // namespace VMIR
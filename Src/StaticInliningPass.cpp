@@ -1,5 +1,6 @@
 #include <StaticInliningPass.h>
 #include <IRBuilder.h>
+#include <Trace.h>
 
 namespace VMIR {
 
@@ -9,9 +10,14 @@ static const size_t DEFAULT_INLINE_INSTRUCTION_COUNT_THRESHOLD = 10;
 StaticInliningPass::StaticInliningPass() : Pass(STATIC_INLINING_PASS_NAME), mInlineInstructionCountThreshold(DEFAULT_INLINE_INSTRUCTION_COUNT_THRESHOLD) {}
 
 void StaticInliningPass::Run(Function* func) {
+    mInlinedCalls = 0;
     InlineCallees(func);
 }
 
+void StaticInliningPass::ReportStatistics(TraceScope& scope) const {
+    scope.AddArg("calls inlined", static_cast<int64_t>(mInlinedCalls));
+}
+
 size_t StaticInliningPass::GetInlineInstructionCountThreshold() const {
     return mInlineInstructionCountThreshold;
 }
@@ -47,6 +53,7 @@ void StaticInliningPass::InlineCallees(Function* func) {
         InlineCallees(callee);
         if (callee->GetInstructionCount() <= mInlineInstructionCountThreshold) {
             InlineCall(instCall);
+            ++mInlinedCalls;
         }
     }
 
@@ -55,16 +62,17 @@ void StaticInliningPass::InlineCallees(Function* func) {
 
 
 void StaticInliningPass::InlineCall(InstructionCall* instCall) const {
-    IRBuilder* IrBuilder = IRBuilder::GetInstance();
-
     BasicBlock* callBB = instCall->GetParentBasicBlock();
-    auto callInputs = instCall->GetArguments();
+    IRContext* IrContext = callBB->GetParentFunction()->GetContext();
+    // Arguments are copied since the call instruction is removed before they are propagated
+    auto callArgs = instCall->GetArguments();
+    std::vector<Value*> callInputs(callArgs.begin(), callArgs.end());
     Value* callOutput = instCall->GetReturnValue();
     Function* caller = callBB->GetParentFunction();
 
     // Build callee graph: copy callee graph to insert it to caller graph (TODO: implement callee cache)
     Function* calleeOrig = instCall->GetFunction();
-    Function* callee = IrBuilder->CopyFunction(calleeOrig);
+    Function* callee = IrContext->CopyFunction(calleeOrig);
     
 
     BasicBlock* callBBTrueSucc  = callBB->GetTrueSuccessor();
@@ -73,11 +81,7 @@ void StaticInliningPass::InlineCall(InstructionCall* instCall) const {
 
     Instruction* instAfterCall = instCall->GetNext();
     callBB->RemoveInstruction(instCall);
-    IrBuilder->RemoveInstruction(instCall);
-    for (size_t i = 0; i < callInputs.size(); ++i) {
-        Value* callInput = callInputs[i];
-        callInput->RemoveUser(instCall);
-    }
+    IrContext->RemoveInstruction(instCall);
 
     // Save instructions of the call BB after the call instruction
     std::vector<Instruction*> instsAfterCall{};
@@ -112,13 +116,12 @@ void StaticInliningPass::InlineCall(InstructionCall* instCall) const {
         callBB->SetTrueSuccessor(calleeEntryTrueSucc);
         callBB->SetFalseSuccessor(calleeEntryFalseSucc);
 
+        // Edges keep their positions, so phis of the successors keep their inputs
         if (calleeEntryTrueSucc) {
-            calleeEntryTrueSucc->RemovePredecessor(calleeEntry);
-            calleeEntryTrueSucc->AddPredecessor(callBB);
+            calleeEntryTrueSucc->ReplacePredecessor(calleeEntry, callBB);
         }
         if (calleeEntryFalseSucc) {
-            calleeEntryFalseSucc->RemovePredecessor(calleeEntry);
-            calleeEntryFalseSucc->AddPredecessor(callBB);
+            calleeEntryFalseSucc->ReplacePredecessor(calleeEntry, callBB);
         }
     }
     else {
@@ -126,7 +129,7 @@ void StaticInliningPass::InlineCall(InstructionCall* instCall) const {
         // In that case we must append whole callee entry BB to the caller graph and create Jump to it
         caller->AppendBasicBlock(calleeEntry);
 
-        InstructionJump* instJumpToCalleeEntry = IrBuilder->CreateJump();
+        InstructionJump* instJumpToCalleeEntry = IrContext->CreateJump();
         instJumpToCalleeEntry->SetJumpBasicBlock(calleeEntry);
         callBB->AppendInstruction(instJumpToCalleeEntry);
 
@@ -155,109 +158,7 @@ void StaticInliningPass::InlineCall(InstructionCall* instCall) const {
 
     // Propagate arguments: rebind all inputs if there are any
     for (size_t i = 0; i < callInputs.size(); ++i) {
-        Value* callInput = callInputs[i];
-        Value* calleeArg = callee->GetArg(i);
-
-        auto calleeArgUsers = calleeArg->GetUsers();
-        for (auto* user : calleeArgUsers) {
-            if (user->IsArithmetic()) {
-                InstructionArithmetic* instArith = static_cast<InstructionArithmetic*>(user);
-                Value* userInput1 = instArith->GetInput1();
-                Value* userInput2 = instArith->GetInput2();
-
-                calleeArg->RemoveUser(instArith);
-                callInput->AddUser(instArith);
-                if (userInput1 == calleeArg) {
-                    instArith->SetInput1(callInput);
-                }
-                if (userInput2 == calleeArg) {
-                    instArith->SetInput2(callInput);
-                }
-
-            }
-            else if (user->GetType() == InstructionType::Load) {
-                InstructionLoad* instLoad = static_cast<InstructionLoad*>(user);
-        
-                calleeArg->RemoveUser(instLoad);
-                callInput->AddUser(instLoad);
-                instLoad->SetLoadPtr(callInput);
-            }
-            else if (user->GetType() == InstructionType::Store) {
-                InstructionStore* instStore = static_cast<InstructionStore*>(user);
-                Value* userInput1 = instStore->GetStorePtr();
-                Value* userInput2 = instStore->GetInput();
-        
-                calleeArg->RemoveUser(instStore);
-                callInput->AddUser(instStore);
-                if (userInput1 == calleeArg) {
-                    instStore->SetStorePtr(callInput);
-                }
-                if (userInput2 == calleeArg) {
-                    instStore->SetInput(callInput);
-                }
-            }
-            else if (user->IsBranch()) {
-                InstructionBranch* instBranch = static_cast<InstructionBranch*>(user);
-                Value* userInput1 = instBranch->GetInput1();
-                Value* userInput2 = instBranch->GetInput2();
-        
-                calleeArg->RemoveUser(instBranch);
-                callInput->AddUser(instBranch);
-                if (userInput1 == calleeArg) {
-                    instBranch->SetInput1(callInput);
-                }
-                if (userInput2 == calleeArg) {
-                    instBranch->SetInput2(callInput);
-                }
-            }
-            else if (user->GetType() == InstructionType::Call) {
-                InstructionCall* instCall = static_cast<InstructionCall*>(user);
-                auto args = instCall->GetArguments();
-        
-                calleeArg->RemoveUser(instCall);
-                callInput->AddUser(instCall);
-                for (size_t i = 0; i < args.size(); ++i) {
-                    if (args[i] == calleeArg) {
-                        instCall->SetArgument(i, callInput);
-                    }
-                }
-            }
-            else if (user->GetType() == InstructionType::Ret) {
-                InstructionRet* instRet = static_cast<InstructionRet*>(user);
-        
-                calleeArg->RemoveUser(instRet);
-                callInput->AddUser(instRet);
-                instRet->SetReturnValue(callInput);
-            }
-            else if (user->GetType() == InstructionType::Mv) {
-                InstructionMv* instMv = static_cast<InstructionMv*>(user);
-        
-                calleeArg->RemoveUser(instMv);
-                callInput->AddUser(instMv);
-                instMv->SetInput(callInput);
-            }
-            else if (user->GetType() == InstructionType::NullCheck) {
-                InstructionNullCheck* instNullCheck = static_cast<InstructionNullCheck*>(user);
-
-                calleeArg->RemoveUser(instNullCheck);
-                callInput->AddUser(instNullCheck);
-                instNullCheck->SetInput(callInput);
-            }
-            else if (user->GetType() == InstructionType::BoundsCheck) {
-                InstructionBoundsCheck* instBoundsCheck = static_cast<InstructionBoundsCheck*>(user);
-                Value* userInputPtr = instBoundsCheck->GetInputPtr();
-                Value* userInputArray = instBoundsCheck->GetInputArray();
-
-                calleeArg->RemoveUser(instBoundsCheck);
-                callInput->AddUser(instBoundsCheck);
-                if (userInputPtr == calleeArg) {
-                    instBoundsCheck->SetInputPtr(callInput);
-                }
-                if (userInputArray == calleeArg) {
-                    instBoundsCheck->SetInputArray(callInput);
-                }
-            }
-        }
+        callee->GetArg(i)->ReplaceAllUsesWith(callInputs[i]);
     }
 
 
@@ -272,12 +173,9 @@ void StaticInliningPass::InlineCall(InstructionCall* instCall) const {
         // Rebind output if there is a return value
         Value* retValue = calleeRet->GetReturnValue();
         if (retValue) {
-            InstructionMv* instMv = IrBuilder->CreateMv();
+            InstructionMv* instMv = IrContext->CreateMv();
             instMv->SetInput(retValue);
             instMv->SetOutput(callOutput);
-    
-            retValue->RemoveUser(calleeRet);
-            retValue->AddUser(instMv);
 
             callOutput->SetProducer(instMv);
     
@@ -285,7 +183,7 @@ void StaticInliningPass::InlineCall(InstructionCall* instCall) const {
         }
 
         calleeRetBB->RemoveInstruction(calleeRet);
-        IrBuilder->RemoveInstruction(calleeRet);
+        IrContext->RemoveInstruction(calleeRet);
 
         for (auto* inst : instsAfterCall) {
             calleeRetBB->AppendInstruction(inst);
@@ -295,41 +193,34 @@ void StaticInliningPass::InlineCall(InstructionCall* instCall) const {
     }
     else {
         // If the callee has multiple return BBs, then we need to create another post call BB
-        postCallBB = IrBuilder->CreateBasicBlock(caller, "PostCallTo_" + calleeOrig->GetName());
+        postCallBB = IrContext->CreateBasicBlock(caller, "PostCallTo_" + calleeOrig->GetName());
 
         // For all basic blocks of the callee which end with Ret instruction replace the instruction with Jump to post call BB
         std::vector<Value*> phiInputs{};
+        std::vector<BasicBlock*> phiBlocks{};
         for (auto* calleeRet : calleeRets) {
             BasicBlock* calleeRetBB = calleeRet->GetParentBasicBlock();
 
             Value* retValue = calleeRet->GetReturnValue();
             if (retValue) {
                 phiInputs.push_back(retValue);
-                retValue->RemoveUser(calleeRet);
+                phiBlocks.push_back(calleeRetBB);
             }
 
-            InstructionJump* instJumpToPostCall = IrBuilder->CreateJump();
+            InstructionJump* instJumpToPostCall = IrContext->CreateJump();
             instJumpToPostCall->SetJumpBasicBlock(postCallBB);
             calleeRetBB->SetSuccessor(postCallBB);
             postCallBB->AddPredecessor(calleeRetBB);
 
             calleeRetBB->RemoveInstruction(calleeRet);
-            IrBuilder->RemoveInstruction(calleeRet);
+            IrContext->RemoveInstruction(calleeRet);
 
             calleeRetBB->AppendInstruction(instJumpToPostCall);
         }
 
         // If there is a return value, then create Phi
         if (callOutput) {
-            InstructionPhi* instPhi = IrBuilder->CreatePhi();
-            for (auto* input : phiInputs) {
-                instPhi->AddInput(input);
-                input->AddUser(instPhi);
-            }
-
-            instPhi->SetOutput(callOutput);
-            callOutput->SetProducer(instPhi);
-
+            InstructionPhi* instPhi = IrContext->CreatePhi(nullptr, phiInputs, phiBlocks, callOutput);
             postCallBB->AppendInstruction(instPhi);
         }
 
@@ -342,16 +233,14 @@ void StaticInliningPass::InlineCall(InstructionCall* instCall) const {
     postCallBB->SetFalseSuccessor(callBBFalseSucc);
 
     if (callBBTrueSucc) {
-        callBBTrueSucc->RemovePredecessor(callBB);
-        callBBTrueSucc->AddPredecessor(postCallBB);
+        callBBTrueSucc->ReplacePredecessor(callBB, postCallBB);
     }
     if (callBBFalseSucc) {
-        callBBFalseSucc->RemovePredecessor(callBB);
-        callBBFalseSucc->AddPredecessor(postCallBB);
+        callBBFalseSucc->ReplacePredecessor(callBB, postCallBB);
     }
 
     // TODO: Remove unused basic blocks (if any) and unused values (if any)
-    IrBuilder->RemoveFunction(callee);
+    IrContext->RemoveFunction(callee);
 }
 
 }   // namespace VMIR
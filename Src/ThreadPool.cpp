@@ -0,0 +1,120 @@
+#include <ThreadPool.h>
+
+#include <algorithm>
+
+namespace VMIR {
+
+// Lets Submit find the queue of the calling worker
+static thread_local const ThreadPool* tCurrentPool = nullptr;
+static thread_local size_t tWorkerIndex = 0;
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < threadCount; ++i) {
+        mQueues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        mWorkers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    Wait();
+    {
+        std::lock_guard lock{mMutex};
+        mStopping = true;
+    }
+    mWorkAvailable.notify_all();
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+
+void ThreadPool::Submit(Task task) {
+    const size_t idx = tCurrentPool == this ? tWorkerIndex : mNextQueue.fetch_add(1, std::memory_order_relaxed) % mQueues.size();
+
+    // Unfinished before the push, so Wait cannot see zero while the task runs. Queued after the push,
+    // so a worker woken by the count finds the task
+    mUnfinishedTasks.fetch_add(1);
+    {
+        std::lock_guard lock{mQueues[idx]->mutex};
+        mQueues[idx]->tasks.push_back(std::move(task));
+    }
+    mQueuedTasks.fetch_add(1);
+
+    // Worker registers itself as sleeping before it checks the count, so one of the two sees the other.
+    // Taking the mutex orders the notification after the check of the sleeping worker
+    if (mSleepingWorkers.load() > 0) {
+        { std::lock_guard lock{mMutex}; }
+        mWorkAvailable.notify_one();
+    }
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock lock{mMutex};
+    mAllDone.wait(lock, [this]() { return mUnfinishedTasks.load() == 0; });
+}
+
+
+void ThreadPool::WorkerLoop(size_t idx) {
+    tCurrentPool = this;
+    tWorkerIndex = idx;
+
+    while (true) {
+        Task task{};
+        if (TryPop(idx, task) || TrySteal(idx, task)) {
+            mQueuedTasks.fetch_sub(1);
+
+            task();
+
+            if (mUnfinishedTasks.fetch_sub(1) == 1) {
+                { std::lock_guard lock{mMutex}; }
+                mAllDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock lock{mMutex};
+        mSleepingWorkers.fetch_add(1);
+        mWorkAvailable.wait(lock, [this]() { return mStopping || mQueuedTasks.load() > 0; });
+        mSleepingWorkers.fetch_sub(1);
+        if (mStopping && mQueuedTasks.load() <= 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::TryPop(size_t idx, Task& task) {
+    WorkerQueue& queue = *mQueues[idx];
+    std::lock_guard lock{queue.mutex};
+    if (queue.tasks.empty()) {
+        return false;
+    }
+
+    // The newest task is the most likely to have its data in cache
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::TrySteal(size_t idx, Task& task) {
+    for (size_t i = 1; i < mQueues.size(); ++i) {
+        WorkerQueue& victim = *mQueues[(idx + i) % mQueues.size()];
+        std::lock_guard lock{victim.mutex};
+        if (victim.tasks.empty()) {
+            continue;
+        }
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        mStealCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+}   // namespace VMIR
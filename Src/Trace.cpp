@@ -0,0 +1,139 @@
+#include <Trace.h>
+#include <Function.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+namespace VMIR {
+
+static void WriteJsonString(std::ostream& out, const std::string& str) {
+    out << '"';
+    for (char c : str) {
+        switch (c) {
+            case '"':   out << "\\\""; break;
+            case '\\':  out << "\\\\"; break;
+            case '\n':  out << "\\n"; break;
+            case '\t':  out << "\\t"; break;
+            default: {
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+                    out << buf;
+                }
+                else {
+                    out << c;
+                }
+                break;
+            }
+        }
+    }
+    out << '"';
+}
+
+// Chrome trace timestamps are in microseconds
+static void WriteMicroseconds(std::ostream& out, uint64_t ns) {
+    out << ns / 1000 << '.';
+    const uint64_t frac = ns % 1000;
+    out << static_cast<char>('0' + frac / 100) << static_cast<char>('0' + frac / 10 % 10) << static_cast<char>('0' + frac % 10);
+}
+
+
+void TraceRecorder::Record(TraceEvent&& event) {
+    std::lock_guard lock{mMutex};
+    auto it = mThreadIds.try_emplace(std::this_thread::get_id(), static_cast<uint32_t>(mThreadIds.size())).first;
+    event.threadId = it->second;
+    mEvents.push_back(std::move(event));
+}
+
+std::vector<TraceEvent> TraceRecorder::GetEvents() const {
+    std::lock_guard lock{mMutex};
+    return mEvents;
+}
+
+void TraceRecorder::Clear() {
+    std::lock_guard lock{mMutex};
+    mEvents.clear();
+}
+
+void TraceRecorder::WriteChromeTrace(std::ostream& out) const {
+    std::lock_guard lock{mMutex};
+
+    out << "{\"traceEvents\":[";
+    for (size_t i = 0; i < mEvents.size(); ++i) {
+        const TraceEvent& event = mEvents[i];
+        out << (i > 0 ? ",\n" : "\n");
+
+        // Complete events carry both start and duration
+        out << "{\"name\":";
+        WriteJsonString(out, event.name);
+        out << ",\"cat\":";
+        WriteJsonString(out, event.category);
+        out << ",\"ph\":\"X\",\"ts\":";
+        WriteMicroseconds(out, event.startNs);
+        out << ",\"dur\":";
+        WriteMicroseconds(out, event.durationNs);
+        out << ",\"pid\":1,\"tid\":" << event.threadId << ",\"args\":{";
+
+        bool first = true;
+        if (!event.function.empty()) {
+            out << "\"function\":";
+            WriteJsonString(out, event.function);
+            first = false;
+        }
+        for (const auto& [key, value] : event.args) {
+            out << (first ? "" : ",");
+            WriteJsonString(out, key);
+            out << ":" << value;
+            first = false;
+        }
+        out << "}}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+void TraceRecorder::PrintSummary(std::ostream& out) const {
+    struct Total {
+        uint64_t durationNs{0};
+        size_t count{0};
+    };
+
+    std::map<std::string, Total> totals{};
+    {
+        std::lock_guard lock{mMutex};
+        for (const auto& event : mEvents) {
+            Total& total = totals[event.name];
+            total.durationNs += event.durationNs;
+            ++total.count;
+        }
+    }
+
+    std::vector<std::pair<std::string, Total>> sorted(totals.begin(), totals.end());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) { return lhs.second.durationNs > rhs.second.durationNs; });
+
+    for (const auto& [name, total] : sorted) {
+        out << name << ": ";
+        WriteMicroseconds(out, total.durationNs);
+        out << " us in " << total.count << " runs\n";
+    }
+}
+
+
+TraceScope::~TraceScope() {
+    if (mRecorder == nullptr) {
+        return;
+    }
+
+    TraceEvent event{};
+    event.name = mName;
+    event.category = mCategory;
+    if (mFunction != nullptr) {
+        event.function = mFunction->GetName();
+    }
+    event.startNs = mStartNs;
+    event.durationNs = mRecorder->GetTimestampNs() - mStartNs;
+    event.args = std::move(mArgs);
+    mRecorder->Record(std::move(event));
+}
+
+}   // namespace VMIR
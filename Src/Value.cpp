@@ -0,0 +1,36 @@
+#include <Value.h>
+#include <Arena.h>
+
+#include <bit>
+#include <mutex>
+
+namespace VMIR {
+
+// Use-lists of constants are guarded by a fixed set of locks picked by the address of the constant
+static constexpr size_t CONSTANT_USE_LOCK_COUNT = 64;
+static std::mutex gConstantUseLocks[CONSTANT_USE_LOCK_COUNT];
+
+static std::mutex* GetConstantUseLock(const Value* value) {
+    if (value == nullptr || !value->HasValue()) {
+        return nullptr;
+    }
+    // Values come from the arena, so the low bits below its alignment are always zero
+    const uintptr_t addr = reinterpret_cast<uintptr_t>(value);
+    return &gConstantUseLocks[(addr >> std::countr_zero(Arena::kAlignment)) % CONSTANT_USE_LOCK_COUNT];
+}
+
+void Use::SetShared(Value* value) {
+    std::mutex* oldLock = GetConstantUseLock(mValue);
+    std::mutex* newLock = GetConstantUseLock(value);
+
+    if (oldLock == nullptr || newLock == nullptr || oldLock == newLock) {
+        std::lock_guard lock{oldLock != nullptr ? *oldLock : *newLock};
+        Link(value);
+        return;
+    }
+
+    std::scoped_lock lock{*oldLock, *newLock};
+    Link(value);
+}
+
+}   // namespace VMIR
@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+
+#include <IRBuilder.h>
+#include <BinaryIR.h>
+
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+
+
+// Same functions as in the parser test, constants are canonical so functions of one context can be compared
+static void BuildFillAndScale(VMIR::IRContext* IrContext) {
+    VMIR::Function* Fill = IrContext->CreateFunction(VMIR::ValueType::Void, {VMIR::ValueType::Pointer, VMIR::ValueType::Int32}, "Fill");
+    VMIR::Function* Scale = IrContext->CreateFunction(VMIR::ValueType::Float64, {VMIR::ValueType::Int32, VMIR::ValueType::Float64}, "Scale");
+    VMIR::BasicBlock* Fill_BB_1 = IrContext->CreateBasicBlock(Fill, "Fill_BB_1");
+    VMIR::BasicBlock* Fill_BB_2 = IrContext->CreateBasicBlock(Fill, "Fill_BB_2");
+    VMIR::BasicBlock* Fill_BB_3 = IrContext->CreateBasicBlock(Fill, "Fill_BB_3");
+    Fill->SetEntryBasicBlock(Fill_BB_1);
+
+    VMIR::Value* v2 = IrContext->CreateValue(VMIR::ValueType::Pointer);
+    VMIR::Value* v3 = IrContext->CreateValue(VMIR::ValueType::Pointer);
+    VMIR::Value* v4 = IrContext->CreateValue(VMIR::ValueType::Int32);
+    VMIR::Value* v5 = IrContext->CreateValue(VMIR::ValueType::Int32);
+    VMIR::Value* v6 = IrContext->CreateValue(VMIR::ValueType::Int32);
+    VMIR::Value* v7 = IrContext->CreateValue(VMIR::ValueType::Int32);
+    VMIR::Value* v8 = IrContext->CreateValue(VMIR::ValueType::Int32);
+    VMIR::Value* v9 = IrContext->CreateValue(VMIR::ValueType::Int32);
+    VMIR::Value* v10 = IrContext->CreateValue(VMIR::ValueType::Float64);
+
+    IrContext->CreateNullCheck(Fill_BB_1, Fill->GetArg(0));
+    IrContext->CreateAlloc(Fill_BB_1, v2, VMIR::ValueType::Int32, 16);
+    IrContext->CreateAdd(Fill_BB_1, v2, IrContext->GetOrCreateValueWithData(int64_t(4)), v3);
+    IrContext->CreateBoundsCheck(Fill_BB_1, v3, v2);
+    IrContext->CreateStore(Fill_BB_1, v3, Fill->GetArg(1));
+    IrContext->CreateLoad(Fill_BB_1, v3, v4);
+    IrContext->CreateShl(Fill_BB_1, v4, IrContext->GetOrCreateValueWithData(int32_t(2)), v5);
+    IrContext->CreateAshr(Fill_BB_1, IrContext->GetOrCreateValueWithData(int32_t(-8)), v5, v6);
+    IrContext->CreateXor(Fill_BB_1, v6, v5, v7);
+    IrContext->CreateBge(Fill_BB_1, v7, IrContext->GetOrCreateValueWithData(int32_t(0)), Fill_BB_2, Fill_BB_3);
+    IrContext->CreateMv(Fill_BB_2, v7, v8);
+    IrContext->CreateJump(Fill_BB_2, Fill_BB_3);
+    IrContext->CreatePhi(Fill_BB_3, {v7, v8}, v9);
+    IrContext->CreateCall(Fill_BB_3, Scale, v10, {v9, IrContext->GetOrCreateValueWithData(0.5)});
+    IrContext->CreateRet(Fill_BB_3);
+
+    VMIR::BasicBlock* Scale_BB_1 = IrContext->CreateBasicBlock(Scale, "Scale_BB_1");
+    Scale->SetEntryBasicBlock(Scale_BB_1);
+    VMIR::Value* v13 = IrContext->CreateValue(VMIR::ValueType::Float64);
+    VMIR::Value* v14 = IrContext->CreateValue(VMIR::ValueType::Float64);
+    IrContext->CreateMul(Scale_BB_1, Scale->GetArg(1), IrContext->GetOrCreateValueWithData(-1.25), v13);
+    IrContext->CreateDiv(Scale_BB_1, v13, Scale->GetArg(1), v14);
+    IrContext->CreateRet(Scale_BB_1, v14);
+}
+
+
+TEST(binary_ir, round_trip_of_every_instruction) {
+    VMIR::IRContext IrContext{};
+    BuildFillAndScale(&IrContext);
+    VMIR::Function* Fill = IrContext.GetFunctions().front();
+    VMIR::Function* Scale = IrContext.GetFunctions().back();
+
+    std::ostringstream out{};
+    VMIR::BinaryIRWriter writer{&IrContext};
+    ASSERT_TRUE(writer.Write(out)) << writer.GetError();
+    const std::string data = out.str();
+
+    VMIR::BinaryIRModule module{&IrContext};
+    ASSERT_TRUE(module.Load(data)) << module.GetError();
+    ASSERT_EQ(module.GetFunctionCount(), 2);
+    EXPECT_EQ(module.GetFunctionName(0), "Fill");
+    EXPECT_EQ(module.GetFunctionName(1), "Scale");
+    ASSERT_TRUE(module.MaterializeAll()) << module.GetError();
+
+    VMIR::Function* loadedFill = module.GetFunction(0);
+    VMIR::Function* loadedScale = module.GetFunction(1);
+    ASSERT_NE(loadedFill, nullptr);
+    ASSERT_NE(loadedScale, nullptr);
+    EXPECT_TRUE(loadedFill->IsValid());
+    EXPECT_TRUE(loadedScale->IsValid());
+    EXPECT_TRUE(IrContext.CompareFunctions(Fill, loadedFill));
+    EXPECT_TRUE(IrContext.CompareFunctions(Scale, loadedScale));
+
+    // Call refers to the loaded callee, not to the original one
+    VMIR::Instruction* call = loadedFill->GetBasicBlock(2)->Back()->GetPrev();
+    ASSERT_EQ(call->GetType(), VMIR::InstructionType::Call);
+    EXPECT_EQ(static_cast<VMIR::InstructionCall*>(call)->GetFunction(), loadedScale);
+}
+
+
+TEST(binary_ir, materializes_only_requested_functions) {
+    VMIR::IRContext IrContext{};
+    BuildFillAndScale(&IrContext);
+
+    std::ostringstream out{};
+    VMIR::BinaryIRWriter writer{&IrContext};
+    ASSERT_TRUE(writer.Write(out)) << writer.GetError();
+    const std::string data = out.str();
+
+    VMIR::IRContext loadedContext{};
+    VMIR::BinaryIRModule module{&loadedContext};
+    ASSERT_TRUE(module.Load(data)) << module.GetError();
+    EXPECT_EQ(module.GetMaterializedCount(), 0);
+    EXPECT_TRUE(loadedContext.GetFunctions().empty());
+
+    // Callee of Fill is declared with its signature, but has no body yet
+    VMIR::Function* Fill = module.GetFunction("Fill");
+    ASSERT_NE(Fill, nullptr) << module.GetError();
+    EXPECT_EQ(module.GetMaterializedCount(), 1);
+    EXPECT_TRUE(module.IsMaterialized(0));
+    EXPECT_FALSE(module.IsMaterialized(1));
+    ASSERT_EQ(loadedContext.GetFunctions().size(), 2);
+
+    VMIR::Function* declaredScale = loadedContext.GetFunctions().back();
+    EXPECT_EQ(declaredScale->GetName(), "Scale");
+    EXPECT_EQ(declaredScale->GetReturnType(), VMIR::ValueType::Float64);
+    EXPECT_EQ(declaredScale->GetArgs().size(), 2);
+    EXPECT_EQ(declaredScale->Size(), 0);
+
+    // Requesting the callee fills the same function
+    EXPECT_EQ(module.GetFunction("Scale"), declaredScale);
+    EXPECT_EQ(declaredScale->Size(), 1);
+    EXPECT_EQ(module.GetMaterializedCount(), 2);
+
+    EXPECT_EQ(module.GetFunction("Missing"), nullptr);
+    EXPECT_EQ(module.GetError(), "no function #Missing");
+}
+
+
+TEST(binary_ir, maps_written_file) {
+    VMIR::IRContext IrContext{};
+    BuildFillAndScale(&IrContext);
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "vmir_binary_ir_test.vmirb";
+    VMIR::BinaryIRWriter writer{&IrContext};
+    ASSERT_TRUE(writer.WriteFile(path.string())) << writer.GetError();
+
+    {
+        VMIR::BinaryIRModule module{&IrContext};
+        ASSERT_TRUE(module.Open(path.string())) << module.GetError();
+        ASSERT_TRUE(module.MaterializeAll()) << module.GetError();
+        EXPECT_TRUE(IrContext.CompareFunctions(IrContext.GetFunctions().front(), module.GetFunction(0)));
+        EXPECT_TRUE(IrContext.CompareFunctions(*std::next(IrContext.GetFunctions().begin()), module.GetFunction(1)));
+    }
+    std::filesystem::remove(path);
+
+    VMIR::BinaryIRModule missing{&IrContext};
+    EXPECT_FALSE(missing.Open(path.string()));
+    EXPECT_EQ(missing.GetError(), "cannot open " + path.string());
+}
+
+
+TEST(binary_ir, rejects_corrupted_data) {
+    VMIR::IRContext IrContext{};
+    BuildFillAndScale(&IrContext);
+
+    std::ostringstream out{};
+    VMIR::BinaryIRWriter writer{&IrContext};
+    ASSERT_TRUE(writer.Write(out)) << writer.GetError();
+    const std::string data = out.str();
+
+    // Strings do not guarantee alignment of the records, so data is copied into 8-byte words
+    auto load = [](const std::string& bytes, bool materialize) {
+        std::vector<uint64_t> words((bytes.size() + 7) / 8);
+        std::memcpy(words.data(), bytes.data(), bytes.size());
+
+        VMIR::IRContext loadedContext{};
+        VMIR::BinaryIRModule module{&loadedContext};
+        bool loaded = module.Load(std::string_view(reinterpret_cast<const char*>(words.data()), bytes.size()));
+        if (loaded && materialize) {
+            loaded = module.MaterializeAll();
+        }
+        return loaded ? std::string{} : module.GetError();
+    };
+
+    EXPECT_EQ(load(data, true), "");
+    EXPECT_EQ(load(data.substr(0, 16), false), "binary IR is truncated or misaligned");
+    EXPECT_EQ(load("VMIRTXT" + data.substr(7), false), "not a binary IR module");
+
+    // Tables are still in bounds, but the body of the last function is cut off
+    EXPECT_EQ(load(data.substr(0, data.size() - 8), true), "body of #Scale is out of bounds");
+}
+
+TEST(binary_ir, rejects_malformed_instructions) {
+    VMIR::IRContext IrContext{};
+    BuildFillAndScale(&IrContext);
+
+    std::ostringstream out{};
+    VMIR::BinaryIRWriter writer{&IrContext};
+    ASSERT_TRUE(writer.Write(out)) << writer.GetError();
+    std::string data = out.str();
+
+    // Body of #Scale is the last 128 bytes: 8 bytes of value types, one 24-byte block, then 24-byte instructions.
+    // Operand count of its Div is at 12 bytes into the second instruction
+    const size_t divOperandCount = data.size() - 128 + 8 + 24 + 24 + 12;
+    const uint32_t oneOperand = 1;
+    std::memcpy(data.data() + divOperandCount, &oneOperand, sizeof(oneOperand));
+
+    std::vector<uint64_t> words((data.size() + 7) / 8);
+    std::memcpy(words.data(), data.data(), data.size());
+
+    VMIR::IRContext loadedContext{};
+    VMIR::BinaryIRModule module{&loadedContext};
+    ASSERT_TRUE(module.Load(std::string_view(reinterpret_cast<const char*>(words.data()), data.size()))) << module.GetError();
+    ASSERT_NE(module.GetFunction("Fill"), nullptr) << module.GetError();
+
+    // Failed body is removed, so the next request fails the same way instead of appending to it
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        EXPECT_EQ(module.GetFunction("Scale"), nullptr);
+        EXPECT_EQ(module.GetError(), "wrong operands of Div in Scale_BB_1");
+        EXPECT_FALSE(module.IsMaterialized(1));
+    }
+    VMIR::Function* declaredScale = loadedContext.GetFunctions().back();
+    EXPECT_EQ(declaredScale->GetName(), "Scale");
+    EXPECT_EQ(declaredScale->Size(), 0);
+    EXPECT_EQ(declaredScale->GetEntryBasicBlock(), nullptr);
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -269,6 +269,112 @@ TEST(dominator_tree, example3) {
 }
 
 
+TEST(dominator_tree, children_and_unreachable) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Function* Func = IrBuilder->CreateFunction("ChildrenAndUnreachable");
+
+    VMIR::BasicBlock* A = IrBuilder->CreateBasicBlock(Func, "A");
+    VMIR::BasicBlock* B = IrBuilder->CreateBasicBlock(Func, "B");
+    VMIR::BasicBlock* C = IrBuilder->CreateBasicBlock(Func, "C");
+    VMIR::BasicBlock* D = IrBuilder->CreateBasicBlock(Func, "D");
+    VMIR::BasicBlock* U = IrBuilder->CreateBasicBlock(Func, "U");
+
+    // Just create dummy graph. The fucntion will be invalid but we need only graph
+    Func->SetEntryBasicBlock(A);
+
+    // 2 edges: A -> B and A -> C
+    IrBuilder->CreateBeq(A, nullptr, nullptr, B, C);
+
+    // 1 edge:  B -> D
+    IrBuilder->CreateJump(B, D);
+
+    // 1 edge:  C -> D
+    IrBuilder->CreateJump(C, D);
+
+    // 1 edge:  U -> D, but nothing leads to U
+    IrBuilder->CreateJump(U, D);
+
+    VMIR::ControlFlowGraph* cfg = IrBuilder->CreateControlFlowGraph(Func);
+    cfg->BuildDominatorTree();
+
+    // Edge from unreachable block does not affect dominance
+    EXPECT_EQ(D->GetImmediateDominator(), A);
+    EXPECT_EQ(U->GetImmediateDominator(), nullptr);
+    EXPECT_FALSE(U->IsDominatedBy(A));
+    EXPECT_FALSE(D->IsDominatedBy(U));
+    EXPECT_FALSE(U->IsDominatedBy(U));
+    EXPECT_TRUE(A->IsDominatedBy(A));
+    EXPECT_TRUE(A->IsDominatorOf(D));
+    EXPECT_FALSE(B->IsDominatorOf(D));
+    EXPECT_FALSE(D->IsDominatorOf(A));
+
+    // Children are listed in reverse post-order
+    const auto& children = A->GetDominatorTreeChildren();
+    EXPECT_EQ(std::vector<VMIR::BasicBlock*>(children.begin(), children.end()), std::vector<VMIR::BasicBlock*>({C, B, D}));
+    EXPECT_TRUE(B->GetDominatorTreeChildren().empty());
+    EXPECT_TRUE(U->GetDominatorTreeChildren().empty());
+
+    // Rebuild gives the same tree
+    cfg->BuildDominatorTree();
+    EXPECT_EQ(A->GetDominatorTreeChildren().size(), 3);
+    EXPECT_EQ(D->GetImmediateDominator(), A);
+    EXPECT_TRUE(D->IsDominatedBy(A));
+    EXPECT_FALSE(D->IsDominatedBy(C));
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(dominator_tree, traversal_order) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Function* Func = IrBuilder->CreateFunction("TraversalOrder");
+
+    VMIR::BasicBlock* A = IrBuilder->CreateBasicBlock(Func, "A");
+    VMIR::BasicBlock* B = IrBuilder->CreateBasicBlock(Func, "B");
+    VMIR::BasicBlock* C = IrBuilder->CreateBasicBlock(Func, "C");
+    VMIR::BasicBlock* D = IrBuilder->CreateBasicBlock(Func, "D");
+    VMIR::BasicBlock* E = IrBuilder->CreateBasicBlock(Func, "E");
+    VMIR::BasicBlock* F = IrBuilder->CreateBasicBlock(Func, "F");
+    VMIR::BasicBlock* G = IrBuilder->CreateBasicBlock(Func, "G");
+
+    // Same graph as in example 1
+    Func->SetEntryBasicBlock(A);
+    IrBuilder->CreateJump(A, B);
+    IrBuilder->CreateBeq(B, nullptr, nullptr, C, F);
+    IrBuilder->CreateJump(C, D);
+    IrBuilder->CreateBeq(F, nullptr, nullptr, E, G);
+    IrBuilder->CreateJump(E, D);
+    IrBuilder->CreateJump(G, D);
+
+    using BasicBlocks = std::vector<VMIR::BasicBlock*>;
+
+    VMIR::DFS dfs{};
+    dfs.Run(A);
+    EXPECT_EQ(dfs.GetBasicBlocks(), BasicBlocks({A, B, C, D, F, E, G}));
+
+    // Another traversal over the same blocks while the first one keeps its state
+    VMIR::DFS reverseDfs{};
+    reverseDfs.SetReverse();
+    reverseDfs.Run(D);
+    EXPECT_EQ(reverseDfs.GetBasicBlocks(), BasicBlocks({D, C, B, A, E, F, G}));
+
+    // Running again needs no unmarking
+    dfs.Clear();
+    dfs.Run(A, F);
+    EXPECT_EQ(dfs.GetBasicBlocks(), BasicBlocks({A, B, C, D}));
+
+    size_t count = Func->GetBasicBlocks().size();
+    VMIR::RPO rpo{};
+    rpo.Run(A, &count);
+    EXPECT_EQ(count, 0);
+    EXPECT_EQ(rpo.GetBasicBlocks(), BasicBlocks({A, B, F, G, E, C, D}));
+
+    IrBuilder->Cleanup();
+}
+
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,361 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include <Arena.h>
+#include <IRBuilder.h>
+
+
+TEST(arena, bump_allocation) {
+    VMIR::Arena arena{};
+
+    void* first = arena.Allocate(24);
+    void* second = arena.Allocate(24);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % VMIR::Arena::kAlignment, 0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(second) % VMIR::Arena::kAlignment, 0);
+
+    // Big allocations must not break the current chunk
+    void* big = arena.Allocate(4 * VMIR::Arena::kDefaultChunkSize);
+    void* third = arena.Allocate(24);
+    EXPECT_NE(big, nullptr);
+    EXPECT_EQ(static_cast<char*>(third), static_cast<char*>(second) + VMIR::Arena::kAlignment * 2);
+
+    EXPECT_GT(arena.GetReservedBytes(), 4 * VMIR::Arena::kDefaultChunkSize);
+    arena.Release();
+    EXPECT_EQ(arena.GetReservedBytes(), 0);
+}
+
+
+TEST(arena, free_list_reuse) {
+    VMIR::Arena arena{};
+
+    void* first = arena.Allocate(40);
+    arena.Deallocate(first, 40);
+
+    // Another size class must not get the freed block
+    void* other = arena.Allocate(100);
+    EXPECT_NE(other, first);
+
+    void* reused = arena.Allocate(40);
+    EXPECT_EQ(reused, first);
+}
+
+
+TEST(ir_builder, removed_instruction_memory_is_reused) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Value* v0 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v1 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v2 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+
+    VMIR::InstructionAdd* add = IrBuilder->CreateAdd(v0, v1, v2);
+    void* addMemory = add;
+    IrBuilder->RemoveInstruction(add);
+    EXPECT_TRUE(v0->GetUsers().empty());
+
+    VMIR::InstructionSub* sub = IrBuilder->CreateSub(v0, v1, v2);
+    EXPECT_EQ(static_cast<void*>(sub), addMemory);
+    EXPECT_EQ(sub->GetInput1(), v0);
+    EXPECT_EQ(sub->GetInput2(), v1);
+    EXPECT_EQ(v2->GetProducer(), sub);
+
+    // Removing twice must be harmless
+    IrBuilder->RemoveValue(v0);
+    IrBuilder->RemoveValue(v0);
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(ir_builder, cleanup_resets_ids) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Function* Func = IrBuilder->CreateFunction(VMIR::ValueType::Int32, {VMIR::ValueType::Int32}, "Func");
+    VMIR::BasicBlock* bb = IrBuilder->CreateBasicBlock(Func);
+    VMIR::Value* c = IrBuilder->CreateValue(int32_t(42));
+    IrBuilder->CreateRet(bb, c);
+
+    EXPECT_EQ(Func->GetArg(0)->GetId(), 0);
+    EXPECT_EQ(bb->GetId(), 0);
+    EXPECT_EQ(IrBuilder->GetOrCreateValueWithData<int32_t>(42), c);
+
+    IrBuilder->Cleanup();
+
+    VMIR::Value* v = IrBuilder->CreateValue(VMIR::ValueType::Int32);
+    VMIR::BasicBlock* otherBB = IrBuilder->CreateBasicBlock();
+    EXPECT_EQ(v->GetId(), 0);
+    EXPECT_EQ(otherBB->GetId(), 0);
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(ir_builder, constant_interning) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Value* i32 = IrBuilder->GetOrCreateValueWithData<int32_t>(7);
+    EXPECT_EQ(IrBuilder->GetOrCreateValueWithData<int32_t>(7), i32);
+
+    // Same bits but another type is another constant
+    VMIR::Value* u32 = IrBuilder->GetOrCreateValueWithData<uint32_t>(7);
+    EXPECT_NE(u32, i32);
+    EXPECT_EQ(u32->GetValueType(), VMIR::ValueType::Uint32);
+
+    // Constants created directly are found as well
+    VMIR::Value* i64 = IrBuilder->CreateValue(int64_t(-1));
+    EXPECT_EQ(IrBuilder->GetOrCreateValueWithData<int64_t>(-1), i64);
+
+    // +0.0 and -0.0 compare equal but must not be folded into each other
+    VMIR::Value* posZero = IrBuilder->GetOrCreateValueWithData<double>(0.0);
+    VMIR::Value* negZero = IrBuilder->GetOrCreateValueWithData<double>(-0.0);
+    EXPECT_NE(posZero, negZero);
+    EXPECT_TRUE(std::signbit(negZero->GetValue<double>().value()));
+
+    IrBuilder->RemoveValue(i32);
+    VMIR::Value* recreated = IrBuilder->GetOrCreateValueWithData<int32_t>(7);
+    EXPECT_EQ(recreated->GetValue<int32_t>().value(), 7);
+    EXPECT_EQ(IrBuilder->GetOrCreateValueWithData<int32_t>(7), recreated);
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(ir_builder, value_payload_and_allocation_info) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    EXPECT_EQ(IrBuilder->CreateValue(int8_t(-5))->GetValue<int8_t>().value(), -5);
+    EXPECT_EQ(IrBuilder->CreateValue(uint16_t(65535))->GetValue<uint16_t>().value(), 65535);
+    EXPECT_EQ(IrBuilder->CreateValue(int64_t(-1))->GetValue<int64_t>().value(), -1);
+    EXPECT_EQ(IrBuilder->CreateValue(1.5f)->GetValue<float>().value(), 1.5f);
+    EXPECT_EQ(IrBuilder->CreateValue(-2.25)->GetValue<double>().value(), -2.25);
+
+    VMIR::Value* v = IrBuilder->CreateValue(VMIR::ValueType::Int32);
+    EXPECT_FALSE(v->HasValue());
+    EXPECT_FALSE(v->GetValue<int32_t>().has_value());
+
+    // Untouched values report empty interval and the first register
+    const VMIR::Value* constV = v;
+    EXPECT_EQ(constV->GetLiveInterval(), VMIR::LiveInterval(0, 0));
+    EXPECT_EQ(v->GetLocation(), VMIR::Location(VMIR::GPRegisterLocation(0)));
+
+    v->GetLiveInterval() = VMIR::LiveInterval(2, 10);
+    v->SetLocation(VMIR::StackLocation(3));
+    EXPECT_EQ(constV->GetLiveInterval(), VMIR::LiveInterval(2, 10));
+    EXPECT_EQ(v->GetLocation(), VMIR::Location(VMIR::StackLocation(3)));
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(ir_builder, use_lists) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Value* v0 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v1 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v2 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v3 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+
+    // Instruction is listed once for every input it takes the value through
+    VMIR::InstructionMul* mul = IrBuilder->CreateMul(v0, v0, v1);
+    VMIR::InstructionAdd* add = IrBuilder->CreateAdd(v1, v0, v2);
+    EXPECT_EQ(v0->GetUsers().size(), 3);
+    EXPECT_TRUE(v1->HasUser(add));
+
+    // Setting operand moves the use from one value to another
+    mul->SetOperand(1, v3);
+    EXPECT_EQ(mul->GetInput2(), v3);
+    EXPECT_TRUE(v3->HasUser(mul));
+    EXPECT_EQ(v0->GetUsers().size(), 2);
+
+    v0->ReplaceAllUsesWith(v3);
+    EXPECT_TRUE(v0->GetUsers().empty());
+    EXPECT_EQ(v3->GetUsers().size(), 3);
+    EXPECT_EQ(mul->GetInput1(), v3);
+    EXPECT_EQ(add->GetInput2(), v3);
+
+    // Growing argument list must keep the use-lists intact
+    VMIR::InstructionPhi* phi = IrBuilder->CreatePhi({v1, v2}, v0);
+    for (int i = 0; i < 16; ++i) {
+        phi->AddInput(v3);
+    }
+    EXPECT_EQ(v3->GetUsers().size(), 19);
+    phi->RemoveInput(v3);
+    EXPECT_EQ(v3->GetUsers().size(), 3);
+    EXPECT_EQ(phi->GetInputs().size(), 2);
+    EXPECT_EQ(phi->GetInputs()[1], v2);
+
+    IrBuilder->RemoveInstruction(phi);
+    IrBuilder->RemoveInstruction(add);
+    EXPECT_FALSE(v2->HasUser(phi));
+    EXPECT_EQ(v1->GetUsers().size(), 0);
+    EXPECT_EQ(v3->GetUsers().size(), 2);
+
+    // Removed value does not leave dangling inputs
+    IrBuilder->RemoveValue(v3);
+    EXPECT_EQ(mul->GetInput1(), nullptr);
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(ir_builder, uniform_operands) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Function* Callee = IrBuilder->CreateFunction(VMIR::ValueType::Void, {VMIR::ValueType::Int64, VMIR::ValueType::Int64}, "Callee");
+    VMIR::Value* v0 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v1 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v2 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+
+    VMIR::Instruction* sub = IrBuilder->CreateSub(v0, v1, v2);
+    EXPECT_EQ(sub->NumOperands(), 2);
+    EXPECT_EQ(sub->GetOperand(0), v0);
+    EXPECT_EQ(sub->GetOperand(1), v1);
+
+    EXPECT_EQ(IrBuilder->CreateRet()->NumOperands(), 0);
+    VMIR::InstructionRet* ret = IrBuilder->CreateRet(v2);
+    EXPECT_EQ(ret->NumOperands(), 1);
+    ret->SetReturnValue(nullptr);
+    EXPECT_EQ(ret->NumOperands(), 0);
+
+    // Arguments of the call live right after the instruction
+    VMIR::InstructionCall* call = IrBuilder->CreateCall(Callee, {v0, v1});
+    EXPECT_EQ(reinterpret_cast<const char*>(call->GetOperandUses().data()), reinterpret_cast<const char*>(call) + sizeof(VMIR::InstructionCall));
+    EXPECT_EQ(call->GetTrailingOperands().capacity, 2);
+
+    std::vector<VMIR::Value*> args(call->operands().begin(), call->operands().end());
+    EXPECT_EQ(args, std::vector<VMIR::Value*>({v0, v1}));
+
+    // Phi which outgrows the trailing array keeps its inputs and use-lists
+    VMIR::InstructionPhi* phi = IrBuilder->CreatePhi({v0, v1}, v2);
+    for (int i = 0; i < 8; ++i) {
+        phi->AddInput(i % 2 == 0 ? v0 : v1);
+    }
+    EXPECT_EQ(phi->NumOperands(), 10);
+    EXPECT_EQ(v0->GetUsers().size(), 7);
+    phi->RemoveInput(v0);
+    EXPECT_EQ(phi->NumOperands(), 5);
+    EXPECT_EQ(v0->GetUsers().size(), 2);
+    for (VMIR::Value* input : phi->operands()) {
+        EXPECT_EQ(input, v1);
+    }
+
+    // Memory of the removed instruction with trailing array goes to the free list of its full size
+    void* phiMemory = phi;
+    IrBuilder->RemoveInstruction(phi);
+    EXPECT_EQ(v1->GetUsers().size(), 2);
+    EXPECT_EQ(static_cast<void*>(IrBuilder->CreatePhi({v0, v1}, v2)), phiMemory);
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(ir_builder, small_vector) {
+    VMIR::SmallVector<int, 2> vec{1, 2};
+    EXPECT_TRUE(vec.IsInline());
+
+    // Outgrows inline storage and keeps the elements
+    vec.push_back(3);
+    vec.push_back(4);
+    EXPECT_FALSE(vec.IsInline());
+    EXPECT_EQ(std::vector<int>(vec.begin(), vec.end()), std::vector<int>({1, 2, 3, 4}));
+
+    // Erase keeps the order
+    vec.erase(vec.begin() + 1);
+    EXPECT_EQ(std::vector<int>(vec.begin(), vec.end()), std::vector<int>({1, 3, 4}));
+    EXPECT_TRUE(vec.contains(4));
+    EXPECT_FALSE(vec.contains(2));
+
+    VMIR::SmallVector<int, 2> copy = vec;
+    EXPECT_EQ(std::vector<int>(copy.begin(), copy.end()), std::vector<int>({1, 3, 4}));
+
+    VMIR::SmallVector<int, 2> moved = std::move(copy);
+    EXPECT_EQ(moved.size(), 3);
+    EXPECT_TRUE(copy.empty());
+    EXPECT_TRUE(copy.IsInline());
+}
+
+
+TEST(ir_builder, basic_block_edges) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::BasicBlock* bb0 = IrBuilder->CreateBasicBlock();
+    VMIR::BasicBlock* bb1 = IrBuilder->CreateBasicBlock();
+    VMIR::BasicBlock* bb2 = IrBuilder->CreateBasicBlock();
+    VMIR::BasicBlock* bb3 = IrBuilder->CreateBasicBlock();
+
+    // Predecessors keep insertion order and have no duplicates
+    bb0->AddPredecessor(bb3);
+    bb0->AddPredecessor(bb1);
+    bb0->AddPredecessor(bb2);
+    bb0->AddPredecessor(bb1);
+    EXPECT_EQ(std::vector<VMIR::BasicBlock*>(bb0->GetPredecessors().begin(), bb0->GetPredecessors().end()),
+              std::vector<VMIR::BasicBlock*>({bb3, bb1, bb2}));
+
+    bb0->RemovePredecessor(bb3);
+    EXPECT_EQ(std::vector<VMIR::BasicBlock*>(bb0->GetPredecessors().begin(), bb0->GetPredecessors().end()),
+              std::vector<VMIR::BasicBlock*>({bb1, bb2}));
+
+    // Successors skip missing edges
+    EXPECT_TRUE(bb0->GetSuccessors().empty());
+    bb0->SetFalseSuccessor(bb2);
+    ASSERT_EQ(bb0->GetSuccessors().size(), 1);
+    EXPECT_EQ(bb0->GetSuccessors()[0], bb2);
+    bb0->SetTrueSuccessor(bb1);
+    ASSERT_EQ(bb0->GetSuccessors().size(), 2);
+    EXPECT_EQ(bb0->GetSuccessors()[0], bb1);
+    EXPECT_EQ(bb0->GetSuccessors()[1], bb2);
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(ir_builder, instruction_order) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::BasicBlock* bb = IrBuilder->CreateBasicBlock();
+    VMIR::Value* v0 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+
+    VMIR::Instruction* first = IrBuilder->CreateMv(v0, v0);
+    VMIR::Instruction* last = IrBuilder->CreateMv(v0, v0);
+    bb->AppendInstruction(first);
+    bb->AppendInstruction(last);
+    EXPECT_TRUE(first->ComesBefore(last));
+    EXPECT_FALSE(last->ComesBefore(first));
+    EXPECT_FALSE(first->ComesBefore(first));
+
+    // Keep inserting right after the first instruction until the gap runs out and the block gets renumbered
+    for (int i = 0; i < 32; ++i) {
+        bb->InsertInstructionAfter(IrBuilder->CreateMv(v0, v0), first);
+    }
+    EXPECT_FALSE(bb->IsInstructionOrderValid());
+
+    bb->PrependInstruction(IrBuilder->CreateMv(v0, v0));
+    bb->InsertInstructionBefore(IrBuilder->CreateMv(v0, v0), last);
+
+    std::vector<VMIR::Instruction*> insts{};
+    for (VMIR::Instruction* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+        insts.push_back(inst);
+    }
+    for (size_t i = 0; i < insts.size(); ++i) {
+        for (size_t j = 0; j < insts.size(); ++j) {
+            EXPECT_EQ(insts[i]->ComesBefore(insts[j]), i < j);
+        }
+    }
+    EXPECT_TRUE(bb->IsInstructionOrderValid());
+
+    // Removal keeps the order valid
+    bb->RemoveInstruction(insts[2]);
+    EXPECT_TRUE(bb->IsInstructionOrderValid());
+    EXPECT_TRUE(insts[1]->ComesBefore(insts[3]));
+    EXPECT_TRUE(last->IsDominatedBy(first));
+    EXPECT_FALSE(first->IsDominatedBy(last));
+
+    IrBuilder->Cleanup();
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
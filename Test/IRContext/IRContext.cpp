@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+
+#include <IRBuilder.h>
+#include <StaticInliningPass.h>
+#include <ConstantFoldingPass.h>
+#include <PeepholesPass.h>
+#include <CheckEliminationPass.h>
+
+
+// Module with work for every pass: call to inline, constants to fold, repeated null checks and a loop
+static VMIR::Function* BuildModule(VMIR::IRContext* IrContext, uint64_t seed) {
+    // Callee
+    VMIR::Function* Scale = IrContext->CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "Scale");
+    VMIR::BasicBlock* Scale_BB_1 = IrContext->CreateBasicBlock(Scale, "Scale_BB_1");
+    Scale->SetEntryBasicBlock(Scale_BB_1);
+
+    VMIR::Value* scaled = IrContext->CreateValue(VMIR::ValueType::Uint64);
+    IrContext->CreateMul(Scale_BB_1, Scale->GetArg(0), IrContext->CreateValue(seed), scaled);
+    IrContext->CreateRet(Scale_BB_1, scaled);
+
+    // Caller
+    VMIR::Function* Compute = IrContext->CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "Compute");
+    VMIR::BasicBlock* Compute_BB_1 = IrContext->CreateBasicBlock(Compute, "Compute_BB_1");
+    VMIR::BasicBlock* Compute_BB_2 = IrContext->CreateBasicBlock(Compute, "Compute_BB_2");
+    VMIR::BasicBlock* Compute_BB_3 = IrContext->CreateBasicBlock(Compute, "Compute_BB_3");
+    Compute->SetEntryBasicBlock(Compute_BB_1);
+
+    VMIR::Value* ptr = IrContext->CreateValue(VMIR::ValueType::Pointer);
+    VMIR::Value* init = IrContext->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* counter = IrContext->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* called = IrContext->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* next = IrContext->CreateValue(VMIR::ValueType::Uint64);
+
+    IrContext->CreateAlloc(Compute_BB_1, ptr, VMIR::ValueType::Uint64);
+    IrContext->CreateNullCheck(Compute_BB_1, ptr);
+    IrContext->CreateAdd(Compute_BB_1, IrContext->CreateValue(seed), IrContext->CreateValue(uint64_t(3)), init);
+    IrContext->CreateJump(Compute_BB_1, Compute_BB_2);
+
+    IrContext->CreatePhi(Compute_BB_2, {init, next}, counter);
+    IrContext->CreateNullCheck(Compute_BB_2, ptr);
+    IrContext->CreateStore(Compute_BB_2, ptr, counter);
+    IrContext->CreateCall(Compute_BB_2, Scale, called, {counter});
+    IrContext->CreateAdd(Compute_BB_2, called, IrContext->CreateValue(uint64_t(1)), next);
+    IrContext->CreateBeq(Compute_BB_2, next, Compute->GetArg(0), Compute_BB_3, Compute_BB_2);
+
+    IrContext->CreateRet(Compute_BB_3, next);
+
+    return Compute;
+}
+
+// Run the whole pipeline and print the resulting IR
+static std::string CompileModule(VMIR::IRContext* IrContext, uint64_t seed) {
+    VMIR::Function* Compute = BuildModule(IrContext, seed);
+
+    VMIR::StaticInliningPass staticInliningPass{};
+    VMIR::ConstantFoldingPass constantFoldingPass{};
+    VMIR::PeepholesPass peepholesPass{};
+    VMIR::CheckEliminationPass checkEliminationPass{};
+
+    staticInliningPass.Run(Compute);
+    constantFoldingPass.Run(Compute);
+    peepholesPass.Run(Compute);
+    checkEliminationPass.Run(Compute);
+
+    VMIR::ControlFlowGraph* cfg = IrContext->GetOrCreateControlFlowGraph(Compute);
+    VMIR::RegisterAllocator* registerAllocator = IrContext->CreateRegisterAllocator(cfg, 2, 1);
+    if (!registerAllocator->PerformRegisterAllocation()) {
+        return {};
+    }
+
+    std::ostringstream out{};
+    IrContext->PrintIR(out);
+    for (auto* bb : cfg->GetBasicBlocks()) {
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            if (inst->GetOutput() != nullptr) {
+                out << inst->GetOutput()->GetValueStr() << ": [" << inst->GetOutput()->GetLiveInterval().start << ", "
+                    << inst->GetOutput()->GetLiveInterval().end << ")\n";
+            }
+        }
+    }
+
+    IrContext->Cleanup();
+    return out.str();
+}
+
+
+TEST(ir_context, contexts_are_independent) {
+    EXPECT_EQ(VMIR::IRBuilder::GetInstance(), VMIR::IRContext::GetInstance());
+
+    VMIR::IRContext first{};
+    VMIR::IRContext second{};
+
+    VMIR::Function* firstFunc = first.CreateFunction(VMIR::ValueType::Void, {VMIR::ValueType::Int64}, "First");
+    VMIR::Function* secondFunc = second.CreateFunction(VMIR::ValueType::Void, {VMIR::ValueType::Int64}, "Second");
+    EXPECT_EQ(firstFunc->GetContext(), &first);
+    EXPECT_EQ(secondFunc->GetContext(), &second);
+
+    // Every context numbers its objects on its own
+    EXPECT_EQ(firstFunc->GetArg(0)->GetId(), 0);
+    EXPECT_EQ(secondFunc->GetArg(0)->GetId(), 0);
+    EXPECT_EQ(first.CreateBasicBlock(firstFunc)->GetId(), 0);
+    EXPECT_EQ(second.CreateBasicBlock(secondFunc)->GetId(), 0);
+
+    // Constants are interned per context
+    EXPECT_NE(first.GetOrCreateValueWithData(int64_t(42)), second.GetOrCreateValueWithData(int64_t(42)));
+
+    // Cleanup of one context leaves the other one intact
+    first.Cleanup();
+    EXPECT_EQ(secondFunc->GetName(), "Second");
+    EXPECT_EQ(second.CreateBasicBlock(secondFunc)->GetId(), 1);
+}
+
+
+TEST(ir_context, parallel_compilation) {
+    constexpr size_t threadCount = 8;
+    constexpr size_t modulesPerThread = 16;
+
+    // Reference results are produced one by one
+    std::vector<std::string> expected(threadCount * modulesPerThread);
+    for (size_t i = 0; i < expected.size(); ++i) {
+        VMIR::IRContext IrContext{};
+        expected[i] = CompileModule(&IrContext, i);
+        ASSERT_FALSE(expected[i].empty());
+    }
+
+    // Every thread compiles its own modules, each one in its own context
+    std::vector<std::string> results(expected.size());
+    std::vector<std::thread> threads{};
+    for (size_t t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&results, t]() {
+            for (size_t m = 0; m < modulesPerThread; ++m) {
+                const size_t idx = t * modulesPerThread + m;
+                VMIR::IRContext IrContext{};
+                results[idx] = CompileModule(&IrContext, idx);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(results[i], expected[i]);
+    }
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
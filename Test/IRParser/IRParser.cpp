@@ -0,0 +1,257 @@
+#include <gtest/gtest.h>
+
+#include <IRBuilder.h>
+#include <IRParser.h>
+
+#include <cctype>
+#include <sstream>
+#include <unordered_map>
+
+
+static std::string PrintIR(VMIR::IRContext* IrContext) {
+    std::ostringstream out{};
+    IrContext->PrintIR(out);
+    return out.str();
+}
+
+// Values are renamed in the order of their appearance, so texts from different contexts can be compared
+static std::string CanonicalizeValueNames(const std::string& text) {
+    std::unordered_map<std::string, size_t> names{};
+    std::string result{};
+    for (size_t i = 0; i < text.size();) {
+        const bool startsWord = i == 0 || !(std::isalnum(static_cast<unsigned char>(text[i - 1])) || text[i - 1] == '_');
+        if (startsWord && text[i] == 'v' && i + 1 < text.size() && std::isdigit(static_cast<unsigned char>(text[i + 1]))) {
+            size_t end = i + 1;
+            while (end < text.size() && std::isdigit(static_cast<unsigned char>(text[end]))) {
+                ++end;
+            }
+            const std::string name = text.substr(i, end - i);
+            result += "%" + std::to_string(names.try_emplace(name, names.size()).first->second);
+            i = end;
+            continue;
+        }
+        result += text[i++];
+    }
+    return result;
+}
+
+
+TEST(ir_parser, parses_sample_files) {
+    // Both samples define #Fact, so they go to different contexts
+    VMIR::IRContext loopContext{};
+    VMIR::IRParser loopParser{&loopContext};
+    ASSERT_TRUE(loopParser.ParseFile("SampleIR/FactLoop/FactLoop.vmir")) << loopParser.GetError();
+    ASSERT_EQ(loopParser.GetFunctions().size(), 1);
+
+    VMIR::Function* FactLoop = loopParser.GetFunctions()[0];
+    EXPECT_EQ(FactLoop->GetReturnType(), VMIR::ValueType::Uint64);
+    ASSERT_EQ(FactLoop->Size(), 5);
+    EXPECT_EQ(FactLoop->GetEntryBasicBlock()->GetName(), "Entry");
+
+    VMIR::BasicBlock* LoopHeader = FactLoop->GetBasicBlock(2);
+    VMIR::BasicBlock* LoopBody = FactLoop->GetBasicBlock(3);
+    ASSERT_EQ(LoopHeader->GetPredecessors().size(), 2);
+    EXPECT_EQ(LoopHeader->GetPredecessors()[0], FactLoop->GetBasicBlock(1));
+    EXPECT_EQ(LoopHeader->GetPredecessors()[1], LoopBody);
+
+    // Phi takes the value defined later in the loop body
+    VMIR::Instruction* phi = LoopHeader->Front();
+    ASSERT_EQ(phi->GetType(), VMIR::InstructionType::Phi);
+    VMIR::Value* v6 = phi->operands()[1];
+    ASSERT_NE(v6->GetProducer(), nullptr);
+    EXPECT_EQ(v6->GetProducer()->GetParentBasicBlock(), LoopBody);
+    EXPECT_EQ(v6->GetValueType(), VMIR::ValueType::Uint64);
+
+    VMIR::Instruction* branch = LoopHeader->Back();
+    ASSERT_EQ(branch->GetType(), VMIR::InstructionType::Bgt);
+    EXPECT_EQ(branch->operands()[1], FactLoop->GetArg(0));
+    EXPECT_EQ(LoopHeader->GetTrueSuccessor(), FactLoop->GetBasicBlock(4));
+    EXPECT_EQ(LoopHeader->GetFalseSuccessor(), LoopBody);
+
+    // Recursive call resolves to the function being parsed
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    ASSERT_TRUE(parser.ParseFile("SampleIR/FactRecursive/FactRecursive.vmir")) << parser.GetError();
+    VMIR::Function* FactRecursive = parser.GetFunctions()[0];
+    EXPECT_TRUE(FactRecursive->IsValid());
+    VMIR::Instruction* call = FactRecursive->GetBasicBlock(3)->Front()->GetNext();
+    ASSERT_EQ(call->GetType(), VMIR::InstructionType::Call);
+    EXPECT_EQ(static_cast<VMIR::InstructionCall*>(call)->GetFunction(), FactRecursive);
+
+    // Printed result is parsed back to the same text
+    const std::string printed = PrintIR(&IrContext);
+    VMIR::IRContext reparsedContext{};
+    VMIR::IRParser reparser{&reparsedContext};
+    ASSERT_TRUE(reparser.Parse(printed)) << reparser.GetError();
+    EXPECT_EQ(CanonicalizeValueNames(PrintIR(&reparsedContext)), CanonicalizeValueNames(printed));
+}
+
+
+TEST(ir_parser, round_trip_of_every_instruction) {
+    /*
+        function void #Fill(ptr v0, i32 v1) {
+        Fill_BB_1:
+            NullCheck ptr v0
+            v2 = Alloc i32, 16
+            v3 = Add ptr v2, 4
+            BoundsCheck ptr v3, [ptr v2, 16]
+            Store i32 v1, ptr v3
+            v4 = Load i32, ptr v3
+            v5 = Shl i32 v4, 2
+            v6 = Ashr i32 -8, v5
+            v7 = Xor i32 v6, v5
+            Bge i32 v7, 0 ? #Fill_BB_2 : #Fill_BB_3
+        Fill_BB_2: (preds: Fill_BB_1)
+            v8 = Mv i32 v7
+            Jump #Fill_BB_3
+        Fill_BB_3: (preds: Fill_BB_1, Fill_BB_2)
+            v9 = Phi i32 v7, v8
+            v10 = Call f64 #Scale(i32 v9, f64 0.500000)
+            Ret
+        }
+
+        function f64 #Scale(i32 v11, f64 v12) {
+        Scale_BB_1:
+            v13 = Mul f64 v12, -1.250000
+            v14 = Div f64 v13, v12
+            Ret f64 v14
+        }
+    */
+    VMIR::IRContext IrContext{};
+
+    VMIR::Function* Scale = IrContext.CreateFunction(VMIR::ValueType::Float64, {VMIR::ValueType::Int32, VMIR::ValueType::Float64}, "Scale");
+    VMIR::Function* Fill = IrContext.CreateFunction(VMIR::ValueType::Void, {VMIR::ValueType::Pointer, VMIR::ValueType::Int32}, "Fill");
+    VMIR::BasicBlock* Fill_BB_1 = IrContext.CreateBasicBlock(Fill, "Fill_BB_1");
+    VMIR::BasicBlock* Fill_BB_2 = IrContext.CreateBasicBlock(Fill, "Fill_BB_2");
+    VMIR::BasicBlock* Fill_BB_3 = IrContext.CreateBasicBlock(Fill, "Fill_BB_3");
+    Fill->SetEntryBasicBlock(Fill_BB_1);
+
+    VMIR::Value* v2 = IrContext.CreateValue(VMIR::ValueType::Pointer);
+    VMIR::Value* v3 = IrContext.CreateValue(VMIR::ValueType::Pointer);
+    VMIR::Value* v4 = IrContext.CreateValue(VMIR::ValueType::Int32);
+    VMIR::Value* v5 = IrContext.CreateValue(VMIR::ValueType::Int32);
+    VMIR::Value* v6 = IrContext.CreateValue(VMIR::ValueType::Int32);
+    VMIR::Value* v7 = IrContext.CreateValue(VMIR::ValueType::Int32);
+    VMIR::Value* v8 = IrContext.CreateValue(VMIR::ValueType::Int32);
+    VMIR::Value* v9 = IrContext.CreateValue(VMIR::ValueType::Int32);
+    VMIR::Value* v10 = IrContext.CreateValue(VMIR::ValueType::Float64);
+
+    IrContext.CreateNullCheck(Fill_BB_1, Fill->GetArg(0));
+    IrContext.CreateAlloc(Fill_BB_1, v2, VMIR::ValueType::Int32, 16);
+    IrContext.CreateAdd(Fill_BB_1, v2, IrContext.CreateValue(int64_t(4)), v3);
+    IrContext.CreateBoundsCheck(Fill_BB_1, v3, v2);
+    IrContext.CreateStore(Fill_BB_1, v3, Fill->GetArg(1));
+    IrContext.CreateLoad(Fill_BB_1, v3, v4);
+    IrContext.CreateShl(Fill_BB_1, v4, IrContext.CreateValue(int32_t(2)), v5);
+    IrContext.CreateAshr(Fill_BB_1, IrContext.CreateValue(int32_t(-8)), v5, v6);
+    IrContext.CreateXor(Fill_BB_1, v6, v5, v7);
+    IrContext.CreateBge(Fill_BB_1, v7, IrContext.CreateValue(int32_t(0)), Fill_BB_2, Fill_BB_3);
+    IrContext.CreateMv(Fill_BB_2, v7, v8);
+    IrContext.CreateJump(Fill_BB_2, Fill_BB_3);
+    IrContext.CreatePhi(Fill_BB_3, {v7, v8}, v9);
+    IrContext.CreateCall(Fill_BB_3, Scale, v10, {v9, IrContext.CreateValue(0.5)});
+    IrContext.CreateRet(Fill_BB_3);
+
+    VMIR::BasicBlock* Scale_BB_1 = IrContext.CreateBasicBlock(Scale, "Scale_BB_1");
+    Scale->SetEntryBasicBlock(Scale_BB_1);
+    VMIR::Value* v13 = IrContext.CreateValue(VMIR::ValueType::Float64);
+    VMIR::Value* v14 = IrContext.CreateValue(VMIR::ValueType::Float64);
+    IrContext.CreateMul(Scale_BB_1, Scale->GetArg(1), IrContext.CreateValue(-1.25), v13);
+    IrContext.CreateDiv(Scale_BB_1, v13, Scale->GetArg(1), v14);
+    IrContext.CreateRet(Scale_BB_1, v14);
+
+    // Caller goes first, so the callee is declared by the call
+    IrContext.MoveFunctionToBack(Scale);
+    const std::string printed = PrintIR(&IrContext);
+
+    VMIR::IRContext parsedContext{};
+    VMIR::IRParser parser{&parsedContext};
+    ASSERT_TRUE(parser.Parse(printed)) << parser.GetError();
+    EXPECT_EQ(CanonicalizeValueNames(PrintIR(&parsedContext)), CanonicalizeValueNames(printed));
+
+    ASSERT_EQ(parsedContext.GetFunctions().size(), 2);
+    VMIR::Function* parsedFill = parsedContext.GetFunctions().front();
+    VMIR::Function* parsedScale = parsedContext.GetFunctions().back();
+    EXPECT_TRUE(parsedFill->IsValid());
+    EXPECT_TRUE(parsedScale->IsValid());
+
+    // Offset added to the pointer is a 64-bit integer, the sum is a pointer
+    VMIR::Instruction* add = parsedFill->GetEntryBasicBlock()->Front()->GetNext()->GetNext();
+    ASSERT_EQ(add->GetType(), VMIR::InstructionType::Add);
+    EXPECT_EQ(add->operands()[1]->GetValueType(), VMIR::ValueType::Int64);
+    EXPECT_EQ(add->GetOutput()->GetValueType(), VMIR::ValueType::Pointer);
+
+    // Constants are shared with the rest of the context
+    EXPECT_EQ(parsedContext.GetOrCreateValueWithData(int32_t(-8)), parsedFill->GetEntryBasicBlock()->Back()->GetPrev()->GetPrev()->operands()[0]);
+}
+
+
+TEST(ir_parser, predecessors_follow_the_header) {
+    // Phi inputs are matched to predecessors by position, and branches are listed in another order
+    const std::string text =
+        "function i64 #Select(i64 v0) {\n"
+        "A:\n"
+        "    Blt i64 v0, 0 ? #C : #B\n"
+        "\n"
+        "B: (preds: A)\n"
+        "    v1 = Sub i64 0, v0\n"
+        "    Jump #C\n"
+        "\n"
+        "C: (preds: B, A)\n"
+        "    v2 = Phi i64 v1, v0\n"
+        "    Ret i64 v2\n"
+        "}\n";
+
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    ASSERT_TRUE(parser.Parse(text)) << parser.GetError();
+
+    VMIR::Function* Select = parser.GetFunctions()[0];
+    VMIR::BasicBlock* A = Select->GetBasicBlock(0);
+    VMIR::BasicBlock* B = Select->GetBasicBlock(1);
+    VMIR::BasicBlock* C = Select->GetBasicBlock(2);
+    ASSERT_EQ(C->GetPredecessors().size(), 2);
+    EXPECT_EQ(C->GetPredecessors()[0], B);
+    EXPECT_EQ(C->GetPredecessors()[1], A);
+    EXPECT_TRUE(Select->IsValid());
+
+    // Missing edge is reported
+    const std::string wrongPreds =
+        "function void #F() {\n"
+        "A:\n"
+        "    Jump #B\n"
+        "B: (preds: A, B)\n"
+        "    Ret\n"
+        "}\n";
+    VMIR::IRContext wrongContext{};
+    VMIR::IRParser wrongParser{&wrongContext};
+    EXPECT_FALSE(wrongParser.Parse(wrongPreds));
+    EXPECT_NE(wrongParser.GetError().find("predecessors of B"), std::string::npos);
+}
+
+
+TEST(ir_parser, reports_errors) {
+    auto parseError = [](const std::string& text) {
+        VMIR::IRContext IrContext{};
+        VMIR::IRParser parser{&IrContext};
+        EXPECT_FALSE(parser.Parse(text));
+        return parser.GetError();
+    };
+
+    EXPECT_EQ(parseError("fn void #F() {\n}"), "1:3: expected 'function'");
+    EXPECT_EQ(parseError("function void #F() {\nA:\n    Frobnicate\n}"), "3:15: unknown instruction 'Frobnicate'");
+    EXPECT_EQ(parseError("function i8 #F() {\nA:\n    Ret i8 300\n}"), "3:15: invalid constant '300' of type i8");
+    EXPECT_EQ(parseError("function i32 #F() {\nA:\n    Ret i32 v7\n}"), "4:2: value v7 is used but not defined in #F");
+    EXPECT_EQ(parseError("function void #F() {\nA:\n    Jump #B\n}"), "4:2: basic block B is used but not defined in #F");
+    EXPECT_EQ(parseError("function void #F() {\nA:\n    Ret\n}\nfunction void #F() {\n}"), "5:19: redefinition of function #F");
+    EXPECT_EQ(parseError("function i32 #F(i32 v0) {\nA:\n    v0 = Mv i32 1\n    Ret i32 v0\n}"), "3:18: redefinition of value v0");
+    EXPECT_EQ(parseError("function void #F() {\nA:\n    Call #G(i32 1)\n    Ret\n}\nfunction i32 #G(i32 v0) {\n}"),
+              "6:24: definition of #G does not match its calls");
+    EXPECT_EQ(parseError("function i32 #F() {\nA:\n    Ret i32 v1000000000000\n}"), "3:27: value index of v1000000000000 is out of range");
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <IRBuilder.h>
+#include <IRParser.h>
+#include <IRPrinter.h>
+
+#include <limits>
+#include <sstream>
+
+
+// Output of Function::Print, which builds every line from temporary strings
+static std::string PrintWithFunctions(VMIR::IRContext* IrContext) {
+    std::ostringstream out{};
+    for (auto* func : IrContext->GetFunctions()) {
+        func->Print(out);
+        out << "\n\n";
+    }
+    return out.str();
+}
+
+static std::string PrintWithPrinter(VMIR::IRContext* IrContext) {
+    std::ostringstream out{};
+    VMIR::IRPrinter printer{};
+    printer.PrintIR(IrContext, out);
+    return out.str();
+}
+
+
+TEST(ir_printer, matches_print_of_sample_files) {
+    for (const char* filename : {"SampleIR/FactLoop/FactLoop.vmir", "SampleIR/FactRecursive/FactRecursive.vmir"}) {
+        VMIR::IRContext IrContext{};
+        VMIR::IRParser parser{&IrContext};
+        ASSERT_TRUE(parser.ParseFile(filename)) << parser.GetError();
+        EXPECT_EQ(PrintWithPrinter(&IrContext), PrintWithFunctions(&IrContext)) << filename;
+    }
+}
+
+
+TEST(ir_printer, matches_print_of_every_instruction) {
+    VMIR::IRContext IrContext{};
+
+    VMIR::Function* Scale = IrContext.CreateFunction(VMIR::ValueType::Float32, {VMIR::ValueType::Int8, VMIR::ValueType::Float32}, "Scale");
+    VMIR::Function* Fill = IrContext.CreateFunction(VMIR::ValueType::Void, {VMIR::ValueType::Pointer, VMIR::ValueType::Uint16}, "Fill");
+
+    // Second block has no name, so both printers use the placeholder
+    VMIR::BasicBlock* Fill_BB_1 = IrContext.CreateBasicBlock(Fill, "Fill_BB_1");
+    VMIR::BasicBlock* Unnamed = IrContext.CreateBasicBlock(Fill);
+    VMIR::BasicBlock* Fill_BB_3 = IrContext.CreateBasicBlock(Fill, "Fill_BB_3");
+    Fill->SetEntryBasicBlock(Fill_BB_1);
+
+    VMIR::Value* v2 = IrContext.CreateValue(VMIR::ValueType::Pointer);
+    VMIR::Value* v3 = IrContext.CreateValue(VMIR::ValueType::Pointer);
+    VMIR::Value* v4 = IrContext.CreateValue(VMIR::ValueType::Uint16);
+    VMIR::Value* v5 = IrContext.CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v6 = IrContext.CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v7 = IrContext.CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v8 = IrContext.CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v9 = IrContext.CreateValue(VMIR::ValueType::Float32);
+    VMIR::Value* v10 = IrContext.CreateValue(VMIR::ValueType::Pointer);
+
+    IrContext.CreateNullCheck(Fill_BB_1, Fill->GetArg(0));
+    IrContext.CreateAlloc(Fill_BB_1, v2, VMIR::ValueType::Uint16, 16);
+    IrContext.CreateAlloc(Fill_BB_1, v10, VMIR::ValueType::Float64);
+    IrContext.CreateAdd(Fill_BB_1, v2, IrContext.CreateValue(int64_t(4)), v3);
+    IrContext.CreateBoundsCheck(Fill_BB_1, v3, v2);
+    IrContext.CreateStore(Fill_BB_1, v3, Fill->GetArg(1));
+    IrContext.CreateLoad(Fill_BB_1, v3, v4);
+    IrContext.CreateAshr(Fill_BB_1, IrContext.CreateValue(std::numeric_limits<int64_t>::min()), IrContext.CreateValue(int64_t(3)), v5);
+    IrContext.CreateOr(Fill_BB_1, IrContext.CreateValue(std::numeric_limits<uint64_t>::max()), IrContext.CreateValue(uint64_t(0)), v6);
+    IrContext.CreateBle(Fill_BB_1, v5, IrContext.CreateValue(int64_t(-1)), Unnamed, Fill_BB_3);
+    IrContext.CreateMv(Unnamed, v5, v7);
+    IrContext.CreateJump(Unnamed, Fill_BB_3);
+    IrContext.CreatePhi(Fill_BB_3, {v5, v7}, v8);
+    IrContext.CreateCall(Fill_BB_3, Scale, v9, {IrContext.CreateValue(int8_t(-128)), IrContext.CreateValue(1.0e20f)});
+    IrContext.CreateCall(Fill_BB_3, Fill, {Fill->GetArg(0), IrContext.CreateValue(uint16_t(65535))});
+    IrContext.CreateRet(Fill_BB_3);
+
+    VMIR::BasicBlock* Scale_BB_1 = IrContext.CreateBasicBlock(Scale, "Scale_BB_1");
+    Scale->SetEntryBasicBlock(Scale_BB_1);
+    VMIR::Value* v13 = IrContext.CreateValue(VMIR::ValueType::Float32);
+    VMIR::Value* v14 = IrContext.CreateValue(VMIR::ValueType::Float32);
+    IrContext.CreateMul(Scale_BB_1, Scale->GetArg(1), IrContext.CreateValue(-0.0000004f), v13);
+    IrContext.CreateDiv(Scale_BB_1, v13, IrContext.CreateValue(3.14159265f), v14);
+    IrContext.CreateRet(Scale_BB_1, v14);
+
+    const std::string expected = PrintWithFunctions(&IrContext);
+    EXPECT_EQ(PrintWithPrinter(&IrContext), expected);
+
+    // Single instructions are the same as GetAsString
+    VMIR::IRPrinter printer{};
+    for (auto* bb : Fill->GetBasicBlocks()) {
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            printer.Clear();
+            printer.PrintInstruction(inst);
+            EXPECT_EQ(printer.GetBuffer(), inst->GetAsString());
+        }
+    }
+
+    // Buffer is reused, so printing the function again does not grow it
+    printer.Clear();
+    printer.PrintFunction(Fill);
+    const char* data = printer.GetBuffer().data();
+    printer.Clear();
+    printer.PrintFunction(Fill);
+    EXPECT_EQ(printer.GetBuffer().data(), data);
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,310 @@
+#include <gtest/gtest.h>
+
+#include <IRBuilder.h>
+#include <IRParser.h>
+#include <Interpreter.h>
+#include <ConstantFoldingPass.h>
+#include <PeepholesPass.h>
+#include <StaticInliningPass.h>
+
+
+static const char* kProgram = R"(
+function i32 #Sum(ptr v0, i64 v1) {
+Entry:
+    Jump #Header
+
+Header: (preds: Entry, Body)
+    v2 = Phi i64 0, v7
+    v3 = Phi i32 0, v6
+    Bge i64 v2, v1 ? #Exit : #Body
+
+Body: (preds: Header)
+    v4 = Shl i64 v2, 2
+    v5 = Add ptr v0, v4
+    NullCheck ptr v5
+    v8 = Load i32, ptr v5
+    v6 = Add i32 v3, v8
+    v7 = Add i64 v2, 1
+    Jump #Header
+
+Exit: (preds: Header)
+    Ret i32 v3
+}
+
+function i32 #Fill(i64 v0) {
+Entry:
+    v1 = Alloc i32, 4
+    v2 = Mul i64 v0, 4
+    v3 = Add ptr v1, v2
+    BoundsCheck ptr v3, [ptr v1, 4]
+    Store i32 7, ptr v3
+    Store i32 -5, ptr v1
+    v4 = Call i32 #Sum(ptr v1, i64 4)
+    Ret i32 v4
+}
+
+function i8 #Narrow(i8 v0, i8 v1) {
+Entry:
+    v2 = Mul i8 v0, v1
+    v3 = Ashr i8 v2, 1
+    v4 = Shr i8 v2, 1
+    v5 = Xor i8 v3, v4
+    Ret i8 v5
+}
+
+function f64 #Mean(f64 v0, f64 v1) {
+Entry:
+    v2 = Add f64 v0, v1
+    v3 = Div f64 v2, 2.0
+    Blt f64 v3, 0.0 ? #Negative : #Done
+
+Negative: (preds: Entry)
+    v4 = Sub f64 0.0, v3
+    Ret f64 v4
+
+Done: (preds: Entry)
+    Ret f64 v3
+}
+
+function i32 #Div(i32 v0, i32 v1) {
+Entry:
+    v2 = Div i32 v0, v1
+    v3 = Rem i32 v0, v1
+    v4 = Mul i32 v2, 100
+    v5 = Add i32 v4, v3
+    Ret i32 v5
+}
+
+function i32 #Deref(ptr v0) {
+Entry:
+    NullCheck ptr v0
+    v1 = Load i32, ptr v0
+    Ret i32 v1
+}
+
+function i32 #Forever(i32 v0) {
+Entry:
+    v1 = Call i32 #Forever(i32 v0)
+    Ret i32 v1
+}
+
+function ui32 #Swap(ui32 v0) {
+Entry:
+    Jump #Loop
+
+Loop: (preds: Entry, Loop)
+    v1 = Phi ui32 1, v2
+    v2 = Phi ui32 2, v1
+    v3 = Phi ui32 0, v4
+    v4 = Add ui32 v3, 1
+    Blt ui32 v4, v0 ? #Loop : #Exit
+
+Exit: (preds: Loop)
+    v5 = Mul ui32 v1, 10
+    v6 = Add ui32 v5, v2
+    Ret ui32 v6
+}
+
+function i32 #Sel(i32 v0) {
+Entry:
+    v1 = Add i32 v0, 1
+    v2 = Add i32 v0, 2
+    Bgt i32 v0, 0 ? #A : #B
+
+A: (preds: Entry)
+    Jump #J
+
+B: (preds: Entry)
+    Jump #J
+
+J: (preds: A, B)
+    v3 = Phi i32 v1, v2
+    Ret i32 v3
+}
+)";
+
+
+TEST(interpreter, runs_sample_files) {
+    VMIR::IRContext loopContext{};
+    VMIR::IRParser loopParser{&loopContext};
+    ASSERT_TRUE(loopParser.ParseFile("SampleIR/FactLoop/FactLoop.vmir")) << loopParser.GetError();
+
+    VMIR::Interpreter loopInterpreter{&loopContext};
+    VMIR::Function* FactLoop = loopParser.GetFunctions()[0];
+    EXPECT_EQ(loopInterpreter.Call<uint64_t>(FactLoop, uint64_t(10)), 3628800);
+    EXPECT_EQ(loopInterpreter.Call<uint64_t>(FactLoop, uint64_t(20)), 2432902008176640000);
+    EXPECT_EQ(loopInterpreter.Call<uint64_t>(FactLoop, uint64_t(0)), 1);
+
+    VMIR::IRContext recursiveContext{};
+    VMIR::IRParser recursiveParser{&recursiveContext};
+    ASSERT_TRUE(recursiveParser.ParseFile("SampleIR/FactRecursive/FactRecursive.vmir")) << recursiveParser.GetError();
+
+    VMIR::Interpreter recursiveInterpreter{&recursiveContext};
+    VMIR::Function* FactRecursive = recursiveParser.GetFunctions()[0];
+    EXPECT_EQ(recursiveInterpreter.Call<int32_t>(FactRecursive, int32_t(10)), 3628800);
+    EXPECT_EQ(recursiveInterpreter.Call<int32_t>(FactRecursive, int32_t(1)), 1);
+}
+
+
+TEST(interpreter, runs_all_instructions) {
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    ASSERT_TRUE(parser.Parse(kProgram)) << parser.GetError();
+
+    VMIR::Interpreter interpreter{&IrContext};
+    auto function = [&parser](const std::string& name) {
+        for (auto* func : parser.GetFunctions()) {
+            if (func->GetName() == name) {
+                return func;
+            }
+        }
+        return static_cast<VMIR::Function*>(nullptr);
+    };
+
+    // Alloc, stores, call, loop with loads
+    EXPECT_EQ(interpreter.Call<int32_t>(function("Fill"), int64_t(2)), 2);
+    EXPECT_EQ(interpreter.Call<int32_t>(function("Fill"), int64_t(0)), -5);
+
+    // 16 * 10 = 160 wraps to -96, Ashr gives -48 and Shr gives 80
+    EXPECT_EQ(interpreter.Call<int8_t>(function("Narrow"), int8_t(16), int8_t(10)), int8_t(-48 ^ 80));
+
+    EXPECT_EQ(interpreter.Call<double>(function("Mean"), 1.0, 4.0), 2.5);
+    EXPECT_EQ(interpreter.Call<double>(function("Mean"), -1.0, -4.0), 2.5);
+
+    EXPECT_EQ(interpreter.Call<int32_t>(function("Div"), int32_t(-7), int32_t(2)), -301);
+    EXPECT_EQ(interpreter.Call<int32_t>(function("Div"), int32_t(INT32_MIN), int32_t(-1)), int32_t(uint32_t(INT32_MIN) * 100u));
+
+    int32_t cell = 42;
+    EXPECT_TRUE(interpreter.Run(function("Deref"), {reinterpret_cast<uintptr_t>(&cell)}));
+    EXPECT_EQ(interpreter.GetResult(), 42);
+
+    // All phis of a block take their inputs at once
+    EXPECT_EQ(interpreter.Call<uint32_t>(function("Swap"), uint32_t(1)), 12);
+    EXPECT_EQ(interpreter.Call<uint32_t>(function("Swap"), uint32_t(2)), 21);
+    EXPECT_EQ(interpreter.Call<uint32_t>(function("Swap"), uint32_t(5)), 12);
+
+    // Both inputs are available on both edges, each edge takes the input at its position
+    EXPECT_EQ(interpreter.Call<int32_t>(function("Sel"), int32_t(5)), 6);
+    EXPECT_EQ(interpreter.Call<int32_t>(function("Sel"), int32_t(-1)), 1);
+}
+
+
+TEST(interpreter, reports_errors) {
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    ASSERT_TRUE(parser.Parse(kProgram)) << parser.GetError();
+
+    VMIR::Interpreter interpreter{&IrContext, 1 << 12};
+    auto runError = [&](const std::string& name, const std::vector<uint64_t>& args) {
+        for (auto* func : parser.GetFunctions()) {
+            if (func->GetName() == name) {
+                EXPECT_FALSE(interpreter.Run(func, args));
+                return interpreter.GetError();
+            }
+        }
+        return std::string{};
+    };
+
+    EXPECT_EQ(runError("Fill", {4}), "bounds check failed in #Fill");
+    EXPECT_EQ(runError("Deref", {0}), "null check failed in #Deref");
+    EXPECT_EQ(runError("Div", {1, 0}), "division by zero in #Div");
+    EXPECT_EQ(runError("Forever", {1}), "stack overflow in #Forever");
+    EXPECT_EQ(runError("Div", {1}), "#Div takes 2 arguments");
+
+    // Errors do not break the next runs
+    EXPECT_EQ(interpreter.Call<int32_t>(parser.GetFunctions()[1], int64_t(3)), 2);
+}
+
+
+TEST(interpreter, matches_optimized_code) {
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    ASSERT_TRUE(parser.Parse(kProgram)) << parser.GetError();
+
+    VMIR::Interpreter interpreter{&IrContext};
+    std::vector<uint64_t> before{};
+    for (int64_t i = 0; i < 4; ++i) {
+        ASSERT_TRUE(interpreter.Run(parser.GetFunctions()[1], {static_cast<uint64_t>(i)}));
+        before.push_back(interpreter.GetResult());
+    }
+    ASSERT_TRUE(interpreter.Run(parser.GetFunctions()[2], {VMIR::ToBitPattern(int8_t(-3)), VMIR::ToBitPattern(int8_t(7))}));
+    before.push_back(interpreter.GetResult());
+
+    VMIR::ConstantFoldingPass constantFoldingPass{};
+    VMIR::PeepholesPass peepholesPass{};
+    for (auto* func : parser.GetFunctions()) {
+        constantFoldingPass.Run(func);
+        peepholesPass.Run(func);
+    }
+    interpreter.Invalidate();
+
+    std::vector<uint64_t> after{};
+    for (int64_t i = 0; i < 4; ++i) {
+        ASSERT_TRUE(interpreter.Run(parser.GetFunctions()[1], {static_cast<uint64_t>(i)})) << interpreter.GetError();
+        after.push_back(interpreter.GetResult());
+    }
+    ASSERT_TRUE(interpreter.Run(parser.GetFunctions()[2], {VMIR::ToBitPattern(int8_t(-3)), VMIR::ToBitPattern(int8_t(7))}));
+    after.push_back(interpreter.GetResult());
+
+    EXPECT_EQ(before, after);
+}
+
+
+TEST(interpreter, matches_inlined_code) {
+    // The phi of Join takes v1 along the edge from Entry, which the inliner splits
+    static const char* kCallerProgram = R"(
+function i64 #Abs(i64 v0) {
+Entry:
+    Blt i64 v0, 0 ? #Negative : #Done
+
+Negative: (preds: Entry)
+    v1 = Sub i64 0, v0
+    Ret i64 v1
+
+Done: (preds: Entry)
+    Ret i64 v0
+}
+
+function i64 #Foo(i64 v0) {
+Entry:
+    v1 = Call i64 #Abs(i64 v0)
+    Bgt i64 v0, 0 ? #Join : #Other
+
+Other: (preds: Entry)
+    v2 = Add i64 v0, 100
+    Jump #Join
+
+Join: (preds: Entry, Other)
+    v3 = Phi i64 v1, v2
+    Ret i64 v3
+}
+)";
+
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    ASSERT_TRUE(parser.Parse(kCallerProgram)) << parser.GetError();
+    VMIR::Function* Foo = parser.GetFunctions()[1];
+
+    VMIR::Interpreter interpreter{&IrContext};
+    EXPECT_EQ(interpreter.Call<int64_t>(Foo, int64_t(5)), 5);
+    EXPECT_EQ(interpreter.Call<int64_t>(Foo, int64_t(-3)), 97);
+
+    VMIR::StaticInliningPass staticInliningPass{};
+    staticInliningPass.Run(Foo);
+    interpreter.Invalidate();
+
+    for (auto* bb : Foo->GetBasicBlocks()) {
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            EXPECT_NE(inst->GetType(), VMIR::InstructionType::Call);
+            EXPECT_TRUE(inst->IsValid());
+        }
+    }
+    EXPECT_EQ(interpreter.Call<int64_t>(Foo, int64_t(5)), 5);
+    EXPECT_EQ(interpreter.Call<int64_t>(Foo, int64_t(-3)), 97);
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
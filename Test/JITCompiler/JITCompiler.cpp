@@ -0,0 +1,378 @@
+#include <gtest/gtest.h>
+
+#include <IRBuilder.h>
+#include <IRParser.h>
+#include <Interpreter.h>
+#include <JITCompiler.h>
+
+
+static const char* kProgram = R"(
+function i32 #Sum(ptr v0, i64 v1) {
+Entry:
+    Jump #Header
+
+Header: (preds: Entry, Body)
+    v2 = Phi i64 0, v7
+    v3 = Phi i32 0, v6
+    Bge i64 v2, v1 ? #Exit : #Body
+
+Body: (preds: Header)
+    v4 = Shl i64 v2, 2
+    v5 = Add ptr v0, v4
+    NullCheck ptr v5
+    v8 = Load i32, ptr v5
+    v6 = Add i32 v3, v8
+    v7 = Add i64 v2, 1
+    Jump #Header
+
+Exit: (preds: Header)
+    Ret i32 v3
+}
+
+function i32 #Fill(i64 v0) {
+Entry:
+    v1 = Alloc i32, 4
+    v2 = Mul i64 v0, 4
+    v3 = Add ptr v1, v2
+    BoundsCheck ptr v3, [ptr v1, 4]
+    Store i32 7, ptr v3
+    Store i32 -5, ptr v1
+    v4 = Call i32 #Sum(ptr v1, i64 4)
+    Ret i32 v4
+}
+
+function i8 #Narrow(i8 v0, i8 v1) {
+Entry:
+    v2 = Mul i8 v0, v1
+    v3 = Ashr i8 v2, 1
+    v4 = Shr i8 v2, 1
+    v5 = Xor i8 v3, v4
+    Ret i8 v5
+}
+
+function f64 #Mean(f64 v0, f64 v1) {
+Entry:
+    v2 = Add f64 v0, v1
+    v3 = Div f64 v2, 2.0
+    Blt f64 v3, 0.0 ? #Negative : #Done
+
+Negative: (preds: Entry)
+    v4 = Sub f64 0.0, v3
+    Ret f64 v4
+
+Done: (preds: Entry)
+    Ret f64 v3
+}
+
+function f32 #Wrap(f32 v0, f32 v1) {
+Entry:
+    v2 = Rem f32 v0, v1
+    v3 = Mul f32 v2, 2.0
+    Ret f32 v3
+}
+
+function i32 #Div(i32 v0, i32 v1) {
+Entry:
+    v2 = Div i32 v0, v1
+    v3 = Rem i32 v0, v1
+    v4 = Mul i32 v2, 100
+    v5 = Add i32 v4, v3
+    Ret i32 v5
+}
+
+function ui16 #DivU(ui16 v0, ui16 v1) {
+Entry:
+    v2 = Div ui16 v0, v1
+    v3 = Sub ui16 v2, 1
+    Ret ui16 v3
+}
+
+function i32 #Deref(ptr v0) {
+Entry:
+    NullCheck ptr v0
+    v1 = Load i32, ptr v0
+    Ret i32 v1
+}
+
+function i64 #Select(i64 v0) {
+Entry:
+    v1 = Mul i64 v0, 3
+    Bgt i64 v0, 0 ? #Positive : #Join
+
+Positive: (preds: Entry)
+    v2 = Add i64 v0, 100
+    v3 = Mul i64 v2, v2
+    Jump #Join
+
+Join: (preds: Entry, Positive)
+    v4 = Phi i64 v1, v1
+    v5 = Phi i64 0, v3
+    v6 = Add i64 v4, v5
+    Ret i64 v6
+}
+
+function i64 #Unordered(i64 v0) {
+Entry:
+    v1 = Mul i64 v0, 3
+    Bgt i64 v0, 0 ? #Positive : #Join
+
+Positive: (preds: Entry)
+    v2 = Add i64 v1, 100
+    Jump #Join
+
+Join: (preds: Positive, Entry)
+    v3 = Phi i64 v2, v1
+    Ret i64 v3
+}
+
+function ui32 #Swap(ui32 v0) {
+Entry:
+    Jump #Loop
+
+Loop: (preds: Entry, Loop)
+    v1 = Phi ui32 1, v2
+    v2 = Phi ui32 2, v1
+    v3 = Phi ui32 0, v4
+    v4 = Add ui32 v3, 1
+    Blt ui32 v4, v0 ? #Loop : #Exit
+
+Exit: (preds: Loop)
+    v5 = Mul ui32 v1, 10
+    v6 = Add ui32 v5, v2
+    Ret ui32 v6
+}
+
+function i32 #Sel(i32 v0) {
+Entry:
+    v1 = Add i32 v0, 1
+    v2 = Add i32 v0, 2
+    Bgt i32 v0, 0 ? #A : #B
+
+A: (preds: Entry)
+    Jump #J
+
+B: (preds: Entry)
+    Jump #J
+
+J: (preds: A, B)
+    v3 = Phi i32 v1, v2
+    Ret i32 v3
+}
+)";
+
+static VMIR::Function* FindFunction(VMIR::IRParser& parser, const std::string& name) {
+    for (auto* func : parser.GetFunctions()) {
+        if (func->GetName() == name) {
+            return func;
+        }
+    }
+    return nullptr;
+}
+
+
+TEST(jit_compiler, runs_sample_files) {
+    VMIR::IRContext loopContext{};
+    VMIR::IRParser loopParser{&loopContext};
+    ASSERT_TRUE(loopParser.ParseFile("SampleIR/FactLoop/FactLoop.vmir")) << loopParser.GetError();
+
+    VMIR::JITCompiler loopCompiler{&loopContext};
+    VMIR::Function* FactLoop = loopParser.GetFunctions()[0];
+    ASSERT_TRUE(loopCompiler.Compile(FactLoop)) << loopCompiler.GetError();
+
+    // Compiled functions are plain functions
+    auto fact = reinterpret_cast<uint64_t (*)(uint64_t)>(loopCompiler.GetEntry(FactLoop));
+    EXPECT_EQ(fact(20), 2432902008176640000);
+    EXPECT_EQ(fact(10), 3628800);
+    EXPECT_EQ(fact(0), 1);
+
+    VMIR::IRContext recursiveContext{};
+    VMIR::IRParser recursiveParser{&recursiveContext};
+    ASSERT_TRUE(recursiveParser.ParseFile("SampleIR/FactRecursive/FactRecursive.vmir")) << recursiveParser.GetError();
+
+    VMIR::JITCompiler recursiveCompiler{&recursiveContext};
+    VMIR::Function* FactRecursive = recursiveParser.GetFunctions()[0];
+    EXPECT_EQ(recursiveCompiler.Call<int32_t>(FactRecursive, int32_t(10)), 3628800);
+    EXPECT_EQ(recursiveCompiler.Call<int32_t>(FactRecursive, int32_t(1)), 1);
+}
+
+
+TEST(jit_compiler, matches_interpreter) {
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    ASSERT_TRUE(parser.Parse(kProgram)) << parser.GetError();
+
+    VMIR::JITCompiler compiler{&IrContext};
+    VMIR::Interpreter interpreter{&IrContext};
+    auto expectSame = [&]<typename R, typename... Args>(const std::string& name, R, Args... args) {
+        VMIR::Function* func = FindFunction(parser, name);
+        std::optional<R> compiled = compiler.Call<R>(func, args...);
+        ASSERT_TRUE(compiled.has_value()) << compiler.GetError();
+        EXPECT_EQ(compiled, interpreter.Call<R>(func, args...)) << name;
+    };
+
+    for (int64_t i = 0; i < 4; ++i) {
+        expectSame("Fill", int32_t{}, i);
+    }
+    for (int8_t a : {int8_t(16), int8_t(-3), int8_t(127)}) {
+        expectSame("Narrow", int8_t{}, a, int8_t(10));
+    }
+    expectSame("Mean", double{}, 1.0, 4.0);
+    expectSame("Mean", double{}, -1.0, -4.0);
+    expectSame("Wrap", float{}, 7.5f, 2.0f);
+    expectSame("Div", int32_t{}, int32_t(-7), int32_t(2));
+    expectSame("Div", int32_t{}, int32_t(INT32_MIN), int32_t(-1));
+    expectSame("DivU", uint16_t{}, uint16_t(60000), uint16_t(3));
+    expectSame("DivU", uint16_t{}, uint16_t(1), uint16_t(3));
+    // Phi input from the entry block stays live through the other predecessor
+    expectSame("Select", int64_t{}, int64_t(5));
+    expectSame("Select", int64_t{}, int64_t(-1));
+    // Phi inputs follow the listed predecessors, not the order of the branches
+    EXPECT_EQ(compiler.Call<int64_t>(FindFunction(parser, "Unordered"), int64_t(2)), 106);
+    EXPECT_EQ(compiler.Call<int64_t>(FindFunction(parser, "Unordered"), int64_t(-2)), -6);
+    expectSame("Unordered", int64_t{}, int64_t(7));
+    // Both inputs are available on both edges, each edge takes the input at its position
+    EXPECT_EQ(compiler.Call<int32_t>(FindFunction(parser, "Sel"), int32_t(5)), 6);
+    EXPECT_EQ(compiler.Call<int32_t>(FindFunction(parser, "Sel"), int32_t(-1)), 1);
+    expectSame("Sel", int32_t{}, int32_t(5));
+    for (uint32_t n = 1; n < 6; ++n) {
+        expectSame("Swap", uint32_t{}, n);
+    }
+
+    int32_t cell = 42;
+    EXPECT_EQ(compiler.Call<int32_t>(FindFunction(parser, "Deref"), &cell), 42);
+}
+
+
+TEST(jit_compiler, reports_errors) {
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    ASSERT_TRUE(parser.Parse(kProgram + std::string("function i32 #Declared(i32 v0) {\n}\n")
+                             + "function i32 #Caller(i32 v0) {\nA:\n    v1 = Call i32 #Declared(i32 v0)\n    Ret i32 v1\n}\n"))
+        << parser.GetError();
+
+    VMIR::JITCompiler compiler{&IrContext};
+    EXPECT_EQ(compiler.Call<int32_t>(FindFunction(parser, "Fill"), int64_t(4)), std::nullopt);
+    EXPECT_EQ(compiler.GetError(), "bounds check failed in #Fill");
+    EXPECT_EQ(compiler.Call<int32_t>(FindFunction(parser, "Deref"), static_cast<int32_t*>(nullptr)), std::nullopt);
+    EXPECT_EQ(compiler.GetError(), "null check failed in #Deref");
+    EXPECT_EQ(compiler.Call<int32_t>(FindFunction(parser, "Div"), int32_t(1), int32_t(0)), std::nullopt);
+    EXPECT_EQ(compiler.GetError(), "division by zero in #Div");
+
+    // Traps do not break the next calls
+    EXPECT_EQ(compiler.Call<int32_t>(FindFunction(parser, "Fill"), int64_t(3)), 2);
+
+    EXPECT_FALSE(compiler.Compile(FindFunction(parser, "Caller")));
+    EXPECT_EQ(compiler.GetError(), "#Declared has no body");
+}
+
+
+TEST(jit_compiler, spills_under_register_pressure) {
+    // Forty values live at once do not fit into the registers
+    constexpr int kValueCount = 40;
+    std::string text = "function i64 #Pressure(i64 v0) {\nEntry:\n";
+    for (int i = 1; i <= kValueCount; ++i) {
+        text += "    v" + std::to_string(i) + " = Mul i64 v0, " + std::to_string(i) + "\n";
+    }
+    text += "    v" + std::to_string(kValueCount + 1) + " = Add i64 v1, v2\n";
+    for (int i = 3; i <= kValueCount; ++i) {
+        text += "    v" + std::to_string(kValueCount + i - 1) + " = Add i64 v" + std::to_string(kValueCount + i - 2) + ", v" + std::to_string(i) + "\n";
+    }
+    text += "    Ret i64 v" + std::to_string(2 * kValueCount - 1) + "\n}\n";
+
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    ASSERT_TRUE(parser.Parse(text)) << parser.GetError();
+
+    VMIR::JITCompiler compiler{&IrContext};
+    EXPECT_EQ(compiler.Call<int64_t>(parser.GetFunctions()[0], int64_t(3)), 3 * kValueCount * (kValueCount + 1) / 2);
+    EXPECT_EQ(compiler.Call<int64_t>(parser.GetFunctions()[0], int64_t(-1)), -kValueCount * (kValueCount + 1) / 2);
+}
+
+
+// Values carried through a loop, each one is updated from its neighbour on every iteration
+static std::string CarriedLoopProgram(int valueCount) {
+    std::string text = "function i64 #Carried(i64 v0) {\nEntry:\n";
+    for (int i = 1; i <= valueCount; ++i) {
+        text += "    v" + std::to_string(i) + " = Mul i64 v0, " + std::to_string(i) + "\n";
+    }
+    text += "    Jump #Header\n\nHeader: (preds: Entry, Body)\n";
+    for (int i = 1; i <= valueCount; ++i) {
+        text += "    v" + std::to_string(100 + i) + " = Phi i64 v" + std::to_string(i) + ", v" + std::to_string(200 + i) + "\n";
+    }
+    text += "    v300 = Phi i64 0, v301\n    Bge i64 v300, 3 ? #Exit : #Body\n\nBody: (preds: Header)\n";
+    for (int i = 1; i <= valueCount; ++i) {
+        const int next = i % valueCount + 1;
+        text += "    v" + std::to_string(200 + i) + " = Add i64 v" + std::to_string(100 + i) + ", v" + std::to_string(100 + next) + "\n";
+    }
+    text += "    v301 = Add i64 v300, 1\n    Jump #Header\n\nExit: (preds: Header)\n    v400 = Add i64 v101, v300\n";
+    for (int i = 2; i <= valueCount; ++i) {
+        text += "    v" + std::to_string(399 + i) + " = Add i64 v" + std::to_string(398 + i) + ", v" + std::to_string(100 + i) + "\n";
+    }
+    text += "    v500 = Add i64 v" + std::to_string(399 + valueCount) + ", v1\n    Ret i64 v500\n}\n";
+    return text;
+}
+
+
+TEST(jit_compiler, splits_values_live_across_loops) {
+    // Values live through the loop go to the stack and come back before their uses, also on the edges
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    ASSERT_TRUE(parser.Parse(CarriedLoopProgram(24))) << parser.GetError();
+
+    VMIR::JITCompiler compiler{&IrContext};
+    VMIR::Interpreter interpreter{&IrContext};
+    VMIR::Function* func = parser.GetFunctions()[0];
+    for (int64_t arg : {int64_t(1), int64_t(-7), int64_t(1000)}) {
+        std::optional<int64_t> compiled = compiler.Call<int64_t>(func, arg);
+        ASSERT_TRUE(compiled.has_value()) << compiler.GetError();
+        EXPECT_EQ(compiled, interpreter.Call<int64_t>(func, arg));
+    }
+}
+
+
+TEST(jit_compiler, colors_registers_per_function) {
+    VMIR::IRContext IrContext{};
+    VMIR::IRParser parser{&IrContext};
+    ASSERT_TRUE(parser.Parse(std::string(kProgram) + CarriedLoopProgram(24))) << parser.GetError();
+
+    // Callers and callees may use different allocators
+    for (VMIR::Function* func : parser.GetFunctions()) {
+        if (func->GetName() != "Fill") {
+            func->SetRegisterAllocationMode(VMIR::RegisterAllocationMode::GraphColoring);
+        }
+    }
+
+    VMIR::JITCompiler compiler{&IrContext};
+    VMIR::Interpreter interpreter{&IrContext};
+    auto expectSame = [&]<typename R, typename... Args>(const std::string& name, R, Args... args) {
+        VMIR::Function* func = FindFunction(parser, name);
+        std::optional<R> compiled = compiler.Call<R>(func, args...);
+        ASSERT_TRUE(compiled.has_value()) << compiler.GetError();
+        EXPECT_EQ(compiled, interpreter.Call<R>(func, args...)) << name;
+    };
+
+    for (int64_t i = 0; i < 4; ++i) {
+        expectSame("Fill", int32_t{}, i);
+    }
+    expectSame("Narrow", int8_t{}, int8_t(-3), int8_t(10));
+    expectSame("Mean", double{}, 1.0, 4.0);
+    expectSame("Wrap", float{}, 7.5f, 2.0f);
+    expectSame("Div", int32_t{}, int32_t(-7), int32_t(2));
+    expectSame("Select", int64_t{}, int64_t(5));
+    expectSame("Select", int64_t{}, int64_t(-1));
+    expectSame("Unordered", int64_t{}, int64_t(7));
+    expectSame("Sel", int32_t{}, int32_t(5));
+    expectSame("Sel", int32_t{}, int32_t(-1));
+    for (uint32_t n = 1; n < 6; ++n) {
+        expectSame("Swap", uint32_t{}, n);
+    }
+    for (int64_t arg : {int64_t(1), int64_t(-7), int64_t(1000)}) {
+        expectSame("Carried", int64_t{}, arg);
+    }
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
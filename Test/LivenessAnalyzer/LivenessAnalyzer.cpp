@@ -66,6 +66,30 @@ static void TestLinearOrderInvariants(VMIR::LivenessAnalyzer* livenessAnalyzer)
 
 
 
+static void TestLiveRangeInvariants(VMIR::LivenessAnalyzer* livenessAnalyzer) {
+    // Ranges are sorted and separated by holes, they stay inside of the interval and cover every use but the definition
+    for (size_t idx = 0; idx < livenessAnalyzer->GetValueCount(); ++idx) {
+        VMIR::Value* value = livenessAnalyzer->GetValueByIndex(idx);
+        if (value == nullptr) {
+            continue;
+        }
+
+        const auto& liveRanges = value->GetLiveRanges();
+        const auto& ranges = liveRanges.GetRanges();
+        for (size_t i = 1; i < ranges.size(); ++i) {
+            EXPECT_LT(ranges[i - 1].end, ranges[i].start);
+        }
+        if (!ranges.empty()) {
+            EXPECT_LE(value->GetLiveInterval().start, ranges.front().start);
+            EXPECT_GE(value->GetLiveInterval().end, ranges.back().end);
+        }
+        for (uint64_t use : liveRanges.GetUsePositions()) {
+            EXPECT_TRUE(liveRanges.Covers(use) || liveRanges.Covers(use - 1));
+        }
+    }
+}
+
+
 TEST(liveness_analyzer, linear_order__1) {
     VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
 
@@ -651,6 +675,7 @@ TEST(liveness_analyzer, liveness__fact_recursive) {
     livenessAnalyzer->PerformLivenessAnalysis();
 
     TestLinearOrderInvariants(livenessAnalyzer);
+    TestLiveRangeInvariants(livenessAnalyzer);
 
 
     EXPECT_EQ(instTermBB_1->GetLinearNumber(),  0);
@@ -787,6 +812,7 @@ TEST(liveness_analyzer, liveness__fact_loop) {
     livenessAnalyzer->PerformLivenessAnalysis();
 
     TestLinearOrderInvariants(livenessAnalyzer);
+    TestLiveRangeInvariants(livenessAnalyzer);
 
 
     EXPECT_EQ(instV1->GetLinearNumber(),                    0);
@@ -956,6 +982,7 @@ TEST(liveness_analyzer, liveness__from_lecture_1) {
     livenessAnalyzer->PerformLivenessAnalysis();
 
     TestLinearOrderInvariants(livenessAnalyzer);
+    TestLiveRangeInvariants(livenessAnalyzer);
 
 
     EXPECT_EQ(instV2->GetLinearNumber(),        0);
@@ -1138,6 +1165,7 @@ TEST(liveness_analyzer, liveness__from_lecture_2) {
     livenessAnalyzer->PerformLivenessAnalysis();
 
     TestLinearOrderInvariants(livenessAnalyzer);
+    TestLiveRangeInvariants(livenessAnalyzer);
 
 
     EXPECT_EQ(instV0->GetLinearNumber(),        0);
@@ -1224,6 +1252,196 @@ TEST(liveness_analyzer, liveness__from_lecture_2) {
 }
 
 
+TEST(liveness_analyzer, liveness__live_in_out) {
+    /*
+        Entry:
+            v1 = Add v0, 1
+            Jump #Header
+
+        Header: (preds: Entry, Body)
+            v2 = Phi v1, v4
+            Bgt v2, v0 ? #Exit : #Body
+
+        Body: (preds: Header)
+            v3 = Mul v2, v1
+            v4 = Add v3, 1
+            Jump #Header
+
+        Exit: (preds: Header)
+            Ret v2
+    */
+
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Function* Func = IrBuilder->CreateFunction(VMIR::ValueType::Int64, {VMIR::ValueType::Int64}, "livenessSets");
+
+    VMIR::BasicBlock* EntryBB   = IrBuilder->CreateBasicBlock(Func, "Entry");
+    VMIR::BasicBlock* HeaderBB  = IrBuilder->CreateBasicBlock(Func, "Header");
+    VMIR::BasicBlock* BodyBB    = IrBuilder->CreateBasicBlock(Func, "Body");
+    VMIR::BasicBlock* ExitBB    = IrBuilder->CreateBasicBlock(Func, "Exit");
+
+    Func->SetEntryBasicBlock(EntryBB);
+
+    VMIR::Value* one = IrBuilder->CreateValue(1L);
+
+    VMIR::Value* v0 = Func->GetArg(0);
+    VMIR::Value* v1 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v2 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v3 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v4 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+
+    IrBuilder->CreateAdd(EntryBB, v0, one, v1);
+    IrBuilder->CreateJump(EntryBB, HeaderBB);
+
+    IrBuilder->CreatePhi(HeaderBB, {v1, v4}, v2);
+    IrBuilder->CreateBgt(HeaderBB, v2, v0, ExitBB, BodyBB);
+
+    IrBuilder->CreateMul(BodyBB, v2, v1, v3);
+    IrBuilder->CreateAdd(BodyBB, v3, one, v4);
+    IrBuilder->CreateJump(BodyBB, HeaderBB);
+
+    IrBuilder->CreateRet(ExitBB, v2);
+
+    VMIR::ControlFlowGraph* cfg = IrBuilder->CreateControlFlowGraph(Func);
+    VMIR::LivenessAnalyzer* livenessAnalyzer = IrBuilder->CreateLivenessAnalyzer(cfg);
+    ASSERT_TRUE(livenessAnalyzer->PerformLivenessAnalysis());
+    TestLiveRangeInvariants(livenessAnalyzer);
+
+    auto values = [livenessAnalyzer](const VMIR::BitVector& set) {
+        std::vector<VMIR::Value*> result{};
+        set.ForEach([&](size_t idx) { result.push_back(livenessAnalyzer->GetValueByIndex(idx)); });
+        return result;
+    };
+
+    using ::testing::UnorderedElementsAre;
+    EXPECT_THAT(values(livenessAnalyzer->GetLiveIn(EntryBB)),   UnorderedElementsAre(v0));
+    EXPECT_THAT(values(livenessAnalyzer->GetLiveOut(EntryBB)),  UnorderedElementsAre(v0, v1));
+    EXPECT_THAT(values(livenessAnalyzer->GetLiveIn(HeaderBB)),  UnorderedElementsAre(v0, v1));
+    EXPECT_THAT(values(livenessAnalyzer->GetLiveOut(HeaderBB)), UnorderedElementsAre(v0, v1, v2));
+    EXPECT_THAT(values(livenessAnalyzer->GetLiveIn(BodyBB)),    UnorderedElementsAre(v0, v1, v2));
+    EXPECT_THAT(values(livenessAnalyzer->GetLiveOut(BodyBB)),   UnorderedElementsAre(v0, v1, v4));
+    EXPECT_THAT(values(livenessAnalyzer->GetLiveIn(ExitBB)),    UnorderedElementsAre(v2));
+    EXPECT_TRUE(livenessAnalyzer->GetLiveOut(ExitBB).None());
+
+    EXPECT_TRUE(livenessAnalyzer->IsLiveOut(BodyBB, v4));
+    EXPECT_FALSE(livenessAnalyzer->IsLiveIn(BodyBB, v4));
+    EXPECT_FALSE(livenessAnalyzer->IsLiveIn(EntryBB, one));
+
+    // Analysis can be performed again with the same results
+    ASSERT_TRUE(livenessAnalyzer->PerformLivenessAnalysis());
+    EXPECT_EQ(livenessAnalyzer->GetBasicBlocksLinearOrder().size(), 4);
+    EXPECT_THAT(values(livenessAnalyzer->GetLiveOut(BodyBB)),   UnorderedElementsAre(v0, v1, v4));
+
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(liveness_analyzer, liveness__lifetime_holes) {
+    /*
+        Entry:
+            v1 = Mul v0, 3
+            Bgt v0, 0 ? #Then : #Else
+
+        Else: (preds: Entry)
+            v2 = Add v0, 1
+            Jump #Join
+
+        Then: (preds: Entry)
+            v3 = Add v1, 2
+            Jump #Join
+
+        Join: (preds: Else, Then)
+            v4 = Phi v2, v3
+            Ret v4
+
+                live: 0
+        v1      live: 2
+        Bgt     live: 4
+                live: 6
+        v2      live: 8
+        Jump    live: 10
+                live: 12
+        v3      live: 14
+        Jump    live: 16
+        v4      live: 18
+        Ret     live: 20
+                live: 22
+    */
+
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Function* Func = IrBuilder->CreateFunction(VMIR::ValueType::Int64, {VMIR::ValueType::Int64}, "livenessHoles");
+
+    VMIR::BasicBlock* EntryBB   = IrBuilder->CreateBasicBlock(Func, "Entry");
+    VMIR::BasicBlock* ElseBB    = IrBuilder->CreateBasicBlock(Func, "Else");
+    VMIR::BasicBlock* ThenBB    = IrBuilder->CreateBasicBlock(Func, "Then");
+    VMIR::BasicBlock* JoinBB    = IrBuilder->CreateBasicBlock(Func, "Join");
+
+    Func->SetEntryBasicBlock(EntryBB);
+
+    VMIR::Value* zero  = IrBuilder->CreateValue(0L);
+    VMIR::Value* one   = IrBuilder->CreateValue(1L);
+    VMIR::Value* two   = IrBuilder->CreateValue(2L);
+    VMIR::Value* three = IrBuilder->CreateValue(3L);
+
+    VMIR::Value* v0 = Func->GetArg(0);
+    VMIR::Value* v1 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v2 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v3 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+    VMIR::Value* v4 = IrBuilder->CreateValue(VMIR::ValueType::Int64);
+
+    IrBuilder->CreateMul(EntryBB, v0, three, v1);
+    IrBuilder->CreateBgt(EntryBB, v0, zero, ThenBB, ElseBB);
+
+    IrBuilder->CreateAdd(ElseBB, v0, one, v2);
+    IrBuilder->CreateJump(ElseBB, JoinBB);
+
+    IrBuilder->CreateAdd(ThenBB, v1, two, v3);
+    IrBuilder->CreateJump(ThenBB, JoinBB);
+
+    IrBuilder->CreatePhi(JoinBB, {v2, v3}, v4);
+    IrBuilder->CreateRet(JoinBB, v4);
+
+    VMIR::ControlFlowGraph* cfg = IrBuilder->CreateControlFlowGraph(Func);
+    VMIR::LivenessAnalyzer* livenessAnalyzer = IrBuilder->CreateLivenessAnalyzer(cfg);
+    ASSERT_TRUE(livenessAnalyzer->PerformLivenessAnalysis());
+    TestLiveRangeInvariants(livenessAnalyzer);
+
+    ASSERT_THAT(livenessAnalyzer->GetBasicBlocksLinearOrder(), ::testing::ElementsAre(EntryBB, ElseBB, ThenBB, JoinBB));
+
+    using Ranges = std::vector<VMIR::LiveRange>;
+    using Uses = std::vector<uint64_t>;
+
+    // v1 is not live in Else, but its interval covers it
+    EXPECT_EQ(v1->GetLiveInterval(), VMIR::LiveInterval(2, 14));
+    EXPECT_EQ(v1->GetLiveRanges().GetRanges(), (Ranges{{2, 6}, {12, 14}}));
+    EXPECT_EQ(v1->GetLiveRanges().GetUsePositions(), (Uses{2, 14}));
+    EXPECT_FALSE(v1->GetLiveRanges().Covers(8));
+    EXPECT_TRUE(v1->GetLiveRanges().Covers(12));
+    EXPECT_EQ(v1->GetLiveRanges().GetHull(), VMIR::LiveRange(2, 14));
+
+    EXPECT_EQ(v0->GetLiveRanges().GetRanges(), (Ranges{{0, 8}}));
+    EXPECT_EQ(v0->GetLiveRanges().GetUsePositions(), (Uses{2, 4, 8}));
+
+    // Input of the edge is live up to the end of the predecessor
+    EXPECT_EQ(v2->GetLiveRanges().GetRanges(), (Ranges{{8, 12}}));
+    EXPECT_EQ(v3->GetLiveRanges().GetRanges(), (Ranges{{14, 18}}));
+    EXPECT_EQ(v4->GetLiveRanges().GetRanges(), (Ranges{{18, 20}}));
+    EXPECT_EQ(v4->GetLiveRanges().GetUsePositions(), (Uses{18, 20}));
+
+    EXPECT_EQ(v1->GetLiveRanges().FirstIntersection(v2->GetLiveRanges()), std::nullopt);
+    EXPECT_EQ(v0->GetLiveRanges().FirstIntersection(v1->GetLiveRanges()), 2);
+    // Output may take the register of the input which dies at the instruction
+    EXPECT_EQ(v0->GetLiveRanges().FirstIntersection(v2->GetLiveRanges()), std::nullopt);
+    EXPECT_EQ(v1->GetLiveRanges().NextUseFrom(3), 14);
+    EXPECT_EQ(v1->GetLiveRanges().NextUseFrom(15), std::nullopt);
+
+
+    IrBuilder->Cleanup();
+}
+
+
 
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
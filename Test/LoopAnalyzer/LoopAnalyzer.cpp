@@ -466,6 +466,49 @@ TEST(loop_analyzer, exampleBig) {
 }
 
 
+TEST(loop_analyzer, deep_chain) {
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Function* Func = IrBuilder->CreateFunction("DeepChain");
+
+    // Entry -> Header -> ... long chain ... -> Latch -> Header and Latch -> Exit
+    // Walks over such graph must not depend on the depth of the call stack
+    const size_t chainLength = 1 << 18;
+
+    VMIR::BasicBlock* Entry = IrBuilder->CreateBasicBlock(Func, "Entry");
+    VMIR::BasicBlock* Header = IrBuilder->CreateBasicBlock(Func, "Header");
+    Func->SetEntryBasicBlock(Entry);
+    IrBuilder->CreateJump(Entry, Header);
+
+    VMIR::BasicBlock* Latch = Header;
+    for (size_t i = 0; i < chainLength; ++i) {
+        VMIR::BasicBlock* next = IrBuilder->CreateBasicBlock(Func);
+        IrBuilder->CreateJump(Latch, next);
+        Latch = next;
+    }
+    VMIR::BasicBlock* Exit = IrBuilder->CreateBasicBlock(Func, "Exit");
+    IrBuilder->CreateBeq(Latch, nullptr, nullptr, Header, Exit);
+
+    VMIR::ControlFlowGraph* cfg = IrBuilder->CreateControlFlowGraph(Func);
+    VMIR::LoopAnalyzer* loopAnalyzer = IrBuilder->CreateLoopAnalyzer(cfg);
+    loopAnalyzer->BuildLoopTree();
+
+    auto& loops = loopAnalyzer->GetLoops();
+    EXPECT_EQ(loops.size(), 1);
+    EXPECT_THAT(loops, ::testing::Contains(::testing::Key(Header)));
+
+    auto* loopHeader = loops.at(Header);
+    EXPECT_EQ(loopHeader->GetBasicBlocks().size(), chainLength + 1);
+    EXPECT_THAT(loopHeader->GetLatches(), ::testing::ElementsAre(Latch));
+    EXPECT_TRUE(loopHeader->IsReducible());
+
+    EXPECT_TRUE(Exit->IsDominatedBy(Latch));
+    EXPECT_EQ(Exit->GetLoop(), loopAnalyzer->GetRootLoop());
+
+    IrBuilder->Cleanup();
+}
+
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     ::testing::InitGoogleMock(&argc, argv);
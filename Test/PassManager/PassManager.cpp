@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include <IRBuilder.h>
+#include <PassManager.h>
+#include <StaticInliningPass.h>
+#include <ConstantFoldingPass.h>
+#include <PeepholesPass.h>
+#include <CheckEliminationPass.h>
+
+
+TEST(pass_manager, preserved_analyses) {
+    EXPECT_FALSE(VMIR::PreservedAnalyses::None().IsPreserved(VMIR::AnalysisKind::ControlFlowGraph));
+    EXPECT_TRUE(VMIR::PreservedAnalyses::All().IsPreserved(VMIR::AnalysisKind::Liveness));
+
+    VMIR::PreservedAnalyses preserved{};
+    preserved.Preserve(VMIR::AnalysisKind::ControlFlowGraph).Preserve(VMIR::AnalysisKind::LoopTree);
+    EXPECT_TRUE(preserved.IsPreserved(VMIR::AnalysisKind::ControlFlowGraph));
+    EXPECT_FALSE(preserved.IsPreserved(VMIR::AnalysisKind::DominatorTree));
+
+    // Loop tree is computed from the dominator tree, so it cannot outlive it
+    EXPECT_FALSE(preserved.IsPreserved(VMIR::AnalysisKind::LoopTree));
+}
+
+
+TEST(pass_manager, graph_is_refreshed_after_inlining) {
+    /*
+        function ui64 #Abs(i64 v0) {
+        Abs_BB_1:
+            Blt v0, 0, Abs_BB_2, Abs_BB_3
+        Abs_BB_2:
+            v1 = Sub i64 0, v0
+            Ret v1
+        Abs_BB_3:
+            Ret v0
+        }
+
+        function i64 #Foo(i64 v2) {
+        Foo_BB_1:
+            v3 = Call i64 #Abs(v2)
+            Ret v3
+        }
+    */
+    VMIR::IRContext IrContext{};
+
+    VMIR::Function* Abs = IrContext.CreateFunction(VMIR::ValueType::Int64, {VMIR::ValueType::Int64}, "Abs");
+    VMIR::BasicBlock* Abs_BB_1 = IrContext.CreateBasicBlock(Abs, "Abs_BB_1");
+    VMIR::BasicBlock* Abs_BB_2 = IrContext.CreateBasicBlock(Abs, "Abs_BB_2");
+    VMIR::BasicBlock* Abs_BB_3 = IrContext.CreateBasicBlock(Abs, "Abs_BB_3");
+    Abs->SetEntryBasicBlock(Abs_BB_1);
+
+    VMIR::Value* zero = IrContext.CreateValue(int64_t(0));
+    VMIR::Value* v1 = IrContext.CreateValue(VMIR::ValueType::Int64);
+    IrContext.CreateBlt(Abs_BB_1, Abs->GetArg(0), zero, Abs_BB_2, Abs_BB_3);
+    IrContext.CreateSub(Abs_BB_2, zero, Abs->GetArg(0), v1);
+    IrContext.CreateRet(Abs_BB_2, v1);
+    IrContext.CreateRet(Abs_BB_3, Abs->GetArg(0));
+
+    VMIR::Function* Foo = IrContext.CreateFunction(VMIR::ValueType::Int64, {VMIR::ValueType::Int64}, "Foo");
+    VMIR::BasicBlock* Foo_BB_1 = IrContext.CreateBasicBlock(Foo, "Foo_BB_1");
+    Foo->SetEntryBasicBlock(Foo_BB_1);
+
+    VMIR::Value* v3 = IrContext.CreateValue(VMIR::ValueType::Int64);
+    IrContext.CreateCall(Foo_BB_1, Abs, v3, {Foo->GetArg(0)});
+    IrContext.CreateRet(Foo_BB_1, v3);
+
+    VMIR::ControlFlowGraph* cfg = IrContext.GetOrCreateControlFlowGraph(Foo);
+    cfg->BuildDominatorTree();
+    ASSERT_EQ(cfg->GetBasicBlocks().size(), 1);
+
+    VMIR::PassManager passManager{};
+    passManager.AddPass<VMIR::StaticInliningPass>();
+    passManager.AddPass<VMIR::CheckEliminationPass>();
+    ASSERT_EQ(passManager.GetPasses().size(), 2);
+    passManager.Run(Foo);
+
+    // The same graph object now sees the inlined blocks, check elimination rebuilt the dominator tree over them
+    EXPECT_EQ(IrContext.GetOrCreateControlFlowGraph(Foo), cfg);
+    EXPECT_EQ(cfg->GetBasicBlocks(), Foo->GetBasicBlocks());
+    EXPECT_GT(cfg->GetBasicBlocks().size(), 1);
+    EXPECT_TRUE(cfg->IsDominatorTreeBuilt());
+    for (auto* bb : cfg->GetBasicBlocks()) {
+        EXPECT_TRUE(bb->IsDominatedBy(Foo_BB_1));
+    }
+}
+
+
+TEST(pass_manager, analyses_are_kept_when_preserved) {
+    /*
+        function ui64 #Loop(ui64 v0) {
+        Loop_BB_1:
+            v1 = Add ui64 1, 2
+            Jump Loop_BB_2
+        Loop_BB_2:
+            v2 = Phi ui64 v1, v3
+            v3 = Add ui64 v2, 0
+            Bne v3, v0, Loop_BB_2, Loop_BB_3
+        Loop_BB_3:
+            Ret v3
+        }
+    */
+    VMIR::IRContext IrContext{};
+
+    VMIR::Function* Loop = IrContext.CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "Loop");
+    VMIR::BasicBlock* Loop_BB_1 = IrContext.CreateBasicBlock(Loop, "Loop_BB_1");
+    VMIR::BasicBlock* Loop_BB_2 = IrContext.CreateBasicBlock(Loop, "Loop_BB_2");
+    VMIR::BasicBlock* Loop_BB_3 = IrContext.CreateBasicBlock(Loop, "Loop_BB_3");
+    Loop->SetEntryBasicBlock(Loop_BB_1);
+
+    VMIR::Value* v1 = IrContext.CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v2 = IrContext.CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v3 = IrContext.CreateValue(VMIR::ValueType::Uint64);
+
+    IrContext.CreateAdd(Loop_BB_1, IrContext.CreateValue(uint64_t(1)), IrContext.CreateValue(uint64_t(2)), v1);
+    IrContext.CreateJump(Loop_BB_1, Loop_BB_2);
+    IrContext.CreatePhi(Loop_BB_2, {v1, v3}, v2);
+    IrContext.CreateAdd(Loop_BB_2, v2, IrContext.CreateValue(uint64_t(0)), v3);
+    IrContext.CreateBne(Loop_BB_2, v3, Loop->GetArg(0), Loop_BB_2, Loop_BB_3);
+    IrContext.CreateRet(Loop_BB_3, v3);
+
+    VMIR::ControlFlowGraph* cfg = IrContext.GetOrCreateControlFlowGraph(Loop);
+    VMIR::LivenessAnalyzer* livenessAnalyzer = IrContext.GetOrCreateLivenessAnalyzer(cfg);
+    ASSERT_TRUE(livenessAnalyzer->PerformLivenessAnalysis());
+    VMIR::LoopAnalyzer* loopAnalyzer = livenessAnalyzer->GetLoopAnalyzer();
+    VMIR::Loop* loop = Loop_BB_2->GetLoop();
+    ASSERT_EQ(loop->GetHeader(), Loop_BB_2);
+
+    VMIR::PassManager passManager{};
+    passManager.AddPass<VMIR::ConstantFoldingPass>();
+    passManager.AddPass<VMIR::PeepholesPass>();
+    passManager.Run(Loop);
+
+    // Instructions were replaced, so only liveness has to be recomputed
+    EXPECT_TRUE(cfg->IsDominatorTreeBuilt());
+    EXPECT_TRUE(loopAnalyzer->IsLoopTreeBuilt());
+    EXPECT_EQ(Loop_BB_2->GetLoop(), loop);
+    EXPECT_FALSE(livenessAnalyzer->IsAnalysisDone());
+
+    // Pass which does not declare anything drops all of them
+    IrContext.InvalidateAnalyses(Loop, VMIR::StaticInliningPass{}.GetPreservedAnalyses());
+    EXPECT_FALSE(cfg->IsDominatorTreeBuilt());
+    EXPECT_FALSE(loopAnalyzer->IsLoopTreeBuilt());
+    EXPECT_EQ(Loop_BB_2->GetLoop(), nullptr);
+
+    // Register allocation brings everything back on demand
+    VMIR::RegisterAllocator* registerAllocator = IrContext.CreateRegisterAllocator(cfg, 2, 1);
+    EXPECT_TRUE(registerAllocator->PerformRegisterAllocation());
+    EXPECT_TRUE(cfg->IsDominatorTreeBuilt());
+    EXPECT_TRUE(loopAnalyzer->IsLoopTreeBuilt());
+    EXPECT_TRUE(livenessAnalyzer->IsAnalysisDone());
+    EXPECT_EQ(Loop_BB_2->GetLoop()->GetHeader(), Loop_BB_2);
+
+    // Recomputed liveness does not depend on the previous run
+    const VMIR::LiveInterval v2Interval = v2->GetLiveInterval();
+    const VMIR::LiveInterval v3Interval = v3->GetLiveInterval();
+    v2->GetLiveInterval() = VMIR::LiveInterval{0, 1000};
+    v3->GetLiveInterval() = VMIR::LiveInterval{0, 1000};
+    IrContext.InvalidateAnalyses(Loop, VMIR::CheckEliminationPass{}.GetPreservedAnalyses());
+    ASSERT_TRUE(livenessAnalyzer->PerformLivenessAnalysis());
+    EXPECT_EQ(v2->GetLiveInterval().start, v2Interval.start);
+    EXPECT_EQ(v2->GetLiveInterval().end, v2Interval.end);
+    EXPECT_EQ(v3->GetLiveInterval().start, v3Interval.start);
+    EXPECT_EQ(v3->GetLiveInterval().end, v3Interval.end);
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <sstream>
+#include <unordered_map>
+
+#include <IRBuilder.h>
+#include <PassPipeline.h>
+#include <ThreadPool.h>
+
+
+// Function number i calls a small inlinable callee and function number i - 1, which is too big to be inlined
+static void BuildModule(VMIR::IRContext* IrContext, size_t functionCount) {
+    VMIR::Function* prevCompute = nullptr;
+    for (size_t i = 0; i < functionCount; ++i) {
+        const std::string suffix = std::to_string(i);
+
+        VMIR::Function* Scale = IrContext->CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "Scale_" + suffix);
+        VMIR::BasicBlock* Scale_BB_1 = IrContext->CreateBasicBlock(Scale, "Scale_BB_1");
+        Scale->SetEntryBasicBlock(Scale_BB_1);
+
+        VMIR::Value* scaled = IrContext->CreateValue(VMIR::ValueType::Uint64);
+        IrContext->CreateMul(Scale_BB_1, Scale->GetArg(0), IrContext->CreateValue(uint64_t(i + 2)), scaled);
+        IrContext->CreateRet(Scale_BB_1, scaled);
+
+        VMIR::Function* Compute = IrContext->CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "Compute_" + suffix);
+        VMIR::BasicBlock* Compute_BB_1 = IrContext->CreateBasicBlock(Compute, "Compute_BB_1");
+        VMIR::BasicBlock* Compute_BB_2 = IrContext->CreateBasicBlock(Compute, "Compute_BB_2");
+        VMIR::BasicBlock* Compute_BB_3 = IrContext->CreateBasicBlock(Compute, "Compute_BB_3");
+        Compute->SetEntryBasicBlock(Compute_BB_1);
+
+        VMIR::Value* ptr = IrContext->CreateValue(VMIR::ValueType::Pointer);
+        VMIR::Value* init = IrContext->CreateValue(VMIR::ValueType::Uint64);
+        VMIR::Value* counter = IrContext->CreateValue(VMIR::ValueType::Uint64);
+        VMIR::Value* called = IrContext->CreateValue(VMIR::ValueType::Uint64);
+        VMIR::Value* next = IrContext->CreateValue(VMIR::ValueType::Uint64);
+        VMIR::Value* result = IrContext->CreateValue(VMIR::ValueType::Uint64);
+
+        IrContext->CreateAlloc(Compute_BB_1, ptr, VMIR::ValueType::Uint64);
+        IrContext->CreateNullCheck(Compute_BB_1, ptr);
+        IrContext->CreateAdd(Compute_BB_1, IrContext->CreateValue(uint64_t(i)), IrContext->CreateValue(uint64_t(3)), init);
+        IrContext->CreateJump(Compute_BB_1, Compute_BB_2);
+
+        IrContext->CreatePhi(Compute_BB_2, {init, next}, counter);
+        IrContext->CreateNullCheck(Compute_BB_2, ptr);
+        IrContext->CreateStore(Compute_BB_2, ptr, counter);
+        IrContext->CreateCall(Compute_BB_2, Scale, called, {counter});
+        IrContext->CreateAdd(Compute_BB_2, called, IrContext->CreateValue(uint64_t(1)), next);
+        IrContext->CreateBeq(Compute_BB_2, next, Compute->GetArg(0), Compute_BB_3, Compute_BB_2);
+
+        if (prevCompute != nullptr) {
+            IrContext->CreateCall(Compute_BB_3, prevCompute, result, {next});
+        }
+        else {
+            IrContext->CreateMv(Compute_BB_3, next, result);
+        }
+        IrContext->CreateRet(Compute_BB_3, result);
+
+        prevCompute = Compute;
+    }
+}
+
+static uint32_t LocationId(const VMIR::Location& loc) {
+    if (const auto* gp = std::get_if<VMIR::GPRegisterLocation>(&loc)) {
+        return gp->registerId;
+    }
+    if (const auto* fp = std::get_if<VMIR::FPRegisterLocation>(&loc)) {
+        return fp->registerId;
+    }
+    return std::get<VMIR::StackLocation>(loc).stackLocationId;
+}
+
+// Values are named in the order of their appearance, so functions from different contexts can be compared
+static std::string DescribeModule(VMIR::IRContext* IrContext) {
+    std::ostringstream out{};
+    for (auto* func : IrContext->GetFunctions()) {
+        std::unordered_map<VMIR::Value*, size_t> names{};
+        auto nameOf = [&names](VMIR::Value* value) {
+            if (value->HasValue()) {
+                return value->GetValueStr();
+            }
+            auto it = names.try_emplace(value, names.size()).first;
+            return "v" + std::to_string(it->second);
+        };
+
+        out << func->GetName() << "\n";
+        for (auto* bb : func->GetBasicBlocks()) {
+            out << "  " << bb->GetName() << "\n";
+            for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+                out << "    " << static_cast<int>(inst->GetType());
+                for (VMIR::Value* input : inst->operands()) {
+                    out << " " << nameOf(input);
+                }
+                if (VMIR::Value* output = inst->GetOutput(); output != nullptr) {
+                    out << " -> " << nameOf(output) << " [" << output->GetLiveInterval().start << ", " << output->GetLiveInterval().end
+                        << ") @" << output->GetLocation().index() << ":" << LocationId(output->GetLocation());
+                }
+                out << "\n";
+            }
+        }
+    }
+    return out.str();
+}
+
+
+TEST(thread_pool, runs_every_task) {
+    VMIR::ThreadPool pool{4};
+    EXPECT_EQ(pool.GetThreadCount(), 4);
+
+    // Tasks spawn more tasks, so queues of the workers get unbalanced
+    std::atomic<size_t> counter{0};
+    for (size_t i = 0; i < 64; ++i) {
+        pool.Submit([&pool, &counter]() {
+            for (size_t j = 0; j < 16; ++j) {
+                pool.Submit([&counter]() { counter.fetch_add(1); });
+            }
+            counter.fetch_add(1);
+        });
+    }
+    pool.Wait();
+    EXPECT_EQ(counter.load(), 64 * 17);
+
+    // Pool can be reused after waiting
+    pool.Submit([&counter]() { counter.fetch_add(1); });
+    pool.Wait();
+    EXPECT_EQ(counter.load(), 64 * 17 + 1);
+}
+
+
+TEST(pass_pipeline, call_graph_post_order) {
+    VMIR::IRContext IrContext{};
+
+    VMIR::Function* Main = IrContext.CreateFunction("Main");
+    VMIR::Function* Foo = IrContext.CreateFunction("Foo");
+    VMIR::Function* Bar = IrContext.CreateFunction("Bar");
+
+    VMIR::BasicBlock* Main_BB_1 = IrContext.CreateBasicBlock(Main);
+    VMIR::BasicBlock* Foo_BB_1 = IrContext.CreateBasicBlock(Foo);
+    VMIR::BasicBlock* Bar_BB_1 = IrContext.CreateBasicBlock(Bar);
+    Main->SetEntryBasicBlock(Main_BB_1);
+    Foo->SetEntryBasicBlock(Foo_BB_1);
+    Bar->SetEntryBasicBlock(Bar_BB_1);
+
+    // Main -> Foo -> Bar -> Foo
+    IrContext.CreateCall(Main_BB_1, Foo);
+    IrContext.CreateRet(Main_BB_1);
+    IrContext.CreateCall(Foo_BB_1, Bar);
+    IrContext.CreateRet(Foo_BB_1);
+    IrContext.CreateCall(Bar_BB_1, Foo);
+    IrContext.CreateRet(Bar_BB_1);
+
+    VMIR::PassPipeline pipeline{&IrContext, 2, 1};
+    EXPECT_EQ(pipeline.GetCallGraphPostOrder(), std::vector<VMIR::Function*>({Bar, Foo, Main}));
+}
+
+
+TEST(pass_pipeline, parallel_matches_sequential) {
+    constexpr size_t functionCount = 64;
+
+    VMIR::IRContext sequentialContext{};
+    BuildModule(&sequentialContext, functionCount);
+    VMIR::PassPipeline sequentialPipeline{&sequentialContext, 2, 1};
+    ASSERT_TRUE(sequentialPipeline.Run());
+
+    VMIR::IRContext parallelContext{};
+    BuildModule(&parallelContext, functionCount);
+    VMIR::ThreadPool pool{4};
+    VMIR::PassPipeline parallelPipeline{&parallelContext, 2, 1};
+    ASSERT_TRUE(parallelPipeline.Run(&pool));
+
+    const std::string expected = DescribeModule(&sequentialContext);
+    EXPECT_EQ(DescribeModule(&parallelContext), expected);
+
+    // Small callees are inlined, calls to the previous big function stay
+    for (auto* func : parallelContext.GetFunctions()) {
+        if (func->GetName().starts_with("Compute_")) {
+            size_t callCount = 0;
+            for (auto* bb : func->GetBasicBlocks()) {
+                for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+                    callCount += inst->GetType() == VMIR::InstructionType::Call;
+                }
+            }
+            EXPECT_EQ(callCount, func->GetName() == "Compute_0" ? 0 : 1);
+        }
+    }
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
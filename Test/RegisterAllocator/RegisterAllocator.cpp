@@ -692,17 +692,17 @@ TEST(register_allocator, from_lecture_2) {
     ASSERT_TRUE(std::holds_alternative<VMIR::StackLocation>(v2->GetLocation()));
     EXPECT_EQ(std::get<VMIR::StackLocation>(v2->GetLocation()), VMIR::StackLocation(0));
 
-    ASSERT_TRUE(std::holds_alternative<VMIR::StackLocation>(v3->GetLocation()));
-    EXPECT_EQ(std::get<VMIR::StackLocation>(v3->GetLocation()), VMIR::StackLocation(1));
+    ASSERT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v3->GetLocation()));
+    EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v3->GetLocation()), VMIR::GPRegisterLocation(1));
 
     ASSERT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v4->GetLocation()));
-    EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v4->GetLocation()), VMIR::GPRegisterLocation(1));
+    EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v4->GetLocation()), VMIR::GPRegisterLocation(0));
 
     ASSERT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v5->GetLocation()));
-    EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v5->GetLocation()), VMIR::GPRegisterLocation(1));
+    EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v5->GetLocation()), VMIR::GPRegisterLocation(0));
 
     ASSERT_TRUE(std::holds_alternative<VMIR::StackLocation>(v6->GetLocation()));
-    EXPECT_EQ(std::get<VMIR::StackLocation>(v6->GetLocation()), VMIR::StackLocation(2));
+    EXPECT_EQ(std::get<VMIR::StackLocation>(v6->GetLocation()), VMIR::StackLocation(3));
 
     ASSERT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v7->GetLocation()));
     EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v7->GetLocation()), VMIR::GPRegisterLocation(0));
@@ -806,8 +806,8 @@ TEST(register_allocator, mixed_value_types) {
     livenessAnalyzer->PerformLivenessAnalysis();
     registerAllocator->PerformRegisterAllocation();
 
-    ASSERT_TRUE(std::holds_alternative<VMIR::StackLocation>(v2->GetLocation()));
-    EXPECT_EQ(std::get<VMIR::StackLocation>(v2->GetLocation()), VMIR::StackLocation(0));
+    ASSERT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v2->GetLocation()));
+    EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v2->GetLocation()), VMIR::GPRegisterLocation(0));
 
     ASSERT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v3->GetLocation()));
     EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v3->GetLocation()), VMIR::GPRegisterLocation(1));
@@ -827,14 +827,14 @@ TEST(register_allocator, mixed_value_types) {
     ASSERT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v8->GetLocation()));
     EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v8->GetLocation()), VMIR::GPRegisterLocation(1));
 
-    ASSERT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v9->GetLocation()));
-    EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v9->GetLocation()), VMIR::GPRegisterLocation(0));
+    ASSERT_TRUE(std::holds_alternative<VMIR::StackLocation>(v9->GetLocation()));
+    EXPECT_EQ(std::get<VMIR::StackLocation>(v9->GetLocation()), VMIR::StackLocation(0));
 
     ASSERT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v10->GetLocation()));
     EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v10->GetLocation()), VMIR::GPRegisterLocation(0));
 
     ASSERT_TRUE(std::holds_alternative<VMIR::StackLocation>(v11->GetLocation()));
-    EXPECT_EQ(std::get<VMIR::StackLocation>(v11->GetLocation()), VMIR::StackLocation(1));
+    EXPECT_EQ(std::get<VMIR::StackLocation>(v11->GetLocation()), VMIR::StackLocation(2));
 
     ASSERT_TRUE(std::holds_alternative<VMIR::FPRegisterLocation>(v12->GetLocation()));
     EXPECT_EQ(std::get<VMIR::FPRegisterLocation>(v12->GetLocation()), VMIR::FPRegisterLocation(0));
@@ -850,6 +850,421 @@ TEST(register_allocator, mixed_value_types) {
 
 
 
+TEST(register_allocator, splits_intervals) {
+    /*
+        Linear order:
+            0:
+                                                                live: 0
+                v0 = Add ui64 0, 1                              live: 2,      lin: 0
+                v1 = Add ui64 v0, 2                             live: 4,      lin: 1
+                v2 = Add ui64 v1, 3                             live: 6,      lin: 2
+                v3 = Mul ui64 v1, v2                            live: 8,      lin: 3
+                v4 = Add ui64 v3, v0                            live: 10,     lin: 4
+                Ret                                             live: 12,     lin: 5
+                                                                live: 14
+    */
+
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Function* Func = IrBuilder->CreateFunction("Func");
+    VMIR::BasicBlock* BB_0 = IrBuilder->CreateBasicBlock(Func, "0");
+    Func->SetEntryBasicBlock(BB_0);
+
+    VMIR::Value* zero  = IrBuilder->CreateValue(0UL);
+    VMIR::Value* one   = IrBuilder->CreateValue(1UL);
+    VMIR::Value* two   = IrBuilder->CreateValue(2UL);
+    VMIR::Value* three = IrBuilder->CreateValue(3UL);
+
+    VMIR::Value* v0 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v1 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v2 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v3 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v4 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+
+    IrBuilder->CreateAdd(BB_0, zero, one, v0);
+    VMIR::Instruction* inst1 = IrBuilder->CreateAdd(BB_0, v0, two, v1);
+    IrBuilder->CreateAdd(BB_0, v1, three, v2);
+    IrBuilder->CreateMul(BB_0, v1, v2, v3);
+    VMIR::Instruction* inst4 = IrBuilder->CreateAdd(BB_0, v3, v0, v4);
+    IrBuilder->CreateRet(BB_0);
+
+    VMIR::ControlFlowGraph* cfg = IrBuilder->CreateControlFlowGraph(Func);
+    VMIR::LivenessAnalyzer* livenessAnalyzer = IrBuilder->CreateLivenessAnalyzer(cfg);
+    VMIR::RegisterAllocator* registerAllocator = IrBuilder->CreateRegisterAllocator(cfg, 2, 2);
+
+    livenessAnalyzer->PerformLivenessAnalysis();
+    registerAllocator->PerformRegisterAllocation();
+
+    // v0 gives its register to v2 after its first use and takes a register back right before the second one
+    ASSERT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v0->GetLocation()));
+    EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v0->GetLocation()), VMIR::GPRegisterLocation(0));
+    EXPECT_EQ(v0->GetLocationAt(5), VMIR::Location(VMIR::StackLocation(0)));
+    EXPECT_EQ(v0->GetLocationAt(9), VMIR::Location(VMIR::GPRegisterLocation(1)));
+    ASSERT_EQ(v0->GetLocationSplits().size(), 2);
+
+    ASSERT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v2->GetLocation()));
+    EXPECT_EQ(std::get<VMIR::GPRegisterLocation>(v2->GetLocation()), VMIR::GPRegisterLocation(0));
+    EXPECT_TRUE(v2->GetLocationSplits().empty());
+
+    // Slot is written right after the definition and read before the second use
+    const auto& stores = registerAllocator->GetMovesBefore(inst1);
+    ASSERT_EQ(stores.size(), 1);
+    EXPECT_EQ(stores[0].value, v0);
+    EXPECT_EQ(stores[0].to, VMIR::Location(VMIR::StackLocation(0)));
+
+    const auto& loads = registerAllocator->GetMovesBefore(inst4);
+    ASSERT_EQ(loads.size(), 1);
+    EXPECT_EQ(loads[0].value, v0);
+    EXPECT_EQ(loads[0].from, VMIR::Location(VMIR::StackLocation(0)));
+    EXPECT_EQ(loads[0].to, VMIR::Location(VMIR::GPRegisterLocation(1)));
+
+    const auto& statistics = registerAllocator->GetStatistics();
+    EXPECT_EQ(statistics.splits, 2);
+    EXPECT_EQ(statistics.stackStores, 1);
+    EXPECT_EQ(statistics.stackLoads, 1);
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(register_allocator, unreachable_predecessor) {
+    /*
+        Linear order:
+            Entry:
+                                                                live: 0
+                v0 = Add ui64 0, 1                              live: 2,      lin: 0
+                Jump #Exit                                      live: 4,      lin: 1
+                                                                live: 6
+            Exit:
+                                                                live: 6
+                v1 = Add ui64 v0, 2                             live: 8,      lin: 2
+                Ret ui64 v1                                     live: 10,     lin: 3
+                                                                live: 12
+
+        Dead is not reachable from Entry, but jumps to it
+            Dead:
+                v2 = Add ui64 0, 3
+                Jump #Entry
+    */
+
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Function* Func = IrBuilder->CreateFunction(VMIR::ValueType::Uint64, "Func");
+    VMIR::BasicBlock* EntryBB = IrBuilder->CreateBasicBlock(Func, "Entry");
+    VMIR::BasicBlock* ExitBB  = IrBuilder->CreateBasicBlock(Func, "Exit");
+    VMIR::BasicBlock* DeadBB  = IrBuilder->CreateBasicBlock(Func, "Dead");
+    Func->SetEntryBasicBlock(EntryBB);
+
+    VMIR::Value* zero  = IrBuilder->CreateValue(0UL);
+    VMIR::Value* one   = IrBuilder->CreateValue(1UL);
+    VMIR::Value* two   = IrBuilder->CreateValue(2UL);
+    VMIR::Value* three = IrBuilder->CreateValue(3UL);
+
+    VMIR::Value* v0 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v1 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v2 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+
+    IrBuilder->CreateAdd(EntryBB, zero, one, v0);
+    IrBuilder->CreateJump(EntryBB, ExitBB);
+
+    IrBuilder->CreateAdd(ExitBB, v0, two, v1);
+    IrBuilder->CreateRet(ExitBB, v1);
+
+    IrBuilder->CreateAdd(DeadBB, zero, three, v2);
+    IrBuilder->CreateJump(DeadBB, EntryBB);
+
+    VMIR::ControlFlowGraph* cfg = IrBuilder->CreateControlFlowGraph(Func);
+    VMIR::LivenessAnalyzer* livenessAnalyzer = IrBuilder->CreateLivenessAnalyzer(cfg);
+    VMIR::RegisterAllocator* registerAllocator = IrBuilder->CreateRegisterAllocator(cfg, 2, 2);
+
+    ASSERT_TRUE(livenessAnalyzer->PerformLivenessAnalysis());
+    ASSERT_TRUE(registerAllocator->PerformRegisterAllocation());
+
+    EXPECT_TRUE(livenessAnalyzer->IsInLinearOrder(EntryBB));
+    EXPECT_TRUE(livenessAnalyzer->IsInLinearOrder(ExitBB));
+    EXPECT_FALSE(livenessAnalyzer->IsInLinearOrder(DeadBB));
+
+    // Edge from the unreachable block has no live range, so nothing is resolved on it
+    EXPECT_TRUE(registerAllocator->GetEdgeMoves(DeadBB, EntryBB).empty());
+    EXPECT_TRUE(registerAllocator->GetEdgeMoves(EntryBB, ExitBB).empty());
+
+    EXPECT_EQ(v0->GetLocation(), VMIR::Location(VMIR::GPRegisterLocation(0)));
+    EXPECT_EQ(v1->GetLocation(), VMIR::Location(VMIR::GPRegisterLocation(0)));
+
+    const auto& statistics = registerAllocator->GetStatistics();
+    EXPECT_EQ(statistics.stackStores, 0);
+    EXPECT_EQ(statistics.stackLoads, 0);
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(register_allocator, graph_coloring_coalesces_copies) {
+    /*
+        Linear order:
+            Entry:
+                                                                live: 0
+                v0 = Add ui64 0, 1                              live: 2,      lin: 0
+                Jump #Header                                    live: 4,      lin: 1
+                                                                live: 6
+            Header:
+                                                                live: 6
+                v1 = Phi ui64 v0, v3                            live: 6,      lin: 2
+                Bgt ui64 v1, 100 ? #Exit : #Body                live: 8,      lin: 3
+                                                                live: 10
+            Body:
+                                                                live: 10
+                v2 = Mv ui64 v1                                 live: 12,     lin: 4
+                v3 = Add ui64 v2, 1                             live: 14,     lin: 5
+                Jump #Header                                    live: 16,     lin: 6
+                                                                live: 18
+            Exit:
+                                                                live: 18
+                Ret ui64 v1                                     live: 20,     lin: 7
+                                                                live: 22
+    */
+
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Function* Func = IrBuilder->CreateFunction(VMIR::ValueType::Uint64, "Func");
+    Func->SetRegisterAllocationMode(VMIR::RegisterAllocationMode::GraphColoring);
+
+    VMIR::BasicBlock* EntryBB   = IrBuilder->CreateBasicBlock(Func, "Entry");
+    VMIR::BasicBlock* HeaderBB  = IrBuilder->CreateBasicBlock(Func, "Header");
+    VMIR::BasicBlock* BodyBB    = IrBuilder->CreateBasicBlock(Func, "Body");
+    VMIR::BasicBlock* ExitBB    = IrBuilder->CreateBasicBlock(Func, "Exit");
+
+    Func->SetEntryBasicBlock(EntryBB);
+
+    VMIR::Value* zero    = IrBuilder->CreateValue(0UL);
+    VMIR::Value* one     = IrBuilder->CreateValue(1UL);
+    VMIR::Value* hundred = IrBuilder->CreateValue(100UL);
+
+    VMIR::Value* v0 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v1 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v2 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v3 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+
+    IrBuilder->CreateAdd(EntryBB, zero, one, v0);
+    IrBuilder->CreateJump(EntryBB, HeaderBB);
+
+    IrBuilder->CreatePhi(HeaderBB, {v0, v3}, v1);
+    IrBuilder->CreateBgt(HeaderBB, v1, hundred, ExitBB, BodyBB);
+
+    IrBuilder->CreateMv(BodyBB, v1, v2);
+    IrBuilder->CreateAdd(BodyBB, v2, one, v3);
+    IrBuilder->CreateJump(BodyBB, HeaderBB);
+
+    IrBuilder->CreateRet(ExitBB, v1);
+
+    VMIR::ControlFlowGraph* cfg = IrBuilder->CreateControlFlowGraph(Func);
+    VMIR::LivenessAnalyzer* livenessAnalyzer = IrBuilder->CreateLivenessAnalyzer(cfg);
+    VMIR::RegisterAllocator* registerAllocator = IrBuilder->CreateRegisterAllocator(cfg, 1, 1);
+
+    livenessAnalyzer->PerformLivenessAnalysis();
+    ASSERT_TRUE(registerAllocator->PerformRegisterAllocation());
+
+    // None of the values interfere, so both phi inputs and the copy share one register
+    for (VMIR::Value* value : {v0, v1, v2, v3}) {
+        EXPECT_EQ(value->GetLocation(), VMIR::Location(VMIR::GPRegisterLocation(0)));
+        EXPECT_TRUE(value->GetLocationSplits().empty());
+    }
+
+    const auto& statistics = registerAllocator->GetStatistics();
+    EXPECT_EQ(statistics.coalescedMoves, 3);
+    EXPECT_EQ(statistics.phiCopies, 0);
+    EXPECT_EQ(statistics.moves, 0);
+    EXPECT_EQ(statistics.stackStores, 0);
+    EXPECT_EQ(statistics.stackLoads, 0);
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(register_allocator, graph_coloring_spills_outside_loops) {
+    /*
+        Linear order:
+            Entry:
+                                                                live: 0
+                v0 = Add ui64 0, 1                              live: 2,      lin: 0
+                v1 = Add ui64 0, 2                              live: 4,      lin: 1
+                v2 = Add ui64 0, 3                              live: 6,      lin: 2
+                v3 = Add ui64 0, 0                              live: 8,      lin: 3
+                Jump #Header                                    live: 10,     lin: 4
+                                                                live: 12
+            Header:
+                                                                live: 12
+                v4 = Phi ui64 v3, v5                            live: 12,     lin: 5
+                Bgt ui64 v4, 100 ? #Exit : #Body                live: 14,     lin: 6
+                                                                live: 16
+            Body:
+                                                                live: 16
+                v5 = Add ui64 v4, v2                            live: 18,     lin: 7
+                Jump #Header                                    live: 20,     lin: 8
+                                                                live: 22
+            Exit:
+                                                                live: 22
+                v6 = Add ui64 v0, v1                            live: 24,     lin: 9
+                v7 = Add ui64 v6, v4                            live: 26,     lin: 10
+                Ret ui64 v7                                     live: 28,     lin: 11
+                                                                live: 30
+    */
+
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Function* Func = IrBuilder->CreateFunction(VMIR::ValueType::Uint64, "Func");
+    Func->SetRegisterAllocationMode(VMIR::RegisterAllocationMode::GraphColoring);
+
+    VMIR::BasicBlock* EntryBB   = IrBuilder->CreateBasicBlock(Func, "Entry");
+    VMIR::BasicBlock* HeaderBB  = IrBuilder->CreateBasicBlock(Func, "Header");
+    VMIR::BasicBlock* BodyBB    = IrBuilder->CreateBasicBlock(Func, "Body");
+    VMIR::BasicBlock* ExitBB    = IrBuilder->CreateBasicBlock(Func, "Exit");
+
+    Func->SetEntryBasicBlock(EntryBB);
+
+    VMIR::Value* zero    = IrBuilder->CreateValue(0UL);
+    VMIR::Value* one     = IrBuilder->CreateValue(1UL);
+    VMIR::Value* two     = IrBuilder->CreateValue(2UL);
+    VMIR::Value* three   = IrBuilder->CreateValue(3UL);
+    VMIR::Value* hundred = IrBuilder->CreateValue(100UL);
+
+    VMIR::Value* v0 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v1 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v2 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v3 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v4 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v5 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v6 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v7 = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+
+    IrBuilder->CreateAdd(EntryBB, zero, one, v0);
+    IrBuilder->CreateAdd(EntryBB, zero, two, v1);
+    IrBuilder->CreateAdd(EntryBB, zero, three, v2);
+    IrBuilder->CreateAdd(EntryBB, zero, zero, v3);
+    IrBuilder->CreateJump(EntryBB, HeaderBB);
+
+    IrBuilder->CreatePhi(HeaderBB, {v3, v5}, v4);
+    IrBuilder->CreateBgt(HeaderBB, v4, hundred, ExitBB, BodyBB);
+
+    IrBuilder->CreateAdd(BodyBB, v4, v2, v5);
+    IrBuilder->CreateJump(BodyBB, HeaderBB);
+
+    IrBuilder->CreateAdd(ExitBB, v0, v1, v6);
+    IrBuilder->CreateAdd(ExitBB, v6, v4, v7);
+    IrBuilder->CreateRet(ExitBB, v7);
+
+    VMIR::ControlFlowGraph* cfg = IrBuilder->CreateControlFlowGraph(Func);
+    VMIR::LivenessAnalyzer* livenessAnalyzer = IrBuilder->CreateLivenessAnalyzer(cfg);
+    VMIR::RegisterAllocator* registerAllocator = IrBuilder->CreateRegisterAllocator(cfg, 2, 1);
+
+    livenessAnalyzer->PerformLivenessAnalysis();
+    ASSERT_TRUE(registerAllocator->PerformRegisterAllocation());
+
+    // Four values are live through the loop. The ones used only outside of it go to the stack
+    EXPECT_TRUE(std::holds_alternative<VMIR::StackLocation>(v0->GetLocation()));
+    EXPECT_TRUE(std::holds_alternative<VMIR::StackLocation>(v1->GetLocation()));
+    EXPECT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v2->GetLocation()));
+    EXPECT_TRUE(std::holds_alternative<VMIR::GPRegisterLocation>(v4->GetLocation()));
+
+    // Loop counter and its next value are coalesced
+    EXPECT_EQ(v4->GetLocation(), v5->GetLocation());
+    EXPECT_EQ(v4->GetLocation(), v3->GetLocation());
+
+    const auto& statistics = registerAllocator->GetStatistics();
+    EXPECT_EQ(statistics.stackStores, 2);
+    EXPECT_EQ(statistics.stackLoads, 2);
+    EXPECT_DOUBLE_EQ(statistics.weightedStackLoads, 2.0);
+
+    IrBuilder->Cleanup();
+}
+
+
+TEST(register_allocator, graph_coloring_rewrites_spilled_loop_counters) {
+    /*
+        16 loops nested into each other, the counters of the outer loops are live through the inner ones:
+            Entry:
+                v0 = Alloc ui64
+                Jump #Header_0
+            Header_l:
+                c_l = Phi ui64 0, n_l
+                NullCheck ptr v0
+                x_l = Load ui64 v0
+                y_l = Add ui64 x_l, c_l
+                Store ui64 v0, y_l
+                Jump #Header_l+1                    (#Latch_15 from the innermost header)
+            Latch_l:
+                n_l = Add ui64 c_l, 1
+                Blt ui64 n_l, a0 ? #Header_l : #Latch_l-1       (#Exit from Latch_0)
+            Exit:
+                r = Load ui64 v0
+                Ret ui64 r
+    */
+    constexpr size_t kDepth = 16;
+
+    VMIR::IRBuilder* IrBuilder = VMIR::IRBuilder::GetInstance();
+
+    VMIR::Function* Func = IrBuilder->CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "LoopNest");
+    VMIR::BasicBlock* EntryBB = IrBuilder->CreateBasicBlock(Func, "Entry");
+    Func->SetEntryBasicBlock(EntryBB);
+
+    VMIR::Value* zero = IrBuilder->CreateValue(0UL);
+    VMIR::Value* one  = IrBuilder->CreateValue(1UL);
+    VMIR::Value* ptr  = IrBuilder->CreateValue(VMIR::ValueType::Pointer);
+    IrBuilder->CreateAlloc(EntryBB, ptr, VMIR::ValueType::Uint64);
+
+    std::vector<VMIR::BasicBlock*> headers(kDepth);
+    std::vector<VMIR::BasicBlock*> latches(kDepth);
+    std::vector<VMIR::Value*> counters(kDepth);
+    std::vector<VMIR::Value*> nexts(kDepth);
+    for (size_t l = 0; l < kDepth; ++l) {
+        headers[l] = IrBuilder->CreateBasicBlock(Func, "Header_" + std::to_string(l));
+        counters[l] = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+        nexts[l] = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    }
+    for (size_t l = kDepth; l-- > 0;) {
+        latches[l] = IrBuilder->CreateBasicBlock(Func, "Latch_" + std::to_string(l));
+    }
+    VMIR::BasicBlock* ExitBB = IrBuilder->CreateBasicBlock(Func, "Exit");
+
+    IrBuilder->CreateJump(EntryBB, headers[0]);
+    for (size_t l = 0; l < kDepth; ++l) {
+        VMIR::Value* loaded = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+        VMIR::Value* stored = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+        IrBuilder->CreatePhi(headers[l], {zero, nexts[l]}, counters[l]);
+        IrBuilder->CreateNullCheck(headers[l], ptr);
+        IrBuilder->CreateLoad(headers[l], ptr, loaded);
+        IrBuilder->CreateAdd(headers[l], loaded, counters[l], stored);
+        IrBuilder->CreateStore(headers[l], ptr, stored);
+        IrBuilder->CreateJump(headers[l], l + 1 < kDepth ? headers[l + 1] : latches[l]);
+    }
+    for (size_t l = kDepth; l-- > 0;) {
+        IrBuilder->CreateAdd(latches[l], counters[l], one, nexts[l]);
+        IrBuilder->CreateBlt(latches[l], nexts[l], Func->GetArg(0), headers[l], l > 0 ? latches[l - 1] : ExitBB);
+    }
+    VMIR::Value* result = IrBuilder->CreateValue(VMIR::ValueType::Uint64);
+    IrBuilder->CreateLoad(ExitBB, ptr, result);
+    IrBuilder->CreateRet(ExitBB, result);
+
+    VMIR::ControlFlowGraph* cfg = IrBuilder->CreateControlFlowGraph(Func);
+    VMIR::LivenessAnalyzer* livenessAnalyzer = IrBuilder->CreateLivenessAnalyzer(cfg);
+    ASSERT_TRUE(livenessAnalyzer->PerformLivenessAnalysis());
+
+    VMIR::RegisterAllocator* registerAllocator = IrBuilder->CreateRegisterAllocator(cfg, 8, 8);
+    ASSERT_TRUE(registerAllocator->PerformRegisterAllocation());
+    const auto linearScanStatistics = registerAllocator->GetStatistics();
+
+    Func->SetRegisterAllocationMode(VMIR::RegisterAllocationMode::GraphColoring);
+    ASSERT_TRUE(registerAllocator->PerformRegisterAllocation());
+    const auto& statistics = registerAllocator->GetStatistics();
+
+    // Spilled counters are loaded once per iteration of their latch and stored once in their header
+    EXPECT_GT(statistics.stackStores, 0);
+    EXPECT_LE(statistics.weightedStackLoads + statistics.weightedStackStores, linearScanStatistics.weightedStackLoads + linearScanStatistics.weightedStackStores);
+    EXPECT_LE(statistics.weightedStackLoads, linearScanStatistics.weightedStackLoads);
+
+    IrBuilder->Cleanup();
+}
+
 
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include <IRBuilder.h>
+#include <PassManager.h>
+#include <ConstantFoldingPass.h>
+#include <PeepholesPass.h>
+#include <Trace.h>
+
+#include <sstream>
+
+
+/*
+    function ui64 #Loop(ui64 v0) {
+    Loop_BB_1:
+        v1 = Add ui64 1, 2
+        Jump Loop_BB_2
+    Loop_BB_2:
+        v2 = Phi ui64 v1, v3
+        v3 = Add ui64 v2, 0
+        Bne v3, v0, Loop_BB_2, Loop_BB_3
+    Loop_BB_3:
+        Ret v3
+    }
+*/
+static VMIR::Function* CreateLoopFunction(VMIR::IRContext& IrContext) {
+    VMIR::Function* Loop = IrContext.CreateFunction(VMIR::ValueType::Uint64, {VMIR::ValueType::Uint64}, "Loop");
+    VMIR::BasicBlock* Loop_BB_1 = IrContext.CreateBasicBlock(Loop, "Loop_BB_1");
+    VMIR::BasicBlock* Loop_BB_2 = IrContext.CreateBasicBlock(Loop, "Loop_BB_2");
+    VMIR::BasicBlock* Loop_BB_3 = IrContext.CreateBasicBlock(Loop, "Loop_BB_3");
+    Loop->SetEntryBasicBlock(Loop_BB_1);
+
+    VMIR::Value* v1 = IrContext.CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v2 = IrContext.CreateValue(VMIR::ValueType::Uint64);
+    VMIR::Value* v3 = IrContext.CreateValue(VMIR::ValueType::Uint64);
+
+    IrContext.CreateAdd(Loop_BB_1, IrContext.CreateValue(uint64_t(1)), IrContext.CreateValue(uint64_t(2)), v1);
+    IrContext.CreateJump(Loop_BB_1, Loop_BB_2);
+    IrContext.CreatePhi(Loop_BB_2, {v1, v3}, v2);
+    IrContext.CreateAdd(Loop_BB_2, v2, IrContext.CreateValue(uint64_t(0)), v3);
+    IrContext.CreateBne(Loop_BB_2, v3, Loop->GetArg(0), Loop_BB_2, Loop_BB_3);
+    IrContext.CreateRet(Loop_BB_3, v3);
+    return Loop;
+}
+
+static const VMIR::TraceEvent* FindEvent(const std::vector<VMIR::TraceEvent>& events, const std::string& name) {
+    auto it = std::find_if(events.begin(), events.end(), [&name](const auto& event) { return event.name == name; });
+    return it == events.end() ? nullptr : &*it;
+}
+
+static int64_t GetArg(const VMIR::TraceEvent* event, const std::string& key) {
+    for (const auto& [argKey, value] : event->args) {
+        if (argKey == key) {
+            return value;
+        }
+    }
+    return -1;
+}
+
+
+TEST(trace, passes_and_analyses_are_recorded) {
+    VMIR::IRContext IrContext{};
+    VMIR::Function* Loop = CreateLoopFunction(IrContext);
+
+    VMIR::TraceRecorder recorder{};
+    IrContext.SetTraceRecorder(&recorder);
+
+    VMIR::PassManager passManager{};
+    passManager.AddPass<VMIR::ConstantFoldingPass>();
+    passManager.AddPass<VMIR::PeepholesPass>();
+    passManager.Run(Loop);
+
+    VMIR::ControlFlowGraph* cfg = IrContext.GetOrCreateControlFlowGraph(Loop);
+    VMIR::RegisterAllocator* registerAllocator = IrContext.CreateRegisterAllocator(cfg, 1, 1);
+    ASSERT_TRUE(registerAllocator->PerformRegisterAllocation());
+
+    const auto events = recorder.GetEvents();
+
+    const VMIR::TraceEvent* folding = FindEvent(events, "Constant Folding Pass");
+    ASSERT_NE(folding, nullptr);
+    EXPECT_EQ(folding->category, "pass");
+    EXPECT_EQ(folding->function, "Loop");
+    EXPECT_EQ(GetArg(folding, "blocks before"), 3);
+    EXPECT_EQ(GetArg(folding, "instructions before"), GetArg(folding, "instructions after"));
+    EXPECT_EQ(GetArg(folding, "instructions folded"), 1);
+
+    const VMIR::TraceEvent* peepholes = FindEvent(events, "Peepholes Pass");
+    ASSERT_NE(peepholes, nullptr);
+    EXPECT_EQ(GetArg(peepholes, "peepholes applied"), 1);
+
+    const VMIR::TraceEvent* loopTree = FindEvent(events, "BuildLoopTree");
+    ASSERT_NE(loopTree, nullptr);
+    EXPECT_EQ(loopTree->category, "analysis");
+    EXPECT_EQ(GetArg(loopTree, "loops"), 1);
+
+    EXPECT_NE(FindEvent(events, "BuildDominatorTree"), nullptr);
+    EXPECT_NE(FindEvent(events, "PerformLivenessAnalysis"), nullptr);
+
+    const VMIR::TraceEvent* allocation = FindEvent(events, "PerformRegisterAllocation");
+    ASSERT_NE(allocation, nullptr);
+    EXPECT_EQ(GetArg(allocation, "values"), 3);
+
+    int64_t spilled = 0;
+    for (auto* bb : Loop->GetBasicBlocks()) {
+        for (auto* inst = bb->Front(); inst != nullptr; inst = inst->GetNext()) {
+            if (inst->GetOutput() != nullptr && std::holds_alternative<VMIR::StackLocation>(inst->GetOutput()->GetLocation())) {
+                ++spilled;
+            }
+        }
+    }
+    EXPECT_EQ(GetArg(allocation, "values spilled"), spilled);
+
+    std::ostringstream json{};
+    recorder.WriteChromeTrace(json);
+    EXPECT_EQ(json.str().rfind("{\"traceEvents\":[", 0), 0);
+    EXPECT_NE(json.str().find("\"name\":\"Peepholes Pass\",\"cat\":\"pass\",\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.str().find("\"peepholes applied\":1"), std::string::npos);
+
+    std::ostringstream summary{};
+    recorder.PrintSummary(summary);
+    EXPECT_NE(summary.str().find("Constant Folding Pass: "), std::string::npos);
+
+    recorder.Clear();
+    EXPECT_TRUE(recorder.GetEvents().empty());
+}
+
+
+TEST(trace, nothing_is_recorded_when_disabled) {
+    VMIR::IRContext IrContext{};
+    VMIR::Function* Loop = CreateLoopFunction(IrContext);
+
+    VMIR::TraceRecorder recorder{};
+    IrContext.SetTraceRecorder(&recorder);
+    IrContext.SetTraceRecorder(nullptr);
+
+    VMIR::PassManager passManager{};
+    passManager.AddPass<VMIR::ConstantFoldingPass>();
+    passManager.Run(Loop);
+    ASSERT_TRUE(IrContext.CreateRegisterAllocator(IrContext.GetOrCreateControlFlowGraph(Loop), 2, 1)->PerformRegisterAllocation());
+
+    EXPECT_TRUE(recorder.GetEvents().empty());
+
+    VMIR::TraceScope scope{nullptr, "Disabled", "pass"};
+    EXPECT_FALSE(scope.IsEnabled());
+}
+
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}